@@ -56,6 +56,10 @@ extern int aspect_ratio_setting;
 extern bool aspect_ratio_dirty;
 extern bool is_monkey_hero;
 
+/* Set by retro_serialize while saving a state that will only ever be
+ * loaded back into this instance (see UsingSameInstanceSavestates). */
+extern bool same_instance_savestate;
+
 /* Output color format ("Color Format" core option).
  *
  * PSX_COLOR_FORMAT_24BIT is the historical path (8 bits per channel,
@@ -67,15 +71,26 @@ extern bool is_monkey_hero;
  * once the renderer is confirmed to be Vulkan AND the frontend has
  * accepted the HDR10 format.  Everything downstream must gate on
  * psx_hdr_active, never on psx_color_format alone, so the SW/GL paths
- * and HDR-incapable frontends fall back cleanly to 24-bit. */
+ * and HDR-incapable frontends fall back cleanly to 24-bit.
+ *
+ * PSX_COLOR_FORMAT_16BIT is the software renderer's counterpart: it
+ * asks for RGB565 output, which carries every bit of a 15-bit VRAM
+ * pixel at half the surface bandwidth of XRGB8888.  Again only a
+ * request - psx_sw_rgb565 says whether the frontend took RGB565 at
+ * load.  It does not change for the rest of the session, and
+ * everything that reads or writes the software surface must consult
+ * it: rows are then 2-byte pixels, 24-bit (MDEC) displays are
+ * truncated to 5/6/5 and FastMAD falls back to BOB_OFFSET. */
 enum psx_color_format_e
 {
    PSX_COLOR_FORMAT_24BIT = 0,
-   PSX_COLOR_FORMAT_30BIT_HDR
+   PSX_COLOR_FORMAT_30BIT_HDR,
+   PSX_COLOR_FORMAT_16BIT
 };
 
 extern int   psx_color_format;         /* enum psx_color_format_e; core option */
 extern bool  psx_hdr_active;           /* true only when HDR10 is really engaged */
+extern bool  psx_sw_rgb565;            /* SW surface holds RGB565 pixels this session */
 extern float psx_hdr_paper_white_nits;
 extern float psx_hdr_max_nits;         /* display peak, GET_HDR_MAX_NITS, 1000 fallback */ /* frontend SDR white, default 200        */
 extern int   psx_hdr_expand_gamut;     /* frontend "Colour Boost" rotation        */
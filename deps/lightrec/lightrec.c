@@ -49,6 +49,16 @@ bool lightrec_store_hits_code(struct lightrec_state *state, u32 addr)
 	return state->code_walk_map[w >> 5] & BIT(w & 0x1f);
 }
 
+bool lightrec_ram_page_has_code(struct lightrec_state *state, u32 addr)
+{
+	u32 kaddr = kunseg(addr);
+
+	if (kaddr & ~0x7FFFFF)
+		return false;
+
+	return state->nb_blocks_in_page[(kaddr & 0x1FFFFF) >> CODE_PAGE_SHIFT] != 0;
+}
+
 static void lightrec_default_sb(struct lightrec_state *state, u32 opcode,
 				void *host, u32 addr, u32 data)
 {
@@ -893,6 +903,13 @@ static void lightrec_pgxp_cpu_cb(struct lightrec_state *state, u32 arg)
 			       addr);
 }
 
+static inline void lightrec_compile_timing(struct lightrec_state *state,
+					   bool begin)
+{
+	if (unlikely(state->ops.compile_timing))
+		(*state->ops.compile_timing)(state, begin);
+}
+
 static struct block * lightrec_get_block(struct lightrec_state *state, u32 pc)
 {
 	struct block *block = lightrec_find_block(state->block_cache, pc);
@@ -923,7 +940,9 @@ static struct block * lightrec_get_block(struct lightrec_state *state, u32 pc)
 	}
 
 	if (!block) {
+		lightrec_compile_timing(state, true);
 		block = lightrec_precompile_block(state, pc);
+		lightrec_compile_timing(state, false);
 		if (!block) {
 			pr_err("Unable to recompile block at "PC_FMT"\n", pc);
 			lightrec_set_exit_flags(state, LIGHTREC_EXIT_SEGFAULT);
@@ -969,7 +988,9 @@ static void * get_next_block_func(struct lightrec_state *state, u32 pc)
 			if (ENABLE_THREADED_COMPILER) {
 				lightrec_recompiler_add(state->rec, block);
 			} else {
+				lightrec_compile_timing(state, true);
 				err = lightrec_compile_block(state->cstate, block);
+				lightrec_compile_timing(state, false);
 				if (err) {
 					state->exit_flags = LIGHTREC_EXIT_NOMEM;
 					return NULL;
@@ -996,7 +1017,9 @@ static void * get_next_block_func(struct lightrec_state *state, u32 pc)
 				pc = lightrec_emulate_block(state, block, pc);
 
 			/* Then compile it using the profiled data */
+			lightrec_compile_timing(state, true);
 			err = lightrec_compile_block(state->cstate, block);
+			lightrec_compile_timing(state, false);
 			if (err) {
 				state->exit_flags = LIGHTREC_EXIT_NOMEM;
 				return NULL;
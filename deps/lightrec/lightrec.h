@@ -127,6 +127,12 @@ struct lightrec_ops {
 	 * tracking is enabled; leaving it NULL keeps the fast path. */
 	void (*pgxp_cpu)(struct lightrec_state *state, u32 instr,
 			 u32 rd, u32 rs, u32 rt, u32 hi, u32 lo, u32 addr);
+	/* When non-NULL, called with begin=1 before and begin=0 after each
+	 * block translation done on the calling thread (decoding and
+	 * optimising a new block, and compiling it when that is not left to
+	 * the compiler thread), so a host can profile translation apart
+	 * from execution. */
+	void (*compile_timing)(struct lightrec_state *state, _Bool begin);
 };
 
 struct lightrec_registers {
@@ -157,6 +163,12 @@ __api void lightrec_invalidate_all(struct lightrec_state *state);
  * DMA-only invalidation mode. */
 __api _Bool lightrec_store_hits_code(struct lightrec_state *state, u32 addr);
 
+/* True if a cached block overlaps the 4 KiB page of main RAM holding
+ * addr. Lets a caller about to replace RAM wholesale (a state load) find
+ * the pages whose contents matter to the code cache, and invalidate only
+ * the ones that really changed instead of calling lightrec_invalidate_all(). */
+__api _Bool lightrec_ram_page_has_code(struct lightrec_state *state, u32 addr);
+
 __api void lightrec_set_exit_flags(struct lightrec_state *state, u32 flags);
 __api u32 lightrec_exit_flags(struct lightrec_state *state);
 
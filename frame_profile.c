@@ -0,0 +1,229 @@
+/* See frame_profile.h for the design rationale.
+ *
+ * This file is only added to the build when HAVE_PROFILE is set in the
+ * make invocation; the guard below keeps it compilable (and empty) if it
+ * ends up in a build without -DHAVE_PROFILE. */
+
+#include "frame_profile.h"
+
+#ifdef HAVE_PROFILE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <libretro.h>
+#include <features/features_cpu.h>
+
+#include "osd_message.h"
+
+extern retro_log_printf_t log_cb;
+
+/* Deep enough for CPU > GPU > compile-style nesting several times over;
+ * pushes beyond it are counted and popped without touching the stack. */
+#define PROF_MAX_DEPTH   16
+#define PROF_WINDOW_MAX  600
+
+/* One row per section, plus the whole frame. */
+#define PROF_ROW_FRAME   PROF_COUNT
+#define PROF_ROWS        (PROF_COUNT + 1)
+
+static const char *const prof_names[PROF_ROWS] =
+{
+   "other", "cpu", "cpu compile", "gpu", "spu", "mdec", "cd read",
+   "scanout", "submit", "frame"
+};
+
+/* Short labels for the one-line OSD summary. */
+static const char *const prof_short[PROF_COUNT] =
+{
+   "Other", "CPU", "JIT", "GPU", "SPU", "MDEC", "CD", "Scan", "Submit"
+};
+
+bool prof_enabled = false;
+
+static unsigned prof_mode             = PROF_MODE_OFF;
+static unsigned prof_mode_pending     = PROF_MODE_OFF;
+static unsigned prof_interval         = 300;
+static unsigned prof_interval_pending = 300;
+
+static uint64_t prof_last;                 /* clock at the last switch */
+static uint64_t prof_frame_start;
+static unsigned prof_stack[PROF_MAX_DEPTH];
+static unsigned prof_depth;
+static unsigned prof_overflow;
+static uint64_t prof_acc[PROF_COUNT];      /* this frame, in ns        */
+
+/* ms per frame, per row, over the current window. */
+static float    prof_hist[PROF_ROWS][PROF_WINDOW_MAX];
+static unsigned prof_frames;
+
+static uint64_t prof_now(void)
+{
+#if defined(_WIN32)
+   static LARGE_INTEGER freq;
+   LARGE_INTEGER        count;
+   if (!freq.QuadPart)
+      QueryPerformanceFrequency(&freq);
+   QueryPerformanceCounter(&count);
+   return (uint64_t)((double)count.QuadPart * 1e9 / (double)freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+   return (uint64_t)cpu_features_get_time_usec() * 1000u;
+#endif
+}
+
+void prof_push_raw(unsigned section)
+{
+   uint64_t now;
+
+   if (prof_depth + 1 >= PROF_MAX_DEPTH)
+   {
+      prof_overflow++;
+      return;
+   }
+
+   /* Re-entering the running section changes nothing to charge. */
+   if (prof_stack[prof_depth] != section)
+   {
+      now                            = prof_now();
+      prof_acc[prof_stack[prof_depth]] += now - prof_last;
+      prof_last                      = now;
+   }
+   prof_stack[++prof_depth] = section;
+}
+
+void prof_pop_raw(void)
+{
+   uint64_t now;
+
+   if (prof_overflow)
+   {
+      prof_overflow--;
+      return;
+   }
+   if (!prof_depth)
+      return;
+
+   if (prof_stack[prof_depth - 1] != prof_stack[prof_depth])
+   {
+      now                            = prof_now();
+      prof_acc[prof_stack[prof_depth]] += now - prof_last;
+      prof_last                      = now;
+   }
+   prof_depth--;
+}
+
+void prof_configure(unsigned mode, unsigned interval)
+{
+   prof_mode_pending     = mode;
+   prof_interval_pending = interval < 1 ? 1
+      : interval > PROF_WINDOW_MAX ? PROF_WINDOW_MAX : interval;
+}
+
+void prof_frame_begin(void)
+{
+   if (prof_mode != prof_mode_pending || prof_interval != prof_interval_pending)
+   {
+      prof_mode     = prof_mode_pending;
+      prof_interval = prof_interval_pending;
+      prof_frames   = 0;
+   }
+   prof_enabled = (prof_mode != PROF_MODE_OFF);
+   if (!prof_enabled)
+      return;
+
+   memset(prof_acc, 0, sizeof(prof_acc));
+   prof_stack[0]    = PROF_OTHER;
+   prof_depth       = 0;
+   prof_overflow    = 0;
+   prof_frame_start = prof_last = prof_now();
+}
+
+static int prof_cmp_float(const void *a, const void *b)
+{
+   const float x = *(const float*)a, y = *(const float*)b;
+   return (x > y) - (x < y);
+}
+
+static void prof_report(void)
+{
+   static float sorted[PROF_WINDOW_MAX];
+   float        avg[PROF_ROWS], p99[PROF_ROWS];
+   const unsigned n = prof_frames;
+   const unsigned k = (n * 99 + 99) / 100 - 1;   /* ceil(0.99 n) - 1 */
+   unsigned     r, i;
+
+   if (prof_mode == PROF_MODE_LOG && log_cb)
+      log_cb(RETRO_LOG_INFO,
+            "[profile] last %u frames, ms per frame:      min      avg      p99\n", n);
+
+   for (r = 0; r < PROF_ROWS; r++)
+   {
+      double sum = 0.0;
+
+      memcpy(sorted, prof_hist[r], n * sizeof(float));
+      qsort(sorted, n, sizeof(float), prof_cmp_float);
+      for (i = 0; i < n; i++)
+         sum += sorted[i];
+      avg[r] = (float)(sum / n);
+      p99[r] = sorted[k];
+
+      if (prof_mode == PROF_MODE_LOG && log_cb)
+         log_cb(RETRO_LOG_INFO, "[profile]   %-28s %8.3f %8.3f %8.3f\n",
+               prof_names[r], sorted[0], avg[r], p99[r]);
+   }
+
+   if (prof_mode == PROF_MODE_OSD)
+   {
+      char     msg[256];
+      size_t   len;
+      unsigned s;
+
+      len = snprintf(msg, sizeof(msg), "Frame %.2f ms (p99 %.2f) |",
+            avg[PROF_ROW_FRAME], p99[PROF_ROW_FRAME]);
+      for (s = PROF_CPU; s < PROF_COUNT && len < sizeof(msg); s++)
+         len += snprintf(msg + len, sizeof(msg) - len, " %s %.2f",
+               prof_short[s], avg[s]);
+      if (len < sizeof(msg))
+         snprintf(msg + len, sizeof(msg) - len, " %s %.2f",
+               prof_short[PROF_OTHER], avg[PROF_OTHER]);
+
+      osd_message(1, RETRO_LOG_INFO,
+            RETRO_MESSAGE_TARGET_OSD, RETRO_MESSAGE_TYPE_STATUS, "%s", msg);
+   }
+}
+
+void prof_frame_end(void)
+{
+   uint64_t now;
+   unsigned s;
+
+   if (!prof_enabled)
+      return;
+
+   now                           = prof_now();
+   prof_acc[prof_stack[prof_depth]] += now - prof_last;
+
+   for (s = 0; s < PROF_COUNT; s++)
+      prof_hist[s][prof_frames] = prof_acc[s] / 1e6f;
+   prof_hist[PROF_ROW_FRAME][prof_frames] = (now - prof_frame_start) / 1e6f;
+
+   if (++prof_frames >= prof_interval)
+   {
+      prof_report();
+      prof_frames = 0;
+   }
+}
+
+#endif /* HAVE_PROFILE */
@@ -0,0 +1,96 @@
+/* Per-frame subsystem profiler.
+ *
+ * Splits the wall time of every retro_run into the subsystems the
+ * emulation spends it in, and every N frames reports min/avg/p99 per
+ * subsystem over those N frames, on screen or in the log. Selected with
+ * the "Profiling Overlay" core options.
+ *
+ * COMPILE-TIME GATED behind HAVE_PROFILE, like tt_trace:
+ *
+ *   - Default build (HAVE_PROFILE undefined): frame_profile.c is not
+ *     built, the core options are not offered, and every PROF_* site
+ *     below expands to nothing.
+ *
+ *   - Profiling build (HAVE_PROFILE=1 in the make invocation): each site
+ *     costs one load and branch on prof_enabled while the option is off.
+ *     While it is on, a site reads the clock when it changes which
+ *     subsystem is running.
+ *
+ * Sections nest and time is charged exclusively: PROF_PUSH charges the
+ * time since the last switch to the section on top of the stack and
+ * makes the new one current, PROF_POP charges it and returns to the
+ * section below. So GPU_Update called from inside CPU_Run counts as GPU
+ * and not CPU. Whatever runs outside every section (frontend callbacks,
+ * input, audio handoff, memory-card and auto-save work) is "other".
+ * Pushes and pops must pair up within one retro_run; prof_enabled only
+ * changes in prof_frame_begin.
+ *
+ * Emulation thread only. Work done on helper threads (the lightrec
+ * compiler thread, the CD read thread, deinterlacer workers) is not
+ * counted, except where the emulation thread waits on it.
+ */
+
+#ifndef BEETLE_PSX_FRAME_PROFILE_H
+#define BEETLE_PSX_FRAME_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+   PROF_OTHER = 0,
+   PROF_CPU,          /* CPU_Run: interpreter or lightrec-compiled code  */
+   PROF_CPU_COMPILE,  /* lightrec block translation on the emu thread    */
+   PROF_GPU,          /* GPU_Update and GP0 command processing / raster  */
+   PROF_SPU,          /* SPU_UpdateFromCDC                                */
+   PROF_MDEC,         /* MDEC_Run                                         */
+   PROF_CD,           /* CDC sector read, XA/CD-DA handling               */
+   PROF_SCANOUT,      /* deferred scanout, deinterlacing                  */
+   PROF_SUBMIT,       /* renderer backend frame submission                */
+   PROF_COUNT
+};
+
+enum
+{
+   PROF_MODE_OFF = 0,
+   PROF_MODE_LOG,
+   PROF_MODE_OSD
+};
+
+#ifdef HAVE_PROFILE
+
+#include <boolean.h>
+
+extern bool prof_enabled;
+
+void prof_push_raw(unsigned section);
+void prof_pop_raw(void);
+
+/* Takes effect at the next prof_frame_begin. interval is in frames. */
+void prof_configure(unsigned mode, unsigned interval);
+
+void prof_frame_begin(void);
+void prof_frame_end(void);
+
+#define PROF_PUSH(section) \
+   do { if (prof_enabled) prof_push_raw(section); } while (0)
+#define PROF_POP() \
+   do { if (prof_enabled) prof_pop_raw(); } while (0)
+#define PROF_FRAME_BEGIN()  prof_frame_begin()
+#define PROF_FRAME_END()    prof_frame_end()
+
+#else /* !HAVE_PROFILE */
+
+#define PROF_PUSH(section)  do { } while (0)
+#define PROF_POP()          do { } while (0)
+#define PROF_FRAME_BEGIN()  ((void)0)
+#define PROF_FRAME_END()    ((void)0)
+
+#endif /* HAVE_PROFILE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
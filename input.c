@@ -585,6 +585,20 @@ unsigned input_get_player_count(void)
    return players;
 }
 
+bool input_has_lightgun(void)
+{
+   unsigned i;
+
+   for (i = 0; i < players && i < MAX_CONTROLLERS; i++)
+   {
+      if (input_type[ i ] == RETRO_DEVICE_PS_GUNCON ||
+          input_type[ i ] == RETRO_DEVICE_PS_JUSTIFIER)
+         return true;
+   }
+
+   return false;
+}
+
 static void input_handle_lightgun_touchscreen( INPUT_DATA *p_input, int iplayer, retro_input_state_t input_state_cb )
 {
    int touch_count;
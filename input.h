@@ -33,6 +33,11 @@ extern void input_set_player_count( unsigned players );
 
 extern unsigned input_get_player_count(void);
 
+/* True when any active port holds a GunCon or Justifier.  Both
+ * sample and draw on the software surface through
+ * FrontIO_GPULineHook, so the surface must hold the whole frame. */
+extern bool input_has_lightgun(void);
+
 void input_update(bool supports_bitmasks, retro_input_state_t input_state_cb );
 
 enum
@@ -11,7 +11,9 @@
 #endif
 #include <libretro.h>
 #include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
 #include <streams/file_stream.h>
+#include <encodings/deflate.h>
 #include <vfs/vfs_hybrid.h>
 #include <string/stdstring.h>
 #include <lrc_hash.h>
@@ -22,6 +24,7 @@
 #include "libretro_options.h"
 #include "input.h"
 #include "osd_message.h"
+#include "frame_profile.h"
 
 retro_input_state_t dbg_input_state_cb = 0;
 
@@ -39,6 +42,8 @@ retro_input_state_t dbg_input_state_cb = 0;
 #endif
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #define ISHEXDEC ((codeLine[cursor]>='0') && (codeLine[cursor]<='9')) || ((codeLine[cursor]>='a') && (codeLine[cursor]<='f')) || ((codeLine[cursor]>='A') && (codeLine[cursor]<='F'))
 
 #ifdef HAVE_LIGHTREC
@@ -99,6 +104,7 @@ uint8_t startup_frame_count = 0;
 int aspect_ratio_setting = 0;
 bool aspect_ratio_dirty = false;
 bool is_monkey_hero = false;
+bool same_instance_savestate = false;
 
 /* libretro callback pointers, formerly defined in libretro_cbs.c. Declared in
  * libretro_cbs.h; assigned by retro_set_environment / retro_set_video_refresh
@@ -188,6 +194,7 @@ static int psx_skipbios;
 static int override_bios;
 
 bool psx_gte_overclock;
+bool psx_skip_idle_loops;
 enum dither_mode psx_gpu_dither_mode;
 
 /* Output color format state (see beetle_psx_globals.h). Defaults keep
@@ -196,6 +203,18 @@ enum dither_mode psx_gpu_dither_mode;
  * 10-bit end to end. */
 int   psx_color_format         = PSX_COLOR_FORMAT_24BIT;
 bool  psx_hdr_active           = false;
+/* RGB565 software output: set by retro_load_game when the frontend
+ * took RETRO_PIXEL_FORMAT_RGB565, and fixed for the session. */
+bool  psx_sw_rgb565            = false;
+/* Direct software output ("Direct Framebuffer Output", off by default
+ * since it gives up per-line VRAM reads): sw_direct_frame is set for a
+ * frame whose scanout is held back (GPU_DeferScanout) so it can be
+ * converted into the frontend's own framebuffer; sw_direct_supported
+ * drops once the frontend fails to hand out a usable one, until the
+ * pixel format changes or content is reloaded. */
+static bool     sw_direct_enabled        = false;
+static bool     sw_direct_supported      = true;
+static bool     sw_direct_frame          = false;
 /* Peak the display can reach. The gap above paper white is the whole headroom
  * for highlights, so guessing it wrong either wastes range or clips. 1000 is
  * the fallback for a frontend that does not answer: it is the HDR10 reference
@@ -286,17 +305,334 @@ enum
 };
 
 #include <lists/dir_list.h>
+#include <file/file_path.h>
+#ifdef _WIN32
+#include <encodings/utf.h>
+#endif
+
+/* Firmware identification cache.
+ *
+ * firmware_is_present() has to know the SHA1 of the BIOS it hands to the
+ * core, and when none of the expected file names is present
+ * search_firmware() hashes every BIOS-sized file in the system
+ * directory.  A frontend system directory can hold thousands of files
+ * and several dumps, so that costs from hundreds of milliseconds to
+ * seconds on every launch for an answer that never changes.
+ *
+ * The SHA1 of each file hashed is therefore remembered in a small text
+ * file in the save directory, one "<sha1> <size> <mtime> <path>" line
+ * per file, and reused as long as the file's size and modification time
+ * still match.  A file that is replaced in place therefore gets hashed
+ * again; everything else costs a stat() call.  A missing, stale or
+ * unreadable cache only means hashing as before. */
+
+#define FIRMWARE_CACHE_NAME    "beetle_psx_firmware.sha1"
+/* Only BIOS-sized files are ever hashed, so this is plenty; past it the
+ * oldest line is dropped. */
+#define FIRMWARE_CACHE_ENTRIES 4096
+
+struct firmware_cache_entry
+{
+   char    *path;
+   int64_t  size;
+   int64_t  mtime;
+   char     sha1[41];
+};
+
+static struct firmware_cache_entry *firmware_cache;
+static unsigned firmware_cache_count;
+static unsigned firmware_cache_capacity;
+static bool     firmware_cache_loaded;
+static bool     firmware_cache_dirty;
+
+static void firmware_cache_path(char *out, size_t size)
+{
+   snprintf(out, size, "%s%c%s", retro_save_directory, retro_slash,
+         FIRMWARE_CACHE_NAME);
+}
+
+/* Existence, type and size come from the VFS like every other file
+ * access of the core.  The VFS interface has no modification time, so
+ * that is asked of the OS directly, through the UTF-16 API on Windows
+ * so that non-ASCII paths work.  A path only the frontend's VFS can
+ * resolve fails here and is simply hashed every time. */
+static bool firmware_stat(const char *path, int64_t *size, int64_t *mtime)
+{
+   int flags = path_stat(path);
+
+   if (!(flags & RETRO_VFS_STAT_IS_VALID)
+         || (flags & (RETRO_VFS_STAT_IS_DIRECTORY
+               | RETRO_VFS_STAT_IS_CHARACTER_SPECIAL)))
+      return false;
+
+   if ((*size = path_get_size(path)) < 0)
+      return false;
+
+#ifdef _WIN32
+   {
+      struct _stat64 st;
+      wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+      bool     ok        = path_wide && _wstat64(path_wide, &st) == 0;
+
+      free(path_wide);
+      if (!ok)
+         return false;
+      *mtime = (int64_t)st.st_mtime;
+   }
+#else
+   {
+      struct stat st;
+
+      if (stat(path, &st) != 0)
+         return false;
+      *mtime = (int64_t)st.st_mtime;
+   }
+#endif
+   return true;
+}
+
+/* Whether path names a file inside dir rather than merely starting with
+ * the same characters, as "/system2/scph5501.bin" does for "/system". */
+static bool firmware_path_in_dir(const char *path, const char *dir)
+{
+   size_t len = strlen(dir);
+
+   if (!len || strncmp(path, dir, len))
+      return false;
+   if (dir[len - 1] == '/' || dir[len - 1] == '\\')
+      return true;
+   return path[len] == '/' || path[len] == '\\';
+}
+
+static void firmware_cache_store(const char *path, int64_t size,
+      int64_t mtime, const char *sha1)
+{
+   struct firmware_cache_entry *e = NULL;
+   unsigned i;
+
+   for (i = 0; i < firmware_cache_count; i++)
+   {
+      if (!strcmp(firmware_cache[i].path, path))
+      {
+         e = &firmware_cache[i];
+         break;
+      }
+   }
+
+   if (!e)
+   {
+      char *dup;
+
+      if (firmware_cache_count == FIRMWARE_CACHE_ENTRIES)
+      {
+         free(firmware_cache[0].path);
+         memmove(&firmware_cache[0], &firmware_cache[1],
+               (FIRMWARE_CACHE_ENTRIES - 1) * sizeof(firmware_cache[0]));
+         firmware_cache_count--;
+      }
+      else if (firmware_cache_count == firmware_cache_capacity)
+      {
+         unsigned new_capacity = firmware_cache_capacity
+            ? firmware_cache_capacity * 2 : 32;
+         struct firmware_cache_entry *grown =
+            (struct firmware_cache_entry*)realloc(firmware_cache,
+                  new_capacity * sizeof(*grown));
+
+         if (!grown)
+            return;
+         firmware_cache          = grown;
+         firmware_cache_capacity = new_capacity;
+      }
+
+      if (!(dup = strdup(path)))
+         return;
+
+      e       = &firmware_cache[firmware_cache_count++];
+      e->path = dup;
+   }
+
+   e->size  = size;
+   e->mtime = mtime;
+   strlcpy(e->sha1, sha1, sizeof(e->sha1));
+   firmware_cache_dirty = true;
+}
+
+static void firmware_cache_load(void)
+{
+   char   cache_path[4096 + 32];
+   char   line[4096 + 128];
+   RFILE *fp;
+
+   if (firmware_cache_loaded)
+      return;
+   firmware_cache_loaded = true;
+
+   firmware_cache_path(cache_path, sizeof(cache_path));
+   fp = filestream_open(cache_path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!fp)
+      return;
+
+   while (filestream_gets(fp, line, sizeof(line)))
+   {
+      char      sha1[41];
+      long long size, mtime;
+      int       path_start = 0;
+      size_t    len;
+
+      if (sscanf(line, "%40s %lld %lld %n", sha1, &size, &mtime,
+               &path_start) != 3 || !path_start || strlen(sha1) != 40)
+         continue;
+
+      len = strlen(line);
+      while (len > (size_t)path_start
+            && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+         line[--len] = '\0';
+
+      if (len > (size_t)path_start)
+         firmware_cache_store(line + path_start, size, mtime, sha1);
+   }
+
+   filestream_close(fp);
+   firmware_cache_dirty = false;
+}
+
+/* Written to <cache>.tmp and renamed over the cache, like the auto-save
+ * file, so that a crash or full disk mid-write leaves the previous
+ * cache rather than a truncated one. */
+static void firmware_cache_save(void)
+{
+   char     cache_path[4096 + 32];
+   char     tmp_path[4096 + 36];
+   RFILE   *fp;
+   unsigned i;
+   bool     ok;
+
+   if (!firmware_cache_dirty)
+      return;
+   firmware_cache_dirty = false;
+
+   firmware_cache_path(cache_path, sizeof(cache_path));
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+   fp = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!fp)
+   {
+      log_cb(RETRO_LOG_WARN, "Could not write firmware cache: %s\n",
+            tmp_path);
+      return;
+   }
+
+   /* Lines for files that have since been deleted are dropped here, so
+    * the file does not only ever grow. */
+   for (i = 0; i < firmware_cache_count; i++)
+   {
+      const struct firmware_cache_entry *e = &firmware_cache[i];
+      int64_t size, mtime;
+
+      if (firmware_stat(e->path, &size, &mtime))
+         filestream_printf(fp, "%s %lld %lld %s\n", e->sha1,
+               (long long)e->size, (long long)e->mtime, e->path);
+   }
+
+   ok = filestream_error(fp) == 0;
+   ok = (filestream_close(fp) == 0) && ok;
+
+   if (ok && filestream_rename(tmp_path, cache_path) != 0)
+   {
+      filestream_delete(cache_path);
+      ok = filestream_rename(tmp_path, cache_path) == 0;
+   }
+   if (!ok)
+   {
+      log_cb(RETRO_LOG_WARN, "Could not write firmware cache: %s\n",
+            cache_path);
+      filestream_delete(tmp_path);
+   }
+}
+
+static void firmware_cache_free(void)
+{
+   unsigned i;
+
+   for (i = 0; i < firmware_cache_count; i++)
+      free(firmware_cache[i].path);
+   free(firmware_cache);
+   firmware_cache          = NULL;
+   firmware_cache_count    = 0;
+   firmware_cache_capacity = 0;
+   firmware_cache_loaded   = false;
+   firmware_cache_dirty    = false;
+}
+
+/* SHA1 of the file at path, from the cache when its size and mtime
+ * still match, else by hashing it. */
+static bool firmware_sha1(const char *path, char *sha1)
+{
+   int64_t  size, mtime;
+   unsigned i;
+
+   sha1[0] = '\0';
+
+   if (!firmware_stat(path, &size, &mtime))
+      return sha1_calculate(path, sha1) == 0;
+
+   firmware_cache_load();
+
+   for (i = 0; i < firmware_cache_count; i++)
+   {
+      const struct firmware_cache_entry *e = &firmware_cache[i];
+
+      if (e->size == size && e->mtime == mtime && !strcmp(e->path, path))
+      {
+         memcpy(sha1, e->sha1, sizeof(e->sha1));
+         return true;
+      }
+   }
+
+   if (sha1_calculate(path, sha1) != 0)
+      return false;
+
+   firmware_cache_store(path, size, mtime, sha1);
+   return true;
+}
 
 static bool search_firmware(char *obtained_sha1, const char *bios_sha1)
 {
    int i, r;
-   RFILE *BIOSFile;
+   unsigned j;
 
    if (!bios_sha1)
       return false;
 
    log_cb(RETRO_LOG_INFO, "Searching for firmware checksum: %s\n", bios_sha1);
 
+   /* A dump identified on an earlier launch that is still in the system
+    * directory and unchanged needs neither the directory scan nor a
+    * hash. */
+   firmware_cache_load();
+
+   for (j = 0; j < firmware_cache_count; j++)
+   {
+      const struct firmware_cache_entry *e = &firmware_cache[j];
+      int64_t size, mtime;
+
+      if (strcmp(e->sha1, bios_sha1)
+            || !firmware_path_in_dir(e->path, retro_base_directory)
+            || !firmware_stat(e->path, &size, &mtime)
+            || size != e->size || mtime != e->mtime)
+         continue;
+
+      r = snprintf(bios_path, sizeof(bios_path), "%s", e->path);
+      if (r >= 4096)
+         continue;
+
+      memcpy(obtained_sha1, e->sha1, sizeof(e->sha1));
+      return true;
+   }
+
    /* Consider setting recursive flag */
    struct string_list *dir_list = dir_list_new(retro_base_directory, NULL, false, false, false, false);
 
@@ -305,6 +641,8 @@ static bool search_firmware(char *obtained_sha1, const char *bios_sha1)
 
    for (i = 0; i < (int)dir_list->size; i++)
    {
+      int64_t bios_size, mtime;
+
       r = snprintf(bios_path, sizeof(bios_path), "%s", dir_list->elems[i].data);
       if (r >= 4096)
       {
@@ -313,27 +651,28 @@ static bool search_firmware(char *obtained_sha1, const char *bios_sha1)
          break;
       }
 
-      BIOSFile = filestream_open(bios_path,
+      if (!firmware_stat(bios_path, &bios_size, &mtime))
+      {
+         RFILE *BIOSFile = filestream_open(bios_path,
                  RETRO_VFS_FILE_ACCESS_READ,
                  RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-      if (BIOSFile)
-      {
-         int64_t bios_size = filestream_get_size(BIOSFile);
+         if (!BIOSFile)
+            continue;
 
+         bios_size = filestream_get_size(BIOSFile);
          filestream_close(BIOSFile);
+      }
 
-         /* SHA1 is expensive, verify correct file size first.  Both the
-          * stock 512K geometry and the 1M SCPH-5903 part are candidates. */
-         if(bios_size == 512 * 1024 || bios_size == 1024 * 1024)
+      /* SHA1 is expensive, verify correct file size first.  Both the
+       * stock 512K geometry and the 1M SCPH-5903 part are candidates. */
+      if(bios_size == 512 * 1024 || bios_size == 1024 * 1024)
+      {
+         if (firmware_sha1(bios_path, obtained_sha1)
+               && strcmp(obtained_sha1, bios_sha1) == 0)
          {
-            sha1_calculate(bios_path, obtained_sha1);
-
-            if (strcmp(obtained_sha1, bios_sha1) == 0)
-            {
-               string_list_free(dir_list);
-               return true;
-            }
+            string_list_free(dir_list);
+            return true;
          }
       }
    }
@@ -342,7 +681,7 @@ static bool search_firmware(char *obtained_sha1, const char *bios_sha1)
    return false;
 }
 
-static bool firmware_is_present(unsigned region)
+static bool firmware_lookup(unsigned region)
 {
    /* C90 requires array sizes to be integer constant expressions; a
     * `static const size_t list_size = 16` is not one, so spell it
@@ -413,7 +752,7 @@ static bool firmware_is_present(unsigned region)
 
       if (firmware_found)
       {
-         sha1_calculate(bios_path, obtained_sha1);
+         firmware_sha1(bios_path, obtained_sha1);
          if (bios_sha1 && strcmp(obtained_sha1, bios_sha1))
          {
             log_cb(RETRO_LOG_WARN, "Override firmware found but has invalid SHA1: %s\n", bios_path);
@@ -518,7 +857,7 @@ static bool firmware_is_present(unsigned region)
       return false;
    }
 
-   sha1_calculate(bios_path, obtained_sha1);
+   firmware_sha1(bios_path, obtained_sha1);
    if (strcmp(obtained_sha1, bios_sha1))
    {
       log_cb(RETRO_LOG_WARN, "Firmware found but has invalid SHA1: %s\n", bios_path);
@@ -534,6 +873,15 @@ static bool firmware_is_present(unsigned region)
    return true;
 }
 
+static bool firmware_is_present(unsigned region)
+{
+   bool found = firmware_lookup(region);
+
+   firmware_cache_save();
+   firmware_cache_free();
+   return found;
+}
+
 static void extract_basename(char *buf, const char *path, size_t size)
 {
    const char *base = strrchr(path, '/');
@@ -612,6 +960,10 @@ static struct MDFN_PseudoRNG PSX_PRNG;
 
 bool setting_apply_analog_toggle  = false;
 bool setting_apply_analog_default = false;
+/* "Late Input Polling": poll the frontend at the game's first controller
+ * access of the frame rather than at the top of retro_run. */
+static bool setting_late_input_poll = false;
+static bool late_input_poll_pending = false;
 bool use_mednafen_memcard0_method = false;
 
 uint32_t PSX_GetRandU32(uint32_t mina, uint32_t maxa)
@@ -989,6 +1341,392 @@ static void mc_async_flush_and_stop(void)
 PS_CDC *PSX_CDC = NULL;
 FrontIO *PSX_FIO = NULL;
 
+/* ------------------------------------------------------------------------
+ * Periodic auto-save.
+ *
+ * With "Auto-Save Interval" set, the core snapshots itself every N seconds
+ * of wall time to <save dir>/<content>.autosave and, with "Resume From
+ * Auto-Save", loads that file back on the first frame after the content
+ * starts. The emulation thread only pays for MDFNSS_SaveSM into a buffer it
+ * reuses; compression and the file write happen on a writer thread, in the
+ * style of mc_async above.
+ *
+ * Buffers: three, reused for the life of the content. At any moment at most
+ * one is being compressed (busy) and at most one is waiting for the writer
+ * (pending), so the emu thread always finds a third to serialize into and
+ * never waits. A snapshot taken while another is still pending supersedes
+ * it (latest wins); the superseded buffer becomes the next free one.
+ *
+ * File: a 16-byte header (magic, format version, uncompressed size, all
+ * little-endian) followed by the state as a zlib stream, compressed with
+ * libretro-common's DEFLATE encoder; the zlib trailer's adler32 guards the
+ * payload. It is written to <path>.tmp and renamed over <path>, so a crash
+ * or power cut mid-write leaves the previous snapshot intact. Where rename
+ * cannot replace an existing file (Win32), the old file is deleted first;
+ * the window in which neither exists is one rename wide, and the .tmp
+ * survives it.
+ *
+ * The last snapshot is taken synchronously at CloseGame and drained with
+ * the rest before the writer thread is joined. If the thread cannot be
+ * created, snapshots are compressed and written inline.
+ * ---------------------------------------------------------------------- */
+#define AUTOSAVE_BUFS        3
+#define AUTOSAVE_HEADER_SIZE 16
+#define AUTOSAVE_VERSION     1
+#define AUTOSAVE_LEVEL       1   /* rdeflate level: fastest */
+
+static const char autosave_magic[8] = { 'B', 'P', 'S', 'X', 'A', 'U', 'T', 'O' };
+
+typedef struct
+{
+   uint8_t *data;
+   uint32_t size;
+   uint32_t cap;
+} autosave_buf;
+
+static unsigned     autosave_interval = 0;     /* seconds; 0 = off */
+static bool         autosave_resume   = true;
+
+static char         autosave_path[4096];
+static autosave_buf autosave_bufs[AUTOSAVE_BUFS];
+static int          autosave_pending  = -1;    /* buffer awaiting the writer  */
+static int          autosave_busy     = -1;    /* buffer the writer is on     */
+static retro_time_t autosave_due      = 0;     /* 0: rearm on the next frame  */
+static bool         autosave_resume_pending = false;
+static bool         autosave_ran      = false; /* content has run a frame     */
+
+static sthread_t   *autosave_thread   = NULL;
+static slock_t     *autosave_lock     = NULL;
+static scond_t     *autosave_work     = NULL;
+static bool         autosave_running  = false;
+static bool         autosave_quit     = false;
+
+/* Writer-thread scratch: the compressed file image, grown as needed. */
+static uint8_t     *autosave_out      = NULL;
+static size_t       autosave_out_cap  = 0;
+
+static void autosave_put_le32(uint8_t *p, uint32_t v)
+{
+   p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t autosave_get_le32(const uint8_t *p)
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Compress into autosave_out; returns the file size, 0 on failure. */
+static size_t autosave_compress(const uint8_t *raw, uint32_t size)
+{
+   size_t pos = AUTOSAVE_HEADER_SIZE;
+   void  *z   = rdeflate_new(AUTOSAVE_LEVEL, 15);
+
+   if (!z)
+      return 0;
+
+   rdeflate_set_in(z, raw, size);
+   rdeflate_finish(z);
+
+   for (;;)
+   {
+      size_t rd = 0, wr = 0;
+      int    ret;
+
+      if (autosave_out_cap < pos + 65536)
+      {
+         size_t   cap = autosave_out_cap ? autosave_out_cap * 2
+                                         : (size_t)size / 2 + 65536;
+         uint8_t *out = (uint8_t*)realloc(autosave_out, cap);
+         if (!out)
+            break;
+         autosave_out     = out;
+         autosave_out_cap = cap;
+      }
+
+      rdeflate_set_out(z, autosave_out + pos, autosave_out_cap - pos);
+      ret  = rdeflate_process(z, &rd, &wr);
+      pos += wr;
+
+      if (ret == RDEFLATE_PROCESS_END)
+      {
+         rdeflate_free(z);
+         memcpy(autosave_out, autosave_magic, 8);
+         autosave_put_le32(autosave_out + 8,  AUTOSAVE_VERSION);
+         autosave_put_le32(autosave_out + 12, size);
+         return pos;
+      }
+      if (ret == RDEFLATE_PROCESS_ERROR)
+         break;
+   }
+
+   rdeflate_free(z);
+   return 0;
+}
+
+static void autosave_file_write(const uint8_t *raw, uint32_t size)
+{
+   char   tmp[4096 + 8];
+   size_t len = autosave_compress(raw, size);
+   RFILE *f;
+   bool   ok;
+
+   if (!len)
+   {
+      log_cb(RETRO_LOG_WARN, "Auto-save: compression failed.\n");
+      return;
+   }
+
+   snprintf(tmp, sizeof(tmp), "%s.tmp", autosave_path);
+   f = filestream_open(tmp,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!f)
+   {
+      log_cb(RETRO_LOG_WARN, "Auto-save: cannot create %s.\n", tmp);
+      return;
+   }
+   ok = filestream_write(f, autosave_out, len) == (int64_t)len;
+   ok = (filestream_close(f) == 0) && ok;
+
+   if (ok && filestream_rename(tmp, autosave_path) != 0)
+   {
+      filestream_delete(autosave_path);
+      ok = filestream_rename(tmp, autosave_path) == 0;
+   }
+   if (!ok)
+   {
+      log_cb(RETRO_LOG_WARN, "Auto-save: writing %s failed.\n", autosave_path);
+      filestream_delete(tmp);
+   }
+}
+
+static void autosave_writer(void *unused)
+{
+   (void)unused;
+   for (;;)
+   {
+      int idx;
+
+      slock_lock(autosave_lock);
+      while (autosave_pending < 0)
+      {
+         if (autosave_quit) { slock_unlock(autosave_lock); return; } /* drained + quit */
+         scond_wait(autosave_work, autosave_lock);
+      }
+      idx              = autosave_pending;
+      autosave_busy    = idx;
+      autosave_pending = -1;
+      slock_unlock(autosave_lock);
+
+      autosave_file_write(autosave_bufs[idx].data, autosave_bufs[idx].size);
+
+      slock_lock(autosave_lock);
+      autosave_busy = -1;
+      slock_unlock(autosave_lock);
+   }
+}
+
+/* Started on the first snapshot, so content that never enables the
+ * option never creates the thread. */
+static void autosave_start(void)
+{
+   if (autosave_running)
+      return;
+   autosave_quit = false;
+   autosave_lock = slock_new();
+   autosave_work = scond_new();
+   if (autosave_lock && autosave_work)
+      autosave_thread = sthread_create(autosave_writer, NULL);
+   autosave_running = (autosave_thread != NULL);
+   if (!autosave_running)   /* setup failed: fall back to inline writes */
+   {
+      if (autosave_lock) { slock_free(autosave_lock); autosave_lock = NULL; }
+      if (autosave_work) { scond_free(autosave_work); autosave_work = NULL; }
+   }
+}
+
+/* Emulation thread: serialize into a free buffer and hand it over. */
+static void autosave_snapshot(void)
+{
+   StateMem      st;
+   autosave_buf *b;
+   int           idx = 0;
+   bool          ok;
+
+   autosave_start();
+
+   if (autosave_running)
+   {
+      slock_lock(autosave_lock);
+      while (idx == autosave_busy || idx == autosave_pending)
+         idx++;
+      slock_unlock(autosave_lock);
+   }
+   b = &autosave_bufs[idx];
+
+   st.data           = b->data;
+   st.loc            = 0;
+   st.len            = 0;
+   st.malloced       = b->cap;
+   st.initial_malloc = 0;
+
+   ok      = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   /* smem_write may have grown the buffer; keep it for next time. */
+   b->data = st.data;
+   b->cap  = st.malloced;
+   b->size = st.len;
+   if (!ok)
+      return;
+
+   if (!autosave_running)
+   {
+      autosave_file_write(b->data, b->size);
+      return;
+   }
+
+   slock_lock(autosave_lock);
+   autosave_pending = idx;   /* supersedes any snapshot still pending */
+   scond_signal(autosave_work);
+   slock_unlock(autosave_lock);
+}
+
+/* Called at load, once the content name is known. */
+static void autosave_init(void)
+{
+   int r = snprintf(autosave_path, sizeof(autosave_path), "%s%c%s.autosave",
+         retro_save_directory, retro_slash, retro_cd_base_name);
+
+   /* A truncated path would name some other file: leave auto-save off. */
+   if (r < 0 || (size_t)r >= sizeof(autosave_path))
+   {
+      log_cb(RETRO_LOG_WARN, "Auto-save: save path too long, disabled.\n");
+      autosave_path[0] = '\0';
+   }
+   autosave_due            = 0;
+   autosave_ran            = false;
+   autosave_resume_pending = true;
+}
+
+/* End of every retro_run: take a snapshot when one is due. */
+static void autosave_tick(void)
+{
+   retro_time_t now;
+
+   autosave_ran = true;
+   if (!autosave_interval || !autosave_path[0])
+   {
+      autosave_due = 0;
+      return;
+   }
+
+   now = cpu_features_get_time_usec();
+   if (!autosave_due)
+      autosave_due = now + (retro_time_t)autosave_interval * 1000000;
+   else if (now >= autosave_due)
+   {
+      autosave_due = now + (retro_time_t)autosave_interval * 1000000;
+      autosave_snapshot();
+   }
+}
+
+/* First retro_run after load: restore the last snapshot, unless the
+ * frontend already loaded a state of its own. */
+static void autosave_try_resume(void)
+{
+   void    *file = NULL;
+   int64_t  len  = 0;
+   uint8_t *raw  = NULL;
+   void    *z    = NULL;
+   uint32_t size;
+   size_t   expect;
+   size_t   rd = 0, wr = 0;
+   bool     ok = false;
+
+   autosave_resume_pending = false;
+   if (!autosave_interval || !autosave_resume || !autosave_path[0]
+         || !filestream_exists(autosave_path))
+      return;
+
+   if (!filestream_read_file(autosave_path, &file, &len)
+         || len < AUTOSAVE_HEADER_SIZE
+         || memcmp(file, autosave_magic, 8)
+         || autosave_get_le32((const uint8_t*)file + 8) != AUTOSAVE_VERSION)
+      goto done;
+
+   /* The header's size decides the allocation, so check it before
+    * trusting it.  With a variable-size frontend retro_serialize_size()
+    * is this core's exact state size; otherwise it is the fixed bound
+    * every state fits in. */
+   size   = autosave_get_le32((const uint8_t*)file + 12);
+   expect = retro_serialize_size();
+   if (!size || size > expect
+         || (enable_variable_serialization_size && size != expect))
+      goto done;
+
+   raw  = (uint8_t*)malloc(size);
+   z    = rinflate_new(15);
+   if (!raw || !z)
+      goto done;
+
+   rinflate_set_in(z, (const uint8_t*)file + AUTOSAVE_HEADER_SIZE,
+         (size_t)len - AUTOSAVE_HEADER_SIZE);
+   rinflate_set_out(z, raw, size);
+   if (rinflate_process(z, &rd, &wr) != RDEFLATE_PROCESS_END || wr != size)
+      goto done;
+
+   ok = retro_unserialize(raw, size);
+
+done:
+   if (z)
+      rinflate_free(z);
+   free(raw);
+   free(file);
+
+   if (ok)
+      osd_message(1, RETRO_LOG_INFO,
+            RETRO_MESSAGE_TARGET_ALL, RETRO_MESSAGE_TYPE_NOTIFICATION,
+            "Resumed from auto-save.");
+   else
+      log_cb(RETRO_LOG_WARN, "Auto-save: %s is not a usable snapshot.\n",
+            autosave_path);
+}
+
+/* CloseGame: take the final snapshot, drain, join and release. */
+static void autosave_stop(void)
+{
+   unsigned i;
+
+   if (autosave_interval && autosave_path[0] && autosave_ran && PSX_FIO)
+      autosave_snapshot();
+
+   if (autosave_running)
+   {
+      slock_lock(autosave_lock);
+      autosave_quit = true;
+      scond_signal(autosave_work);
+      slock_unlock(autosave_lock);
+      sthread_join(autosave_thread);   /* returns only after pending drained */
+      autosave_thread  = NULL;
+      autosave_running = false;
+      slock_free(autosave_lock);  autosave_lock = NULL;
+      scond_free(autosave_work);  autosave_work = NULL;
+   }
+
+   for (i = 0; i < AUTOSAVE_BUFS; i++)
+   {
+      free(autosave_bufs[i].data);
+      autosave_bufs[i].data = NULL;
+      autosave_bufs[i].size = 0;
+      autosave_bufs[i].cap  = 0;
+   }
+   free(autosave_out);
+   autosave_out            = NULL;
+   autosave_out_cap        = 0;
+   autosave_pending        = -1;
+   autosave_busy           = -1;
+   autosave_ran            = false;
+   autosave_resume_pending = false;
+}
+
 /* The SCPH-5903 (PU-16, "PSX with Video CD") ships a 1 Mbyte kernel ROM
  * (M538032E-02) rather than the usual 512 Kbyte part.  Low 512K is an
  * ordinary "System ROM Version 2.2 12/04/95 J" kernel; the upper half holds
@@ -1142,6 +1880,11 @@ void PSX_SetDMACycleSteal(unsigned stealage)
    DMACycleSteal = stealage;
 }
 
+unsigned PSX_GetDMACycleSteal(void)
+{
+   return DMACycleSteal;
+}
+
 /* Event stuff */
 
 static int32_t Running; // Set to -1 when not desiring exit, and 0 when we are.
@@ -3049,6 +3792,7 @@ static void InitCommon(const bool EmulateMemcards, const bool WantPIOMem)
    }
 
    mc_async_init();
+   autosave_init();
 
 	input_init_calibration();
 
@@ -3458,6 +4202,9 @@ static void CloseGame(void)
 {
    int i;
 
+   /* Take the final auto-save while the machine is still intact. */
+   autosave_stop();
+
    /* Drain and stop the async memcard writer before the synchronous save
     * loop and Cleanup(); guarantees no pending write is lost at teardown. */
    mc_async_flush_and_stop();
@@ -3525,7 +4272,16 @@ int StateAction(StateMem *sm, int load, int data_only)
    };
 
 
-   int ret = MDFNSS_StateAction(sm, load, data_only, StateRegs, "MAIN");
+   int ret;
+
+#ifdef HAVE_LIGHTREC
+   /* Before MainRAM is overwritten: lets CPU_StateAction keep the
+    * compiled code the incoming RAM leaves unchanged. */
+   if (load)
+      CPU_LightrecBeginStateLoad();
+#endif
+
+   ret = MDFNSS_StateAction(sm, load, data_only, StateRegs, "MAIN");
 
    /* Call SetDisc() BEFORE we load CDC state, since SetDisc() has emulation side effects.
     * We might want to clean this up in the future. */
@@ -3818,7 +4574,10 @@ static void alloc_surface(void)
    if (surf)
       MDFN_Surface_Delete(surf);
 
-   surf = MDFN_Surface_New(width, height, width);
+   /* RGB565 rows are packed at 2 bytes per pixel, so the surface,
+    * and the pitch handed to the frontend, are half the size. */
+   surf = MDFN_Surface_New(width, height, width,
+         psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t));
 
    /* The fresh surface is calloc'd (all zero).  Discard any
     * previously-cached per-dest_line geometry so the first
@@ -4287,6 +5046,17 @@ static void check_variables(bool startup)
    else
       psx_gte_overclock = false;
 
+   var.key = BEETLE_OPT(skip_idle_loops);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         psx_skip_idle_loops = true;
+      else if (strcmp(var.value, "disabled") == 0)
+         psx_skip_idle_loops = false;
+   }
+   else
+      psx_skip_idle_loops = false;
+
    var.key = BEETLE_OPT(gpu_overclock);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
       {
@@ -4549,16 +5319,6 @@ static void check_variables(bool startup)
    {
       bool hw_renderer = false;
 
-#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) || defined(HAVE_VULKAN)
-      var.key = BEETLE_OPT(renderer);
-      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-      {
-         if (!strcmp(var.value, "hardware") || !strcmp(var.value, "hardware_gl") || !strcmp(var.value, "hardware_vk"))
-         {
-            hw_renderer = true;
-         }
-      }
-
       /* Record the requested output color format. This is only the
        * user's *request*; HDR is not engaged here. Whether it actually
        * takes effect is decided later, once the renderer is confirmed
@@ -4572,6 +5332,18 @@ static void check_variables(bool startup)
       {
          if (!strcmp(var.value, "30bit_hdr"))
             psx_color_format = PSX_COLOR_FORMAT_30BIT_HDR;
+         else if (!strcmp(var.value, "16bit"))
+            psx_color_format = PSX_COLOR_FORMAT_16BIT;
+      }
+
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) || defined(HAVE_VULKAN)
+      var.key = BEETLE_OPT(renderer);
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         if (!strcmp(var.value, "hardware") || !strcmp(var.value, "hardware_gl") || !strcmp(var.value, "hardware_vk"))
+         {
+            hw_renderer = true;
+         }
       }
 
       /* PGXP precise colour and linear-light fog are part of the 30-bit HDR
@@ -4699,6 +5471,12 @@ static void check_variables(bool startup)
    else
       psx_gpu_dither_mode = DITHER_NATIVE;
 
+   var.key = BEETLE_OPT(sw_texture_cache);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      GPU_SetTexPageCache(strcmp(var.value, "enabled") == 0);
+   else
+      GPU_SetTexPageCache(false);
+
    // iCB: PGXP settings
    var.key = BEETLE_OPT(pgxp_mode);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -4955,6 +5733,14 @@ static void check_variables(bool startup)
          setting_psx_multitap_port_2 = false;
    }
 
+   var.key = BEETLE_OPT(late_input_poll);
+   setting_late_input_poll = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         setting_late_input_poll = true;
+   }
+
    var.key = BEETLE_OPT(mouse_sensitivity);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
       input_set_mouse_sensitivity(atoi(var.value));
@@ -5094,6 +5880,14 @@ static void check_variables(bool startup)
    }
    /* End Memcards */
 
+   var.key = BEETLE_OPT(direct_framebuffer);
+   sw_direct_enabled = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "enabled") == 0)
+         sw_direct_enabled = true;
+   }
+
    var.key = BEETLE_OPT(frame_duping);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
@@ -5131,6 +5925,28 @@ static void check_variables(bool startup)
    else
       display_notifications = true;
 
+#ifdef HAVE_PROFILE
+   {
+      unsigned prof_mode     = PROF_MODE_OFF;
+      unsigned prof_interval = 300;
+
+      var.key = BEETLE_OPT(profile);
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         if (strcmp(var.value, "log") == 0)
+            prof_mode = PROF_MODE_LOG;
+         else if (strcmp(var.value, "osd") == 0)
+            prof_mode = PROF_MODE_OSD;
+      }
+
+      var.key = BEETLE_OPT(profile_interval);
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         prof_interval = atoi(var.value);
+
+      prof_configure(prof_mode, prof_interval);
+   }
+
+#endif
    var.key = BEETLE_OPT(crop_overscan);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
@@ -5199,6 +6015,19 @@ static void check_variables(bool startup)
       memcard_right_index     = atoi(var.value);
    }
 
+   var.key = BEETLE_OPT(auto_save_interval);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned interval = strcmp(var.value, "disabled") ? atoi(var.value) : 0;
+      if (interval != autosave_interval)
+         autosave_due = 0;   /* restart the countdown */
+      autosave_interval = interval;
+   }
+
+   var.key = BEETLE_OPT(auto_save_resume);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      autosave_resume = !strcmp(var.value, "enabled");
+
    var.key = BEETLE_OPT(deinterlacer);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
@@ -5215,6 +6044,27 @@ static void check_variables(bool startup)
 
       psx_gpu_rasterize_both_fields = (Deinterlacer_GetType(&deint) == DEINT_OFF);
    }
+
+   var.key = BEETLE_OPT(deinterlacer_threads);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned threads = 1;
+
+      if (strcmp(var.value, "auto") == 0)
+      {
+         /* Leave a core to the emulation thread's next frame. */
+         unsigned cores = cpu_features_get_core_amount();
+         threads = (cores > 1) ? cores - 1 : 1;
+      }
+      else if (strcmp(var.value, "disabled") != 0)
+         threads = (unsigned)atoi(var.value);
+
+      Deinterlacer_SetThreads(&deint, threads);
+   }
+
+   var.key = BEETLE_OPT(deinterlacer_pipeline);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      Deinterlacer_SetPipelined(&deint, strcmp(var.value, "enabled") == 0);
 }
 
 #ifdef NEED_CD
@@ -5628,6 +6478,41 @@ static void negotiate_hdr_output(void)
    }
 }
 
+/* Software-renderer counterpart of negotiate_hdr_output(): when the
+ * user asked for 16-bit output, offer RGB565 now, while
+ * SET_PIXEL_FORMAT is allowed.  The answer holds for the whole
+ * session; it must come before alloc_surface(), which sizes the
+ * surface rows by it.  24-bit (MDEC) frames are converted down inside
+ * the RGB565 scanout rather than renegotiating the format, which the
+ * frontend could only pick up by reinitialising its video driver.
+ * A Video CD is the exception: its decoder only produces XRGB8888,
+ * so such a disc stays on the XRGB8888 that retro_load_game already
+ * set, as does a frontend that rejects RGB565. */
+static void negotiate_sw_pixel_format(void)
+{
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+   const char *result          = "engaged";
+   VCD_DiscInfo vi;
+
+   psx_sw_rgb565       = false;
+   sw_direct_supported = true;
+
+   if (psx_color_format != PSX_COLOR_FORMAT_16BIT)
+      return;
+
+   if (cdifs_loaded && cdifs.count > 0
+         && VCD_ProbeDisc(cdifs.items[0], &vi) != VCD_DISC_NONE)
+      result = "not used for Video CD - falling back to 24-bit";
+   else if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+      psx_sw_rgb565 = true;
+   else
+      result = "rejected by frontend - falling back to 24-bit";
+
+   if (log_cb)
+      log_cb(RETRO_LOG_INFO, "[Color Format] 16-bit RGB565 requested: %s.\n",
+            result);
+}
+
 bool retro_load_game(const struct retro_game_info *info)
 {
    char tocbasepath[4096];
@@ -5700,6 +6585,9 @@ bool retro_load_game(const struct retro_game_info *info)
    force_software_renderer = false;
    ret = rhi_intf_open(content_is_pal, force_software_renderer);
 
+   if (rhi_intf_is_type() == RHI_SOFTWARE)
+      negotiate_sw_pixel_format();
+
    alloc_surface();
 
    /* Hide irrelevant core options */
@@ -5712,6 +6600,8 @@ bool retro_load_game(const struct retro_game_info *info)
 
          option_display.key = BEETLE_OPT(renderer_software_fb);
          environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+         option_display.key = BEETLE_OPT(gpu_vram_snapshots);
+         environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
          option_display.key = BEETLE_OPT(scaled_uv_offset);
          environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
          option_display.key = BEETLE_OPT(filter_exclude_sprite);
@@ -5939,6 +6829,89 @@ static bool retro_set_system_av_info(void)
    return environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &new_av_info);
 }
 
+/* Whether this frame's software scanout should wait for the end of the
+ * frame, to go straight into the frontend's framebuffer
+ * (RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER) rather than
+ * into surf and be copied from there by the frontend.  That needs the
+ * whole output image in one pass: an interlaced frame is put together
+ * by the deinterlacer from surf and the previous field, the lightgun
+ * hooks sample and plot the surface as the beam passes, and a VCD
+ * frame replaces the GPU output.  The previous frame stands in for
+ * this one's interlace state; a frame that turns out interlaced
+ * anyway is flushed into surf before deinterlacing.
+ *
+ * Reading VRAM at the end of the frame rather than per line shows when
+ * a game draws into the displayed buffer while it is being scanned out.
+ * The hardware renderers do the same, but for the software renderer it
+ * is an accuracy trade, so the path only runs with "Direct Framebuffer
+ * Output" enabled. */
+static bool sw_direct_wanted(void)
+{
+   if (!sw_direct_enabled || rhi_intf_is_type() != RHI_SOFTWARE
+         || !sw_direct_supported
+         || input_has_lightgun() || VCD_GetMode() != VCD_MODE_OFF)
+      return false;
+#ifdef NEED_DEINTERLACER
+   if (PrevInterlaced)
+      return false;
+#endif
+   return true;
+}
+
+/* Convert the held-back scanout into a frontend framebuffer holding
+ * the width x height window at column x of the surface.  False, with
+ * the records left for GPU_FlushDeferredScanout, if the frontend has
+ * no suitable buffer. */
+static bool sw_direct_present(const void **fb, unsigned width,
+      unsigned height, unsigned x, unsigned *pitch)
+{
+   struct retro_framebuffer fbuf;
+   const size_t bpp = psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+   if (!width || !height)
+      return false;
+
+   memset(&fbuf, 0, sizeof(fbuf));
+   fbuf.width        = width;
+   fbuf.height       = height;
+   fbuf.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fbuf)
+         || !fbuf.data
+         || fbuf.format != (psx_sw_rgb565
+            ? RETRO_PIXEL_FORMAT_RGB565 : RETRO_PIXEL_FORMAT_XRGB8888)
+         || fbuf.pitch < width * bpp
+         || fbuf.pitch % bpp)
+   {
+      sw_direct_supported = false;
+      return false;
+   }
+
+   GPU_FlushDeferredScanoutTo(fbuf.data, fbuf.pitch, x, width, height);
+   *fb    = fbuf.data;
+   *pitch = (unsigned)fbuf.pitch;
+   return true;
+}
+
+/* Fetch this frame's input from the frontend and hand it to the
+ * emulated devices.  With late polling it runs from inside CPU_Run,
+ * via the FrontIO pad access hook, when the game starts its first
+ * controller transaction of the frame: the vblank-to-read interval
+ * that input would otherwise sit out is no longer added to latency.
+ * A game that reads the pad again in the same frame gets the same
+ * state, as it does with polling at frame start; one that does not
+ * read it at all is polled once CPU_Run returns. */
+static void late_input_poll(void)
+{
+   late_input_poll_pending = false;
+
+   if (input_poll_cb)
+      input_poll_cb();
+
+   input_update(libretro_supports_bitmasks, input_state_cb);
+   FrontIO_UpdateInput(PSX_FIO);
+}
+
 void retro_run(void)
 {
    bool updated = false;
@@ -5950,8 +6923,10 @@ void retro_run(void)
    unsigned        width;
    unsigned        height;
    uint8_t         upscale_shift;
-   const uint32_t *pix;
+   const uint8_t  *pix;
    unsigned        pix_offset;
+   unsigned        pitch;
+   const MDFN_Surface *out_surf;
 
    /* Defensive: a frontend should not call retro_run before
     * retro_load_game succeeds, but if it does we'd crash on the
@@ -5959,6 +6934,8 @@ void retro_run(void)
    if (!PSX_CPU || !PSX_FIO || !PSX_CDC)
       return;
 
+   PROF_FRAME_BEGIN();
+
    /* Keep the HDR encode in sync with the frontend's live HDR controls.
     * RetroArch's paper-white and Colour Boost sliders change at runtime and
     * do NOT fire the core's variable-update path, so re-query them each frame
@@ -6115,6 +7092,9 @@ void retro_run(void)
       FrontIO_SetCrosshairsColor(PSX_FIO, 1, setting_crosshair_color_p2);
    }
 
+   if (MDFN_UNLIKELY(autosave_resume_pending))
+      autosave_try_resume();
+
    /* We only start counting after the first frame we encounter. This
       way the value we display remains consistent if the real
       framerate is not a multiple of INTERNAL_FPS_SAMPLE_PERIOD
@@ -6161,10 +7141,20 @@ void retro_run(void)
       setting_apply_analog_toggle = false;
    }
 
-   if (input_poll_cb)
-      input_poll_cb();
+   /* The Video CD transport below samples the pad before CPU_Run, so a
+    * Video CD is always polled at frame start. */
+   if (setting_late_input_poll && VCD_GetMode() == VCD_MODE_OFF)
+   {
+      late_input_poll_pending = true;
+      FrontIO_SetPadAccessHook(PSX_FIO, late_input_poll);
+   }
+   else
+   {
+      if (input_poll_cb)
+         input_poll_cb();
 
-   input_update(libretro_supports_bitmasks, input_state_cb);
+      input_update(libretro_supports_bitmasks, input_state_cb);
+   }
 
    /* Video CD transport. In HLE mode there is no PSX-side player to read the
     * pad, so the buttons have to reach the transport directly or the disc
@@ -6205,11 +7195,22 @@ void retro_run(void)
 
    espec->SoundBufSize = 0;
 
-   FrontIO_UpdateInput(PSX_FIO);
+   if (!late_input_poll_pending)
+      FrontIO_UpdateInput(PSX_FIO);
+   sw_direct_frame = sw_direct_wanted();
+   GPU_DeferScanout(sw_direct_frame);
    GPU_StartFrame(espec);
 
    Running = -1;
+   PROF_PUSH(PROF_CPU);
    timestamp = CPU_Run(PSX_CPU, timestamp);
+   PROF_POP();
+
+   if (late_input_poll_pending)
+   {
+      FrontIO_SetPadAccessHook(PSX_FIO, NULL);
+      late_input_poll();
+   }
 
    assert(timestamp);
 
@@ -6219,8 +7220,15 @@ void retro_run(void)
     * during this frame's emulation.  See GPU_FlushDeferredScanout
     * and psx_gpu_rasterize_both_fields - this is the safe point
     * to read VRAM since rasterisation for this frame is finished
-    * and the frontend hasn't yet read the surface for display. */
-   GPU_FlushDeferredScanout();
+    * and the frontend hasn't yet read the surface for display.  A
+    * progressive sw_direct_frame keeps its records until the output
+    * geometry is known, see sw_direct_present. */
+   if (!sw_direct_frame || spec.InterlaceOn)
+   {
+      PROF_PUSH(PROF_SCANOUT);
+      GPU_FlushDeferredScanout();
+      PROF_POP();
+   }
 
    espec->SoundBufSize = IntermediateBufferPos;
    IntermediateBufferPos = 0;
@@ -6305,9 +7313,12 @@ void retro_run(void)
    }
 
    fb            = NULL;
+   out_surf      = surf;
    width         = rects[0];
    height        = spec.DisplayRect.h;
    upscale_shift = GPU_get_upscale_shift();
+   pitch         = (MEDNAFEN_CORE_GEOMETRY_MAX_W << upscale_shift)
+      * (psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t));
 
    if (rhi_intf_is_type() == RHI_SOFTWARE)
    {
@@ -6317,7 +7328,10 @@ void retro_run(void)
          if (!PrevInterlaced)
             Deinterlacer_ClearState(&deint);
 
+         PROF_PUSH(PROF_SCANOUT);
          Deinterlacer_Process(&deint, surf, &spec.DisplayRect, rects, spec.InterlaceField);
+         out_surf = Deinterlacer_OutputSurface(&deint, surf);
+         PROF_POP();
 
          /* The scanout cache assumes margin pixels are still zero
           * from the previous frame's writes.  WEAVE's XReposition
@@ -6334,6 +7348,14 @@ void retro_run(void)
           * run and the cache can stay hot. */
          if (Deinterlacer_DidDisturbMargins(&deint))
             GPU_InvalidateScanoutCache();
+         /* Every mode but WEAVE and OFF rewrites active rows in
+          * place, so those rows no longer match their VRAM source
+          * and the dirty-row skip must not trust them next frame.
+          * Pipelined FastMAD writes its own surface instead. */
+         else if (out_surf == surf
+               && Deinterlacer_GetType(&deint) != DEINT_WEAVE
+               && Deinterlacer_GetType(&deint) != DEINT_OFF)
+            GPU_InvalidateScanoutRows();
 
          PrevInterlaced = true;
 
@@ -6355,7 +7377,7 @@ void retro_run(void)
 #endif
 
       // PSX core inserts padding on left and right (overscan). Optionally crop this.
-      pix = surf->pixels;
+      pix = (const uint8_t*)out_surf->pixels;
       pix_offset = 0;
 
       if (crop_overscan)
@@ -6420,13 +7442,26 @@ void retro_run(void)
 
       width  <<= upscale_shift;
       height <<= upscale_shift;
-      pix     += pix_offset << upscale_shift;
+      pix     += (size_t)(pix_offset << upscale_shift)
+         * (psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t));
 
       if (     GPU_get_display_possibly_dirty()
             || GPU_get_display_change_count()
             || (currently_interlaced || PrevInterlaced)
             || !allow_frame_duping)
          fb = pix;
+
+      /* Still holding the scanout: hand the frame to the frontend in
+       * its own buffer, or fall back to surf for a duped frame or a
+       * frontend without one. */
+      if (GPU_HasDeferredScanout())
+      {
+         PROF_PUSH(PROF_SCANOUT);
+         if (!fb || !sw_direct_present(&fb, width, height,
+                  pix_offset << upscale_shift, &pitch))
+            GPU_FlushDeferredScanout();
+         PROF_POP();
+      }
    }
 
    /* Video CD output substitution.
@@ -6450,11 +7485,13 @@ void retro_run(void)
       VCD_RunFrame();
       vcd_fb = VCD_GetVideo(&vcd_w, &vcd_h, &vcd_pitch);
 
+      PROF_PUSH(PROF_SUBMIT);
       if (vcd_fb)
          rhi_intf_finalize_frame(vcd_fb, vcd_w, vcd_h, (unsigned)vcd_pitch);
       else
          rhi_intf_finalize_frame(NULL, width, height,
                MEDNAFEN_CORE_GEOMETRY_MAX_W << (2 + upscale_shift));
+      PROF_POP();
 
       if (audio_batch_cb)
       {
@@ -6467,8 +7504,15 @@ void retro_run(void)
    }
    else
    {
-   rhi_intf_finalize_frame(fb, width, height,
-		   MEDNAFEN_CORE_GEOMETRY_MAX_W << (2 + upscale_shift));
+   PROF_PUSH(PROF_SUBMIT);
+   rhi_intf_finalize_frame(fb, width, height, pitch);
+   PROF_POP();
+
+#ifdef NEED_DEINTERLACER
+   /* The frontend is done with the presented frame, so a pipelined
+    * FastMAD job may now reuse its output surface. */
+   Deinterlacer_Kick(&deint);
+#endif
 
    if (audio_batch_cb)
       audio_batch_cb(&IntermediateBuffer[0][0], spec.SoundBufSize);
@@ -6484,6 +7528,10 @@ void retro_run(void)
    /* LED interface */
    if (led_state_cb)
       retro_led_interface();
+
+   autosave_tick();
+
+   PROF_FRAME_END();
 }
 
 void retro_get_system_info(struct retro_system_info *info)
@@ -6544,6 +7592,9 @@ void retro_deinit(void)
     * dlopen/dlclose-cycle leak concern as CDUtility above. */
    PGXP_Shutdown();
 
+   /* Compiled savestate section layouts, cached by MDFNSS_LoadSM. */
+   MDFNSS_FreeLayouts();
+
    /* Frame/UI state. */
    frame_count           = 0;
    internal_frame_count  = 0;
@@ -6577,6 +7628,11 @@ void retro_deinit(void)
    display_notifications      = true;
    allow_frame_duping         = false;
 
+   /* Software output pixel format; renegotiated by retro_load_game. */
+   psx_sw_rgb565              = false;
+   sw_direct_supported        = true;
+   sw_direct_frame            = false;
+
    /* Capability flags re-detected by retro_init. */
    libretro_supports_option_categories = false;
    libretro_supports_bitmasks          = false;
@@ -6687,6 +7743,19 @@ bool UsingFastSavestates(void)
    return false;
 }
 
+/* For a fast savestate: whether it comes back into this instance.
+ * Fast savestates stay in the process, but with second-instance
+ * run-ahead or netplay rollback they are loaded by another instance
+ * of the core.  Frontends that report a savestate context say which;
+ * for the rest the fast savestate flag is all there is to go on. */
+static bool UsingSameInstanceSavestates(void)
+{
+   int context;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &context))
+      return context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE;
+   return true;
+}
+
 /* Serialize emulator state into the frontend's `data` buffer of `size`
  * bytes.
  *
@@ -6731,9 +7800,11 @@ bool retro_serialize(void *data, size_t size)
    st.malloced       = size;
    st.initial_malloc = 0;
 
-   FastSaveStates = UsingFastSavestates();
-   ret            = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
-   FastSaveStates = false;
+   FastSaveStates          = UsingFastSavestates();
+   same_instance_savestate = FastSaveStates && UsingSameInstanceSavestates();
+   ret                     = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   FastSaveStates          = false;
+   same_instance_savestate = false;
 
    if (ret)
    {
@@ -6773,6 +7844,10 @@ bool retro_unserialize(const void *data, size_t size)
    if (!data || size == 0 || !MainRAM || !PSX_CDC || !PSX_CPU || !PSX_FIO)
       return false;
 
+   /* A state the frontend loads before the first frame wins over the
+    * auto-save. */
+   autosave_resume_pending = false;
+
    st.data           = (uint8_t*)data;
    st.loc            = 0;
    st.len            = size;
@@ -206,6 +206,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      BEETLE_OPT(skip_idle_loops),
+      "Skip Idle Loops",
+      NULL,
+      "Detect short CPU loops that only wait for an interrupt or event (e.g. polling a vblank flag) and jump straight to the next scheduled event instead of emulating every pass. Saves host CPU time with no change in emulated behavior, mainly when running the interpreter at high CPU overclocks; otherwise the extra test on every branch can cost about as much as it saves. Interpreter only; the dynarec is unaffected.",
+      NULL,
+      "system",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
 #ifndef EMSCRIPTEN
    {
       BEETLE_OPT(cd_access_method),
@@ -340,20 +354,41 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "enabled"
    },
+   {
+      BEETLE_OPT(gpu_vram_snapshots),
+      "Run-Ahead VRAM Snapshots",
+      NULL,
+      "Hardware renderers with Software Framebuffer disabled only. Savestates taken for run-ahead, preemptive frames or rewind keep VRAM as a copy on the GPU instead of reading it back to the CPU every frame, which stalls on the GPU. Sets how many of those copies are kept; each one is the size of the internal-resolution framebuffer. Loading a state older than the last N saves falls back to the CPU copy, which may show stale graphics until they are redrawn. Savestates written to disk are not affected.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "2",        NULL },
+         { "4",        NULL },
+         { "8",        NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#endif
    {
       BEETLE_OPT(color_format),
       "Color Format",
       NULL,
-      "Selects the output color depth. '24-bit (Standard)' is the historical 8-bit-per-channel output. '30-bit Color (HDR)' outputs 10-bit-per-channel, PQ-encoded Rec.2020 (HDR10) for display on an HDR-capable screen: the renderer already carries more than 8 bits of internal precision, so this both reduces banding on upscaled gradients and lets emissive content sit above SDR white. Takes effect with the Vulkan and OpenGL hardware renderers and requires frontend HDR support; it falls back to 24-bit on the Software renderer or when the frontend cannot present HDR10. Restart required.",
+      "Selects the output color depth. '24-bit (Standard)' is the historical 8-bit-per-channel output. '30-bit Color (HDR)' outputs 10-bit-per-channel, PQ-encoded Rec.2020 (HDR10) for display on an HDR-capable screen: the renderer already carries more than 8 bits of internal precision, so this both reduces banding on upscaled gradients and lets emissive content sit above SDR white. Takes effect with the Vulkan and OpenGL hardware renderers and requires frontend HDR support; it falls back to 24-bit on the Software renderer or when the frontend cannot present HDR10. '16-bit (Software Renderer)' outputs RGB565, which holds every PlayStation 15-bit color exactly at half the memory traffic of 24-bit output; useful on low-end devices. 24-bit videos (MDEC) are shown with 16-bit color, the FastMAD deinterlacer is replaced by 'Bob (Offset)', and Video CDs use 24-bit output. Has no effect on the hardware renderers. Restart required.",
       NULL,
       "video",
       {
          { "24bit",     "24-bit (Standard)" },
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) || defined(HAVE_VULKAN)
          { "30bit_hdr", "30-bit Color (HDR)" },
+#endif
+         { "16bit",     "16-bit (Software Renderer)" },
          { NULL, NULL },
       },
       "24bit"
    },
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) || defined(HAVE_VULKAN)
    {
       BEETLE_OPT(hdr_shoulder),
       "HDR Highlight Roll-Off",
@@ -510,6 +545,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "1x(native)"
    },
+   {
+      BEETLE_OPT(sw_texture_cache),
+      "Software Texture Page Cache",
+      NULL,
+      "Software renderer only. Keeps recently used texture pages with their palettes already applied, so textured polygons and sprites read each texel with a single lookup. Faster with textured scenes, especially at higher internal resolutions, but does not emulate the timing or stale contents of the console's texture and palette caches, which a few games rely on.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
 #ifdef HAVE_VULKAN
    {
       BEETLE_OPT(scaled_uv_offset),
@@ -624,6 +673,52 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "1x"
    },
+   {
+      BEETLE_OPT(dynamic_resolution),
+      "Dynamic Internal Resolution",
+      NULL,
+      "Measure how long the GPU spends on each frame and lower the internal resolution in heavy scenes, raising it again once there is headroom. 'Internal GPU Resolution' sets the highest scale and the output size, which stays fixed; lower scales are resampled up to it. Changes are rare by design: the scale only drops after half a second over budget and only rises after several seconds well under it. Only supported by the Vulkan renderer.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      BEETLE_OPT(dynamic_resolution_min),
+      "Dynamic Internal Resolution Minimum",
+      NULL,
+      "Lowest internal resolution 'Dynamic Internal Resolution' may drop to. Only supported by the Vulkan renderer.",
+      NULL,
+      "video",
+      {
+         { "1x", "1x (Native)" },
+         { "2x", NULL },
+         { "4x", NULL },
+         { "8x", NULL },
+         { NULL, NULL },
+      },
+      "1x"
+   },
+   {
+      BEETLE_OPT(dynamic_resolution_budget),
+      "Dynamic Internal Resolution GPU Budget",
+      NULL,
+      "Share of each frame the GPU may spend rendering before 'Dynamic Internal Resolution' lowers the scale. Lower values leave more room for the frontend's own work (shaders, other applications). Only supported by the Vulkan renderer.",
+      NULL,
+      "video",
+      {
+         { "50%", NULL },
+         { "60%", NULL },
+         { "75%", NULL },
+         { "90%", NULL },
+         { NULL, NULL },
+      },
+      "75%"
+   },
    {
       BEETLE_OPT(mdec_yuv),
       "MDEC YUV Chroma Filter",
@@ -933,6 +1028,39 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+#endif
+#ifdef HAVE_PROFILE
+   {
+      BEETLE_OPT(profile),
+      "Profiling Overlay",
+      NULL,
+      "Time each frame and the emulated subsystems within it (CPU, recompiler, GPU, SPU, MDEC, CD reads, scanout, frame submission), and report the minimum, average and 99th-percentile time per frame of each, either to the frontend log as a table or on screen as a one-line summary. Only present in builds made with HAVE_PROFILE=1.",
+      NULL,
+      "osd",
+      {
+         { "disabled", NULL },
+         { "log",      "Log" },
+         { "osd",      "On-Screen" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      BEETLE_OPT(profile_interval),
+      "Profiling Interval",
+      NULL,
+      "Number of frames each 'Profiling Overlay' report covers.",
+      NULL,
+      "osd",
+      {
+         { "60",  "60 frames" },
+         { "120", "120 frames" },
+         { "300", "300 frames" },
+         { "600", "600 frames" },
+         { NULL, NULL },
+      },
+      "300"
+   },
 #endif
    {
       BEETLE_OPT(analog_calibration),
@@ -1031,6 +1159,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      BEETLE_OPT(late_input_poll),
+      "Late Input Polling",
+      NULL,
+      "Read the controllers when the game first talks to a controller or multitap in each frame, instead of at the start of the frame. Games that read the pad late in the frame respond up to one frame sooner, at no CPU cost. Games that read the pad several times per frame see the same input at every read, as they do with this disabled.",
+      NULL,
+      "input",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       BEETLE_OPT(gun_input_mode),
       "Gun Input Mode",
@@ -1385,6 +1527,40 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "1"
    },
+   {
+      BEETLE_OPT(auto_save_interval),
+      "Auto-Save Interval",
+      NULL,
+      "Save a snapshot of the running game to the save directory (as <content>.autosave) at this interval, and once more when the content is closed. Serialization is done between frames; compression and the file write happen in the background, and the previous snapshot is only replaced once the new one is fully written.",
+      NULL,
+      "system",
+      {
+         { "disabled", NULL },
+         { "5",   "5 Seconds" },
+         { "10",  "10 Seconds" },
+         { "30",  "30 Seconds" },
+         { "60",  "1 Minute" },
+         { "120", "2 Minutes" },
+         { "300", "5 Minutes" },
+         { "600", "10 Minutes" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      BEETLE_OPT(auto_save_resume),
+      "Resume From Auto-Save",
+      NULL,
+      "When 'Auto-Save Interval' is enabled, load the content's auto-save snapshot, if there is one, as soon as the content starts. Skipped if the frontend loads a save state first.",
+      NULL,
+      "system",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "enabled"
+   },
    {
       BEETLE_OPT(line_render),
       "Line-to-Quad Hack",
@@ -1580,6 +1756,51 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "weave"
    },
+   {
+      BEETLE_OPT(deinterlacer_threads),
+      "Deinterlacer Threads",
+      NULL,
+      "Splits the work of the 'FastMAD' and 'Bob (Offset)' deinterlacers across this many threads. Output is identical at every setting. Helps most with 'FastMAD' at high internal resolutions. 'Auto' uses up to 4 threads, leaving one CPU core for emulation. Software renderer only.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "auto",     "Auto" },
+         { "2",        NULL },
+         { "3",        NULL },
+         { "4",        NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      BEETLE_OPT(deinterlacer_pipeline),
+      "FastMAD Frame Pipelining",
+      NULL,
+      "Runs the 'FastMAD' deinterlacer on a worker thread while the next frame is emulated, so its cost leaves the emulation thread almost entirely. Adds one frame of video latency. Software renderer only.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      BEETLE_OPT(direct_framebuffer),
+      "Direct Framebuffer Output",
+      NULL,
+      "Convert each progressive frame straight into the frontend's framebuffer instead of an intermediate one, saving a full-frame copy. The displayed image is then read from VRAM once the frame is complete rather than line by line as it is scanned out, so games that draw into the displayed buffer mid-frame (beam-racing effects, some FMV players) can show slightly different output. Software renderer only.",
+      NULL,
+      "video",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       BEETLE_OPT(frame_duping),
       "Frame Duping",
@@ -49,18 +49,51 @@
  *   - CDIF_Queue was std::queue<CDIF_Message>.  In practice the
  *     queue depth is 1-3 messages in flight (DIE / EJECT / one
  *     in-flight READ_SECTOR per HintReadSector).  Replaced with
- *     a fixed-size 16-slot ring buffer; same producer/consumer
- *     semantics, no heap allocation per push, no dynamic resizing.
+ *     a fixed-size 16-slot ring buffer; no heap allocation per
+ *     push, no dynamic resizing.
  *
  *   - The read thread used to read each sector into a 2448-byte
- *     stack tmpbuf and then memcpy it into the ring slot under
- *     the SBMutex.  The sector buffer's `valid` flag is now flipped
- *     to false outside the lock, the read targets the slot directly,
- *     and `valid` flips back to true (with the lba update and a
- *     wake) under the lock.  Saves one 2448-byte memcpy per sector.
+ *     stack tmpbuf and then memcpy it into the ring slot.  It now
+ *     reads straight into the slot.  Saves one 2448-byte memcpy
+ *     per sector.
  *
  *   - cdromif_c.h's CDIF_* shim functions are now ordinary
  *     definitions in this file; cdromif_c.h is gone.
+ *
+ * File-level prefetch (MT only): the linear read-ahead only ever runs
+ * a few sectors in front of the emulated drive, so every seek to a
+ * new file waits on the image backend.  At disc open the read thread
+ * walks the data track's ISO9660 directory tree into a sorted table
+ * of file extents.  When a read or hint lands on the first sector of
+ * one of them, the whole file is streamed into a separate prefetch
+ * window while the thread is otherwise idle, well ahead of the
+ * emulated drive's 150 sectors/s.  Only one file is held at a time.
+ * Files larger than the window (FMV and XA streams) are left to the
+ * linear read-ahead, which serves them just as well.
+ *
+ * Synchronisation (MT only): there is exactly one producer and one
+ * consumer on every path - the emu thread posts messages and reads
+ * sectors, the read thread consumes messages and deposits sectors -
+ * so nothing takes a lock on the way through:
+ *
+ *   - the message queues are SPSC rings with acquire/release head
+ *     and tail counters;
+ *   - each sector slot, and the prefetch window as a whole, is a
+ *     seqlock: the read thread makes the sequence odd, writes, makes
+ *     it even again; the emu thread copies and keeps the copy only if
+ *     the sequence was even and unchanged across it;
+ *   - sleeping goes through CDIF_Event, which touches its mutex and
+ *     condition variable only when the other side is actually asleep.
+ *
+ * A sector already in the ring or the window therefore costs the emu
+ * thread one enqueue and one memcpy, where it used to cost two mutex
+ * round trips (queue, then SBMutex) and a scan of all 256 slots.
+ * Slots are direct-mapped by lba, so lookup is a single probe.
+ *
+ * The lock-free paths need real atomics, compare-exchange and fences
+ * from retro_atomic.h.  On a target whose only backend is the
+ * volatile fallback the MT flavour is compiled out and every image
+ * opens ST.
  */
 
 #include <stdint.h>
@@ -70,7 +103,9 @@
 
 #include <boolean.h>
 #include <rthreads/rthreads.h>
+#include <retro_atomic.h>
 #include <retro_miscellaneous.h>
+#include <retro_timers.h>
 #include <libretro.h>
 
 #include "../mednafen.h"
@@ -81,6 +116,11 @@
 
 extern retro_log_printf_t log_cb;
 
+#if defined(HAVE_THREADS) && defined(RETRO_ATOMIC_LOCK_FREE) \
+      && defined(RETRO_ATOMIC_HAS_CAS)
+#define CDIF_HAVE_MT 1
+#endif
+
 /* ------------------------------------------------------------------
  * CDIF_Message - read-thread protocol message.
  * ------------------------------------------------------------------ */
@@ -99,82 +139,177 @@ typedef struct CDIF_Message
    uint32_t args[4];
 } CDIF_Message;
 
+#ifdef CDIF_HAVE_MT
+/* ------------------------------------------------------------------
+ * CDIF_Event - sleep/wake that costs nothing while nobody sleeps.
+ *
+ * `seq` advances by 2 per notification; bit 0 is set by a consumer
+ * about to sleep.  Both sides change `seq` only with read-modify-
+ * writes, which are totally ordered on one variable: either the
+ * producer's increment comes first, and the consumer's fetch_or
+ * (acquire) makes whatever was published before it visible to the
+ * consumer's re-check; or the fetch_or comes first, and the producer
+ * sees bit 0 and signals under the lock, which the consumer holds
+ * from its last look at `seq` until it is inside the wait.
+ * ------------------------------------------------------------------ */
+
+typedef struct CDIF_Event
+{
+   retro_atomic_int_t seq;
+   slock_t           *lock;
+   scond_t           *cond;
+} CDIF_Event;
+
+static void CDIF_Event_Init(CDIF_Event *ev)
+{
+   retro_atomic_int_init(&ev->seq, 0);
+   ev->lock = slock_new();
+   ev->cond = scond_new();
+}
+
+static void CDIF_Event_Free(CDIF_Event *ev)
+{
+   if (ev->lock)
+      slock_free(ev->lock);
+   if (ev->cond)
+      scond_free(ev->cond);
+   ev->lock = NULL;
+   ev->cond = NULL;
+}
+
+/* Producer: call after publishing. */
+static void CDIF_Event_Notify(CDIF_Event *ev)
+{
+   if (retro_atomic_fetch_add_int(&ev->seq, 2) & 1)
+   {
+      slock_lock(ev->lock);
+      scond_signal(ev->cond);
+      slock_unlock(ev->lock);
+   }
+}
+
+/* Consumer: announce the intent to sleep and return the ticket for
+ * CDIF_Event_Wait.  The caller must re-check its condition after
+ * this and either wait or cancel. */
+static int CDIF_Event_Prepare(CDIF_Event *ev)
+{
+   return retro_atomic_fetch_or_int(&ev->seq, 1) | 1;
+}
+
+static void CDIF_Event_Cancel(CDIF_Event *ev)
+{
+   retro_atomic_fetch_and_int(&ev->seq, ~1);
+}
+
+/* Sleep until a notification after `ticket`.  timeout_us < 0 waits
+ * indefinitely; returns false on timeout. */
+static bool CDIF_Event_Wait(CDIF_Event *ev, int ticket, int64_t timeout_us)
+{
+   bool woke = true;
+
+   slock_lock(ev->lock);
+   while (retro_atomic_load_acquire_int(&ev->seq) == ticket)
+   {
+      if (timeout_us < 0)
+         scond_wait(ev->cond, ev->lock);
+      else if (!scond_wait_timeout(ev->cond, ev->lock, timeout_us))
+      {
+         woke = retro_atomic_load_acquire_int(&ev->seq) != ticket;
+         break;
+      }
+   }
+   slock_unlock(ev->lock);
+
+   CDIF_Event_Cancel(ev);
+   return woke;
+}
+
 /* ------------------------------------------------------------------
- * CDIF_Queue - fixed-capacity ring buffer of CDIF_Message.
- * Single-producer, single-consumer; mutex protects head/tail/count.
+ * CDIF_Queue - fixed-capacity SPSC ring of CDIF_Message.
+ *
+ * `tail` is written only by the producer and `head` only by the
+ * consumer; the release store of either publishes the slot it moved
+ * past.  Both are free-running counters, masked on use.
  * ------------------------------------------------------------------ */
 
 #define CDIF_QUEUE_SIZE 16
 
 typedef struct CDIF_Queue
 {
-   CDIF_Message ring[CDIF_QUEUE_SIZE];
-   unsigned     head;
-   unsigned     tail;
-   unsigned     count;
-   slock_t     *mutex;
-   scond_t     *cond;
+   CDIF_Message       ring[CDIF_QUEUE_SIZE];
+   retro_atomic_int_t head;
+   retro_atomic_int_t tail;
+   CDIF_Event         ev;
 } CDIF_Queue;
 
 static void CDIF_Queue_Init(CDIF_Queue *q)
 {
-   q->head  = 0;
-   q->tail  = 0;
-   q->count = 0;
-   q->mutex = slock_new();
-   q->cond  = scond_new();
+   retro_atomic_int_init(&q->head, 0);
+   retro_atomic_int_init(&q->tail, 0);
+   CDIF_Event_Init(&q->ev);
 }
 
 static void CDIF_Queue_Free(CDIF_Queue *q)
 {
-   if (q->mutex)
-      slock_free(q->mutex);
-   if (q->cond)
-      scond_free(q->cond);
-   q->mutex = NULL;
-   q->cond  = NULL;
+   CDIF_Event_Free(&q->ev);
 }
 
-static bool CDIF_Queue_Read(CDIF_Queue *q, CDIF_Message *out, bool blocking)
+/* Producer side.  Returns false, and posts nothing, if full. */
+static bool CDIF_Queue_Write(CDIF_Queue *q, const CDIF_Message *msg)
 {
-   bool ret = true;
+   int tail = retro_atomic_load_acquire_int(&q->tail);
 
-   slock_lock(q->mutex);
+   if (tail - retro_atomic_load_acquire_int(&q->head) >= CDIF_QUEUE_SIZE)
+      return false;
 
-   if (blocking)
-   {
-      while (q->count == 0)
-         scond_wait(q->cond, q->mutex);
-   }
+   q->ring[tail & (CDIF_QUEUE_SIZE - 1)] = *msg;
+   retro_atomic_store_release_int(&q->tail, tail + 1);
+   CDIF_Event_Notify(&q->ev);
+   return true;
+}
 
-   if (q->count == 0)
-      ret = false;
-   else
-   {
-      *out = q->ring[q->head];
-      q->head = (q->head + 1) & (CDIF_QUEUE_SIZE - 1);
-      q->count--;
-   }
+/* Consumer side, non-blocking. */
+static bool CDIF_Queue_TryRead(CDIF_Queue *q, CDIF_Message *out)
+{
+   int head = retro_atomic_load_acquire_int(&q->head);
 
-   slock_unlock(q->mutex);
+   if (head == retro_atomic_load_acquire_int(&q->tail))
+      return false;
 
-   return ret;
+   *out = q->ring[head & (CDIF_QUEUE_SIZE - 1)];
+   retro_atomic_store_release_int(&q->head, head + 1);
+   return true;
 }
 
-static void CDIF_Queue_Write(CDIF_Queue *q, const CDIF_Message *msg)
+/* Consumer side, blocking. */
+static void CDIF_Queue_Read(CDIF_Queue *q, CDIF_Message *out)
 {
-   slock_lock(q->mutex);
-
-   if (q->count < CDIF_QUEUE_SIZE)
+   for (;;)
    {
-      q->ring[q->tail] = *msg;
-      q->tail = (q->tail + 1) & (CDIF_QUEUE_SIZE - 1);
-      q->count++;
+      int ticket;
+
+      if (CDIF_Queue_TryRead(q, out))
+         return;
+
+      ticket = CDIF_Event_Prepare(&q->ev);
+      if (CDIF_Queue_TryRead(q, out))
+      {
+         CDIF_Event_Cancel(&q->ev);
+         return;
+      }
+      CDIF_Event_Wait(&q->ev, ticket, -1);
    }
+}
 
-   scond_signal(q->cond);
-   slock_unlock(q->mutex);
+/* A message the sender waits on the reply to (EJECT, DIEDIEDIE) must
+ * not be lost.  The read thread drains the queue every time round its
+ * loop, so a full queue only means it is inside one backend read. */
+static void CDIF_Queue_WriteControl(CDIF_Queue *q, const CDIF_Message *msg)
+{
+   while (!CDIF_Queue_Write(q, msg))
+      retro_sleep(1);
 }
+#endif
 
 /* ------------------------------------------------------------------
  * Sector-ring slot.
@@ -183,14 +318,39 @@ static void CDIF_Queue_Write(CDIF_Queue *q, const CDIF_Message *msg)
 #define SBSIZE 256
 #define SECTOR_RAW_BYTES (2352 + 96)
 
+/* Slot lba & (SBSIZE - 1) holds lba.  `seq` is odd while the read
+ * thread rewrites the slot; the other fields are only trusted if
+ * `seq` was even and unchanged across reading them. */
 typedef struct CDIF_Sector_Buffer
 {
+#ifdef CDIF_HAVE_MT
+   retro_atomic_int_t seq;
+#endif
    bool     valid;
    bool     error;
    uint32_t lba;
    uint8_t  data[SECTOR_RAW_BYTES];
 } CDIF_Sector_Buffer;
 
+/* ------------------------------------------------------------------
+ * ISO9660 file extents and the prefetch window.
+ * ------------------------------------------------------------------ */
+
+/* 2 MB of user data: a file the size of PS1 main RAM, the most any
+ * game loads in one go. */
+#define CDIF_PF_SECTORS      1024
+#define CDIF_PF_MAX_EXTENTS  8192
+#define CDIF_PF_MAX_DIRS     1024
+/* Directories beyond this many sectors are truncated; a 64-sector
+ * directory already holds well over a thousand entries. */
+#define CDIF_PF_MAX_DIR_SECTORS 64
+
+typedef struct CDIF_Extent
+{
+   uint32_t lba;
+   uint32_t count;
+} CDIF_Extent;
+
 /* ------------------------------------------------------------------
  * CDIF - one disc instance.
  * ------------------------------------------------------------------ */
@@ -203,25 +363,336 @@ struct CDIF
    TOC        disc_toc;
    CDAccess  *disc_cdaccess;
 
+#ifdef CDIF_HAVE_MT
    /* MT-only */
    sthread_t *CDReadThread;
    CDIF_Queue ReadThreadQueue;
    CDIF_Queue EmuThreadQueue;
 
+   /* A READ_SECTOR that found ReadThreadQueue full, as lba + 1 (0 for
+    * none).  Only the newest matters: it is what the emu thread is
+    * waiting on. */
+   retro_atomic_int_t hint_overflow;
+
    CDIF_Sector_Buffer SectorBuffers[SBSIZE];
-   uint32_t   SBWritePos;
-   slock_t   *SBMutex;
-   scond_t   *SBCond;
+   /* Notified for every sector published to the ring or window. */
+   CDIF_Event SBEvent;
 
    uint32_t   ra_lba;
    int        ra_count;
    uint32_t   last_read_lba;
+
+   /* File extents of the data track, sorted by lba.  Built and read
+    * by the read thread only. */
+   CDIF_Extent *extents;
+   unsigned     extent_count;
+
+   /* Prefetch window: sectors [pf_lba, pf_lba + pf_filled) are valid
+    * in pf_data.  pf_seq is odd while the window is being moved to a
+    * new file; pf_filled only grows between moves, by release store
+    * after the sector is in place.  pf_len, the size of the file
+    * being fetched, is read-thread only. */
+   uint8_t   *pf_data;
+   retro_atomic_int_t pf_seq;
+   retro_atomic_int_t pf_lba;
+   retro_atomic_int_t pf_filled;
+   uint32_t   pf_len;
+#endif
 };
 
+#ifdef CDIF_HAVE_MT
 /* ------------------------------------------------------------------
  * MT read-thread implementation.
  * ------------------------------------------------------------------ */
 
+/* Seqlock write side, read thread only. */
+static void CDIF_RT_SeqBegin(retro_atomic_int_t *seq)
+{
+   retro_atomic_store_release_int(seq, retro_atomic_load_acquire_int(seq) + 1);
+   retro_atomic_thread_fence_release();
+}
+
+static void CDIF_RT_SeqEnd(retro_atomic_int_t *seq)
+{
+   retro_atomic_store_release_int(seq, retro_atomic_load_acquire_int(seq) + 1);
+}
+
+static uint32_t CDIF_RT_PrefetchFilled(CDIF *cdif)
+{
+   return (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_filled);
+}
+
+/* Point the window at a new file (len 0 to empty it). */
+static void CDIF_RT_MoveWindow(CDIF *cdif, uint32_t lba, uint32_t len)
+{
+   CDIF_RT_SeqBegin(&cdif->pf_seq);
+   retro_atomic_store_release_int(&cdif->pf_filled, 0);
+   retro_atomic_store_release_int(&cdif->pf_lba, (int)lba);
+   CDIF_RT_SeqEnd(&cdif->pf_seq);
+   cdif->pf_len = len;
+}
+
+static uint32_t CDIF_LE32(const uint8_t *p)
+{
+   return (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+      | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* User data of a mode 1 or mode 2 form 1 sector, read into raw;
+ * NULL for anything else. */
+static const uint8_t *CDIF_RT_UserData(CDIF *cdif, uint8_t *raw,
+      uint32_t lba)
+{
+   if (lba >= cdif->disc_toc.tracks[100].lba)
+      return NULL;
+   if (!cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess, raw, lba))
+      return NULL;
+
+   switch (raw[12 + 3])
+   {
+      case 1:
+         return raw + 12 + 4;
+      case 2:
+         return raw + 12 + 4 + 8;
+   }
+   return NULL;
+}
+
+static int CDIF_ExtentCompare(const void *a, const void *b)
+{
+   const CDIF_Extent *ea = (const CDIF_Extent *)a;
+   const CDIF_Extent *eb = (const CDIF_Extent *)b;
+
+   if (ea->lba != eb->lba)
+      return (ea->lba < eb->lba) ? -1 : 1;
+   return 0;
+}
+
+/* Rebuild cdif->extents from the ISO9660 file system on the first
+ * track.  Any failure (audio first track, no PVD, truncated or
+ * damaged directories) just leaves fewer or no extents; prefetch is
+ * an optimisation and the disc reads the same without it. */
+static void CDIF_RT_BuildExtentIndex(CDIF *cdif)
+{
+   uint8_t      raw[SECTOR_RAW_BYTES];
+   const TOC   *toc = &cdif->disc_toc;
+   const uint8_t *ud;
+   CDIF_Extent *dirs;
+   unsigned     dir_head  = 0;
+   unsigned     dir_count = 0;
+   uint32_t     base, leadout, s;
+
+   free(cdif->extents);
+   cdif->extents      = NULL;
+   cdif->extent_count = 0;
+
+   if (!(toc->tracks[toc->first_track].control & SUBQ_CTRLF_DATA))
+      return;
+
+   base    = toc->tracks[toc->first_track].lba;
+   leadout = toc->tracks[100].lba;
+
+   /* Volume descriptors start at sector 16; stop at the terminator. */
+   for (s = 16; s < 48; s++)
+   {
+      if (!(ud = CDIF_RT_UserData(cdif, raw, base + s))
+            || memcmp(&ud[1], "CD001", 5) || ud[0] == 0xFF)
+         return;
+      if (ud[0] == 0x01)
+         break;
+   }
+   if (s == 48)
+      return;
+
+   dirs          = (CDIF_Extent *)malloc(CDIF_PF_MAX_DIRS * sizeof(*dirs));
+   cdif->extents = (CDIF_Extent *)malloc(CDIF_PF_MAX_EXTENTS * sizeof(*cdif->extents));
+   if (!dirs || !cdif->extents)
+   {
+      free(dirs);
+      free(cdif->extents);
+      cdif->extents = NULL;
+      return;
+   }
+
+   /* Root directory record, PVD bytes 156-189: extent at +2, data
+    * length at +10 (both-endian fields; the LE half is first). */
+   dirs[dir_count].lba   = CDIF_LE32(&ud[156 + 2]);
+   dirs[dir_count].count = CDIF_LE32(&ud[156 + 10]);
+   dir_count++;
+
+   /* Breadth-first over the directory tree.  "." and ".." are
+    * skipped; the CDIF_PF_MAX_DIRS cap bounds the walk on a disc
+    * whose directories point back into themselves. */
+   while (dir_head < dir_count)
+   {
+      const CDIF_Extent dir = dirs[dir_head++];
+      uint32_t          nsec = (dir.count + 2047) / 2048;
+
+      if (nsec > CDIF_PF_MAX_DIR_SECTORS)
+         nsec = CDIF_PF_MAX_DIR_SECTORS;
+
+      for (s = 0; s < nsec; s++)
+      {
+         unsigned off = 0;
+
+         if (!(ud = CDIF_RT_UserData(cdif, raw, base + dir.lba + s)))
+            break;
+
+         /* Records never cross a sector; a zero length byte pads the
+          * rest of the sector. */
+         while (off + 34 <= 2048 && ud[off] >= 34 && off + ud[off] <= 2048)
+         {
+            const uint8_t *dr   = &ud[off];
+            const uint32_t lba  = CDIF_LE32(&dr[2]);
+            const uint32_t size = CDIF_LE32(&dr[10]);
+
+            off += dr[0];
+
+            if (dr[32] == 1 && dr[33] <= 1)
+               continue;
+
+            if (dr[25] & 0x02)
+            {
+               if (dir_count < CDIF_PF_MAX_DIRS)
+               {
+                  dirs[dir_count].lba   = lba;
+                  dirs[dir_count].count = size;
+                  dir_count++;
+               }
+            }
+            else
+            {
+               const uint32_t count = (size + 2047) / 2048;
+
+               /* Single-sector files gain nothing over the ring. */
+               if (count >= 2 && count <= CDIF_PF_SECTORS
+                     && base + lba + count <= leadout
+                     && cdif->extent_count < CDIF_PF_MAX_EXTENTS)
+               {
+                  cdif->extents[cdif->extent_count].lba   = base + lba;
+                  cdif->extents[cdif->extent_count].count = count;
+                  cdif->extent_count++;
+               }
+            }
+         }
+      }
+   }
+
+   free(dirs);
+
+   if (cdif->extent_count)
+   {
+      unsigned i, n = 1;
+
+      qsort(cdif->extents, cdif->extent_count, sizeof(*cdif->extents),
+            CDIF_ExtentCompare);
+      /* Hard links share a start; keep one. */
+      for (i = 1; i < cdif->extent_count; i++)
+         if (cdif->extents[i].lba != cdif->extents[n - 1].lba)
+            cdif->extents[n++] = cdif->extents[i];
+      cdif->extent_count = n;
+
+      if (!cdif->pf_data)
+         cdif->pf_data = (uint8_t *)malloc(CDIF_PF_SECTORS * SECTOR_RAW_BYTES);
+   }
+
+   if (!cdif->pf_data)
+   {
+      free(cdif->extents);
+      cdif->extents      = NULL;
+      cdif->extent_count = 0;
+   }
+   else if (log_cb)
+      log_cb(RETRO_LOG_INFO, "[CDIF] Indexed %u file extents for prefetch.\n",
+            cdif->extent_count);
+}
+
+/* Start fetching the file whose first sector is lba, if there is
+ * one and it is not the file already in the window. */
+static void CDIF_RT_StartPrefetch(CDIF *cdif, uint32_t lba)
+{
+   unsigned lo = 0, hi = cdif->extent_count;
+
+   if (lba - (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_lba) < cdif->pf_len)
+      return;
+
+   while (lo < hi)
+   {
+      unsigned mid = (lo + hi) >> 1;
+
+      if (cdif->extents[mid].lba < lba)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (lo == cdif->extent_count || cdif->extents[lo].lba != lba)
+      return;
+
+   CDIF_RT_MoveWindow(cdif, lba, cdif->extents[lo].count);
+}
+
+/* Read the next sector of the file being fetched.  The slot past
+ * pf_filled is invisible to readers until the release store. */
+static void CDIF_RT_FillPrefetch(CDIF *cdif)
+{
+   const uint32_t filled = CDIF_RT_PrefetchFilled(cdif);
+
+   cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess,
+         cdif->pf_data + (size_t)filled * SECTOR_RAW_BYTES,
+         (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_lba) + filled);
+
+   retro_atomic_store_release_int(&cdif->pf_filled, (int)(filled + 1));
+   CDIF_Event_Notify(&cdif->SBEvent);
+}
+
+/* Read lba into its ring slot. */
+static void CDIF_RT_FillSlot(CDIF *cdif, uint32_t lba)
+{
+   CDIF_Sector_Buffer *slot = &cdif->SectorBuffers[lba & (SBSIZE - 1)];
+
+   CDIF_RT_SeqBegin(&slot->seq);
+   /* Read directly into the slot - saves a 2448-byte memcpy. */
+   cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess, slot->data, lba);
+   slot->lba   = lba;
+   slot->error = false;
+   slot->valid = true;
+   CDIF_RT_SeqEnd(&slot->seq);
+
+   CDIF_Event_Notify(&cdif->SBEvent);
+}
+
+/* Whether lba is already in its ring slot or the prefetch window.
+ * Read thread only: it is the sole writer of both. */
+static bool CDIF_RT_Holds(CDIF *cdif, uint32_t lba)
+{
+   const CDIF_Sector_Buffer *slot = &cdif->SectorBuffers[lba & (SBSIZE - 1)];
+
+   if (slot->valid && slot->lba == lba)
+      return true;
+   return lba - (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_lba)
+      < CDIF_RT_PrefetchFilled(cdif);
+}
+
+/* Next message for the read thread: the queue first, then a
+ * READ_SECTOR that overflowed it. */
+static bool CDIF_RT_NextMessage(CDIF *cdif, CDIF_Message *msg)
+{
+   int hint;
+
+   if (CDIF_Queue_TryRead(&cdif->ReadThreadQueue, msg))
+      return true;
+
+   hint = retro_atomic_exchange_int(&cdif->hint_overflow, 0);
+   if (!hint)
+      return false;
+
+   msg->message = CDIF_MSG_READ_SECTOR;
+   msg->args[0] = (uint32_t)(hint - 1);
+   msg->args[1] = msg->args[2] = msg->args[3] = 0;
+   return true;
+}
+
 static bool CDIF_RT_EjectDisc(CDIF *cdif, bool eject_status,
       bool skip_actual_eject)
 {
@@ -236,6 +707,8 @@ static bool CDIF_RT_EjectDisc(CDIF *cdif, bool eject_status,
       if (!skip_actual_eject)
          cdif->disc_cdaccess->Eject(cdif->disc_cdaccess, eject_status);
 
+      CDIF_RT_MoveWindow(cdif, 0, 0);
+
       if (!eject_status)
       {
          cdif->disc_cdaccess->Read_TOC(cdif->disc_cdaccess, &cdif->disc_toc);
@@ -249,14 +722,19 @@ static bool CDIF_RT_EjectDisc(CDIF *cdif, bool eject_status,
                   cdif->disc_toc.first_track, cdif->disc_toc.last_track);
             return false;
          }
+
+         CDIF_RT_BuildExtentIndex(cdif);
       }
 
-      cdif->SBWritePos    = 0;
       cdif->ra_lba        = 0;
       cdif->ra_count      = 0;
       cdif->last_read_lba = ~0U;
       for (i = 0; i < SBSIZE; i++)
+      {
+         CDIF_RT_SeqBegin(&cdif->SectorBuffers[i].seq);
          cdif->SectorBuffers[i].valid = false;
+         CDIF_RT_SeqEnd(&cdif->SectorBuffers[i].seq);
+      }
    }
 
    return true;
@@ -272,7 +750,6 @@ static int CDIF_ReadThread(void *v_arg)
    memset(done_msg.args, 0, sizeof(done_msg.args));
 
    cdif->DiscEjected   = true;
-   cdif->SBWritePos    = 0;
    cdif->ra_lba        = 0;
    cdif->ra_count      = 0;
    cdif->last_read_lba = ~0U;
@@ -289,10 +766,28 @@ static int CDIF_ReadThread(void *v_arg)
    while (Running)
    {
       CDIF_Message msg;
-      bool got_msg = CDIF_Queue_Read(&cdif->ReadThreadQueue, &msg,
-            cdif->ra_count ? false : true);
+      bool got_msg = CDIF_RT_NextMessage(cdif, &msg);
+
+      /* Nothing to read ahead and nothing asked: sleep. */
+      if (!got_msg && !cdif->ra_count
+            && CDIF_RT_PrefetchFilled(cdif) >= cdif->pf_len)
+      {
+         int ticket = CDIF_Event_Prepare(&cdif->ReadThreadQueue.ev);
+
+         if ((got_msg = CDIF_RT_NextMessage(cdif, &msg)))
+            CDIF_Event_Cancel(&cdif->ReadThreadQueue.ev);
+         else
+         {
+            CDIF_Event_Wait(&cdif->ReadThreadQueue.ev, ticket, -1);
+            continue;
+         }
+      }
 
-      if (got_msg)
+      /* Drain everything queued before touching the disc again.  A
+       * sector served from the prefetch window returns at once, so
+       * the emu thread can post reads faster than one per sector read
+       * here. */
+      while (got_msg)
       {
          switch (msg.message)
          {
@@ -332,9 +827,27 @@ static int CDIF_ReadThread(void *v_arg)
                }
 
                cdif->last_read_lba = new_lba;
+
+               if (cdif->extent_count)
+                  CDIF_RT_StartPrefetch(cdif, new_lba);
+
+               /* The emu thread posts once and then waits, so the
+                * sector asked for must be on its way whatever the
+                * pattern above decided.  A batch of hints drained
+                * together (sectors already in the ring answer at once)
+                * can otherwise leave ra_lba behind it. */
+               if (new_lba - cdif->ra_lba >= (uint32_t)cdif->ra_count
+                     && !CDIF_RT_Holds(cdif, new_lba))
+               {
+                  cdif->ra_lba = new_lba;
+                  if (!cdif->ra_count)
+                     cdif->ra_count = initial_ra;
+               }
                break;
             }
          }
+
+         got_msg = Running && CDIF_RT_NextMessage(cdif, &msg);
       }
 
       if (cdif->ra_count
@@ -343,34 +856,84 @@ static int CDIF_ReadThread(void *v_arg)
 
       if (cdif->ra_count)
       {
-         CDIF_Sector_Buffer *slot = &cdif->SectorBuffers[cdif->SBWritePos];
-
-         /* Mark stale before reading so a concurrent ReadRawSector
-          * never returns half-written data from this slot. */
-         slock_lock(cdif->SBMutex);
-         slot->valid = false;
-         slock_unlock(cdif->SBMutex);
-
-         /* Read directly into the slot - saves a 2448-byte memcpy. */
-         cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess, slot->data,
-               cdif->ra_lba);
-
-         slock_lock(cdif->SBMutex);
-         slot->lba   = cdif->ra_lba;
-         slot->error = false;
-         slot->valid = true;
-         cdif->SBWritePos = (cdif->SBWritePos + 1) % SBSIZE;
-         scond_signal(cdif->SBCond);
-         slock_unlock(cdif->SBMutex);
+         const uint32_t pf_lba    = (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_lba);
+         const uint32_t pf_filled = CDIF_RT_PrefetchFilled(cdif);
+
+         if (cdif->ra_lba - pf_lba < pf_filled)
+         {
+            /* Already fetched with the rest of its file. */
+         }
+         else if (cdif->ra_lba == pf_lba + pf_filled && pf_filled < cdif->pf_len)
+            CDIF_RT_FillPrefetch(cdif);
+         else
+            CDIF_RT_FillSlot(cdif, cdif->ra_lba);
 
          cdif->ra_lba++;
          cdif->ra_count--;
       }
+      else if (CDIF_RT_PrefetchFilled(cdif) < cdif->pf_len)
+         CDIF_RT_FillPrefetch(cdif);
    }
 
    return 1;
 }
 
+/* Emu thread: copy lba out of the prefetch window or its ring slot.
+ * False if it is in neither, or was being replaced while copied. */
+static bool CDIF_TryReadSector(CDIF *cdif, uint8_t *buf, uint32_t lba,
+      bool *error)
+{
+   CDIF_Sector_Buffer *slot;
+   int                 seq;
+
+   seq = retro_atomic_load_acquire_int(&cdif->pf_seq);
+   if (!(seq & 1))
+   {
+      const uint32_t pf_lba    = (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_lba);
+      const uint32_t pf_filled = (uint32_t)retro_atomic_load_acquire_int(&cdif->pf_filled);
+
+      if (lba - pf_lba < pf_filled)
+      {
+         memcpy(buf, cdif->pf_data + (size_t)(lba - pf_lba) * SECTOR_RAW_BYTES,
+               SECTOR_RAW_BYTES);
+         retro_atomic_thread_fence_acquire();
+         if (retro_atomic_load_acquire_int(&cdif->pf_seq) == seq)
+         {
+            *error = false;
+            return true;
+         }
+      }
+   }
+
+   slot = &cdif->SectorBuffers[lba & (SBSIZE - 1)];
+   seq  = retro_atomic_load_acquire_int(&slot->seq);
+   if ((seq & 1) || !slot->valid || slot->lba != lba)
+      return false;
+
+   *error = slot->error;
+   memcpy(buf, slot->data, SECTOR_RAW_BYTES);
+   retro_atomic_thread_fence_acquire();
+   return retro_atomic_load_acquire_int(&slot->seq) == seq;
+}
+
+/* Emu thread: tell the read thread lba is wanted.  Never blocks; if
+ * the queue is full the hint goes to the overflow mailbox instead. */
+static void CDIF_PostReadSector(CDIF *cdif, uint32_t lba)
+{
+   CDIF_Message msg;
+
+   msg.message = CDIF_MSG_READ_SECTOR;
+   msg.args[0] = lba;
+   msg.args[1] = msg.args[2] = msg.args[3] = 0;
+
+   if (!CDIF_Queue_Write(&cdif->ReadThreadQueue, &msg))
+   {
+      retro_atomic_exchange_int(&cdif->hint_overflow, (int)(lba + 1));
+      CDIF_Event_Notify(&cdif->ReadThreadQueue.ev);
+   }
+}
+#endif
+
 /* ------------------------------------------------------------------
  * Public API.
  * ------------------------------------------------------------------ */
@@ -384,14 +947,10 @@ void CDIF_HintReadSector(CDIF *cdif, uint32_t lba)
 {
    if (cdif->UnrecoverableError)
       return;
+#ifdef CDIF_HAVE_MT
    if (cdif->is_mt)
-   {
-      CDIF_Message msg;
-      msg.message = CDIF_MSG_READ_SECTOR;
-      msg.args[0] = lba;
-      msg.args[1] = msg.args[2] = msg.args[3] = 0;
-      CDIF_Queue_Write(&cdif->ReadThreadQueue, &msg);
-   }
+      CDIF_PostReadSector(cdif, lba);
+#endif
 }
 
 bool CDIF_ReadRawSector(CDIF *cdif, uint8_t *buf, uint32_t lba,
@@ -416,61 +975,41 @@ bool CDIF_ReadRawSector(CDIF *cdif, uint8_t *buf, uint32_t lba,
       return false;
    }
 
-   if (!cdif->is_mt)
-   {
-      (void)timeout_us;
-      cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess, buf, lba);
-      return true;
-   }
-   else
+#ifdef CDIF_HAVE_MT
+   if (cdif->is_mt)
    {
-      CDIF_Message msg;
-      bool found           = false;
-      bool error_condition = false;
+      bool error = false;
 
-      msg.message = CDIF_MSG_READ_SECTOR;
-      msg.args[0] = lba;
-      msg.args[1] = msg.args[2] = msg.args[3] = 0;
-      CDIF_Queue_Write(&cdif->ReadThreadQueue, &msg);
-
-      slock_lock(cdif->SBMutex);
+      CDIF_PostReadSector(cdif, lba);
 
-      do
+      for (;;)
       {
-         int i;
-         for (i = 0; i < SBSIZE; i++)
-         {
-            CDIF_Sector_Buffer *slot = &cdif->SectorBuffers[i];
-            if (slot->valid && slot->lba == lba)
-            {
-               error_condition = slot->error;
-               memcpy(buf, slot->data, SECTOR_RAW_BYTES);
-               found = true;
-               break;
-            }
-         }
+         int ticket;
+
+         if (CDIF_TryReadSector(cdif, buf, lba, &error))
+            return !error;
+         if (timeout_us == 0)
+            break;
 
-         if (!found)
+         /* Only now does the read thread have to wake us. */
+         ticket = CDIF_Event_Prepare(&cdif->SBEvent);
+         if (CDIF_TryReadSector(cdif, buf, lba, &error))
          {
-            if (timeout_us >= 0)
-            {
-               if (!scond_wait_timeout(cdif->SBCond, cdif->SBMutex,
-                        timeout_us))
-               {
-                  error_condition = true;
-                  memset(buf, 0, SECTOR_RAW_BYTES);
-                  break;
-               }
-            }
-            else
-               scond_wait(cdif->SBCond, cdif->SBMutex);
+            CDIF_Event_Cancel(&cdif->SBEvent);
+            return !error;
          }
-      } while (!found);
-
-      slock_unlock(cdif->SBMutex);
+         if (!CDIF_Event_Wait(&cdif->SBEvent, ticket, timeout_us))
+            break;
+      }
 
-      return !error_condition;
+      memset(buf, 0, SECTOR_RAW_BYTES);
+      return false;
    }
+#endif
+
+   (void)timeout_us;
+   cdif->disc_cdaccess->Read_Raw_Sector(cdif->disc_cdaccess, buf, lba);
+   return true;
 }
 
 bool CDIF_ReadRawSectorPWOnly(CDIF *cdif, uint8_t *buf, uint32_t lba,
@@ -488,7 +1027,7 @@ bool CDIF_ReadRawSectorPWOnly(CDIF *cdif, uint8_t *buf, uint32_t lba,
       return false;
    }
 
-   if (cdif->is_mt && hint_fullread)
+   if (hint_fullread)
       CDIF_HintReadSector(cdif, lba);
 
    return cdif->disc_cdaccess->Read_Raw_PW(cdif->disc_cdaccess, buf, lba);
@@ -499,6 +1038,7 @@ bool CDIF_Eject(CDIF *cdif, bool eject_status)
    if (cdif->UnrecoverableError)
       return false;
 
+#ifdef CDIF_HAVE_MT
    if (cdif->is_mt)
    {
       CDIF_Message msg;
@@ -506,11 +1046,11 @@ bool CDIF_Eject(CDIF *cdif, bool eject_status)
       msg.message = CDIF_MSG_EJECT;
       msg.args[0] = eject_status ? 1u : 0u;
       msg.args[1] = msg.args[2] = msg.args[3] = 0;
-      CDIF_Queue_Write(&cdif->ReadThreadQueue, &msg);
-      CDIF_Queue_Read(&cdif->EmuThreadQueue, &ack, true);
+      CDIF_Queue_WriteControl(&cdif->ReadThreadQueue, &msg);
+      CDIF_Queue_Read(&cdif->EmuThreadQueue, &ack);
       return true;
    }
-   else
+#endif
    {
       bool old_de = cdif->DiscEjected;
 
@@ -605,26 +1145,25 @@ void CDIF_Close(CDIF *cdif)
    if (!cdif)
       return;
 
+#ifdef CDIF_HAVE_MT
    if (cdif->is_mt)
    {
       CDIF_Message msg;
 
       msg.message = CDIF_MSG_DIEDIEDIE;
       msg.args[0] = msg.args[1] = msg.args[2] = msg.args[3] = 0;
-      CDIF_Queue_Write(&cdif->ReadThreadQueue, &msg);
+      CDIF_Queue_WriteControl(&cdif->ReadThreadQueue, &msg);
 
       sthread_join(cdif->CDReadThread);
 
-      if (cdif->SBMutex)
-         slock_free(cdif->SBMutex);
-      if (cdif->SBCond)
-         scond_free(cdif->SBCond);
-      cdif->SBMutex = NULL;
-      cdif->SBCond  = NULL;
-
+      CDIF_Event_Free(&cdif->SBEvent);
       CDIF_Queue_Free(&cdif->ReadThreadQueue);
       CDIF_Queue_Free(&cdif->EmuThreadQueue);
+
+      free(cdif->extents);
+      free(cdif->pf_data);
    }
+#endif
 
    if (cdif->disc_cdaccess)
       cdif->disc_cdaccess->destroy(cdif->disc_cdaccess);
@@ -637,6 +1176,7 @@ void CDIF_Close(CDIF *cdif)
  * Construction.
  * ------------------------------------------------------------------ */
 
+#ifdef CDIF_HAVE_MT
 static CDIF *CDIF_Open_MT(CDAccess *cda)
 {
    CDIF        *cdif;
@@ -654,18 +1194,26 @@ static CDIF *CDIF_Open_MT(CDAccess *cda)
 
    CDIF_Queue_Init(&cdif->ReadThreadQueue);
    CDIF_Queue_Init(&cdif->EmuThreadQueue);
-
-   cdif->SBMutex = slock_new();
-   cdif->SBCond  = scond_new();
+   CDIF_Event_Init(&cdif->SBEvent);
+   retro_atomic_int_init(&cdif->hint_overflow, 0);
+   retro_atomic_int_init(&cdif->pf_seq, 0);
+   retro_atomic_int_init(&cdif->pf_lba, 0);
+   retro_atomic_int_init(&cdif->pf_filled, 0);
+   {
+      unsigned i;
+      for (i = 0; i < SBSIZE; i++)
+         retro_atomic_int_init(&cdif->SectorBuffers[i].seq, 0);
+   }
 
    cdif->CDReadThread = sthread_create(
          (void (*)(void *))CDIF_ReadThread, cdif);
 
    /* Wait for the read thread to finish initial TOC parsing. */
-   CDIF_Queue_Read(&cdif->EmuThreadQueue, &ack, true);
+   CDIF_Queue_Read(&cdif->EmuThreadQueue, &ack);
 
    return cdif;
 }
+#endif
 
 static CDIF *CDIF_Open_ST(CDAccess *cda)
 {
@@ -719,7 +1267,7 @@ CDIF *CDIF_Open(bool *success, const char *path,
       return NULL;
    }
 
-#if HAVE_THREADS
+#ifdef CDIF_HAVE_MT
    if (!image_memcache)
    {
       cdif = CDIF_Open_MT(cda);
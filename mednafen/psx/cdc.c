@@ -53,9 +53,11 @@
 #include "cdc.h"
 #include "vcd.h"
 #include "spu.h"
+#include "cdc_xa.h"
 
 #include "../mednafen-types.h"
 #include "../../osd_message.h"
+#include "../../frame_profile.h"
 #include "../state_helpers.h"
 #include "../cdrom/cdromif.h"
 
@@ -838,17 +840,6 @@ bool PS_CDC_DecodeSubQ(PS_CDC *cdc, uint8_t *subpw)
    return(false);
 }
 
-static const int16_t CDADPCMImpulse[7][25] =
-{
-   {     0,    -5,    17,   -35,    70,   -23,   -68,   347,  -839,  2062, -4681, 15367, 21472, -5882,  2810, -1352,   635,  -235,    26,    43,   -35,    16,    -8,     2,     0,  }, /* 0 */
-   {     0,    -2,    10,   -34,    65,   -84,    52,     9,  -266,  1024, -2680,  9036, 26516, -6016,  3021, -1571,   848,  -365,   107,    10,   -16,    17,    -8,     3,    -1,  }, /* 1 */
-   {    -2,     0,     3,   -19,    60,   -75,   162,  -227,   306,   -67,  -615,  3229, 29883, -4532,  2488, -1471,   882,  -424,   166,   -27,     5,     6,    -8,     3,    -1,  }, /* 2 */
-   {    -1,     3,    -2,    -5,    31,   -74,   179,  -402,   689,  -926,  1272, -1446, 31033, -1446,  1272,  -926,   689,  -402,   179,   -74,    31,    -5,    -2,     3,    -1,  }, /* 3 */
-   {    -1,     3,    -8,     6,     5,   -27,   166,  -424,   882, -1471,  2488, -4532, 29883,  3229,  -615,   -67,   306,  -227,   162,   -75,    60,   -19,     3,     0,    -2,  }, /* 4 */
-   {    -1,     3,    -8,    17,   -16,    10,   107,  -365,   848, -1571,  3021, -6016, 26516,  9036, -2680,  1024,  -266,     9,    52,   -84,    65,   -34,    10,    -2,     0,  }, /* 5 */
-   {     0,     2,    -8,    16,   -35,    43,    26,  -235,   635, -1352,  2810, -5882, 21472, 15367, -4681,  2062,  -839,   347,   -68,   -23,    70,   -35,    17,    -5,     0,  }, /* 6 */
-};
-
 void PS_CDC_ReadAudioBuffer(PS_CDC *cdc, int32_t samples[2])
 {
    samples[0] = cdc->AudioBuffer.Samples[0][cdc->AudioBuffer.ReadPos];
@@ -910,32 +901,11 @@ void PS_CDC_GetCDAudio(PS_CDC *cdc, int32_t samples[2], const unsigned freq)
    else
    {
       /* Fractional-rate path: 25-tap windowed-sinc resampler per
-       * channel. Was using an int32 out_tmp[2] stack scratch
-       * accumulator; folded directly into samples[i] now since
-       * each channel's accumulation is independent and the final
-       * write was already to samples[i]. */
-      {
-         unsigned i;
-         for (i = 0; i < 2; i++)
-      {
-         const int16_t *imp = CDADPCMImpulse[cdc->ADPCM_ResampCurPhase];
-         int16_t       *wf  = &cdc->ADPCM_ResampBuf[i][(cdc->ADPCM_ResampCurPos + 32 - 25) & 0x1F];
-         int32_t        acc = 0;
-
-         {
-            unsigned s;
-            for (s = 0; s < 25; s++)
-            acc += imp[s] * wf[s];
-         }
-
-         acc >>= 15;
-         /* Saturate resampled output to signed 16-bit; required
-          * by this function's contract per its leading comment. */
-         if      (acc < -32768) acc = -32768;
-         else if (acc >  32767) acc =  32767;
-         samples[i] = acc;
-      }
-      }
+       * channel (cdc_xa.h). */
+      samples[0] = CDC_XA_Resample(cdc->ADPCM_ResampBuf[0],
+            cdc->ADPCM_ResampCurPos, cdc->ADPCM_ResampCurPhase);
+      samples[1] = CDC_XA_Resample(cdc->ADPCM_ResampBuf[1],
+            cdc->ADPCM_ResampCurPos, cdc->ADPCM_ResampCurPhase);
 
       cdc->ADPCM_ResampCurPhase += freq;
 
@@ -979,12 +949,6 @@ typedef struct XA_Subheader
    uint8_t coding_dup;
 } XA_Subheader;
 
-typedef struct XA_SoundGroup
-{
-   uint8_t params[16];
-   uint8_t samples[112];
-} XA_SoundGroup;
-
 #define XA_SUBMODE_EOF		0x80
 #define XA_SUBMODE_REALTIME	0x40
 #define XA_SUBMODE_FORM		0x20
@@ -1003,9 +967,6 @@ typedef struct XA_SoundGroup
 /*#define XA_CODING_SR_378	0x00 */
 /*#define XA_CODING_SR_ */
 
-#define XA_CODING_8BIT		0x10
-#define XA_CODING_189		0x04
-#define XA_CODING_STEREO	0x01
 
 /* Special regression prevention test cases: */
 /*	Um Jammer Lammy (start doing poorly) */
@@ -1053,126 +1014,13 @@ void PS_CDC_ClearAudioBuffers(PS_CDC *cdc)
 }
 
 
-/* output should be readable at -2 and -1 */
-static void DecodeXAADPCM(const uint8_t *input, int16_t *output, const unsigned shift, const unsigned weight)
-{
-   /* Weights copied over from SPU channel ADPCM playback code, */
-   /* may not be entirely the same for CD-XA ADPCM, we need to run tests. */
-   static const int32_t Weights[16][2] =
-   {
-      /* s-1    s-2 */
-      {   0,    0 },
-      {  60,    0 },
-      { 115,  -52 },
-      {  98,  -55 },
-      { 122,  -60 },
-   };
-
-   {
-      int i;
-      for (i = 0; i < 28; i++)
-   {
-      int32_t sample = (int16_t)(input[i] << 8);
-      sample >>= shift;
-
-      sample += ((output[i - 1] * Weights[weight][0]) >> 6) + ((output[i - 2] * Weights[weight][1]) >> 6);
-
-      /* Saturate to signed 16-bit. The clamped value is fed back
-       * via output[i-1]/output[i-2] into subsequent iterations'
-       * IIR-style filter (weights from SPU's ADPCM playback - may
-       * not be exact for CD-XA ADPCM per the comment above). */
-      if      (sample < -32768) sample = -32768;
-      else if (sample >  32767) sample =  32767;
-      output[i] = sample;
-   }
-   }
-}
-
 void PS_CDC_XA_ProcessSector(PS_CDC *cdc, const uint8_t *sdata, CD_Audio_Buffer *ab)
 {
    const XA_Subheader *sh = (const XA_Subheader *)&sdata[12 + 4];
-   const unsigned unit_index_shift = (sh->coding & XA_CODING_8BIT) ? 0 : 1;
 
    ab->ReadPos = 0;
-   ab->Size = 18 * (4 << unit_index_shift) * 28;
-
-   if(sh->coding & XA_CODING_STEREO)
-      ab->Size >>= 1;
-
-   ab->Freq = (sh->coding & XA_CODING_189) ? 3 : 6;
-
-   /*fprintf(stderr, "Coding: %02x %02x\n", sh->coding, sh->coding_dup); */
-
-   {
-      unsigned group;
-      for (group = 0; group < 18; group++)
-   {
-      const XA_SoundGroup *sg = (const XA_SoundGroup *)&sdata[12 + 4 + 8 + group * 128];
-
-      {
-         unsigned unit;
-         for (unit = 0; unit < (4U << unit_index_shift); unit++)
-      {
-         const uint8_t param = sg->params[(unit & 3) | ((unit & 4) << 1)];
-         const uint8_t param_copy = sg->params[4 | (unit & 3) | ((unit & 4) << 1)];
-         uint8_t ibuffer[28];
-         int16_t obuffer[2 + 28];
-         bool ocn;
-
-         {
-            unsigned i;
-            for (i = 0; i < 28; i++)
-         {
-            uint8_t tmp = sg->samples[i * 4 + (unit >> unit_index_shift)];
-
-            if(unit_index_shift)
-            {
-               tmp <<= (unit & 1) ? 0 : 4;
-               tmp &= 0xf0;
-            }
-
-            ibuffer[i] = tmp;
-         }
-         }
-
-         ocn = (bool)(unit & 1) && (sh->coding & XA_CODING_STEREO);
-
-         obuffer[0] = cdc->xa_previous[ocn][0];
-         obuffer[1] = cdc->xa_previous[ocn][1];
-
-         DecodeXAADPCM(ibuffer, &obuffer[2], param & 0x0F, param >> 4);
-
-         cdc->xa_previous[ocn][0] = obuffer[28];
-         cdc->xa_previous[ocn][1] = obuffer[29];
-
-         if(param != param_copy)
-            memset(obuffer, 0, sizeof(obuffer));
-
-         if(sh->coding & XA_CODING_STEREO)
-         {
-            {
-               unsigned s;
-               for (s = 0; s < 28; s++)
-            {
-               ab->Samples[ocn][group * (2 << unit_index_shift) * 28 + (unit >> 1) * 28 + s] = obuffer[2 + s];
-            }
-            }
-         }
-         else
-         {
-            {
-               unsigned s;
-               for (s = 0; s < 28; s++)
-            {
-               ab->Samples[0][group * (4 << unit_index_shift) * 28 + unit * 28 + s] = obuffer[2 + s];
-               ab->Samples[1][group * (4 << unit_index_shift) * 28 + unit * 28 + s] = obuffer[2 + s];
-            }
-            }
-         }
-      }
-      }
-   }
-   }
+   ab->Size    = CDC_XA_DecodeSector(sdata, cdc->xa_previous, ab->Samples);
+   ab->Freq    = (sh->coding & XA_CODING_189) ? 3 : 6;
 }
 
 void PS_CDC_CheckAIP(PS_CDC *cdc)
@@ -1779,7 +1627,9 @@ int32_t PS_CDC_Update(PS_CDC *cdc, const int32_t timestamp)
                cdc->DriveStatus == DS_READING || cdc->DriveStatus == DS_PLAYING ||
                cdc->DriveStatus == DS_SEEKING_LOGICAL2)
             {
+               PROF_PUSH(PROF_CD);
                PS_CDC_HandlePlayRead(cdc);
+               PROF_POP();
             }
          }
       }
@@ -1877,7 +1727,9 @@ int32_t PS_CDC_Update(PS_CDC *cdc, const int32_t timestamp)
          }
       }
 
+      PROF_PUSH(PROF_SPU);
       cdc->SPUCounter = SPU_UpdateFromCDC(chunk_clocks);
+      PROF_POP();
 
       clocks -= chunk_clocks;
    }  /* end while(clocks > 0) */
@@ -2084,6 +1936,30 @@ uint32_t CDC_DMARead(void)
    return PS_CDC_DMARead(PSX_CDC);
 }
 
+/* Each DMA word takes up to four bytes from the FIFO, low byte first,
+ * and zero-fills whatever the FIFO runs short of. Stored little-endian
+ * that is just the FIFO's bytes in order followed by zeroes, so copy
+ * out of the ring in at most two pieces. */
+void CDC_DMAReadBlock(uint8_t *ram, uint32_t count)
+{
+   SimpleFIFO *f     = &PSX_CDC->DMABuffer;
+   uint32_t    bytes = count * 4;
+   uint32_t    avail = (f->in_count < bytes) ? f->in_count : bytes;
+   uint32_t    first = f->size - f->read_pos;
+
+   if (first > avail)
+      first = avail;
+
+   if (avail)
+   {
+      memcpy(ram, f->data + f->read_pos, first);
+      memcpy(ram + first, f->data, avail - first);
+      f->read_pos  = (f->read_pos + avail) & (f->size - 1);
+      f->in_count -= avail;
+   }
+   memset(ram + avail, 0, bytes - avail);
+}
+
 /*
  * `samples` is always written; both channels are 
  * zeroed when no CD audio is currently
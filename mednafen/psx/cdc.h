@@ -203,6 +203,8 @@ void     PS_CDC_GetCDAudio(PS_CDC *cdc, int32_t samples[2],
                            const unsigned freq);
 
 uint32_t CDC_DMARead(void);
+/* `count` consecutive CDC_DMARead words, stored little-endian at `ram`. */
+void     CDC_DMAReadBlock(uint8_t *ram, uint32_t count);
 
 /*
  * `samples` is always written; if there's no audio playing or the
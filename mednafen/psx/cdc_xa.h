@@ -0,0 +1,350 @@
+#ifndef __MDFN_PSX_CDC_XA_H
+#define __MDFN_PSX_CDC_XA_H
+
+/* CD-XA ADPCM kernels: sound-group decode and the 37.8/18.9 kHz ->
+ * 44.1 kHz resampler.
+ *
+ * Split out of cdc.c so tools/cdc_xa can build the SIMD paths and the
+ * scalar reference side by side and compare them.  Defining
+ * CDC_XA_SCALAR before including this header compiles the scalar
+ * loops only; that build IS the reference, so the scalar loops below
+ * must keep their exact historical behaviour:
+ *
+ *   - a 4-bit sample is the nibble in the top of an int16, shifted
+ *     right arithmetically by the unit's shift (0-15, unclamped);
+ *   - the prediction filter indexes a 16-entry weight table of which
+ *     only 0-4 are non-zero, and adds the two products after shifting
+ *     each by 6, not after summing them;
+ *   - a unit whose parameter byte disagrees with its copy still feeds
+ *     the filter history, but outputs silence.
+ *
+ * What vectorises and what does not:
+ *
+ *   - The resampler is a plain 25-tap dot product.  The impulse table
+ *     is zero-padded to 32 taps so SSE2 does it as four pmaddwd and
+ *     NEON as eight vmlal, with no tail.  The padding taps multiply
+ *     whatever follows the window in ADPCM_ResampBuf; that is still
+ *     inside the 64-entry double buffer, and the product is 0.  No
+ *     partial sum can overflow: pmaddwd only wraps on
+ *     -32768 * -32768 twice, and no impulse tap is -32768.
+ *   - Group decode pulls every unit's 28 samples out of the
+ *     interleaved 112-byte block (a byte column per 8-bit unit, a
+ *     nibble column per 4-bit unit) and applies the unit's shift.  In
+ *     SIMD that is a 32-bit-lane shift-and-mask per column and one
+ *     16-bit arithmetic shift per 8 samples.
+ *   - The prediction filter is a recurrence through a clamp, so each
+ *     sample needs the previous two clamped outputs.  It stays scalar
+ *     and is shared by both builds.
+ *
+ * Instruction sets are picked at compile time, as for the GPU
+ * kernels: SSE2 on x86, else NEON on ARM. */
+
+#include <stdint.h>
+#include <string.h>
+#include <boolean.h>
+
+#include "../mednafen-types.h"
+
+#if !defined(CDC_XA_SCALAR)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CDC_XA_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CDC_XA_NEON 1
+#endif
+#endif
+
+#define XA_CODING_8BIT		0x10
+#define XA_CODING_189		0x04
+#define XA_CODING_STEREO	0x01
+
+/* Samples in one sector: 18 sound groups of up to 8 units of 28. */
+#define CDC_XA_SECTOR_SAMPLES	(18 * 8 * 28)
+
+/* 25 taps per phase, zero-padded to 32 for the SIMD dot products. */
+static const int16_t CDADPCMImpulse[7][32] =
+{
+   {     0,    -5,    17,   -35,    70,   -23,   -68,   347,  -839,  2062, -4681, 15367, 21472, -5882,  2810, -1352,   635,  -235,    26,    43,   -35,    16,    -8,     2,     0,  }, /* 0 */
+   {     0,    -2,    10,   -34,    65,   -84,    52,     9,  -266,  1024, -2680,  9036, 26516, -6016,  3021, -1571,   848,  -365,   107,    10,   -16,    17,    -8,     3,    -1,  }, /* 1 */
+   {    -2,     0,     3,   -19,    60,   -75,   162,  -227,   306,   -67,  -615,  3229, 29883, -4532,  2488, -1471,   882,  -424,   166,   -27,     5,     6,    -8,     3,    -1,  }, /* 2 */
+   {    -1,     3,    -2,    -5,    31,   -74,   179,  -402,   689,  -926,  1272, -1446, 31033, -1446,  1272,  -926,   689,  -402,   179,   -74,    31,    -5,    -2,     3,    -1,  }, /* 3 */
+   {    -1,     3,    -8,     6,     5,   -27,   166,  -424,   882, -1471,  2488, -4532, 29883,  3229,  -615,   -67,   306,  -227,   162,   -75,    60,   -19,     3,     0,    -2,  }, /* 4 */
+   {    -1,     3,    -8,    17,   -16,    10,   107,  -365,   848, -1571,  3021, -6016, 26516,  9036, -2680,  1024,  -266,     9,    52,   -84,    65,   -34,    10,    -2,     0,  }, /* 5 */
+   {     0,     2,    -8,    16,   -35,    43,    26,  -235,   635, -1352,  2810, -5882, 21472, 15367, -4681,  2062,  -839,   347,   -68,   -23,    70,   -35,    17,    -5,     0,  }, /* 6 */
+};
+
+/* One resampled output sample for one channel.  `buf` is that
+ * channel's 64-entry ADPCM_ResampBuf (the 32-entry ring stored twice,
+ * so the 25-sample window ending at `pos` is contiguous), `phase` is
+ * ADPCM_ResampCurPhase.  Saturated to int16. */
+static INLINE int32_t CDC_XA_Resample(const int16_t *buf, unsigned pos, unsigned phase)
+{
+   const int16_t *imp = CDADPCMImpulse[phase];
+   const int16_t *wf  = &buf[(pos + 32 - 25) & 0x1F];
+   int32_t        acc;
+
+#if defined(CDC_XA_SSE2)
+   {
+      __m128i sum = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&wf[0]),
+            _mm_loadu_si128((const __m128i*)&imp[0]));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&wf[8]),
+               _mm_loadu_si128((const __m128i*)&imp[8])));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&wf[16]),
+               _mm_loadu_si128((const __m128i*)&imp[16])));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&wf[24]),
+               _mm_loadu_si128((const __m128i*)&imp[24])));
+      sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+      sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+      acc = _mm_cvtsi128_si32(sum);
+   }
+#elif defined(CDC_XA_NEON)
+   {
+      int32x4_t sum = vmull_s16(vld1_s16(&wf[0]), vld1_s16(&imp[0]));
+      int32x2_t s2;
+      unsigned  s;
+
+      for (s = 4; s < 32; s += 4)
+         sum = vmlal_s16(sum, vld1_s16(&wf[s]), vld1_s16(&imp[s]));
+      s2  = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+      s2  = vpadd_s32(s2, s2);
+      acc = vget_lane_s32(s2, 0);
+   }
+#else
+   {
+      unsigned s;
+
+      acc = 0;
+      for (s = 0; s < 25; s++)
+         acc += imp[s] * wf[s];
+   }
+#endif
+
+   acc >>= 15;
+   /* Saturate resampled output to signed 16-bit. */
+   if      (acc < -32768) acc = -32768;
+   else if (acc >  32767) acc =  32767;
+   return acc;
+}
+
+/* Unpack and shift the 28 samples of every unit of one 128-byte sound
+ * group.  base[unit][0..27] receives (int16)(raw << 8) >> shift, raw
+ * being the unit's byte (8-bit) or its nibble moved to the top of the
+ * byte (4-bit).  base[unit][28..31] is scratch for the vector stores. */
+static INLINE void CDC_XA_UnpackGroup(const uint8_t *sg, unsigned unit_index_shift,
+      int16_t base[8][32])
+{
+   const uint8_t *params  = sg;
+   const uint8_t *samples = sg + 16;
+   const unsigned units   = 4U << unit_index_shift;
+
+#if defined(CDC_XA_SSE2)
+   const __m128i lo8     = _mm_set1_epi32(0xFF);
+   const __m128i hinib   = _mm_set1_epi16(0xF0);
+   unsigned      col;
+
+   (void)units;
+
+   for (col = 0; col < 4; col++)
+   {
+      const __m128i cnt = _mm_cvtsi32_si128(col * 8);
+      __m128i       raw[4];
+      unsigned      j;
+
+      /* Four rows of four bytes per load; lane r keeps row r's byte
+       * in column `col`.  Pairs of loads pack into eight rows. */
+      for (j = 0; j < 4; j++)
+      {
+         __m128i a = _mm_and_si128(_mm_srl_epi32(
+                  _mm_loadu_si128((const __m128i*)&samples[32 * j]), cnt), lo8);
+         __m128i b = (j < 3)
+            ? _mm_and_si128(_mm_srl_epi32(
+                  _mm_loadu_si128((const __m128i*)&samples[32 * j + 16]), cnt), lo8)
+            : _mm_setzero_si128();
+         raw[j] = _mm_packs_epi32(a, b);
+      }
+
+      if (unit_index_shift)
+      {
+         const unsigned u0 = col * 2, u1 = col * 2 + 1;
+         const __m128i  s0 = _mm_cvtsi32_si128(params[(u0 & 3) | ((u0 & 4) << 1)] & 0x0F);
+         const __m128i  s1 = _mm_cvtsi32_si128(params[(u1 & 3) | ((u1 & 4) << 1)] & 0x0F);
+
+         for (j = 0; j < 4; j++)
+         {
+            _mm_storeu_si128((__m128i*)&base[u0][8 * j],
+                  _mm_sra_epi16(_mm_slli_epi16(raw[j], 12), s0));
+            _mm_storeu_si128((__m128i*)&base[u1][8 * j],
+                  _mm_sra_epi16(_mm_slli_epi16(_mm_and_si128(raw[j], hinib), 8), s1));
+         }
+      }
+      else
+      {
+         const __m128i s = _mm_cvtsi32_si128(params[col] & 0x0F);
+
+         for (j = 0; j < 4; j++)
+            _mm_storeu_si128((__m128i*)&base[col][8 * j],
+                  _mm_sra_epi16(_mm_slli_epi16(raw[j], 8), s));
+      }
+   }
+#elif defined(CDC_XA_NEON)
+   const uint32x4_t lo8   = vdupq_n_u32(0xFF);
+   const int16x8_t  hinib = vdupq_n_s16(0xF0);
+   unsigned         col;
+
+   (void)units;
+
+   for (col = 0; col < 4; col++)
+   {
+      const int32x4_t cnt = vdupq_n_s32(-(int32_t)(col * 8));
+      int16x8_t       raw[4];
+      unsigned        j;
+
+      for (j = 0; j < 4; j++)
+      {
+         uint32x4_t a = vandq_u32(vshlq_u32(
+                  vreinterpretq_u32_u8(vld1q_u8(&samples[32 * j])), cnt), lo8);
+         uint32x4_t b = (j < 3)
+            ? vandq_u32(vshlq_u32(
+                  vreinterpretq_u32_u8(vld1q_u8(&samples[32 * j + 16])), cnt), lo8)
+            : vdupq_n_u32(0);
+         raw[j] = vreinterpretq_s16_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+      }
+
+      if (unit_index_shift)
+      {
+         const unsigned  u0 = col * 2, u1 = col * 2 + 1;
+         const int16x8_t s0 = vdupq_n_s16(-(int16_t)(params[(u0 & 3) | ((u0 & 4) << 1)] & 0x0F));
+         const int16x8_t s1 = vdupq_n_s16(-(int16_t)(params[(u1 & 3) | ((u1 & 4) << 1)] & 0x0F));
+
+         for (j = 0; j < 4; j++)
+         {
+            vst1q_s16(&base[u0][8 * j], vshlq_s16(vshlq_n_s16(raw[j], 12), s0));
+            vst1q_s16(&base[u1][8 * j],
+                  vshlq_s16(vshlq_n_s16(vandq_s16(raw[j], hinib), 8), s1));
+         }
+      }
+      else
+      {
+         const int16x8_t s = vdupq_n_s16(-(int16_t)(params[col] & 0x0F));
+
+         for (j = 0; j < 4; j++)
+            vst1q_s16(&base[col][8 * j], vshlq_s16(vshlq_n_s16(raw[j], 8), s));
+      }
+   }
+#else
+   unsigned unit;
+
+   for (unit = 0; unit < units; unit++)
+   {
+      const unsigned shift = params[(unit & 3) | ((unit & 4) << 1)] & 0x0F;
+      unsigned       i;
+
+      for (i = 0; i < 28; i++)
+      {
+         uint8_t tmp = samples[i * 4 + (unit >> unit_index_shift)];
+         int32_t sample;
+
+         if (unit_index_shift)
+         {
+            tmp <<= (unit & 1) ? 0 : 4;
+            tmp &= 0xf0;
+         }
+
+         sample = (int16_t)(tmp << 8);
+         sample >>= shift;
+         base[unit][i] = sample;
+      }
+   }
+#endif
+}
+
+/* The prediction filter over one unit.  output[-2] and output[-1] hold
+ * the channel's history on entry. */
+static INLINE void CDC_XA_FilterUnit(const int16_t *base, int16_t *output, unsigned weight)
+{
+   /* Weights copied over from SPU channel ADPCM playback code, */
+   /* may not be entirely the same for CD-XA ADPCM, we need to run tests. */
+   static const int32_t Weights[16][2] =
+   {
+      /* s-1    s-2 */
+      {   0,    0 },
+      {  60,    0 },
+      { 115,  -52 },
+      {  98,  -55 },
+      { 122,  -60 },
+   };
+   const int32_t w0 = Weights[weight][0];
+   const int32_t w1 = Weights[weight][1];
+   int           i;
+
+   for (i = 0; i < 28; i++)
+   {
+      int32_t sample = base[i];
+
+      sample += ((output[i - 1] * w0) >> 6) + ((output[i - 2] * w1) >> 6);
+
+      /* Saturate to signed 16-bit. The clamped value is fed back
+       * via output[i-1]/output[i-2] into subsequent iterations. */
+      if      (sample < -32768) sample = -32768;
+      else if (sample >  32767) sample =  32767;
+      output[i] = sample;
+   }
+}
+
+/* Decode the audio of one raw 2352-byte Form 2 sector into
+ * samples[0] (left) and samples[1] (right), updating the per-channel
+ * filter history in xa_previous.  Returns the number of samples
+ * written per channel. */
+static INLINE uint32_t CDC_XA_DecodeSector(const uint8_t *sdata,
+      int16_t xa_previous[2][2], int16_t samples[2][0x1000])
+{
+   const uint8_t  coding           = sdata[12 + 4 + 3];
+   const unsigned unit_index_shift = (coding & XA_CODING_8BIT) ? 0 : 1;
+   const unsigned units            = 4U << unit_index_shift;
+   const bool     stereo           = (coding & XA_CODING_STEREO) != 0;
+   unsigned       group;
+
+   for (group = 0; group < 18; group++)
+   {
+      const uint8_t *sg = &sdata[12 + 4 + 8 + group * 128];
+      int16_t        base[8][32];
+      unsigned       unit;
+
+      CDC_XA_UnpackGroup(sg, unit_index_shift, base);
+
+      for (unit = 0; unit < units; unit++)
+      {
+         const uint8_t param      = sg[(unit & 3) | ((unit & 4) << 1)];
+         const uint8_t param_copy = sg[4 | (unit & 3) | ((unit & 4) << 1)];
+         const bool    ocn        = (unit & 1) && stereo;
+         int16_t       obuffer[2 + 28];
+
+         obuffer[0] = xa_previous[ocn][0];
+         obuffer[1] = xa_previous[ocn][1];
+
+         CDC_XA_FilterUnit(base[unit], &obuffer[2], param >> 4);
+
+         xa_previous[ocn][0] = obuffer[28];
+         xa_previous[ocn][1] = obuffer[29];
+
+         if (param != param_copy)
+            memset(obuffer, 0, sizeof(obuffer));
+
+         if (stereo)
+            memcpy(&samples[ocn][group * (2 << unit_index_shift) * 28 + (unit >> 1) * 28],
+                  &obuffer[2], 28 * sizeof(int16_t));
+         else
+         {
+            memcpy(&samples[0][group * (4 << unit_index_shift) * 28 + unit * 28],
+                  &obuffer[2], 28 * sizeof(int16_t));
+            memcpy(&samples[1][group * (4 << unit_index_shift) * 28 + unit * 28],
+                  &obuffer[2], 28 * sizeof(int16_t));
+         }
+      }
+   }
+
+   return (18 * units * 28) >> (stereo ? 1 : 0);
+}
+
+#endif
@@ -36,6 +36,7 @@
 #include "../math_ops.h"
 #include "../mednafen.h"
 #include "../../osd_message.h"
+#include "../../frame_profile.h"
 
 /* PGXP */
 #include "../pgxp/pgxp_cpu.h"
@@ -131,6 +132,33 @@ static CPU_CP0           cpu_CP0;
 static char              cpu_cache_buf[64 * 1024];
 #endif
 
+/* Idle loop tracking for the interpreter, see CPU_IdleLoop. */
+#define IDLE_LOOP_MAX_OPS 8
+
+static struct
+{
+   uint32_t ds;         /* delay slot address of the tracked branch */
+   uint32_t target;
+   uint32_t reject;     /* delay slot address of a body that can't idle */
+   uint32_t passes;     /* consecutive passes through the loop, up to 2 */
+   int32_t  ts;         /* timestamp at the last pass */
+   int32_t  event_ts;   /* next_event_ts at the last pass */
+   uint32_t written;    /* GPRs the body writes */
+   unsigned nloads;
+   uint32_t load_addr[IDLE_LOOP_MAX_OPS];  /* physical, word aligned */
+   uint32_t inputs[2 * IDLE_LOOP_MAX_OPS]; /* loaded words, then code */
+   unsigned dma_steal;
+   uint32_t gpr[32];
+   uint32_t ld_which;
+   uint32_t ld_value;
+   uint32_t ld_absorb;
+   uint8_t  read_absorb[35];
+   uint8_t  read_absorb_which;
+   uint8_t  read_fudge;
+} cpu_idle;
+
+extern bool psx_skip_idle_loops;
+
 /* Aliases for every PS_CPU instance field used inside this file.
  * Lets the body of methods reference fields by their original bare
  * names (GPR, BACKED_PC, ICache, FastMap, ...) without sprinkling
@@ -202,6 +230,7 @@ static int32_t CPU_RunReal(PS_CPU *self, int32_t timestamp_in);
 static int     lightrec_plugin_init(PS_CPU *self);
 static int32_t lightrec_plugin_execute(PS_CPU *self, int32_t timestamp);
 static void    lightrec_plugin_shutdown(void);
+static void    lightrec_invalidate_loaded_ram(void);
 #endif
 
 /* Local typedef so the body matches the pre-conversion code. */
@@ -460,7 +489,7 @@ int CPU_StateAction(PS_CPU *self, StateMem *sm, const unsigned load, const bool
                next_interpreter = 93;
             }
             else
-               lightrec_invalidate_all(lightrec_state);
+               lightrec_invalidate_loaded_ram();
          }
          else
             lightrec_plugin_init(self);
@@ -860,9 +889,370 @@ static uint32_t NO_INLINE CPU_Exception(uint32_t code, uint32_t PC, const uint32
 
    BDBT = 0;
 
+   /* Passes split by an exception handler aren't comparable. */
+   cpu_idle.passes = 0;
+
    return handler;
 }
 
+/* Idle loop skipping ("Skip Idle Loops" core option).
+ *
+ * Games commonly wait for vblank or for a CD/DMA transfer by spinning
+ * on a short backward branch that only loads a RAM flag set by an
+ * interrupt handler (or I_STAT) and tests it.  Until an event changes
+ * what the loop reads, every pass through it is identical, and
+ * emulating those passes one by one only burns host time.
+ *
+ * CPU_IdleLoop runs on taken backward branches closing a loop of at
+ * most IDLE_LOOP_MAX_OPS instructions, delay slot included.  The body
+ * may only hold ALU ops that can't trap and aligned loads from RAM,
+ * the scratchpad, the BIOS or I_STAT/I_MASK, none of which has side
+ * effects or changes other than through the CPU or an event.  Load
+ * base registers must not be written by the loop, and no register may
+ * carry a value from one pass to the next (which rules out counters
+ * before any state is compared).
+ *
+ * From then on the registers the loop writes, the pending load and
+ * the read/load absorb counters are compared at each pass.  Once a
+ * pass that started with the loop's lines in the instruction cache
+ * ends in the state it started from, every later pass will do the
+ * same in as many cycles, for as long as nothing the pass depends on
+ * changes: the words it loads, its code and the DMA cycle steal.  Only
+ * events change those, so a pass that saw no event qualifies as is,
+ * and one that saw an event does if those inputs are as before it.
+ * The timestamp is then advanced by as many whole passes as fit up to
+ * next_event_ts.  Every instruction of the skipped passes would have
+ * started before the event, so the slice still ends, and the event
+ * and any interrupt still happen, on the very instruction they would
+ * have without the skip.
+ *
+ * Tracking restarts when the loop exits, on every exception and on
+ * every CPU_RunReal call, so passes are never compared across other
+ * code, an exception handler, a savestate load or a timestamp
+ * rebase. */
+
+/* The instruction the interpreter would execute at address, without
+ * charging or filling the instruction cache. */
+static uint32_t IdleLoop_Fetch(uint32_t address)
+{
+   const uint8_t *p;
+   uint32_t       instr;
+
+   if (ICache[(address & 0xFFC) >> 2].TV == address)
+      return ICache[(address & 0xFFC) >> 2].Data;
+
+   p = (const uint8_t *)(FastMap[address >> FAST_MAP_SHIFT] + address);
+#ifdef MSB_FIRST
+   instr = (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#else
+   memcpy(&instr, p, 4);
+#endif
+   return instr;
+}
+
+/* Registers read and written by an instruction allowed in an idle
+ * loop body, and the access size of a load (0 for anything else).
+ * False for any other instruction. */
+static bool IdleLoop_Decode(uint32_t instr, uint32_t *rmask,
+      uint32_t *wmask, unsigned *load_size)
+{
+   const uint32_t rs = (instr >> 21) & 0x1F;
+   const uint32_t rt = (instr >> 16) & 0x1F;
+   const uint32_t rd = (instr >> 11) & 0x1F;
+
+   *load_size = 0;
+
+   switch (instr >> 26)
+   {
+      case 0x00:
+         switch (instr & 0x3F)
+         {
+            case 0x00: /* SLL */
+            case 0x02: /* SRL */
+            case 0x03: /* SRA */
+               *rmask = 1U << rt;
+               break;
+            case 0x04: /* SLLV */
+            case 0x06: /* SRLV */
+            case 0x07: /* SRAV */
+            case 0x21: /* ADDU */
+            case 0x23: /* SUBU */
+            case 0x24: /* AND */
+            case 0x25: /* OR */
+            case 0x26: /* XOR */
+            case 0x27: /* NOR */
+            case 0x2A: /* SLT */
+            case 0x2B: /* SLTU */
+               *rmask = (1U << rs) | (1U << rt);
+               break;
+            default:
+               return false;
+         }
+         *wmask = 1U << rd;
+         break;
+
+      case 0x09: /* ADDIU */
+      case 0x0A: /* SLTI */
+      case 0x0B: /* SLTIU */
+      case 0x0C: /* ANDI */
+      case 0x0D: /* ORI */
+      case 0x0E: /* XORI */
+         *rmask = 1U << rs;
+         *wmask = 1U << rt;
+         break;
+
+      case 0x0F: /* LUI */
+         *rmask = 0;
+         *wmask = 1U << rt;
+         break;
+
+      case 0x20: /* LB */
+      case 0x24: /* LBU */
+         *load_size = 1;
+         goto load;
+      case 0x21: /* LH */
+      case 0x25: /* LHU */
+         *load_size = 2;
+         goto load;
+      case 0x23: /* LW */
+         *load_size = 4;
+      load:
+         *rmask = 1U << rs;
+         *wmask = 1U << rt;
+         break;
+
+      default:
+         return false;
+   }
+
+   *rmask &= ~1U;
+   *wmask &= ~1U;
+   return true;
+}
+
+/* Registers read by the branch closing the loop; false for branches
+ * that link, which write a register the body might also use. */
+static bool IdleLoop_DecodeBranch(uint32_t instr, uint32_t *rmask)
+{
+   const uint32_t rs = (instr >> 21) & 0x1F;
+   const uint32_t rt = (instr >> 16) & 0x1F;
+
+   switch (instr >> 26)
+   {
+      case 0x00: /* JR */
+         if ((instr & 0x3F) != 0x08)
+            return false;
+         *rmask = 1U << rs;
+         break;
+      case 0x01: /* BLTZ, BGEZ */
+         if ((rt & 0x1E) == 0x10)
+            return false;
+         *rmask = 1U << rs;
+         break;
+      case 0x02: /* J */
+         *rmask = 0;
+         break;
+      case 0x04: /* BEQ */
+      case 0x05: /* BNE */
+         *rmask = (1U << rs) | (1U << rt);
+         break;
+      case 0x06: /* BLEZ */
+      case 0x07: /* BGTZ */
+         *rmask = 1U << rs;
+         break;
+      default:
+         return false;
+   }
+
+   *rmask &= ~1U;
+   return true;
+}
+
+/* Checks the loop body from target through the delay slot at ds, the
+ * loads at the current register values, and fills in the registers it
+ * writes and the words it loads. */
+static bool IdleLoop_Validate(uint32_t target, uint32_t ds)
+{
+   uint32_t instr[IDLE_LOOP_MAX_OPS];
+   uint32_t defined = 0;
+   unsigned n       = ((ds - target) >> 2) + 1;
+   unsigned i;
+
+   cpu_idle.written = 0;
+   cpu_idle.nloads  = 0;
+
+   for (i = 0; i < n; i++)
+   {
+      uint32_t rmask, wmask;
+      unsigned size;
+
+      instr[i] = IdleLoop_Fetch(target + (i << 2));
+      if (i == n - 2)
+      {
+         if (!IdleLoop_DecodeBranch(instr[i], &rmask))
+            return false;
+         continue;
+      }
+      if (!IdleLoop_Decode(instr[i], &rmask, &wmask, &size))
+         return false;
+      cpu_idle.written |= wmask;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      const uint32_t rs = (instr[i] >> 21) & 0x1F;
+      uint32_t       rmask, wmask = 0, address;
+      unsigned       size         = 0;
+
+      if (i == n - 2)
+         IdleLoop_DecodeBranch(instr[i], &rmask);
+      else
+         IdleLoop_Decode(instr[i], &rmask, &wmask, &size);
+
+      if (rmask & cpu_idle.written & ~defined)
+         return false;
+      defined |= wmask;
+
+      if (!size)
+         continue;
+
+      address = GPR[rs] + (uint32_t)(int32_t)(int16_t)(instr[i] & 0xFFFF);
+      if ((cpu_idle.written & (1U << rs)) || (address & (size - 1)))
+         return false;
+
+      address &= addr_mask[address >> 29];
+      if (!(address < 0x00800000
+               || (address >= 0x1F800000 && address <= 0x1F8003FF)
+               || (address >= 0x1F801070 && address <= 0x1F801077)
+               || (address >= 0x1FC00000 && address <= 0x1FC7FFFF)))
+         return false;
+
+      cpu_idle.load_addr[cpu_idle.nloads++] = address & ~3U;
+   }
+
+   return true;
+}
+
+/* Samples the inputs of a pass; true if they changed since the last
+ * sample. */
+static bool IdleLoop_Sample(void)
+{
+   const unsigned n       = ((cpu_idle.ds - cpu_idle.target) >> 2) + 1;
+   bool           changed = cpu_idle.dma_steal != PSX_GetDMACycleSteal();
+   unsigned       i;
+
+   cpu_idle.dma_steal = PSX_GetDMACycleSteal();
+
+   for (i = 0; i < cpu_idle.nloads + n; i++)
+   {
+      uint32_t v;
+
+      if (i >= cpu_idle.nloads)
+         v = IdleLoop_Fetch(cpu_idle.target + ((i - cpu_idle.nloads) << 2));
+      else if (cpu_idle.load_addr[i] < 0x00800000)
+         v = MASMEM_ReadU32(MainRAM, cpu_idle.load_addr[i] & 0x1FFFFC);
+      else if (cpu_idle.load_addr[i] <= 0x1F8003FF)
+         v = MASMEM_ReadU32(ScratchRAM, cpu_idle.load_addr[i] & 0x3FC);
+      else if (cpu_idle.load_addr[i] <= 0x1F801077)
+         v = IRQ_Read(cpu_idle.load_addr[i]);
+      else
+         continue; /* BIOS */
+
+      changed |= v != cpu_idle.inputs[i];
+      cpu_idle.inputs[i] = v;
+   }
+
+   return changed;
+}
+
+static bool IdleLoop_SameState(uint32_t LDWhich, uint32_t LDValue)
+{
+   unsigned i;
+
+   if (cpu_idle.ld_which != LDWhich
+         || cpu_idle.ld_value != LDValue
+         || cpu_idle.ld_absorb != LDAbsorb
+         || cpu_idle.read_absorb_which != ReadAbsorbWhich
+         || cpu_idle.read_fudge != ReadFudge
+         || memcmp(cpu_idle.read_absorb, ReadAbsorb, sizeof(cpu_idle.read_absorb)))
+      return false;
+
+   for (i = 1; i < 32; i++)
+      if ((cpu_idle.written & (1U << i)) && cpu_idle.gpr[i] != GPR[i])
+         return false;
+
+   return true;
+}
+
+static void IdleLoop_Snapshot(uint32_t LDWhich, uint32_t LDValue)
+{
+   cpu_idle.ld_which          = LDWhich;
+   cpu_idle.ld_value          = LDValue;
+   cpu_idle.ld_absorb         = LDAbsorb;
+   cpu_idle.read_absorb_which = ReadAbsorbWhich;
+   cpu_idle.read_fudge        = ReadFudge;
+   memcpy(cpu_idle.gpr, GPR, sizeof(cpu_idle.gpr));
+   memcpy(cpu_idle.read_absorb, ReadAbsorb, sizeof(cpu_idle.read_absorb));
+}
+
+/* Called, only while Skip Idle Loops is enabled, by a taken branch at
+ * ds - 4 closing a short enough loop, and by any branch at the tracked
+ * cpu_idle.ds (target being the next instruction when not taken,
+ * ending the loop).  The branch macro tests the option first, so with
+ * it disabled a branch pays one flag check and nothing else.  Returns the
+ * timestamp, advanced past the passes that can be skipped. */
+static int32_t NO_INLINE CPU_IdleLoop(int32_t timestamp, uint32_t ds,
+      uint32_t target, uint32_t LDWhich, uint32_t LDValue)
+{
+   bool same, quiet;
+
+   if (ds != cpu_idle.ds || target != cpu_idle.target || !cpu_idle.passes)
+   {
+      cpu_idle.ds     = ~0U;
+      cpu_idle.passes = 0;
+
+      if ((uint32_t)(ds - target - 4) > (IDLE_LOOP_MAX_OPS - 2) * 4)
+         return timestamp;
+
+      if (!IdleLoop_Validate(target, ds))
+      {
+         cpu_idle.reject = ds;
+         return timestamp;
+      }
+
+      cpu_idle.ds       = ds;
+      cpu_idle.target   = target;
+      cpu_idle.passes   = 1;
+      cpu_idle.ts       = timestamp;
+      cpu_idle.event_ts = next_event_ts;
+      IdleLoop_Sample();
+      IdleLoop_Snapshot(LDWhich, LDValue);
+      return timestamp;
+   }
+
+   same  = IdleLoop_SameState(LDWhich, LDValue);
+   quiet = cpu_idle.event_ts == next_event_ts || !IdleLoop_Sample();
+
+   /* passes >= 2: the pass just run started with every line of the
+    * loop in the instruction cache. */
+   if (same && quiet && cpu_idle.passes >= 2 && !IPCache)
+   {
+      const int32_t period = timestamp - cpu_idle.ts;
+
+      timestamp += (next_event_ts - timestamp) / period * period;
+   }
+
+   if (!same)
+      IdleLoop_Snapshot(LDWhich, LDValue);
+   if (cpu_idle.passes < 2)
+      cpu_idle.passes++;
+
+   cpu_idle.ts       = timestamp;
+   cpu_idle.event_ts = next_event_ts;
+   return timestamp;
+}
+
 #define BACKING_TO_ACTIVE			\
 	PC = BACKED_PC;				\
 	new_PC = BACKED_new_PC;			\
@@ -896,6 +1286,10 @@ static int32_t CPU_RunReal(PS_CPU *self, int32_t timestamp_in)
    gte_ts_done += timestamp;
    muldiv_ts_done += timestamp;
 
+   cpu_idle.ds     = ~0U;
+   cpu_idle.passes = 0;
+   cpu_idle.reject = ~0U;
+
    BACKING_TO_ACTIVE;
 
 #if defined(HAVE_LIGHTREC) && defined(LIGHTREC_DEBUG)
@@ -1023,6 +1417,14 @@ static int32_t CPU_RunReal(PS_CPU *self, int32_t timestamp_in)
 	  BDBT = 3;						\
 	 }							\
 								\
+	 if(psx_skip_idle_loops &&				\
+	    (MDFN_UNLIKELY(PC == cpu_idle.ds) ||		\
+	     (cond && MDFN_UNLIKELY((uint32_t)(PC - new_PC - 4) <=	\
+	      (IDLE_LOOP_MAX_OPS - 2) * 4) &&			\
+	      PC != cpu_idle.reject)))				\
+	  timestamp = CPU_IdleLoop(timestamp, PC, new_PC,	\
+	        LDWhich, LDValue);				\
+								\
 	 BRANCH_DISPATCH					\
 	}
 
@@ -3562,15 +3964,30 @@ static void enable_ram(struct lightrec_state *state, _Bool enable)
 	}
 }
 
+#ifdef HAVE_PROFILE
+static void lightrec_profile_compile(struct lightrec_state *state, bool begin)
+{
+   if (begin)
+      PROF_PUSH(PROF_CPU_COMPILE);
+   else
+      PROF_POP();
+}
+#define LIGHTREC_COMPILE_TIMING lightrec_profile_compile
+#else
+#define LIGHTREC_COMPILE_TIMING NULL
+#endif
+
 static struct lightrec_ops ops = {
 	.cop2_op = cop2_op,
 	.enable_ram = enable_ram,
+	.compile_timing = LIGHTREC_COMPILE_TIMING,
 };
 
 static struct lightrec_ops pgxp_ops = {
 	.cop2_notify = pgxp_cop2_notify,
 	.cop2_op = cop2_op,
 	.enable_ram = enable_ram,
+	.compile_timing = LIGHTREC_COMPILE_TIMING,
 };
 
 static int lightrec_plugin_init(PS_CPU *self)
@@ -3785,9 +4202,92 @@ void CPU_LightrecClear_method(PS_CPU *self, uint32_t addr, uint32_t size)
       lightrec_invalidate(lightrec_state, addr, size * 4);
 }
 
+/* State loads replace all of main RAM, and used to throw the whole code
+ * LUT away with it.  Under run-ahead that happens every frame: every
+ * block then went back through the dispatcher to be re-hashed, and
+ * every entry point in the middle of a block (which has no block of its
+ * own to be re-validated against) was compiled again.
+ *
+ * Instead, CPU_LightrecBeginStateLoad keeps a copy of the RAM pages that
+ * hold compiled code as they were before the load, and the load path
+ * compares them with what the state brought in.  Only the words between
+ * the first and last difference of a changed page are invalidated, the
+ * same way a store into them would be; pages without code need nothing,
+ * and BIOS is not part of a state.  Without a snapshot (allocation
+ * failure, or lightrec created after it was taken) the load falls back
+ * to lightrec_invalidate_all(). */
+#define LOAD_PAGE_SHIFT  12
+#define LOAD_PAGE_SIZE   (1u << LOAD_PAGE_SHIFT)
+#define LOAD_NB_PAGES    ((2048u * 1024u) >> LOAD_PAGE_SHIFT)
+
+static uint8_t                *load_shadow;
+static uint8_t                 load_shadow_valid[LOAD_NB_PAGES];
+static struct lightrec_state  *load_shadow_state;
+
+void CPU_LightrecBeginStateLoad(void)
+{
+   const uint8_t *ram = (const uint8_t *)MainRAM->data8;
+   uint32_t       page;
+
+   load_shadow_state = NULL;
+   if (!lightrec_state || psx_dynarec == DYNAREC_DISABLED)
+      return;
+   if (!load_shadow)
+   {
+      load_shadow = (uint8_t *)malloc(LOAD_NB_PAGES * LOAD_PAGE_SIZE);
+      if (!load_shadow)
+         return;
+   }
+
+   for (page = 0; page < LOAD_NB_PAGES; page++)
+   {
+      load_shadow_valid[page] =
+         lightrec_ram_page_has_code(lightrec_state, page << LOAD_PAGE_SHIFT);
+      if (load_shadow_valid[page])
+         memcpy(load_shadow + (page << LOAD_PAGE_SHIFT),
+               ram + (page << LOAD_PAGE_SHIFT), LOAD_PAGE_SIZE);
+   }
+   load_shadow_state = lightrec_state;
+}
+
+static void lightrec_invalidate_loaded_ram(void)
+{
+   const uint32_t *ram = (const uint32_t *)MainRAM->data8;
+   const uint32_t *old = (const uint32_t *)load_shadow;
+   uint32_t        page;
+
+   if (!load_shadow_state || load_shadow_state != lightrec_state)
+   {
+      lightrec_invalidate_all(lightrec_state);
+      return;
+   }
+   load_shadow_state = NULL;
+
+   for (page = 0; page < LOAD_NB_PAGES; page++)
+   {
+      const uint32_t  base = page << (LOAD_PAGE_SHIFT - 2);
+      const uint32_t  n    = LOAD_PAGE_SIZE / 4;
+      uint32_t        first, last;
+
+      if (!load_shadow_valid[page]
+            || !memcmp(ram + base, old + base, LOAD_PAGE_SIZE))
+         continue;
+
+      for (first = 0; ram[base + first] == old[base + first]; first++)
+         ;
+      for (last = n - 1; ram[base + last] == old[base + last]; last--)
+         ;
+      lightrec_invalidate(lightrec_state, (base + first) << 2,
+            (last - first + 1) << 2);
+   }
+}
+
 static void lightrec_plugin_shutdown(void)
 {
    lightrec_destroy(lightrec_state);
+   free(load_shadow);
+   load_shadow       = NULL;
+   load_shadow_state = NULL;
 }
 
 #endif
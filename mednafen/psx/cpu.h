@@ -180,6 +180,9 @@ void CPU_SetHalt(bool status);
 
 #ifdef HAVE_LIGHTREC
 void CPU_LightrecClear(uint32_t addr, uint32_t size);
+/* Call before a state load overwrites main RAM; CPU_StateAction then
+ * invalidates only the compiled code whose RAM actually changed. */
+void CPU_LightrecBeginStateLoad(void);
 #endif
 
 #ifdef __cplusplus
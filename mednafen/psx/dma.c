@@ -283,6 +283,135 @@ static INLINE void ChRW(const unsigned ch, const uint32_t CRModeCache, const uin
    }
 }
 
+/* Span transfers.
+ *
+ * The payload loop below moves one word per iteration: a switch on the
+ * channel in ChRW, one device call, and the clock, address and word
+ * counter bookkeeping. For the channel modes that carry bulk data -
+ * GPU writes, SPU reads and writes, CDC reads and the OT clear - none
+ * of that bookkeeping can change mid-block: ChCan is only consulted at
+ * block reload, the per-word cost is a constant, and nothing a device
+ * does in response to a word touches the DMA registers. Those modes
+ * instead move a whole span per iteration through the devices' block
+ * handlers.
+ *
+ * A span is as many words as remain in the block, as the clock budget
+ * would have let the loop run (it runs while ClockCounter > 0, so the
+ * last word may take it negative), and as fit before the address wraps
+ * main RAM, which keeps the span contiguous and keeps CurAddr's 0x800000
+ * bus-error bit constant across it. ClockCounter, CurAddr, WordCounter
+ * and the lightrec invalidation range come out exactly as the per-word
+ * loop leaves them.
+ *
+ * Returns the per-word cost, or 0 for modes that stay on the per-word
+ * path (MDEC, GPU reads, channel 5, "BLARGH" mode 0x100, reversed
+ * address order other than the OT clear). */
+static INLINE int32_t ChSpanCost(const unsigned ch, const uint32_t CRModeCache)
+{
+   if(CRModeCache & 0x100)
+      return 0;
+
+   switch(ch)
+   {
+      case CH_GPU:
+         if((CRModeCache & 0x3) == 0x1)
+            return 1;
+         break;
+      case CH_CDC:
+         if(!(CRModeCache & 0x3))
+            return 1 + 8;
+         break;
+      case CH_SPU:
+         if(!(CRModeCache & 0x2))
+            return 1 + 47;
+         break;
+      case CH_OT:
+         if((CRModeCache & 0x3) == 0x2)
+            return 1;
+         break;
+   }
+
+   return 0;
+}
+
+static INLINE void RunChannelSpan(const unsigned ch, const uint32_t CRModeCache,
+      const int32_t cost, uint32_t *inv_min, uint32_t *inv_max, uint32_t *inv_count)
+{
+   Channel *c        = &DMACH[ch];
+   const bool down   = (CRModeCache & 0x2) != 0;
+   uint32_t ram      = c->CurAddr & 0x1FFFFC;
+   uint32_t n        = c->WordCounter ? c->WordCounter : 0x10000;
+   uint32_t by_wrap  = down ? (ram >> 2) + 1 : (0x200000 - ram) >> 2;
+   uint32_t by_clock = 1;
+   uint32_t lo       = ram;
+   uint8_t *p        = MainRAM->data8 + ram;
+
+   /* A block reload charges its own cycles and falls straight through
+    * to one payload word without re-testing the budget, so the first
+    * word is always moved even with ClockCounter already <= 0. */
+   if(c->ClockCounter > 0)
+      by_clock = (uint32_t)((c->ClockCounter + cost - 1) / cost);
+
+   if(n > by_clock)
+      n = by_clock;
+   if(n > by_wrap)
+      n = by_wrap;
+
+   switch(ch)
+   {
+      case CH_GPU:
+         GPU_WriteDMABlock(p, c->CurAddr, n);
+         break;
+
+      case CH_SPU:
+         if(CRModeCache & 0x1)
+            SPU_WriteDMABlock(p, n);
+         else
+            SPU_ReadDMABlock(p, n);
+         break;
+
+      case CH_CDC:
+         CDC_DMAReadBlock(p, n);
+         break;
+
+      case CH_OT:
+         {
+            /* Each entry links to the one below it; the last word of
+             * the block is the end-of-table marker. */
+            uint16_t wc  = c->WordCounter;
+            uint32_t cur = c->CurAddr;
+            uint32_t i;
+
+            for(i = 0; i < n; i++, wc--, cur -= 4)
+               MASMEM_WriteU32(MainRAM, cur & 0x1FFFFC,
+                     (wc == 1) ? 0xFFFFFF : ((cur - 4) & 0x1FFFFF));
+            lo = ram - ((n - 1) << 2);
+         }
+         break;
+   }
+
+#ifdef HAVE_LIGHTREC
+   if(!(CRModeCache & 0x1))
+   {
+      uint32_t hi = lo + ((n - 1) << 2);
+
+      if(!*inv_count || lo < *inv_min)
+         *inv_min = lo;
+      if(!*inv_count || hi > *inv_max)
+         *inv_max = hi;
+      *inv_count += n;
+   }
+#endif
+
+   if(down)
+      c->CurAddr = (c->CurAddr - (n << 2)) & 0xFFFFFF;
+   else
+      c->CurAddr = (c->CurAddr + (n << 2)) & 0xFFFFFF;
+
+   c->WordCounter  -= n;
+   c->ClockCounter -= (int32_t)n * cost;
+}
+
 static INLINE void RunChannel(int32_t timestamp, int32_t clocks, int ch)
 {
 #ifdef HAVE_LIGHTREC
@@ -431,6 +560,7 @@ static INLINE void RunChannel(int32_t timestamp, int32_t clocks, int ch)
          {
             uint32_t vtmp;
             uint32_t voffs = 0;
+            int32_t span_cost;
 
             if(MDFN_UNLIKELY(DMACH[ch].CurAddr & 0x800000))
             {
@@ -440,6 +570,17 @@ static INLINE void RunChannel(int32_t timestamp, int32_t clocks, int ch)
                break;
             }
 
+            span_cost = ChSpanCost(ch, CRModeCache);
+            if(span_cost)
+            {
+#ifdef HAVE_LIGHTREC
+               RunChannelSpan(ch, CRModeCache, span_cost, &inv_min, &inv_max, &inv_count);
+#else
+               RunChannelSpan(ch, CRModeCache, span_cost, NULL, NULL, NULL);
+#endif
+               goto SkipPayloadStuff;
+            }
+
             if(CRModeCache & 0x1)
                vtmp = MASMEM_ReadU32(MainRAM, DMACH[ch].CurAddr & 0x1FFFFC);
 
@@ -75,7 +75,7 @@ static void InputDevice_ResetTS(InputDevice *self_);
 static void InputDevice_SetAMCT(InputDevice *self_, bool);
 static void InputDevice_SetCrosshairsCursor(InputDevice *self_, int cursor);
 static void InputDevice_SetCrosshairsColor(InputDevice *self_, uint32_t color);
-INLINE void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, const unsigned width, const unsigned pix_clock, const unsigned surf_pitchinpix, const unsigned upscale_factor);
+INLINE bool InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, const unsigned width, const unsigned pix_clock, const unsigned surf_pitchinpix, const unsigned upscale_factor);
 int FrontIO_StateAction(FrontIO *self_, StateMem* sm, int load, int data_only);
 static int32_t InputDevice_GPULineHook(InputDevice *self_, const int32_t timestamp, bool vsync, uint32_t *pixels, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider, const unsigned surf_pitchinpix, const unsigned upscale_factor);
 static void InputDevice_UpdateInput(InputDevice *self_, const void *data);
@@ -94,6 +94,7 @@ static void FrontIO_Ctor(FrontIO *self_, bool emulate_memcards_[8], bool emulate
 void FrontIO_SetAMCT(FrontIO *self_, bool enabled);
 void FrontIO_SetCrosshairsCursor(FrontIO *self_, unsigned port, int cursor);
 void FrontIO_SetCrosshairsColor(FrontIO *self_, unsigned port, uint32_t color);
+void FrontIO_SetPadAccessHook(FrontIO *self_, void (*hook)(void));
 static void FrontIO_Destroy(FrontIO *self_);
 int32_t FrontIO_CalcNextEventTS(FrontIO *self_, int32_t timestamp, int32_t next_event);
 static void FrontIO_CheckStartStopPending(FrontIO *self_, int32_t timestamp, bool skip_event_set);
@@ -110,7 +111,7 @@ void FrontIO_LoadMemcard(FrontIO *self_, unsigned int which);
 void FrontIO_LoadMemcardFromPath(FrontIO *self_, unsigned int which, const char *path, bool force_load);
 void FrontIO_SaveMemcard(FrontIO *self_, unsigned int which);
 void FrontIO_SaveMemcardToPath(FrontIO *self_, unsigned int which, const char *path, bool force_save);
-void FrontIO_GPULineHook(FrontIO *self_, const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32_t *pixels, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider, const unsigned surf_pitchinpix, const unsigned upscale_factor);
+bool FrontIO_GPULineHook(FrontIO *self_, const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32_t *pixels, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider, const unsigned surf_pitchinpix, const unsigned upscale_factor);
 static void InputDevice_Gamepad_Ctor(InputDevice *self_);
 static void InputDevice_Gamepad_Power(InputDevice *self_);
 static int InputDevice_Gamepad_StateAction(InputDevice *self_, StateMem* sm, int load, int data_only, const char* section_name);
@@ -264,6 +265,7 @@ struct FrontIO
          bool amct_enabled;
          int chair_cursor[8];
          uint32_t chair_colors[8];
+         void (*pad_access_hook)(void);
 };
 
 static void InputDevice_Power(InputDevice *self_)
@@ -312,6 +314,38 @@ static void InputDevice_SetCrosshairsColor(InputDevice *self_, uint32_t color)
    self->chair_b = (color >>  0) & 0xFF;
 }
 
+/* Lightgun access to the software surface.  Its pixels are XRGB8888,
+ * or RGB565 when psx_sw_rgb565 is set; both helpers take and return
+ * the XRGB8888 encoding and index in pixels of whichever size. */
+static INLINE uint32_t surface_pixel_get(const uint32_t *pixels, int x)
+{
+   if (psx_sw_rgb565)
+   {
+      const uint32_t p = ((const uint16_t*)pixels)[x];
+      const uint32_t r = (p >> 11) & 0x1F;
+      const uint32_t g = (p >>  5) & 0x3F;
+      const uint32_t b =  p        & 0x1F;
+
+      return MAKECOLOR((r << 3) | (r >> 2), (g << 2) | (g >> 4),
+            (b << 3) | (b >> 2), 0);
+   }
+   return pixels[x];
+}
+
+static INLINE void surface_pixel_set(uint32_t *pixels, int x, uint32_t color)
+{
+   if (psx_sw_rgb565)
+   {
+      int r, g, b, a;
+
+      MDFN_DecodeColor(color, &r, &g, &b, &a);
+      ((uint16_t*)pixels)[x] = (uint16_t)(((r & 0xF8) << 8)
+            | ((g & 0xFC) << 3) | (b >> 3));
+   }
+   else
+      pixels[x] = color;
+}
+
 static void crosshair_plot( uint32_t *pixels,
 							int x,
 							unsigned chair_r,
@@ -321,7 +355,7 @@ static void crosshair_plot( uint32_t *pixels,
 	int r, g, b, a;
 	int nr, ng, nb;
 
-	MDFN_DecodeColor(pixels[x], &r, &g, &b, &a);
+	MDFN_DecodeColor(surface_pixel_get(pixels, x), &r, &g, &b, &a);
 
 	nr = (r + chair_r * 3) >> 2;
 	ng = (g + chair_g * 3) >> 2;
@@ -343,20 +377,21 @@ static void crosshair_plot( uint32_t *pixels,
 		}
 	}
 
-	pixels[x] = MAKECOLOR(nr, ng, nb, a);
+	surface_pixel_set(pixels, x, MAKECOLOR(nr, ng, nb, a));
 }
 
-INLINE void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, const unsigned width, const unsigned pix_clock, const unsigned surf_pitchinpix, const unsigned upscale_factor)
+INLINE bool InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, const unsigned width, const unsigned pix_clock, const unsigned surf_pitchinpix, const unsigned upscale_factor)
 {
    int row;
    int32_t x;
+   bool plotted = false;
    InputDevice *self = self_;
 
 	switch ( self->chair_cursor )
 	{
 
 	case SETTING_GUN_CROSSHAIR_OFF:
-		return;
+		return false;
 
 	case SETTING_GUN_CROSSHAIR_CROSS:
 
@@ -384,6 +419,7 @@ INLINE void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, con
             for (row = 0; row < upscale_factor; row++)
             {
                crosshair_plot( pixels, x + (row * surf_pitchinpix), self->chair_r, self->chair_g, self->chair_b );
+               plotted = true;
             }
 			}
 		}
@@ -412,6 +448,7 @@ INLINE void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, con
             for (row = 0; row < upscale_factor; row++)
             {
                crosshair_plot( pixels, x + (row * surf_pitchinpix), self->chair_r, self->chair_g, self->chair_b );
+               plotted = true;
             }
 			}
 		}
@@ -419,6 +456,8 @@ INLINE void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels, con
 		break;
 
 	}; /*  switch ( chair_cursor ) */
+
+   return plotted;
 }
 
 int FrontIO_StateAction(FrontIO *self_, StateMem* sm, int load, int data_only)
@@ -708,6 +747,11 @@ void FrontIO_SetAMCT(FrontIO *self_, bool enabled)
    self->amct_enabled = enabled;
 }
 
+void FrontIO_SetPadAccessHook(FrontIO *self_, void (*hook)(void))
+{
+   self_->pad_access_hook = hook;
+}
+
 void FrontIO_SetCrosshairsCursor(FrontIO *self_, unsigned port, int cursor)
 {
    FrontIO *self = self_;
@@ -851,6 +895,19 @@ void FrontIO_Write(FrontIO *self_, int32_t timestamp, uint32_t A, uint32_t V)
    switch(A & 0xF)
    {
       case 0x0:
+         /* 0x01 is the address byte that opens a controller (or
+          * multitap) transaction; memory cards answer to 0x81.  The
+          * hook fires once and is disarmed, so it runs before the
+          * first pad byte of the frame is clocked out. */
+         if (self->pad_access_hook && (V & 0xFF) == 0x01
+               && (self->Control & 0x2))
+         {
+            void (*hook)(void) = self->pad_access_hook;
+
+            self->pad_access_hook = NULL;
+            hook();
+         }
+
          self->TransmitBuffer = V;
          self->TransmitPending = true;
          self->TransmitInProgress = false;
@@ -1378,9 +1435,10 @@ void FrontIO_SaveMemcardToPathAsync(FrontIO *self_, unsigned int which,
    }
 }
 
-void FrontIO_GPULineHook(FrontIO *self_, const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32_t *pixels, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider, const unsigned surf_pitchinpix, const unsigned upscale_factor)
+bool FrontIO_GPULineHook(FrontIO *self_, const int32_t timestamp, const int32_t line_timestamp, bool vsync, uint32_t *pixels, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider, const unsigned surf_pitchinpix, const unsigned upscale_factor)
 {
    unsigned i;
+   bool drew = false;
    FrontIO *self = self_;
 
    FrontIO_Update(self_, timestamp);
@@ -1409,11 +1467,14 @@ void FrontIO_GPULineHook(FrontIO *self_, const int32_t timestamp, const int32_t
    {
       for (i = 0; i < 8; i++)
       {
-         InputDevice_DrawCrosshairs(self->Devices[i], pixels, width, pix_clock, surf_pitchinpix, upscale_factor);
+         if (InputDevice_DrawCrosshairs(self->Devices[i], pixels, width, pix_clock, surf_pitchinpix, upscale_factor))
+            drew = true;
       }
    }
 
    PSX_SetEventNT(PSX_EVENT_FIO, FrontIO_CalcNextEventTS(self_, timestamp, 0x10000000));
+
+   return drew;
 }
 
 /* ===========================================================================
@@ -4674,7 +4735,7 @@ static int32_t InputDevice_GunCon_GPULineHook(InputDevice *self_, const int32_t
          {
             int r, g, b, a;
 
-            MDFN_DecodeColor(pixels[ix * upscale_factor], &r, &g, &b, &a);
+            MDFN_DecodeColor(surface_pixel_get(pixels, ix * upscale_factor), &r, &g, &b, &a);
 
             if((r + g + b) >= 0x40)	/*  Wrong, but not COMPLETELY ABSOLUTELY wrong, at least. ;) */
             {
@@ -5022,7 +5083,7 @@ static int32_t InputDevice_Justifier_GPULineHook(InputDevice *self_, const int32
       {
          int r, g, b, a;
 
-         MDFN_DecodeColor(pixels[gxa * upscale_factor], &r, &g, &b, &a);
+         MDFN_DecodeColor(surface_pixel_get(pixels, gxa * upscale_factor), &r, &g, &b, &a);
 
          if((r + g + b) >= 0x40)	/*  Wrong, but not COMPLETELY ABSOLUTELY wrong, at least. ;) */
          {
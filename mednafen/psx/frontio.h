@@ -88,8 +88,9 @@ struct InputDevice_VTable
 };
 
 /* The non-virtual InputDevice::DrawCrosshairs.  Free function with
- * the InputDevice * passed explicitly. */
-void InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels,
+ * the InputDevice * passed explicitly.  Returns true if any pixel was
+ * plotted into `pixels`. */
+bool InputDevice_DrawCrosshairs(InputDevice *self_, uint32_t *pixels,
                                 const unsigned width,
                                 const unsigned pix_clock,
                                 const unsigned surf_pitchinpix,
@@ -112,7 +113,9 @@ int32_t  FrontIO_CalcNextEventTS(FrontIO *fio, int32_t timestamp,
 int32_t  FrontIO_Update(FrontIO *fio, int32_t timestamp);
 void     FrontIO_ResetTS(FrontIO *fio);
 
-void     FrontIO_GPULineHook(FrontIO *fio,
+/* Returns true if crosshairs were drawn into `pixels`, i.e. the
+ * surface row no longer matches the plain VRAM scanout. */
+bool     FrontIO_GPULineHook(FrontIO *fio,
                              const int32_t timestamp,
                              const int32_t line_timestamp,
                              bool vsync, uint32_t *pixels,
@@ -130,6 +133,11 @@ void     FrontIO_SetAMCT(FrontIO *fio, bool enabled);
 void     FrontIO_SetCrosshairsCursor(FrontIO *fio, unsigned port, int cursor);
 void     FrontIO_SetCrosshairsColor (FrontIO *fio, unsigned port, uint32_t color);
 
+/* Arm a one-shot callback, run when the game next starts a controller
+ * transaction (before its address byte is clocked out).  NULL disarms.
+ * Used to sample the frontend's input as late as possible. */
+void     FrontIO_SetPadAccessHook(FrontIO *fio, void (*hook)(void));
+
 InputDevice *FrontIO_GetMemcardDevice(FrontIO *fio, unsigned which);
 uint64_t     FrontIO_GetMemcardDirtyCount(FrontIO *fio, unsigned which);
 
@@ -45,6 +45,7 @@
 #include "../state_helpers.h"
 #include "../../rhi/rhi_intf.h"
 #include "../../rhi/tt_trace.h"
+#include "../../frame_profile.h"
 #ifdef PSX_MEASURE_MODULATE
 #include "../../include/debug.h"   /* log_cb */
 #endif
@@ -52,13 +53,42 @@
 #include "../pgxp/pgxp_main.h"
 #include "../pgxp/pgxp_gpu.h"
 #include "../pgxp/pgxp_mem.h"
+#include "../pgxp/pgxp_value.h"
 
 /* Forward decl: gpu_common.h's PlotNativePixel template calls
  * texel_put. The actual definition is below at file scope (static)
  * because it's used only inside this translation unit. */
 static void texel_put(uint32_t x, uint32_t y, uint16_t v);
 
+/*
+ * Per-native-VRAM-row write stamps for the SW scanout row skip.
+ *
+ * Every VRAM writer stores the current vram_stamp into the stamp of
+ * each native row it touches (a plain store, no read-modify-write, so
+ * it is cheap enough for the per-span and per-texel_put sites).  The
+ * scanout takes a fresh stamp each time it converts a row and records
+ * it in scanout_cache; a row whose write stamp is still <= the
+ * recorded one has not been written since, so if the display
+ * parameters for that dest_line also match, the surface row already
+ * holds exactly what ReorderRGB_Var would produce and the conversion
+ * is skipped.  See GPU_ScanoutCacheEntry.
+ *
+ * Writers mark rows before or while writing them; a mark is only
+ * ever conservative (a row marked but not actually changed costs one
+ * redundant conversion, never a stale one).
+ */
+static uint32_t vram_row_stamp[512];
+static uint32_t vram_stamp = 1;
+
+static INLINE void MarkVRAMRow(uint32_t native_y)
+{
+   vram_row_stamp[native_y & 511] = vram_stamp;
+}
+
+#include "gpu_texpage_cache.h"
 #include "gpu_common.h"
+#include "gpu_scanout.h"
+#include "gpu_vram_scale.h"
 
 #include "gpu_polygon.c"
 #include "gpu_sprite.c"
@@ -130,15 +160,31 @@ typedef struct CTEntry CTEntry;
  * TexCache entry sits inside a single line (see gpu.h). */
 MDFN_ALIGN(64) PS_GPU GPU;
 
-/* Scratch handles for PS1-state save/load and resolution rescale.
- * Used as a swap buffer between the GPU.vram (which is at the current
- * upscaled resolution) and the savestate format (which is always
- * stored at 1x for compatibility). Not part of the GPU state itself
- * - merely shared across the multi-stage RestoreStateP1/P2/P3 flow
- * and the GPU_Rescale path. File-scope, no external use. */
+/* Scratch handles for PS1-state save/load.  The savestate format
+ * always stores VRAM at 1x for compatibility.  Not part of the GPU
+ * state itself - merely shared across the multi-stage
+ * RestoreStateP1/P2/P3 flow. File-scope, no external use.
+ *
+ * vram_new is GPU.vram_native while a state is being saved: the
+ * native view already holds exactly the 1x pixels a state stores
+ * (GPU.vram itself at 1x), so saving needs no downscale pass.  Loading
+ * above 1x reads into vram_scale_scratch instead, a 1 MB buffer
+ * allocated the first time it is needed and kept until GPU_Destroy
+ * (under run-ahead or rewind a load runs every frame).  Only once the
+ * whole state has been read does P2 rebuild GPU.vram from it, and the
+ * native view from GPU.vram, so a load that fails partway leaves both
+ * as they were and the two never disagree. */
 static uint32_t  TexCache_Tag[256];
 static uint16_t  TexCache_Data[256][4];
 static uint16_t *vram_new = NULL;
+static uint16_t *vram_scale_scratch = NULL;
+
+/* Id of the renderer's GPU-side copy of VRAM for this state, or 0 when
+ * the state's VRAM is in vram_new (see rhi_intf_snapshot_vram).  Only
+ * states that come back into this instance (same_instance_savestate)
+ * get one, so a state written to disk or handed to another instance
+ * never depends on it. */
+static uint32_t  vram_snapshot;
 
 /*
  * Deferred SW-renderer scanout records.
@@ -167,13 +213,16 @@ static uint16_t *vram_new = NULL;
  * the deinterlacer / surface presentation runs.
  *
  * Only used when both psx_gpu_rasterize_both_fields and the SW
- * renderer are active; other paths keep the original immediate
- * scanout to avoid introducing latency or memory traffic.
+ * renderer are active, or for a whole frame when libretro.c asks for
+ * it (GPU_DeferScanout) so it can convert straight into a frontend
+ * framebuffer once the frame's output geometry is known; other paths
+ * keep the original immediate scanout to avoid introducing latency
+ * or memory traffic.
  */
 typedef struct
 {
    int32_t  dest_line;
-   int32_t  dest_line_other; /* opposite-field surface row to also write */
+   int32_t  dest_line_other; /* opposite-field surface row to also write, or -1 */
    int32_t  vram_y_native;   /* native VRAM row to read into dest_line */
    int32_t  vram_y_other;    /* native VRAM row to read into dest_line_other */
    int32_t  dx_start;
@@ -199,6 +248,7 @@ typedef struct
 
 static GPU_DeferredScanline deferred_scanouts[GPU_DEST_LINE_MAX];
 static unsigned              deferred_scanout_count = 0;
+static bool                  deferred_scanout_all   = false;
 
 /*
  * Per-dest_line cache for the SW renderer's margin zero-fill skip.
@@ -238,12 +288,29 @@ static unsigned              deferred_scanout_count = 0;
  * Sized to GPU_DEST_LINE_MAX so any valid dest_line can index
  * directly without bounds-arithmetic in the hot path.
  */
+/*
+ * The same entry also drives the dirty-row skip: besides the margin
+ * geometry it records which VRAM row was converted into the dest_line
+ * (vram_y, fb_x, rgb24) and the vram_stamp taken at conversion time.
+ * When all of those match and vram_row_stamp[vram_y] has not moved
+ * past `stamp`, the active region is byte-identical to what a fresh
+ * conversion would write and the whole row is skipped.  The skip
+ * additionally needs `content_valid`, which is cleared separately
+ * from `valid` by GPU_InvalidateScanoutRows() when something other
+ * than the scanout (deinterlacer, lightgun crosshairs) has written
+ * into the active region of the surface.
+ */
 typedef struct
 {
    int32_t  dx_start;
    int32_t  dx_end;
    uint32_t dmw;
+   uint32_t vram_y;
+   int32_t  fb_x;
+   uint32_t stamp;
+   bool     rgb24;
    bool     valid;
+   bool     content_valid;
 } GPU_ScanoutCacheEntry;
 
 static GPU_ScanoutCacheEntry scanout_cache[GPU_DEST_LINE_MAX];
@@ -252,7 +319,96 @@ void GPU_InvalidateScanoutCache(void)
 {
    unsigned i;
    for (i = 0; i < GPU_DEST_LINE_MAX; i++)
-      scanout_cache[i].valid = false;
+   {
+      scanout_cache[i].valid         = false;
+      scanout_cache[i].content_valid = false;
+   }
+}
+
+void GPU_InvalidateScanoutRows(void)
+{
+   unsigned i;
+   for (i = 0; i < GPU_DEST_LINE_MAX; i++)
+      scanout_cache[i].content_valid = false;
+}
+
+/* Everything in VRAM changed at once (state load, rescale, power). */
+static void MarkAllVRAMRows(void)
+{
+   unsigned i;
+   TexXCache_Flush(&GPU);
+   for (i = 0; i < 512; i++)
+      vram_row_stamp[i] = vram_stamp;
+}
+
+/* True if dest_line already holds the conversion of native VRAM row
+ * vram_y with this geometry and nothing has written that row since. */
+static INLINE bool ScanoutRowUnchanged(int32_t dest_line,
+      int32_t dx_start, int32_t dx_end, uint32_t dmw,
+      uint32_t vram_y, int32_t fb_x, bool rgb24)
+{
+   const GPU_ScanoutCacheEntry *e;
+
+   if (dest_line < 0 || dest_line >= GPU_DEST_LINE_MAX)
+      return false;
+
+   /* The scanline-0 init zeroes pixels 0 and 1 of every surface row
+    * each frame.  Those are margin pixels unless the active region
+    * starts at the left edge, in which case the row must be redone. */
+   if (dx_start < dx_end && (dx_start << GPU.upscale_shift) < 2)
+      return false;
+
+   e = &scanout_cache[dest_line];
+
+   return e->valid
+       && e->content_valid
+       && e->dx_start == dx_start
+       && e->dx_end   == dx_end
+       && e->dmw      == dmw
+       && e->vram_y   == vram_y
+       && e->fb_x     == fb_x
+       && e->rgb24    == rgb24
+       && vram_row_stamp[vram_y & 511] <= e->stamp;
+}
+
+/* Record a completed conversion of vram_y into dest_line.  Bumps
+ * vram_stamp so any write after this point is seen as newer than the
+ * recorded stamp.  On the (multi-day) wrap of the 32-bit counter all
+ * stamps are rebased and every row is re-converted once. */
+static INLINE void ScanoutRowRecord(int32_t dest_line,
+      int32_t dx_start, int32_t dx_end, uint32_t dmw,
+      uint32_t vram_y, int32_t fb_x, bool rgb24)
+{
+   GPU_ScanoutCacheEntry *e;
+
+   if (dest_line < 0 || dest_line >= GPU_DEST_LINE_MAX)
+      return;
+
+   e                = &scanout_cache[dest_line];
+   e->dx_start      = dx_start;
+   e->dx_end        = dx_end;
+   e->dmw           = dmw;
+   e->vram_y        = vram_y & 511;
+   e->fb_x          = fb_x;
+   e->rgb24         = rgb24;
+   e->stamp         = vram_stamp;
+   e->valid         = true;
+   e->content_valid = true;
+
+   if (MDFN_UNLIKELY(++vram_stamp == UINT32_MAX))
+   {
+      vram_stamp = 1;
+      memset(vram_row_stamp, 0, sizeof(vram_row_stamp));
+      GPU_InvalidateScanoutRows();
+   }
+}
+
+/* First pixel of surface row `row`.  RGB565 rows are pitchinpix
+ * 2-byte pixels, XRGB8888 rows pitchinpix 4-byte ones. */
+static INLINE uint32_t *SurfaceRow(int32_t row)
+{
+   return (uint32_t*)((uint8_t*)GPU.surface->pixels + (size_t)row
+         * GPU.surface->pitchinpix * (psx_sw_rgb565 ? 2 : 4));
 }
 
 static INLINE void InvalidateTexCache(PS_GPU *gpu)
@@ -281,6 +437,11 @@ static INLINE void InvalidateCache(PS_GPU *gpu)
 static void texel_put(uint32_t x, uint32_t y, uint16_t v)
 {
    uint32_t dy, dx;
+   MarkVRAMRow(y);
+   if (GPU.upscale_shift)
+      GPU.vram_native[(y << 10) | x] = v;
+   if (MDFN_UNLIKELY(tex_xc_enabled))
+      TexXCache_Touch(&GPU, y, x, 1);
    x <<= GPU.upscale_shift;
    y <<= GPU.upscale_shift;
 
@@ -525,6 +686,13 @@ static void Command_FBFill(PS_GPU* gpu, const uint32_t *cb)
       if (sw)
       {
          unsigned x = 0;
+         /* The vector path below stores into the row directly rather
+          * than through texel_put, so mark it here.  No texel is
+          * sampled before the row is filled, so reporting it to the
+          * texture page cache ahead of the stores is safe too. */
+         MarkVRAMRow(d_y);
+         if (MDFN_UNLIKELY(tex_xc_enabled))
+            TexXCache_Touch(gpu, d_y, destX, width);
 #if defined(__SSE2__) || defined(GPU_HAVE_NEON)
          /* Native-res 8-pixel fast path.  At upscale_shift == 0,
           * texel_put() reduces to a single vram_put() into a flat
@@ -1117,6 +1285,28 @@ static uint16_t *VRAM_Alloc(uint8_t upscale_shift)
    return vram;
 }
 
+/* The native view for a GPU.vram allocated at upscale_shift: vram
+ * itself at 1x, else a separate 1x buffer (NULL on failure). */
+static uint16_t *VRAM_AllocNative(uint16_t *vram, uint8_t upscale_shift)
+{
+   return upscale_shift ? VRAM_Alloc(0) : vram;
+}
+
+/* The persistent 1x load scratch, or NULL if it cannot be allocated. */
+static uint16_t *VRAM_ScaleScratch(void)
+{
+   if (!vram_scale_scratch)
+      vram_scale_scratch = VRAM_Alloc(0);
+   return vram_scale_scratch;
+}
+
+static void VRAM_FreeNative(void)
+{
+   if (GPU.vram_native != GPU.vram)
+      free(GPU.vram_native);
+   GPU.vram_native = NULL;
+}
+
 bool GPU_Init(bool pal_clock_and_tv,
       int sls, int sle, uint8_t upscale_shift)
 {
@@ -1126,6 +1316,14 @@ bool GPU_Init(bool pal_clock_and_tv,
    if (!GPU.vram)
       return false;
 
+   GPU.vram_native = VRAM_AllocNative(GPU.vram, upscale_shift);
+   if (!GPU.vram_native)
+   {
+      free(GPU.vram);
+      GPU.vram = NULL;
+      return false;
+   }
+
    GPU.HardwarePALType = pal_clock_and_tv;
 
    for(y = 0; y < 4; y++)
@@ -1185,18 +1383,26 @@ void GPU_RecalcClockRatio(void) {
 
 void GPU_Destroy(void)
 {
+   TexXCache_Free(&GPU);
+   VRAM_FreeNative();
    free(GPU.vram);
    GPU.vram = NULL;
+   free(vram_scale_scratch);
+   vram_scale_scratch = NULL;
 }
 
 /* Rescale the GPU with a different upscale_shift.
  *
  * The flow is:
- *   1. Allocate a 1x scratch buffer (vram_new)
- *   2. Copy GPU.vram (downscaled if needed) into vram_new
- *   3. Allocate the new GPU.vram at the requested upscale
- *   4. Copy vram_new into the new GPU.vram (upscaled if needed)
- *   5. Free the old GPU.vram and the scratch buffer
+ *   1. Allocate the new GPU.vram at the requested upscale, and a new
+ *      native view if the old one cannot be kept
+ *   2. Copy the old native view into the new GPU.vram (upscaled if
+ *      needed) and into the new native view
+ *   3. Free whatever of the old buffers is no longer used
+ *
+ * The old native view already holds VRAM at 1x, so no downscale is
+ * needed.  Above 1x on both sides it is kept as it is; the native
+ * pixels do not change with the resolution.
  *
  * Failure handling: an OOM at any allocation step must leave the GPU
  * in a usable state with the original GPU.vram intact. We therefore
@@ -1206,58 +1412,55 @@ void GPU_Destroy(void)
  */
 bool GPU_Rescale(uint8_t ushift)
 {
-   uint16_t *old_vram = GPU.vram;
-   uint8_t     old_shift = GPU.upscale_shift;
+   uint16_t *old_vram   = GPU.vram;
+   uint16_t *old_native = GPU.vram_native;
+   uint8_t   old_shift  = GPU.upscale_shift;
    uint16_t *new_vram;
+   uint16_t *new_native;
 
-   /* Step 1+2: allocate scratch buffer at 1x. If we're already at 1x
-    * we can alias the old vram directly; otherwise allocate scratch
-    * and downscale into it. */
-   if (old_shift == 0)
-   {
-      vram_new = old_vram;
-   }
-   else
-   {
-      vram_new = VRAM_Alloc(0);
-      if (!vram_new)
-         return false;
-
-      for (unsigned y = 0; y < 512; y++)
-         for (unsigned x = 0; x < 1024; x++)
-            vram_new[y * 1024 + x] = texel_fetch(&GPU, x, y);
-   }
-
-   /* Step 3: allocate the new VRAM at the requested upscale. This
-    * is the second failure point; if it fails we must restore
-    * GPU.vram and free the scratch (when it isn't aliased). */
+   /* Step 1: allocate. If either allocation fails GPU.vram and its
+    * native view are still intact. */
    new_vram = VRAM_Alloc(ushift);
    if (!new_vram)
-   {
-      if (old_shift != 0)
-         free(vram_new);
-      vram_new = NULL;
       return false;
+
+   if (ushift && old_shift)
+      new_native = old_native;
+   else
+   {
+      new_native = VRAM_AllocNative(new_vram, ushift);
+      if (!new_native)
+      {
+         free(new_vram);
+         return false;
+      }
    }
 
    /* Past the OOM cliff. Now we can commit: switch upscale_shift
     * before texel_put runs (it reads upscale_shift to compute
-    * destination coords) and swap the vram pointer. */
-   GPU.vram = new_vram;
+    * destination coords) and swap the vram pointers. */
+   GPU.vram        = new_vram;
+   GPU.vram_native = new_native;
    GPU_set_upscale_shift(ushift);
 
-   /* Step 4: copy the scratch buffer into the new VRAM, upscaling
-    * via texel_put (nearest neighbour). */
-   for (unsigned y = 0; y < 512; y++)
-      for (unsigned x = 0; x < 1024; x++)
-         texel_put(x, y, vram_new[y * 1024 + x]);
+   /* Step 2: copy the old native view into the new VRAM, upscaling
+    * (nearest neighbour) a row at a time. At 1x this is a plain copy
+    * into what is also the new native view. */
+   if (ushift == 0)
+      memcpy(new_vram, old_native, 1024 * 512 * sizeof(uint16_t));
+   else
+   {
+      if (new_native != old_native)
+         memcpy(new_native, old_native, 1024 * 512 * sizeof(uint16_t));
+      vram_upscale_changed(new_vram, old_native, ushift, true);
+   }
+   MarkAllVRAMRows();
 
-   /* Step 5: free the old buffer (skipping the alias case where
-    * old_vram == vram_new) and clear the scratch handle. */
-   if (old_shift != 0)
-      free(vram_new);
+   /* Step 3: free the old buffers. At 1x the old native view was the
+    * old vram itself. */
+   if (old_native != old_vram && old_native != new_native)
+      free(old_native);
    free(old_vram);
-   vram_new = NULL;
 
    return true;
 }
@@ -1333,6 +1536,9 @@ static void GPU_SoftReset(void) /* Control command 0x00 */
 void GPU_Power(void)
 {
    memset(GPU.vram, 0, 512 * 1024 * UPSCALE(&GPU) * UPSCALE(&GPU) * sizeof(*GPU.vram));
+   if (GPU.vram_native != GPU.vram)
+      memset(GPU.vram_native, 0, 512 * 1024 * sizeof(*GPU.vram_native));
+   MarkAllVRAMRows();
 
    memset(GPU.CLUT_Cache, 0, sizeof(GPU.CLUT_Cache));
    GPU.CLUT_Cache_VB = ~0U;
@@ -1578,11 +1784,20 @@ static INLINE void GPU_WriteCB(uint32_t InData, uint32_t addr)
       return;
 
    if(PGXP_enabled())
-      PGXP_WriteFIFO(ReadMem(addr), GPU_BlitterFIFO.write_pos);
+   {
+      PGXP_value pgxp_word;
+      if(!ReadMem(&pgxp_word, addr))
+         pgxp_word = PGXP_value_invalid_address;
+      PGXP_WriteFIFO(&pgxp_word, GPU_BlitterFIFO.write_pos);
+   }
    FastFIFO_Write(&GPU_BlitterFIFO, InData);
 
    if(GPU_BlitterFIFO.in_count && GPU.InCmd != INCMD_FBREAD)
+   {
+      PROF_PUSH(PROF_GPU);
       ProcessFIFO(GPU_BlitterFIFO.in_count);
+      PROF_POP();
+   }
 }
 
 void GPU_Write(const int32_t timestamp, uint32_t A, uint32_t V)
@@ -1717,6 +1932,12 @@ void GPU_WriteDMA(uint32_t V, uint32_t addr)
    GPU_WriteCB(V, addr);
 }
 
+void GPU_WriteDMABlock(const uint8_t *src, uint32_t addr, uint32_t count)
+{
+   for (; count; count--, src += 4, addr += 4)
+      GPU_WriteCB(LoadU32_LE((const uint32_t*)src), addr);
+}
+
 static INLINE uint32_t GPU_ReadData(void)
 {
    unsigned i;
@@ -1816,173 +2037,6 @@ uint32_t GPU_Read(const int32_t timestamp, uint32_t A)
    return(ret >> ((A & 3) * 8));
 }
 
-static INLINE void ReorderRGB_Var(uint32_t out_Rshift,
-      uint32_t out_Gshift, uint32_t out_Bshift,
-      bool bpp24, const uint16_t *src, uint32_t *dest,
-      const int32_t dx_start, const int32_t dx_end, int32_t fb_x,
-      unsigned upscale_shift, unsigned upscale)
-{
-  int32_t fb_mask = ((0x7FF << upscale_shift) + upscale - 1);
-
-   if(bpp24)   /* 24bpp */
-   {
-      int32_t x = dx_start;
-#if defined(__SSE2__) || defined(GPU_HAVE_NEON)
-      /* Native-res fast path.  At upscale_shift == 0 the 24bpp source
-       * is a plain byte stream of consecutive R,G,B triplets: output
-       * pixel p reads bytes [fb_x + 3*p + 0..2] as R,G,B and writes
-       * dest = B | (G<<8) | (R<<16) (the RED/GREEN/BLUE_SHIFT layout,
-       * 16/8/0).  fb_x advances by 3 per pixel and wraps at the
-       * 0x7FF-word VRAM-row boundary; we vectorise only the contiguous
-       * span before the wrap and let the scalar loop finish the tail
-       * (it re-derives the wrap via `& fb_mask`).  Upscaled output
-       * replicates pixels and strides differently, so it stays scalar. */
-      if (upscale_shift == 0)
-      {
-         const uint8_t *bytes = (const uint8_t*)src;
-#if defined(__SSE2__)
-         /* 4 px from three stride-3 unaligned words.  word_p has bytes
-          * [R,G,B,next] in ascending memory order; we want B|G<<8|R<<16,
-          * i.e. swap the R and B bytes and drop the 4th. */
-         while (x + 4 <= dx_end)
-         {
-            __m128i w, b0, b2, g, out;
-            /* The block reads bytes [fb_x .. fb_x+12]; fb_x wraps at
-             * byte 0x800 (fb_mask is a byte mask).  Bail if the linear
-             * read would cross the wrap - the scalar tail handles it. */
-            if ((fb_x + 12) > (fb_mask + 1))
-               break;
-            w  = _mm_setr_epi32(
-                  *(const uint32_t*)&bytes[fb_x + 0], *(const uint32_t*)&bytes[fb_x + 3],
-                  *(const uint32_t*)&bytes[fb_x + 6], *(const uint32_t*)&bytes[fb_x + 9]);
-            b0  = _mm_and_si128(w, _mm_set1_epi32(0x000000FF));                       /* R */
-            b2  = _mm_and_si128(_mm_srli_epi32(w, 16), _mm_set1_epi32(0x000000FF));   /* B */
-            g   = _mm_and_si128(w, _mm_set1_epi32(0x0000FF00));                       /* G<<8 */
-            out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(b0, 16), b2), g);
-            _mm_storeu_si128((__m128i*)&dest[x], out);
-            x   += 4;
-            fb_x = (fb_x + 12) & fb_mask;
-         }
-#else /* GPU_HAVE_NEON */
-         /* vld3 de-interleaves 8 RGB triplets straight into R/G/B. */
-         while (x + 8 <= dx_end)
-         {
-            uint8x8x3_t rgb;
-            uint16x8_t  lo, hi;
-            uint32x4_t  p0, p1;
-            /* vld3 reads bytes [fb_x .. fb_x+24); fb_x wraps at byte
-             * 0x800.  Bail if the read would cross the wrap. */
-            if ((fb_x + 24) > (fb_mask + 1))
-               break;
-            rgb = vld3_u8(&bytes[fb_x]);
-            lo  = vorrq_u16(vmovl_u8(rgb.val[2]), vshlq_n_u16(vmovl_u8(rgb.val[1]), 8)); /* B|G<<8 */
-            hi  = vmovl_u8(rgb.val[0]);                                                  /* R */
-            p0  = vorrq_u32(vmovl_u16(vget_low_u16(lo)),  vshlq_n_u32(vmovl_u16(vget_low_u16(hi)),  16));
-            p1  = vorrq_u32(vmovl_u16(vget_high_u16(lo)), vshlq_n_u32(vmovl_u16(vget_high_u16(hi)), 16));
-            vst1q_u32(&dest[x],     p0);
-            vst1q_u32(&dest[x + 4], p1);
-            x   += 8;
-            fb_x = (fb_x + 24) & fb_mask;
-         }
-#endif
-      }
-#endif
-      for(; x < dx_end; x+= upscale)
-      {
-         int i;
-         uint32_t color;
-         uint32_t srcpix = src[(fb_x >> 1) + 0]
-            | (src[((fb_x >> 1) + (1 << upscale_shift)) & fb_mask] << 16);
-         srcpix >>= ((fb_x >> upscale_shift) & 1) * 8;
-
-         color =   (((srcpix >> 0) << RED_SHIFT)   & (0xFF << RED_SHIFT))
-            | (((srcpix >> 8) << GREEN_SHIFT) & (0xFF << GREEN_SHIFT))
-            | (((srcpix >> 16) << BLUE_SHIFT) & (0xFF << BLUE_SHIFT));
-
-         for (i = 0; i < upscale; i++)
-            dest[x + i] = color;
-
-         fb_x = (fb_x + (3 << upscale_shift)) & fb_mask;
-      }
-   }           /* 15bpp */
-   else
-   {
-      int32_t x = dx_start;
-
-#if defined(__SSE2__)
-      /* 8-pixel SSE2 fast path.  Each PSX 16-bit pixel is
-       *   bit  15: mask  (dropped)
-       *   bits 10-14: B (5 bits)
-       *   bits  5-9:  G (5 bits)
-       *   bits  0-4:  R (5 bits)
-       * and the scalar path produces XRGB8888 by zero-padding each
-       * 5-bit channel to 8 bits (i.e. `<< 3`, NOT bit-replication) -
-       * we match that bit-exactly so SSE2 / scalar output is
-       * indistinguishable.
-       *
-       * Bails to scalar when:
-       *   - fewer than 8 output pixels remain (handles the tail);
-       *   - the 8-pixel source span would cross the fb_x wrap
-       *     boundary (rare: only when starting near the end of the
-       *     upscaled VRAM row, and even then only at the boundary
-       *     itself).  The scalar loop's `& fb_mask` handles wrap
-       *     correctly on its own, so we just break and let it run.
-       */
-      const __m128i mask5         = _mm_set1_epi16(0x001F);
-      const int32_t words_per_row = (fb_mask + 1) >> 1;
-      while ((dx_end - x) >= 8)
-      {
-         const int32_t word_idx = fb_x >> 1;
-         __m128i s, r5, g5, b5, r8, g8, b8, gb_lo, ar_hi;
-         __m128i pixels_lo, pixels_hi;
-
-         /* Would the 8-word load cross the wrap?  Hand off to
-          * scalar if so - it'll wrap correctly via `& fb_mask`. */
-         if (word_idx + 8 > words_per_row)
-            break;
-
-         s     = _mm_loadu_si128((const __m128i*)&src[word_idx]);
-         /* Extract R5/G5/B5 in 16-bit lanes. */
-         r5    = _mm_and_si128(s,                          mask5);
-         g5    = _mm_and_si128(_mm_srli_epi16(s,  5),      mask5);
-         b5    = _mm_and_si128(_mm_srli_epi16(s, 10),      mask5);
-         /* Scale to 8-bit by shifting left 3 (zero-pad low bits -
-          * matches scalar's `<< 3` exactly). */
-         r8    = _mm_slli_epi16(r5, 3);
-         g8    = _mm_slli_epi16(g5, 3);
-         b8    = _mm_slli_epi16(b5, 3);
-         /* Assemble per-pixel halves:
-          *   gb_lo lane i = (G8[i] << 8) | B8[i]   -> low 16 bits of XRGB8888
-          *   ar_hi lane i = 0 | R8[i]              -> high 16 bits of XRGB8888 (alpha=0)
-          */
-         gb_lo = _mm_or_si128(_mm_slli_epi16(g8, 8), b8);
-         ar_hi = r8;
-         /* Interleave 16-bit halves into 32-bit XRGB8888 pixels. */
-         pixels_lo = _mm_unpacklo_epi16(gb_lo, ar_hi);   /* P0..P3 */
-         pixels_hi = _mm_unpackhi_epi16(gb_lo, ar_hi);   /* P4..P7 */
-         _mm_storeu_si128((__m128i*)&dest[x],     pixels_lo);
-         _mm_storeu_si128((__m128i*)&dest[x + 4], pixels_hi);
-
-         x   += 8;
-         fb_x = (fb_x + 16) & fb_mask;
-      }
-#endif
-
-      /* Scalar tail / non-SSE2 fallback / wrap-crossing chunks. */
-      for (; x < dx_end; x++)
-      {
-         uint32_t srcpix = src[(fb_x >> 1)];
-         dest[x] = MAKECOLOR(
-               (((srcpix >> 0) & 0x1F) << 3),
-               (((srcpix >> 5) & 0x1F) << 3),
-               (((srcpix >> 10) & 0x1F) << 3),
-               0);
-
-         fb_x = (fb_x + 2) & fb_mask;
-      }
-   }
-}
-
 int32_t GPU_Update(const int32_t sys_timestamp)
 {
    int32_t gpu_clocks;
@@ -1991,6 +2045,8 @@ int32_t GPU_Update(const int32_t sys_timestamp)
    const uint32_t dmw = 2800 / DotClockRatios[dmc];   /* Must be <= 768 */
    int32_t sys_clocks = sys_timestamp - GPU.lastts;
 
+   PROF_PUSH(PROF_GPU);
+
    if(!sys_clocks)
       goto TheEnd;
 
@@ -2132,11 +2188,11 @@ int32_t GPU_Update(const int32_t sys_timestamp)
 
                      for(int32_t y = 0; y < GPU.DisplayRect->h; y++)
                      {
-                        uint32_t *dest = GPU.surface->pixels + y * GPU.surface->pitch32;
+                        uint32_t *dest = SurfaceRow(y);
 
                         GPU.LineWidths[y] = 384;
 
-                        memset(dest, 0, 384 * sizeof(int32_t));
+                        memset(dest, 0, 384 * (psx_sw_rgb565 ? 2 : 4));
                      }
 
                      /* The mismatch clear zeroes only [0, 384) per
@@ -2161,10 +2217,15 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                      /* Clear ~0 state. */
                      GPU.LineWidths[0] = 0;
 
+                     /* Zero pixels 0 and 1 of each row; in RGB565
+                      * both fit in the first 32-bit word. */
                      for(int i = 0; i < (GPU.DisplayRect->y + GPU.DisplayRect->h); i++)
                      {
-                        GPU.surface->pixels[i * GPU.surface->pitch32 + 0] =
-                           GPU.surface->pixels[i * GPU.surface->pitch32 + 1] = 0;
+                        uint32_t *row = SurfaceRow(i);
+
+                        row[0] = 0;
+                        if (!psx_sw_rgb565)
+                           row[1] = 0;
                         GPU.LineWidths[i] = 2;
                      }
                   }
@@ -2304,9 +2365,11 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                   int32_t ufb_x       = fb_x     << GPU.upscale_shift;
                   unsigned _upscale = UPSCALE(&GPU);
 
-                  if (psx_gpu_rasterize_both_fields
+                  const bool both_fields = psx_gpu_rasterize_both_fields
                         && (GPU.DisplayMode & 0x24) == 0x24
-                        && GPU.espec->InterlaceOn)
+                        && GPU.espec->InterlaceOn;
+
+                  if (both_fields || deferred_scanout_all)
                   {
                      /* "Off" deinterlace mode in 480i: defer the
                       * VRAM read until end-of-frame so it doesn't
@@ -2334,7 +2397,11 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                       * the 0x24 bit isn't set) but the per-line
                       * scanout falls back to the immediate path
                       * to avoid writing corrupted opposite-field
-                      * rows. */
+                      * rows.
+                      *
+                      * deferred_scanout_all records every row the
+                      * same way, this field's only unless 480i
+                      * "Off" also applies. */
                      if (deferred_scanout_count < DEFERRED_SCANOUT_MAX)
                      {
                         GPU_DeferredScanline *r =
@@ -2344,7 +2411,7 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                               + (GPU.InVBlank ? 0 : !GPU.field_ram_readout))
                            & 0x1FF;
                         r->dest_line       = dest_line;
-                        r->dest_line_other = dest_line ^ 1;
+                        r->dest_line_other = both_fields ? dest_line ^ 1 : -1;
                         r->vram_y_native   = GPU.DisplayFB_CurLineYReadout;
                         r->vram_y_other    = opp_y;
                         r->dx_start        = dx_start;
@@ -2379,14 +2446,45 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                          && scanout_cache[dest_line].dx_start == dx_start
                          && scanout_cache[dest_line].dx_end   == dx_end
                          && scanout_cache[dest_line].dmw      == (uint32_t)dmw;
-
-                     for (uint32_t i = 0; i < _upscale; i++)
+                     const bool rgb24 = (GPU.DisplayMode & DISP_RGB24) != 0;
+                     /* Dirty-row skip: same source row, same geometry
+                      * and no VRAM write to that row since it was last
+                      * converted into this dest_line - the surface
+                      * row is already current. */
+                     const bool skip_row = skip_margin
+                        && ScanoutRowUnchanged(dest_line, dx_start, dx_end,
+                              (uint32_t)dmw, GPU.DisplayFB_CurLineYReadout,
+                              fb_x, rgb24);
+
+                     for (uint32_t i = 0; !skip_row && i < _upscale; i++)
                      {
                         const uint16_t *src = GPU.vram +
                            ((y + i) << (10 + GPU.upscale_shift));
 
-                        dest = GPU.surface->pixels +
-                           ((dest_line << GPU.upscale_shift) + i) * GPU.surface->pitch32;
+                        dest = SurfaceRow((dest_line << GPU.upscale_shift) + i);
+
+                        if (psx_sw_rgb565)
+                        {
+                           uint16_t *dest16 = (uint16_t*)dest;
+
+                           if (!skip_margin)
+                              memset(dest16, 0, udx_start * sizeof(uint16_t));
+
+                           ReorderRGB565_Var(
+                                 GPU.DisplayMode & DISP_RGB24,
+                                 src,
+                                 dest16,
+                                 udx_start,
+                                 udx_end,
+                                 ufb_x,
+                                 GPU.upscale_shift,
+                                 _upscale);
+
+                           if (!skip_margin)
+                              for(x = udx_end; x < udmw; x++)
+                                 dest16[x] = 0;
+                           continue;
+                        }
 
                         if (!skip_margin)
                            memset(dest, 0, udx_start * sizeof(int32_t));
@@ -2409,19 +2507,17 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                               dest[x] = 0;
                      }
 
-                     /* Record geometry for next frame's skip check.
-                      * dest_line bound was already validated above
-                      * (GPU_DEST_LINE_MAX covers PAL 480i). */
-                     if (dest_line >= 0 && dest_line < GPU_DEST_LINE_MAX)
-                     {
-                        scanout_cache[dest_line].dx_start = dx_start;
-                        scanout_cache[dest_line].dx_end   = dx_end;
-                        scanout_cache[dest_line].dmw      = (uint32_t)dmw;
-                        scanout_cache[dest_line].valid    = true;
-                     }
-
-                     /*reset dest back to i=0 for PSX_GPULineHook call */
-                     dest = GPU.surface->pixels + ((dest_line << GPU.upscale_shift) * GPU.surface->pitch32);
+                     /* Record geometry and source for next frame's
+                      * skip checks. */
+                     if (!skip_row)
+                        ScanoutRowRecord(dest_line, dx_start, dx_end,
+                              (uint32_t)dmw, GPU.DisplayFB_CurLineYReadout,
+                              fb_x, rgb24);
+
+                     /*reset dest back to i=0 for PSX_GPULineHook call.
+                      * The hook reads psx_sw_rgb565 for the pixel
+                      * format. */
+                     dest = SurfaceRow(dest_line << GPU.upscale_shift);
                   }
                }
 
@@ -2430,7 +2526,9 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                pix_clock = (GPU.HardwarePALType ? 53203425 : 53693182) / DotClockRatios[dmc];
                pix_clock_div = DotClockRatios[dmc];
 
-               FrontIO_GPULineHook(PSX_FIO,
+               /* A crosshair drawn into the row makes it differ from
+                * a plain conversion; the next frame must redo it. */
+               if (FrontIO_GPULineHook(PSX_FIO,
                                sys_timestamp,
                                sys_timestamp - ((uint64_t)gpu_clocks * 65536) / GPU.GPUClockRatio,
                                GPU.scanline == 0,
@@ -2440,7 +2538,9 @@ int32_t GPU_Update(const int32_t sys_timestamp)
                                pix_clock,
                                pix_clock_div,
                                surf_pitch,
-                               (1 << GPU.upscale_shift));
+                               (1 << GPU.upscale_shift))
+                     && dest_line >= 0 && dest_line < GPU_DEST_LINE_MAX)
+                  scanout_cache[dest_line].content_valid = false;
             }
             else
             {
@@ -2478,6 +2578,8 @@ TheEnd:
    if (next_dt < 1)          next_dt = 1;
    if (next_dt > EventCycles) next_dt = EventCycles;
 
+   PROF_POP();
+
    return(sys_timestamp + next_dt);
 }
 
@@ -2510,8 +2612,6 @@ void GPU_FlushDeferredScanout(void)
 {
    const unsigned s = GPU.upscale_shift;
    const unsigned up = 1u << s;
-   int32_t   pitch_pix;
-   uint32_t *pixels;
    unsigned r;
 
    /* Fast path and HW-renderer safety:  with no deferred records
@@ -2523,9 +2623,6 @@ void GPU_FlushDeferredScanout(void)
    if (deferred_scanout_count == 0)
       return;
 
-   pitch_pix = GPU.surface->pitch32;
-   pixels    = GPU.surface->pixels;
-
    for (r = 0; r < deferred_scanout_count; r++)
    {
       const GPU_DeferredScanline *rec = &deferred_scanouts[r];
@@ -2539,7 +2636,7 @@ void GPU_FlushDeferredScanout(void)
        * Both populate the surface from CURRENT-frame VRAM, so the
        * displayed image is a single-instant snapshot rather than
        * a temporal interleave between the two fields. */
-      for (field = 0; field < 2; field++)
+      for (field = 0; field < (rec->dest_line_other < 0 ? 1 : 2); field++)
       {
          const int32_t  dest_line = field ? rec->dest_line_other : rec->dest_line;
          const uint32_t y_up      = (uint32_t)(field ? rec->vram_y_other
@@ -2555,16 +2652,36 @@ void GPU_FlushDeferredScanout(void)
              && scanout_cache[dest_line].dx_start == rec->dx_start
              && scanout_cache[dest_line].dx_end   == rec->dx_end
              && scanout_cache[dest_line].dmw      == (uint32_t)rec->dmw;
+         const uint32_t vram_y    = (uint32_t)(field ? rec->vram_y_other
+                                                     : rec->vram_y_native);
+         const bool skip_row = skip_margin
+            && ScanoutRowUnchanged(dest_line, rec->dx_start, rec->dx_end,
+                  (uint32_t)rec->dmw, vram_y, rec->fb_x, rec->rgb24);
          unsigned i;
 
-         for (i = 0; i < up; i++)
+         for (i = 0; !skip_row && i < up; i++)
          {
             const uint16_t *src = GPU.vram +
                ((y_up + i) << (10 + s));
-            uint32_t *dest = pixels +
-               (size_t)(((dest_line << s) + i)) * pitch_pix;
+            uint32_t *dest = SurfaceRow((dest_line << s) + i);
             uint32_t x;
 
+            if (psx_sw_rgb565)
+            {
+               uint16_t *dest16 = (uint16_t*)dest;
+
+               if (!skip_margin)
+                  memset(dest16, 0, udx_start * sizeof(uint16_t));
+
+               ReorderRGB565_Var(rec->rgb24, src, dest16,
+                     udx_start, udx_end, ufb_x, s, up);
+
+               if (!skip_margin)
+                  for (x = (uint32_t)udx_end; x < udmw; x++)
+                     dest16[x] = 0;
+               continue;
+            }
+
             if (!skip_margin)
                memset(dest, 0, udx_start * sizeof(uint32_t));
 
@@ -2586,27 +2703,140 @@ void GPU_FlushDeferredScanout(void)
                   dest[x] = 0;
          }
 
-         if (dest_line >= 0 && dest_line < GPU_DEST_LINE_MAX)
-         {
-            scanout_cache[dest_line].dx_start = rec->dx_start;
-            scanout_cache[dest_line].dx_end   = rec->dx_end;
-            scanout_cache[dest_line].dmw      = (uint32_t)rec->dmw;
-            scanout_cache[dest_line].valid    = true;
-         }
+         if (!skip_row)
+            ScanoutRowRecord(dest_line, rec->dx_start, rec->dx_end,
+                  (uint32_t)rec->dmw, vram_y, rec->fb_x, rec->rgb24);
       }
 
       /* Make sure both rows in LineWidths report the same width
        * (the per-scanline path only set LineWidths[dest_line]). */
-      GPU.LineWidths[rec->dest_line_other] = rec->dmw;
+      if (rec->dest_line_other >= 0)
+         GPU.LineWidths[rec->dest_line_other] = rec->dmw;
    }
 
    deferred_scanout_count = 0;
 }
 
+void GPU_DeferScanout(bool enable)
+{
+   deferred_scanout_all = enable;
+}
+
+bool GPU_HasDeferredScanout(void)
+{
+   return deferred_scanout_count != 0;
+}
+
+/* One row of the frontend framebuffer: columns [x0, x0 + w) of the
+ * surface row the scanout would have written, i.e. zero outside
+ * [udx_start, udx_end).  The conversion goes straight into the row
+ * unless the active region starts left of the window (only with an
+ * image offset/crop wider than the overscan), which takes a trip
+ * through a scratch row. */
+static void FlushDirectRow(uint8_t *row, const uint16_t *src,
+      int32_t udx_start, int32_t udx_end, int32_t ufb_x, bool rgb24,
+      int32_t x0, int32_t w)
+{
+   /* dmw <= 768, upscale <= 16x. */
+   static uint32_t scratch[768 << 4];
+   const unsigned  s   = GPU.upscale_shift;
+   const unsigned  up  = 1u << s;
+   const size_t    bpp = psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t);
+   int32_t         end = udx_end < x0 + w ? udx_end : x0 + w;
+
+   if (end <= udx_start || end <= x0)
+   {
+      memset(row, 0, (size_t)w * bpp);
+      return;
+   }
+
+   if (udx_start >= x0)
+   {
+      memset(row, 0, (size_t)(udx_start - x0) * bpp);
+      if (psx_sw_rgb565)
+         ReorderRGB565_Var(rgb24, src, (uint16_t*)row,
+               udx_start - x0, end - x0, ufb_x, s, up);
+      else
+         ReorderRGB_Var(RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, rgb24,
+               src, (uint32_t*)row, udx_start - x0, end - x0,
+               ufb_x, s, up);
+   }
+   else
+   {
+      if (psx_sw_rgb565)
+         ReorderRGB565_Var(rgb24, src, (uint16_t*)scratch,
+               udx_start, end, ufb_x, s, up);
+      else
+         ReorderRGB_Var(RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, rgb24,
+               src, scratch, udx_start, end, ufb_x, s, up);
+      memcpy(row, (const uint8_t*)scratch + (size_t)x0 * bpp,
+            (size_t)(end - x0) * bpp);
+   }
+
+   memset(row + (size_t)(end - x0) * bpp, 0, (size_t)(x0 + w - end) * bpp);
+}
+
+/* GPU_FlushDeferredScanout for a progressive frame recorded under
+ * GPU_DeferScanout, converting into a frontend-owned framebuffer
+ * rather than the surface.  The buffer receives the w x h window of
+ * the surface starting at column x (all in output pixels), which is
+ * what libretro.c would otherwise present from the surface; rows no
+ * record covers are zeroed, since the buffer starts out undefined.
+ *
+ * The surface and the scanout cache are left alone: the cache still
+ * describes what the surface holds, so a later frame that falls back
+ * to the surface re-converts exactly the rows that went stale. */
+void GPU_FlushDeferredScanoutTo(void *pixels, size_t pitch,
+      unsigned x, unsigned w, unsigned h)
+{
+   const unsigned s   = GPU.upscale_shift;
+   const unsigned up  = 1u << s;
+   const size_t   bpp = psx_sw_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t);
+   bool           covered[GPU_DEST_LINE_MAX];
+   unsigned       r, y;
+
+   memset(covered, 0, sizeof(covered));
+
+   for (r = 0; r < deferred_scanout_count; r++)
+   {
+      const GPU_DeferredScanline *rec = &deferred_scanouts[r];
+      const uint32_t y_up = (uint32_t)rec->vram_y_native << s;
+      unsigned       i;
+
+      if (rec->dest_line < 0 || (unsigned)rec->dest_line >= (h >> s))
+         continue;
+
+      covered[rec->dest_line] = true;
+
+      for (i = 0; i < up; i++)
+         FlushDirectRow(
+               (uint8_t*)pixels + (size_t)((rec->dest_line << s) + i) * pitch,
+               GPU.vram + ((y_up + i) << (10 + s)),
+               rec->dx_start << s, rec->dx_end << s, rec->fb_x << s,
+               rec->rgb24, (int32_t)x, (int32_t)w);
+   }
+
+   for (y = 0; y < h; y++)
+      if ((y >> s) >= GPU_DEST_LINE_MAX || !covered[y >> s])
+         memset((uint8_t*)pixels + (size_t)y * pitch, 0, (size_t)w * bpp);
+
+   deferred_scanout_count = 0;
+}
+
 
 void GPU_RestoreStateP1(bool load)
 {
-   if (!load && !rhi_intf_has_software_renderer())
+   /* A state without the field (older, or saved to disk) restores
+    * from its pixels. */
+   vram_snapshot = 0;
+
+   /* Same-instance state under a pure hardware renderer: if the
+    * renderer keeps a copy on the GPU, GPU.vram is saved as it stands
+    * and the state refers to the copy for the rest. */
+   if (!load && same_instance_savestate && !rhi_intf_has_software_renderer())
+      vram_snapshot = rhi_intf_snapshot_vram();
+
+   if (!load && !vram_snapshot && !rhi_intf_has_software_renderer())
    {
       /* Pure hardware renderer: the composited framebuffer lives only on the
        * GPU. CPU-side GPU.vram is coherent solely where the game issued an
@@ -2619,30 +2849,16 @@ void GPU_RestoreStateP1(bool load)
       rhi_intf_read_vram(0, 0, 1024, 512, GPU.vram);
    }
 
-   if (GPU.upscale_shift == 0)
+   /* Savestates store VRAM at 1x for compatibility: that is the
+    * native view, at 1x GPU.vram itself.  A load above 1x goes to the
+    * scratch instead, see vram_new; should that allocation fail it
+    * falls back to loading into the native view directly. */
+   vram_new = GPU.vram_native;
+   if (load && GPU.upscale_shift)
    {
-      /* No upscaling, we can dump the VRAM contents directly */
-      vram_new = GPU.vram;
-   }
-   else
-   {
-      /* We have increased internal resolution, savestates are always */
-      /* made at 1x for compatibility. The 1MB scratch is exposed to */
-      /* MDFNSS_StateAction via SFARRAY16N below; if this allocation */
-      /* fails the SFARRAY16N would deref NULL, so we leave vram_new */
-      /* at NULL and the StateAction caller is responsible for noticing */
-      /* (an upcoming change will surface the failure to libretro). */
-      vram_new = (uint16_t *)malloc(1024 * 512 * sizeof(uint16_t));
-
-      if (vram_new && !load)
-      {
-         /* We must downscale the current VRAM contents back to 1x */
-         for (unsigned y = 0; y < 512; y++)
-         {
-            for (unsigned x = 0; x < 1024; x++)
-               vram_new[y * 1024 + x] = texel_fetch(&GPU, x, y);
-         }
-      }
+      uint16_t *scratch = VRAM_ScaleScratch();
+      if (scratch)
+         vram_new = scratch;
    }
 
    for(unsigned i = 0; i < 256; i++)
@@ -2659,19 +2875,19 @@ void GPU_RestoreStateP2(bool load)
 {
    if (GPU.upscale_shift > 0)
    {
-      if (load && vram_new)
+      /* Restore upscaled VRAM from the state that was read into
+       * vram_new. Pages whose native pixels already match are left
+       * alone, see gpu_vram_scale.h; the caller marks every row
+       * afterwards. The native view is then taken from the result,
+       * as every other path keeps it: GPU.vram is the one source. */
+      if (load)
       {
-         /* Restore upscaled VRAM from savestate */
-         for (unsigned y = 0; y < 512; y++)
-         {
-            for (unsigned x = 0; x < 1024; x++)
-               texel_put(x, y, vram_new[y * 1024 + x]);
-         }
+         vram_upscale_changed(GPU.vram, vram_new, GPU.upscale_shift, false);
+         vram_downscale(GPU.vram_native, GPU.vram, GPU.upscale_shift);
       }
-
-      free(vram_new);
-      vram_new = NULL;
    }
+
+   vram_new = NULL;
 }
 
 void GPU_RestoreStateP3(void)
@@ -2717,9 +2933,10 @@ void GPU_RestoreStateP3(void)
    rhi_intf_set_draw_area( GPU.ClipX0, GPU.ClipY0,
                            GPU.ClipX1, GPU.ClipY1);
 
-   rhi_intf_load_image( 0,    0,
-                        1024, 512,
-                        GPU.vram, false, false);
+   if (!rhi_intf_restore_vram(vram_snapshot, GPU.vram))
+      rhi_intf_load_image( 0,    0,
+                           1024, 512,
+                           GPU.vram, false, false);
 
    rhi_intf_set_vram_framebuffer_coords(GPU.DisplayFB_XStart, GPU.DisplayFB_YStart);
    rhi_intf_set_horizontal_display_range(GPU.HorizStart, GPU.HorizEnd);
@@ -2737,6 +2954,7 @@ int GPU_StateAction(StateMem *sm, int load, int data_only)
       /* Hardcode entry name to remain backward compatible with the */
       /* previous fixed internal resolution code */
       SFARRAY16N(vram_new, 1024 * 512, "&GPURAM[0][0]"),
+      SFVARN(vram_snapshot, "VRAMSnapshot"),
 
       SFVARN(GPU.DMAControl, "DMAControl"),
 
@@ -2880,10 +3098,17 @@ int GPU_StateAction(StateMem *sm, int load, int data_only)
 
    int ret = MDFNSS_StateAction(sm, load, data_only, StateRegs, "GPU");
 
-   GPU_RestoreStateP2(load);
+   /* A failed load leaves GPU.vram and its native view untouched
+    * (above 1x; at 1x the state is read into GPU.vram itself). */
+   GPU_RestoreStateP2(load && ret);
 
    if(load)
+   {
+      /* At native resolution the state was read straight into
+       * GPU.vram, bypassing every row mark. */
+      MarkAllVRAMRows();
       GPU_RestoreStateP3();
+   }
 
    return(ret);
 }
@@ -2908,11 +3133,23 @@ unsigned GPU_get_display_change_count(void)
    return GPU.display_change_count;
 }
 
+bool GPU_get_display_rgb24(void)
+{
+   return (GPU.DisplayMode & DISP_RGB24) != 0;
+}
+
 void GPU_set_dither_upscale_shift(uint8_t factor)
 {
    GPU.dither_upscale_shift = factor;
 }
 
+void GPU_SetTexPageCache(bool enable)
+{
+   if (!enable && tex_xc_enabled)
+      TexXCache_Free(&GPU);
+   tex_xc_enabled = enable;
+}
+
 uint8_t GPU_get_upscale_shift(void)
 {
    return GPU.upscale_shift;
@@ -107,6 +107,14 @@ struct PS_GPU
    uint32_t last_tex_line;
    void    *last_tex_c;
 
+   /* Page of the CLUT-expanded texture page cache bound to the textured
+    * command being drawn, or NULL to sample through TexCache and
+    * CLUT_Cache above; see gpu_texpage_cache.h.  The u/v adds are the
+    * texture window offset within the page. */
+   void    *tex_xc;
+   uint32_t tex_xc_u_add;
+   uint32_t tex_xc_v_add;
+
    uint32_t DMAControl;
 
    /* Beetle-psx upscaling vars */
@@ -259,6 +267,14 @@ struct PS_GPU
    wrestle a variable-sized struct.
    */
    uint16_t *vram;
+
+   /* Native-resolution view of vram for texture, CLUT and 1x reads
+    * (texel_fetch): 1024x512, the top-left subpixel of every
+    * UPSCALE x UPSCALE block.  At 1x it is vram itself.  Above 1x it
+    * is a separate 1 MB buffer that every vram writer keeps in step,
+    * so a texel read stays in one 2 KB row instead of striding
+    * 2048 << 2 * upscale_shift bytes per native row. */
+   uint16_t *vram_native;
 };
 typedef struct PS_GPU PS_GPU;
 
@@ -274,6 +290,9 @@ extern "C" {
 #endif
 
 void     GPU_WriteDMA(uint32_t V, uint32_t addr);
+/* `count` consecutive GPU_WriteDMA words, read little-endian from `src`;
+ * `addr` is the DMA address of the first one and advances by 4. */
+void     GPU_WriteDMABlock(const uint8_t *src, uint32_t addr, uint32_t count);
 uint32_t GPU_ReadDMA(void);
 bool     GPU_DMACanWrite(void);
 int32_t  GPU_Update(const int32_t sys_timestamp);
@@ -288,6 +307,10 @@ void     GPU_RestoreStateP3(void);
 
 void GPU_set_dither_upscale_shift(uint8_t factor);
 
+/* "Software Texture Page Cache" core option; disabling it frees the
+ * cache.  See gpu_texpage_cache.h. */
+void GPU_SetTexPageCache(bool enable);
+
 uint8_t GPU_get_upscale_shift(void);
 
 bool GPU_get_display_possibly_dirty(void);
@@ -298,6 +321,11 @@ void GPU_set_display_change_count(unsigned a);
 
 unsigned GPU_get_display_change_count(void);
 
+/* True while the display is in 24-bit (MDEC) mode.  The RGB565
+ * software output can only represent 15-bit scanout exactly and uses
+ * this to fall back to XRGB8888. */
+bool GPU_get_display_rgb24(void);
+
 bool GPU_Init(bool pal_clock_and_tv,
       int sls, int sle, uint8_t upscale_shift);
 
@@ -318,6 +346,15 @@ uint32_t GPU_Read(const int32_t timestamp, uint32_t A);
 void GPU_StartFrame(EmulateSpecStruct *espec_arg);
 void GPU_FlushDeferredScanout(void);
 
+/* Record every SW scanout row for the end of the frame instead of
+ * converting it as the beam passes, so GPU_FlushDeferredScanoutTo can
+ * write the frame straight into a frontend framebuffer.  Applies from
+ * the next scanline until turned off. */
+void GPU_DeferScanout(bool enable);
+bool GPU_HasDeferredScanout(void);
+void GPU_FlushDeferredScanoutTo(void *pixels, size_t pitch,
+      unsigned x, unsigned w, unsigned h);
+
 /* Resets the per-dest_line cache that lets the SW renderer skip
  * re-zeroing margin pixels each frame when geometry is unchanged.
  * Must be called whenever the surface storage has been replaced
@@ -325,6 +362,12 @@ void GPU_FlushDeferredScanout(void);
  * dirtied the margin pixels (Deinterlacer_Process in WEAVE mode). */
 void GPU_InvalidateScanoutCache(void);
 
+/* Drops only the dirty-row skip state, keeping the margin cache.
+ * Needed when the active region of the surface was rewritten by
+ * something other than the scanout (BOB / BOB_OFFSET / FASTMAD
+ * deinterlacing), so the next frame re-converts every row. */
+void GPU_InvalidateScanoutRows(void);
+
 int GPU_StateAction(StateMem *sm, int load, int data_only);
 
 void GPU_set_visible_scanlines(int sls, int sle); // Beetle PSX addition
@@ -3,12 +3,14 @@ extern enum dither_mode psx_gpu_dither_mode;
 /* Return a pixel from VRAM */
 #define vram_fetch(gpu, x, y)  ((gpu)->vram[((y) << (10 + (gpu)->upscale_shift)) | (x)])
 
-/* Return a pixel from VRAM, ignoring the internal upscaling */
-#define texel_fetch(gpu, x, y) vram_fetch((gpu), (x) << (gpu)->upscale_shift, (y) << (gpu)->upscale_shift)
+/* Return a pixel from VRAM, ignoring the internal upscaling (the
+ * top-left subpixel of its block, from the native view) */
+#define texel_fetch(gpu, x, y) ((gpu)->vram_native[((y) << 10) | (x)])
 
 /* Set a pixel in VRAM */
 #define vram_put(gpu, x, y, v) (gpu)->vram[((y) << (10 + (gpu)->upscale_shift)) | (x)] = (v)
 
+
 #define DitherEnabled(gpu)    (psx_gpu_dither_mode != DITHER_OFF && (gpu)->dtd)
 
 #define UPSCALE(gpu)          (1U << (gpu)->upscale_shift)
@@ -131,6 +133,9 @@ DEFINE_PlotPixelBlend(BMaddq, BLEND_MODE_ADD_FOURTH)
  * `vram_fetch` and `vram_put` are upscale-aware. For the
  * non-upscaled equivalent used by the line and sprite
  * rasterisers, see PlotNativePixel below.
+ *
+ * PlotPixel does not touch the native view of VRAM; its only caller,
+ * DrawSpan, brings that up to date once per span (DrawSpanNative).
  */
 /*
  * Generator macro for one PlotPixel specialisation.  BLENDMODE_VAL
@@ -380,6 +385,10 @@ static INLINE void RecalcTexWindowStuff(PS_GPU *g)
  * The TexCache is a small (256-entry) read-around cache of
  * recently-fetched VRAM blocks; modes 0 and 1 hit it for
  * spatial-locality wins, mode 2 reads VRAM directly per texel.
+ *
+ * With a page of the texture page cache bound (gpu_texpage_cache.h)
+ * modes 0 and 1 bypass both caches and take the texel straight from
+ * the expanded page.
  */
 
 /* Generator macro for one GetTexel specialisation.  TM_VAL is the
@@ -396,6 +405,8 @@ static INLINE uint16_t GetTexel_##SUFFIX(PS_GPU *g, int32_t u_arg, int32_t v_arg
    uint32_t gro     = fbtex_y * 1024U + fbtex_x; \
    uint32_t gro_line = gro & ~0x3U; \
    PS_GPU_TexCache_t *c; \
+   if ((TM_VAL) != 2 && g->tex_xc) \
+      return TexXCache_Fetch(g, u_arg, v_arg); \
    if (g->last_tex_line == gro_line && g->last_tex_c) { \
       /* same cache line as previous pixel: skip index shuffle + tag check */ \
       c = (PS_GPU_TexCache_t *)g->last_tex_c; \
@@ -863,6 +863,52 @@ static INLINE void PCT_UVBatch(int n, float bias,
 #undef PCT_UV_SIMD
 #endif
 
+/* Follow a run of w pixels stored into upscaled row y from column x
+ * in the native view (PS_GPU.vram_native): on the top row of a block
+ * row, gather the top-left subpixel of every block whose top-left
+ * column lies in the run.
+ *
+ * DrawSpan does this once per span rather than per plotted pixel,
+ * which keeps the extra work off the per-pixel path.  The one thing
+ * it gives up: a textured span reading back a texel that the same
+ * span wrote earlier sees the old value.  Drawing into the texture
+ * being sampled is undefined on the real GPU, whose texture cache
+ * already hides such writes, and at 1x (where the view is vram) the
+ * old behaviour is unchanged. */
+static INLINE void DrawSpanNative(PS_GPU *gpu, int y, int32_t x, int32_t w)
+{
+   const uint32_t us   = gpu->upscale_shift;
+   const int32_t  sub  = (int32_t)UPSCALE(gpu) - 1;
+   int32_t        nx0, nx1;
+
+   if (!us || (y & sub))
+      return;
+
+   y  &= (512 << us) - 1;
+   nx0 = (x + sub) >> us;
+   nx1 = (x + w - 1) >> us;
+   if (nx1 < nx0)
+      return;
+
+   vram_downsample_row(&gpu->vram_native[((uint32_t)y >> us) << 10 | nx0],
+         &gpu->vram[((uint32_t)y << (10 + us)) | (nx0 << us)],
+         nx1 - nx0 + 1, us);
+}
+
+/* A span has stored its w pixels from column x of upscaled row y:
+ * bring the native view up to date, then report the native pixels
+ * covered to the texture page cache (after the view, so a page refilled
+ * from it cannot miss the span). */
+static INLINE void DrawSpanEnd(PS_GPU *gpu, int y, int32_t x, int32_t w)
+{
+   const uint32_t us = gpu->upscale_shift;
+   const int32_t  nx = x >> us;
+
+   DrawSpanNative(gpu, y, x, w);
+   if (MDFN_UNLIKELY(tex_xc_enabled))
+      TexXCache_Touch(gpu, (uint32_t)y >> us, nx, ((x + w - 1) >> us) - nx + 1);
+}
+
 #define DEFINE_DrawSpan(SUFFIX, GOURAUD_LIT, TEXTURED_LIT, BM_VAL, BM_TAG, TM_LIT, MO_LIT, ME_LIT) \
 static INLINE void DrawSpan_##SUFFIX(PS_GPU *gpu, int y, const int32_t x_start, const int32_t x_bound, i_group ig, const i_deltas *idl, const bool pct) \
 { \
@@ -871,6 +917,7 @@ static INLINE void DrawSpan_##SUFFIX(PS_GPU *gpu, int y, const int32_t x_start,
    int32_t x_ig_adjust; \
    int32_t w; \
    int32_t x; \
+   int32_t span_x; \
    /* pct UV precompute scratch.  Only used on the textured perspective- \
     * correct path; PCT_UV_BLOCK pixels are SIMD-computed at a time and the \
     * plot loop reads them back.  pct_idx counts down the pixels remaining \
@@ -902,6 +949,12 @@ static INLINE void DrawSpan_##SUFFIX(PS_GPU *gpu, int y, const int32_t x_start,
       w = clipx1 + 1 - x; \
    if (w <= 0) \
       return; \
+   /* One SW-scanout dirty mark per span; PlotPixel and the vector \
+    * path both store without going through texel_put.  The native \
+    * view and the texture page cache follow at the end of the span \
+    * (DrawSpanEnd). */ \
+   MarkVRAMRow((y & ((512 << gpu->upscale_shift) - 1)) >> gpu->upscale_shift); \
+   span_x = x; \
    /*printf("%d %d %d %d\n", x, w, ClipX0, ClipX1);*/ \
    AddIDeltas_DX_g##GOURAUD_LIT##_t##TEXTURED_LIT(&ig, idl, x_ig_adjust); \
    AddIDeltas_DY_g##GOURAUD_LIT##_t##TEXTURED_LIT(&ig, idl, y); \
@@ -953,7 +1006,10 @@ static INLINE void DrawSpan_##SUFFIX(PS_GPU *gpu, int y, const int32_t x_start,
          x += _vn; \
          w -= _vn; \
          if (w <= 0) \
+         { \
+            DrawSpanEnd(gpu, y, span_x, x - span_x); \
             return; \
+         } \
       } \
    } \
    do \
@@ -1079,6 +1135,7 @@ static INLINE void DrawSpan_##SUFFIX(PS_GPU *gpu, int y, const int32_t x_start,
       AddIDeltas_DX_g##GOURAUD_LIT##_t##TEXTURED_LIT(&ig, idl, 1); \
       /* ig.pct_* are advanced by PCT_UVBatch, not here. */ \
    } while (MDFN_LIKELY(--w > 0)); \
+   DrawSpanEnd(gpu, y, span_x, x - span_x); \
 }
 
 /* DRAWSPAN_T0_BMGROUP and DRAWSPAN_T1_BMGROUP emit the 10
@@ -1850,6 +1907,8 @@ static void Command_DrawPolygon_##SUFFIX(PS_GPU *gpu, const uint32_t *cb) \
          bool pct = (PGXP_LIT) && (TEXTURED_LIT) \
                     && !invalidW \
                     && PGXP_texture_correction_enabled(); \
+         if (TEXTURED_LIT) \
+            TexXCache_Bind(gpu, clut >> 4, MO_LIT); \
          DrawTriangle_g##GOURAUD_LIT##_t##TEXTURED_LIT##_##BM_TAG##_TM##TM_LIT##_MO##MO_LIT##_ME##ME_LIT(gpu, vertices, pct); \
       } \
       /* Line Render: Overwrite vertices with those of the second triangle */ \
@@ -0,0 +1,609 @@
+#ifndef __MDFN_PSX_GPU_SCANOUT_H
+#define __MDFN_PSX_GPU_SCANOUT_H
+
+/* Software scanout kernels: one upscaled VRAM row -> one surface row.
+ *
+ * Split out of gpu.c so tools/gpu_scanout can build the SIMD paths and
+ * the scalar reference side by side and compare them.  Defining
+ * GPU_SCANOUT_SCALAR before including this header compiles the scalar
+ * loops only; that build IS the reference, so the scalar loops below
+ * must keep their exact historical behaviour, quirks included:
+ *
+ *   - fb_mask is a byte mask, (2048 << s) - 1, and the 24-bit path
+ *     applies it to a word index as well.  That never wraps (the word
+ *     index stays below 1024 << s plus one pixel's worth), so the last
+ *     24-bit pixel before the row end reads its high word from the
+ *     start of the next VRAM row.
+ *   - 15-bit pixels widen by `<< 3`, not by bit replication.
+ *
+ * Every SIMD loop runs ahead of the scalar one and hands over as soon
+ * as fewer than a full block of pixels remains or the block's source
+ * bytes would cross the fb_x wrap; the scalar loop finishes the row
+ * and handles the wrap.
+ *
+ * Instruction sets are picked at compile time, like the rest of the
+ * GPU fast paths: AVX2 when the build targets it (-mavx2 or a -march
+ * that implies it), else SSE2 on x86, else NEON on ARM.  The AVX2
+ * loops run first and fall through to the SSE2 ones for the tail. */
+
+#include <stdint.h>
+#include <boolean.h>
+
+#include "../mednafen-types.h"
+#include "../video/surface.h"
+
+#if !defined(GPU_SCANOUT_SCALAR)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GPU_SCANOUT_AVX2 1
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GPU_SCANOUT_SSE2 1
+#elif defined(GPU_HAVE_NEON) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GPU_SCANOUT_NEON 1
+#endif
+#endif
+
+#if defined(GPU_SCANOUT_SSE2)
+/* Store four XRGB8888 pixels each replicated `upscale` times
+ * (upscale >= 2), i.e. 4 * upscale consecutive output pixels. */
+static INLINE void scanout_rep4_sse2(uint32_t *dest, __m128i c,
+      unsigned upscale)
+{
+   if (upscale == 2)
+   {
+      _mm_storeu_si128((__m128i*)&dest[0], _mm_unpacklo_epi32(c, c));
+      _mm_storeu_si128((__m128i*)&dest[4], _mm_unpackhi_epi32(c, c));
+   }
+   else
+   {
+      const __m128i c0 = _mm_shuffle_epi32(c, 0x00);
+      const __m128i c1 = _mm_shuffle_epi32(c, 0x55);
+      const __m128i c2 = _mm_shuffle_epi32(c, 0xAA);
+      const __m128i c3 = _mm_shuffle_epi32(c, 0xFF);
+      unsigned k;
+#if defined(GPU_SCANOUT_AVX2)
+      if (upscale >= 8)
+      {
+         const __m256i w0 = _mm256_broadcastd_epi32(c0);
+         const __m256i w1 = _mm256_broadcastd_epi32(c1);
+         const __m256i w2 = _mm256_broadcastd_epi32(c2);
+         const __m256i w3 = _mm256_broadcastd_epi32(c3);
+         for (k = 0; k < upscale; k += 8)
+         {
+            _mm256_storeu_si256((__m256i*)&dest[k],               w0);
+            _mm256_storeu_si256((__m256i*)&dest[upscale + k],     w1);
+            _mm256_storeu_si256((__m256i*)&dest[2 * upscale + k], w2);
+            _mm256_storeu_si256((__m256i*)&dest[3 * upscale + k], w3);
+         }
+         return;
+      }
+#endif
+      for (k = 0; k < upscale; k += 4)
+      {
+         _mm_storeu_si128((__m128i*)&dest[k],               c0);
+         _mm_storeu_si128((__m128i*)&dest[upscale + k],     c1);
+         _mm_storeu_si128((__m128i*)&dest[2 * upscale + k], c2);
+         _mm_storeu_si128((__m128i*)&dest[3 * upscale + k], c3);
+      }
+   }
+}
+#endif
+
+#if defined(GPU_SCANOUT_NEON)
+/* NEON twin of scanout_rep4_sse2. */
+static INLINE void scanout_rep4_neon(uint32_t *dest, uint32x4_t c,
+      unsigned upscale)
+{
+   if (upscale == 2)
+   {
+      const uint32x4x2_t z = vzipq_u32(c, c);
+      vst1q_u32(&dest[0], z.val[0]);
+      vst1q_u32(&dest[4], z.val[1]);
+   }
+   else
+   {
+      const uint32x4_t c0 = vdupq_n_u32(vgetq_lane_u32(c, 0));
+      const uint32x4_t c1 = vdupq_n_u32(vgetq_lane_u32(c, 1));
+      const uint32x4_t c2 = vdupq_n_u32(vgetq_lane_u32(c, 2));
+      const uint32x4_t c3 = vdupq_n_u32(vgetq_lane_u32(c, 3));
+      unsigned k;
+      for (k = 0; k < upscale; k += 4)
+      {
+         vst1q_u32(&dest[k],               c0);
+         vst1q_u32(&dest[upscale + k],     c1);
+         vst1q_u32(&dest[2 * upscale + k], c2);
+         vst1q_u32(&dest[3 * upscale + k], c3);
+      }
+   }
+}
+#endif
+
+static INLINE void ReorderRGB_Var(uint32_t out_Rshift,
+      uint32_t out_Gshift, uint32_t out_Bshift,
+      bool bpp24, const uint16_t *src, uint32_t *dest,
+      const int32_t dx_start, const int32_t dx_end, int32_t fb_x,
+      unsigned upscale_shift, unsigned upscale)
+{
+  int32_t fb_mask = ((0x7FF << upscale_shift) + upscale - 1);
+
+   if(bpp24)   /* 24bpp */
+   {
+      int32_t x = dx_start;
+#if defined(GPU_SCANOUT_SSE2) || defined(GPU_SCANOUT_NEON)
+      /* Native-res fast path.  At upscale_shift == 0 the 24bpp source
+       * is a plain byte stream of consecutive R,G,B triplets: output
+       * pixel p reads bytes [fb_x + 3*p + 0..2] as R,G,B and writes
+       * dest = B | (G<<8) | (R<<16) (the RED/GREEN/BLUE_SHIFT layout,
+       * 16/8/0).  fb_x advances by 3 per pixel and wraps at the
+       * 0x7FF-word VRAM-row boundary; we vectorise only the contiguous
+       * span before the wrap and let the scalar loop finish the tail
+       * (it re-derives the wrap via `& fb_mask`). */
+      if (upscale_shift == 0)
+      {
+         const uint8_t *bytes = (const uint8_t*)src;
+#if defined(GPU_SCANOUT_AVX2)
+         /* 8 px from one 32-byte load.  The dword permute hands lane 0
+          * bytes [0, 16) and lane 1 bytes [12, 28), so each lane holds
+          * four whole triplets at offsets 0/3/6/9 and one in-lane byte
+          * shuffle rebuilds B|G<<8|R<<16 for all eight. */
+         const __m256i perm = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+         const __m256i shuf = _mm256_setr_epi8(
+               2, 1, 0, -1,  5,  4,  3, -1,  8,  7,  6, -1, 11, 10,  9, -1,
+               2, 1, 0, -1,  5,  4,  3, -1,  8,  7,  6, -1, 11, 10,  9, -1);
+         while (x + 8 <= dx_end)
+         {
+            __m256i w;
+            /* The load covers bytes [fb_x, fb_x + 32); keep it inside
+             * the row, not just the 24 bytes actually used. */
+            if ((fb_x + 32) > (fb_mask + 1))
+               break;
+            w = _mm256_loadu_si256((const __m256i*)&bytes[fb_x]);
+            w = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(w, perm), shuf);
+            _mm256_storeu_si256((__m256i*)&dest[x], w);
+            x   += 8;
+            fb_x = (fb_x + 24) & fb_mask;
+         }
+#endif
+#if defined(GPU_SCANOUT_SSE2)
+         /* 4 px from three stride-3 unaligned words.  word_p has bytes
+          * [R,G,B,next] in ascending memory order; we want B|G<<8|R<<16,
+          * i.e. swap the R and B bytes and drop the 4th. */
+         while (x + 4 <= dx_end)
+         {
+            __m128i w, b0, b2, g, out;
+            /* The block reads bytes [fb_x .. fb_x+12]; fb_x wraps at
+             * byte 0x800 (fb_mask is a byte mask).  Bail if the linear
+             * read would cross the wrap - the scalar tail handles it. */
+            if ((fb_x + 12) > (fb_mask + 1))
+               break;
+            w  = _mm_setr_epi32(
+                  *(const uint32_t*)&bytes[fb_x + 0], *(const uint32_t*)&bytes[fb_x + 3],
+                  *(const uint32_t*)&bytes[fb_x + 6], *(const uint32_t*)&bytes[fb_x + 9]);
+            b0  = _mm_and_si128(w, _mm_set1_epi32(0x000000FF));                       /* R */
+            b2  = _mm_and_si128(_mm_srli_epi32(w, 16), _mm_set1_epi32(0x000000FF));   /* B */
+            g   = _mm_and_si128(w, _mm_set1_epi32(0x0000FF00));                       /* G<<8 */
+            out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(b0, 16), b2), g);
+            _mm_storeu_si128((__m128i*)&dest[x], out);
+            x   += 4;
+            fb_x = (fb_x + 12) & fb_mask;
+         }
+#else /* GPU_SCANOUT_NEON */
+         /* vld3 de-interleaves 8 RGB triplets straight into R/G/B. */
+         while (x + 8 <= dx_end)
+         {
+            uint8x8x3_t rgb;
+            uint16x8_t  lo, hi;
+            uint32x4_t  p0, p1;
+            /* vld3 reads bytes [fb_x .. fb_x+24); fb_x wraps at byte
+             * 0x800.  Bail if the read would cross the wrap. */
+            if ((fb_x + 24) > (fb_mask + 1))
+               break;
+            rgb = vld3_u8(&bytes[fb_x]);
+            lo  = vorrq_u16(vmovl_u8(rgb.val[2]), vshlq_n_u16(vmovl_u8(rgb.val[1]), 8)); /* B|G<<8 */
+            hi  = vmovl_u8(rgb.val[0]);                                                  /* R */
+            p0  = vorrq_u32(vmovl_u16(vget_low_u16(lo)),  vshlq_n_u32(vmovl_u16(vget_low_u16(hi)),  16));
+            p1  = vorrq_u32(vmovl_u16(vget_high_u16(lo)), vshlq_n_u32(vmovl_u16(vget_high_u16(hi)), 16));
+            vst1q_u32(&dest[x],     p0);
+            vst1q_u32(&dest[x + 4], p1);
+            x   += 8;
+            fb_x = (fb_x + 24) & fb_mask;
+         }
+#endif
+      }
+      else
+      {
+         /* Upscaled path.  The scalar loop reads, per output pixel,
+          * the words at w = fb_x >> 1 and w + (1 << s), shifts the pair
+          * right by 8 when the native byte offset (fb_x >> s) is odd,
+          * and writes the colour `upscale` times.  Within a block that
+          * does not wrap, w advances by a constant 3 << (s - 1) words
+          * and the odd/even shift simply alternates from pixel to
+          * pixel, so the blocks below gather the word pairs, apply the
+          * alternating shift with a lane mask and store the replicated
+          * colours with full-width stores - the stores, `upscale` per
+          * pixel on each of the `upscale` rows, are most of the cost.
+          *
+          * The high-word index needs no `& fb_mask` here: w stays below
+          * 1024 << s, so w + (1 << s) stays far below the mask. */
+         const int32_t  span   = 3 << upscale_shift;        /* fb_x bytes per pixel */
+         const int32_t  step   = 3 << (upscale_shift - 1);  /* words per pixel */
+         const int32_t  hi_off = 1 << upscale_shift;
+#if defined(GPU_SCANOUT_AVX2)
+         while (x + 8 * (int32_t)upscale <= dx_end)
+         {
+            const uint16_t *s0 = &src[fb_x >> 1];
+            __m256i v, sel, sh, c;
+            if ((fb_x + 7 * span) > fb_mask)
+               break;
+            v   = _mm256_setr_epi16(
+                  (short)s0[0],        (short)s0[hi_off],
+                  (short)s0[step],     (short)s0[step + hi_off],
+                  (short)s0[2 * step], (short)s0[2 * step + hi_off],
+                  (short)s0[3 * step], (short)s0[3 * step + hi_off],
+                  (short)s0[4 * step], (short)s0[4 * step + hi_off],
+                  (short)s0[5 * step], (short)s0[5 * step + hi_off],
+                  (short)s0[6 * step], (short)s0[6 * step + hi_off],
+                  (short)s0[7 * step], (short)s0[7 * step + hi_off]);
+            /* Lanes whose native byte offset is odd take the >> 8. */
+            sel = ((fb_x >> upscale_shift) & 1)
+               ? _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0)
+               : _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+            sh  = _mm256_blendv_epi8(v, _mm256_srli_epi32(v, 8), sel);
+            c   = _mm256_or_si256(
+                  _mm256_or_si256(
+                     _mm256_slli_epi32(_mm256_and_si256(sh, _mm256_set1_epi32(0xFF)), 16),
+                     _mm256_and_si256(sh, _mm256_set1_epi32(0xFF00))),
+                  _mm256_and_si256(_mm256_srli_epi32(sh, 16), _mm256_set1_epi32(0xFF)));
+            scanout_rep4_sse2(&dest[x], _mm256_castsi256_si128(c), upscale);
+            scanout_rep4_sse2(&dest[x + 4 * upscale],
+                  _mm256_extracti128_si256(c, 1), upscale);
+            x   += 8 * upscale;
+            fb_x = (fb_x + 8 * span) & fb_mask;
+         }
+#endif
+#if defined(GPU_SCANOUT_SSE2)
+         while (x + 4 * (int32_t)upscale <= dx_end)
+         {
+            const uint16_t *s0 = &src[fb_x >> 1];
+            __m128i v, sel, sh, c;
+            if ((fb_x + 3 * span) > fb_mask)
+               break;
+            v   = _mm_setr_epi16(
+                  (short)s0[0],        (short)s0[hi_off],
+                  (short)s0[step],     (short)s0[step + hi_off],
+                  (short)s0[2 * step], (short)s0[2 * step + hi_off],
+                  (short)s0[3 * step], (short)s0[3 * step + hi_off]);
+            sel = ((fb_x >> upscale_shift) & 1)
+               ? _mm_setr_epi32(-1, 0, -1, 0)
+               : _mm_setr_epi32(0, -1, 0, -1);
+            sh  = _mm_or_si128(_mm_and_si128(sel, _mm_srli_epi32(v, 8)),
+                               _mm_andnot_si128(sel, v));
+            c   = _mm_or_si128(
+                  _mm_or_si128(
+                     _mm_slli_epi32(_mm_and_si128(sh, _mm_set1_epi32(0xFF)), 16),
+                     _mm_and_si128(sh, _mm_set1_epi32(0xFF00))),
+                  _mm_and_si128(_mm_srli_epi32(sh, 16), _mm_set1_epi32(0xFF)));
+            scanout_rep4_sse2(&dest[x], c, upscale);
+            x   += 4 * upscale;
+            fb_x = (fb_x + 4 * span) & fb_mask;
+         }
+#else /* GPU_SCANOUT_NEON */
+         static const int32_t shift_even[4] = { 0, -8, 0, -8 };
+         static const int32_t shift_odd[4]  = { -8, 0, -8, 0 };
+         while (x + 4 * (int32_t)upscale <= dx_end)
+         {
+            const uint16_t *s0 = &src[fb_x >> 1];
+            uint32_t   w[4];
+            uint32x4_t v, sh, c;
+            if ((fb_x + 3 * span) > fb_mask)
+               break;
+            w[0] = s0[0]        | ((uint32_t)s0[hi_off]            << 16);
+            w[1] = s0[step]     | ((uint32_t)s0[step + hi_off]     << 16);
+            w[2] = s0[2 * step] | ((uint32_t)s0[2 * step + hi_off] << 16);
+            w[3] = s0[3 * step] | ((uint32_t)s0[3 * step + hi_off] << 16);
+            v  = vld1q_u32(w);
+            /* vshlq with a negative count shifts right. */
+            sh = vshlq_u32(v, vld1q_s32(((fb_x >> upscale_shift) & 1)
+                     ? shift_odd : shift_even));
+            c  = vorrq_u32(
+                  vorrq_u32(
+                     vshlq_n_u32(vandq_u32(sh, vdupq_n_u32(0xFF)), 16),
+                     vandq_u32(sh, vdupq_n_u32(0xFF00))),
+                  vandq_u32(vshrq_n_u32(sh, 16), vdupq_n_u32(0xFF)));
+            scanout_rep4_neon(&dest[x], c, upscale);
+            x   += 4 * upscale;
+            fb_x = (fb_x + 4 * span) & fb_mask;
+         }
+#endif
+      }
+#endif
+      for(; x < dx_end; x+= upscale)
+      {
+         int i;
+         uint32_t color;
+         uint32_t srcpix = src[(fb_x >> 1) + 0]
+            | (src[((fb_x >> 1) + (1 << upscale_shift)) & fb_mask] << 16);
+         srcpix >>= ((fb_x >> upscale_shift) & 1) * 8;
+
+         color =   (((srcpix >> 0) << RED_SHIFT)   & (0xFF << RED_SHIFT))
+            | (((srcpix >> 8) << GREEN_SHIFT) & (0xFF << GREEN_SHIFT))
+            | (((srcpix >> 16) << BLUE_SHIFT) & (0xFF << BLUE_SHIFT));
+
+         for (i = 0; i < upscale; i++)
+            dest[x + i] = color;
+
+         fb_x = (fb_x + (3 << upscale_shift)) & fb_mask;
+      }
+   }           /* 15bpp */
+   else
+   {
+      int32_t x = dx_start;
+
+#if defined(GPU_SCANOUT_SSE2) || defined(GPU_SCANOUT_NEON)
+      /* 8-pixel fast path (16 with AVX2).  Each PSX 16-bit pixel is
+       *   bit  15: mask  (dropped)
+       *   bits 10-14: B (5 bits)
+       *   bits  5-9:  G (5 bits)
+       *   bits  0-4:  R (5 bits)
+       * and the scalar path produces XRGB8888 by zero-padding each
+       * 5-bit channel to 8 bits (i.e. `<< 3`, NOT bit-replication) -
+       * we match that bit-exactly so SIMD / scalar output is
+       * indistinguishable.
+       *
+       * The upscaled row is converted 1:1 (upscaling already happened
+       * when VRAM was written), so this serves every upscale_shift.
+       *
+       * Bails to scalar when:
+       *   - fewer than a block of output pixels remain (handles the
+       *     tail);
+       *   - the block's source span would cross the fb_x wrap
+       *     boundary (rare: only when starting near the end of the
+       *     upscaled VRAM row, and even then only at the boundary
+       *     itself).  The scalar loop's `& fb_mask` handles wrap
+       *     correctly on its own, so we just break and let it run.
+       */
+      const int32_t words_per_row = (fb_mask + 1) >> 1;
+#if defined(GPU_SCANOUT_AVX2)
+      {
+         const __m256i mask5 = _mm256_set1_epi16(0x001F);
+         while ((dx_end - x) >= 16)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            __m256i s, r8, g8, b8, gb_lo, lo, hi;
+
+            if (word_idx + 16 > words_per_row)
+               break;
+
+            s     = _mm256_loadu_si256((const __m256i*)&src[word_idx]);
+            r8    = _mm256_slli_epi16(_mm256_and_si256(s, mask5), 3);
+            g8    = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(s,  5), mask5), 3);
+            b8    = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(s, 10), mask5), 3);
+            gb_lo = _mm256_or_si256(_mm256_slli_epi16(g8, 8), b8);
+            /* The 16-bit unpacks work per 128-bit lane (P0-3|P8-11 and
+             * P4-7|P12-15); the lane permutes put them back in order. */
+            lo    = _mm256_unpacklo_epi16(gb_lo, r8);
+            hi    = _mm256_unpackhi_epi16(gb_lo, r8);
+            _mm256_storeu_si256((__m256i*)&dest[x],
+                  _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)&dest[x + 8],
+                  _mm256_permute2x128_si256(lo, hi, 0x31));
+
+            x   += 16;
+            fb_x = (fb_x + 32) & fb_mask;
+         }
+      }
+#endif
+#if defined(GPU_SCANOUT_SSE2)
+      {
+         const __m128i mask5 = _mm_set1_epi16(0x001F);
+         while ((dx_end - x) >= 8)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            __m128i s, r5, g5, b5, r8, g8, b8, gb_lo, ar_hi;
+            __m128i pixels_lo, pixels_hi;
+
+            /* Would the 8-word load cross the wrap?  Hand off to
+             * scalar if so - it'll wrap correctly via `& fb_mask`. */
+            if (word_idx + 8 > words_per_row)
+               break;
+
+            s     = _mm_loadu_si128((const __m128i*)&src[word_idx]);
+            /* Extract R5/G5/B5 in 16-bit lanes. */
+            r5    = _mm_and_si128(s,                          mask5);
+            g5    = _mm_and_si128(_mm_srli_epi16(s,  5),      mask5);
+            b5    = _mm_and_si128(_mm_srli_epi16(s, 10),      mask5);
+            /* Scale to 8-bit by shifting left 3 (zero-pad low bits -
+             * matches scalar's `<< 3` exactly). */
+            r8    = _mm_slli_epi16(r5, 3);
+            g8    = _mm_slli_epi16(g5, 3);
+            b8    = _mm_slli_epi16(b5, 3);
+            /* Assemble per-pixel halves:
+             *   gb_lo lane i = (G8[i] << 8) | B8[i]   -> low 16 bits of XRGB8888
+             *   ar_hi lane i = 0 | R8[i]              -> high 16 bits of XRGB8888 (alpha=0)
+             */
+            gb_lo = _mm_or_si128(_mm_slli_epi16(g8, 8), b8);
+            ar_hi = r8;
+            /* Interleave 16-bit halves into 32-bit XRGB8888 pixels. */
+            pixels_lo = _mm_unpacklo_epi16(gb_lo, ar_hi);   /* P0..P3 */
+            pixels_hi = _mm_unpackhi_epi16(gb_lo, ar_hi);   /* P4..P7 */
+            _mm_storeu_si128((__m128i*)&dest[x],     pixels_lo);
+            _mm_storeu_si128((__m128i*)&dest[x + 4], pixels_hi);
+
+            x   += 8;
+            fb_x = (fb_x + 16) & fb_mask;
+         }
+      }
+#else /* GPU_SCANOUT_NEON */
+      {
+         const uint16x8_t mask5 = vdupq_n_u16(0x001F);
+         while ((dx_end - x) >= 8)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            uint16x8_t   s, r8, g8, b8, gb_lo;
+            uint16x8x2_t z;
+
+            if (word_idx + 8 > words_per_row)
+               break;
+
+            s     = vld1q_u16(&src[word_idx]);
+            r8    = vshlq_n_u16(vandq_u16(s, mask5), 3);
+            g8    = vshlq_n_u16(vandq_u16(vshrq_n_u16(s,  5), mask5), 3);
+            b8    = vshlq_n_u16(vandq_u16(vshrq_n_u16(s, 10), mask5), 3);
+            gb_lo = vorrq_u16(vshlq_n_u16(g8, 8), b8);
+            /* Zip into (gb_lo, r8) halfword pairs = little-endian
+             * XRGB8888 pixels. */
+            z     = vzipq_u16(gb_lo, r8);
+            vst1q_u32(&dest[x],     vreinterpretq_u32_u16(z.val[0]));
+            vst1q_u32(&dest[x + 4], vreinterpretq_u32_u16(z.val[1]));
+
+            x   += 8;
+            fb_x = (fb_x + 16) & fb_mask;
+         }
+      }
+#endif
+#endif
+
+      /* Scalar tail / non-SIMD fallback / wrap-crossing chunks. */
+      for (; x < dx_end; x++)
+      {
+         uint32_t srcpix = src[(fb_x >> 1)];
+         dest[x] = MAKECOLOR(
+               (((srcpix >> 0) & 0x1F) << 3),
+               (((srcpix >> 5) & 0x1F) << 3),
+               (((srcpix >> 10) & 0x1F) << 3),
+               0);
+
+         fb_x = (fb_x + 2) & fb_mask;
+      }
+   }
+}
+
+/* RGB565 twin of ReorderRGB_Var, used while psx_sw_rgb565 is set.
+ *
+ * Same source walk (fb_x stepping, wrap at the upscaled VRAM row, 1:1
+ * copy of an upscaled 15-bit row) but 16-bit output pixels, so the
+ * surface traffic per scanline halves.  15-bit pixels convert exactly:
+ *   R5 (bits 0-4)   -> bits 11-15
+ *   G5 (bits 5-9)   -> bits 6-10 (G6 = G5 << 1, the low bit zero)
+ *   B5 (bits 10-14) -> bits 0-4
+ * which is bit-for-bit the XRGB8888 output of ReorderRGB_Var with each
+ * channel truncated to 5/6/5 bits - the RGB565 frame shows the same
+ * colours the XRGB8888 one would.
+ *
+ * The 24-bit branch is scalar and lossy: MDEC frames are truncated to
+ * 5/6/5 rather than renegotiating the pixel format mid-session. */
+static INLINE void ReorderRGB565_Var(bool bpp24,
+      const uint16_t *src, uint16_t *dest,
+      const int32_t dx_start, const int32_t dx_end, int32_t fb_x,
+      unsigned upscale_shift, unsigned upscale)
+{
+   int32_t fb_mask = ((0x7FF << upscale_shift) + upscale - 1);
+
+   if (bpp24)
+   {
+      int32_t x;
+      for (x = dx_start; x < dx_end; x += upscale)
+      {
+         int i;
+         uint16_t color;
+         uint32_t srcpix = src[(fb_x >> 1) + 0]
+            | (src[((fb_x >> 1) + (1 << upscale_shift)) & fb_mask] << 16);
+         srcpix >>= ((fb_x >> upscale_shift) & 1) * 8;
+
+         color = (uint16_t)(((srcpix & 0xF8) << 8)
+               | ((srcpix >> 5) & 0x7E0)
+               | ((srcpix >> 19) & 0x1F));
+
+         for (i = 0; i < upscale; i++)
+            dest[x + i] = color;
+
+         fb_x = (fb_x + (3 << upscale_shift)) & fb_mask;
+      }
+   }
+   else
+   {
+      int32_t x = dx_start;
+#if defined(GPU_SCANOUT_SSE2) || defined(GPU_SCANOUT_NEON)
+      /* 8 pixels per step (16 with AVX2).  Same bail-out rules as the
+       * XRGB8888 path: stop before the load would cross the fb_x wrap
+       * and let the scalar tail handle the wrap and the remainder. */
+      const int32_t words_per_row = (fb_mask + 1) >> 1;
+#if defined(GPU_SCANOUT_AVX2)
+      {
+         const __m256i mask_g = _mm256_set1_epi16(0x03E0);
+         const __m256i mask5  = _mm256_set1_epi16(0x001F);
+         while ((dx_end - x) >= 16)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            __m256i sp, r, g, b;
+            if (word_idx + 16 > words_per_row)
+               break;
+            sp = _mm256_loadu_si256((const __m256i*)&src[word_idx]);
+            r  = _mm256_slli_epi16(sp, 11);
+            g  = _mm256_slli_epi16(_mm256_and_si256(sp, mask_g), 1);
+            b  = _mm256_and_si256(_mm256_srli_epi16(sp, 10), mask5);
+            _mm256_storeu_si256((__m256i*)&dest[x],
+                  _mm256_or_si256(_mm256_or_si256(r, g), b));
+            x   += 16;
+            fb_x = (fb_x + 32) & fb_mask;
+         }
+      }
+#endif
+#if defined(GPU_SCANOUT_SSE2)
+      {
+         const __m128i mask_g = _mm_set1_epi16(0x03E0);
+         const __m128i mask5  = _mm_set1_epi16(0x001F);
+         while ((dx_end - x) >= 8)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            __m128i sp, r, g, b;
+            if (word_idx + 8 > words_per_row)
+               break;
+            sp = _mm_loadu_si128((const __m128i*)&src[word_idx]);
+            r  = _mm_slli_epi16(sp, 11);
+            g  = _mm_slli_epi16(_mm_and_si128(sp, mask_g), 1);
+            b  = _mm_and_si128(_mm_srli_epi16(sp, 10), mask5);
+            _mm_storeu_si128((__m128i*)&dest[x],
+                  _mm_or_si128(_mm_or_si128(r, g), b));
+            x   += 8;
+            fb_x = (fb_x + 16) & fb_mask;
+         }
+      }
+#else /* GPU_SCANOUT_NEON */
+      {
+         const uint16x8_t mask_g = vdupq_n_u16(0x03E0);
+         const uint16x8_t mask5  = vdupq_n_u16(0x001F);
+         while ((dx_end - x) >= 8)
+         {
+            const int32_t word_idx = fb_x >> 1;
+            uint16x8_t sp, r, g, b;
+            if (word_idx + 8 > words_per_row)
+               break;
+            sp = vld1q_u16(&src[word_idx]);
+            r  = vshlq_n_u16(sp, 11);
+            g  = vshlq_n_u16(vandq_u16(sp, mask_g), 1);
+            b  = vandq_u16(vshrq_n_u16(sp, 10), mask5);
+            vst1q_u16(&dest[x], vorrq_u16(vorrq_u16(r, g), b));
+            x   += 8;
+            fb_x = (fb_x + 16) & fb_mask;
+         }
+      }
+#endif
+#endif
+
+      for (; x < dx_end; x++)
+      {
+         uint32_t srcpix = src[(fb_x >> 1)];
+         dest[x] = (uint16_t)(((srcpix & 0x1F) << 11)
+               | ((srcpix & 0x3E0) << 1)
+               | ((srcpix >> 10) & 0x1F));
+
+         fb_x = (fb_x + 2) & fb_mask;
+      }
+   }
+}
+
+#endif
@@ -258,6 +258,15 @@ static void DrawSprite_##SUFFIX(PS_GPU *gpu, int32_t x_arg, int32_t y_arg, int32
             gpu->DrawTimeAvail -= suck_time; \
          } \
          x = x_start; \
+         /* DrawSpriteFillVec stores into the row directly; the \
+          * PlotNativePixel path marks via texel_put as well.  The \
+          * texture page cache is told ahead of the stores, which also \
+          * unbinds a page this row is about to draw into. */ \
+         if (x_bound > x_start) \
+         { \
+            MarkVRAMRow(y); \
+            TexXCache_Touch(gpu, y, x_start, x_bound - x_start); \
+         } \
          /* Native-res flat-fill fast path.  Textured sprites and any \
           * upscale stay scalar; the run is within [ClipX0,ClipX1] so \
           * it never crosses the x==1024 VRAM wrap. */ \
@@ -538,6 +547,8 @@ static void Command_DrawSprite_##SUFFIX(PS_GPU *gpu, const uint32_t *cb) \
    GPU_SPR_RHI_PUSH_HOOK(gpu, x, y, w, h, u, v, color, clut, T_LIT, TM_LIT, MO_LIT, BM_VAL, ME_LIT); \
    if (!rhi_intf_has_software_renderer()) \
       return; \
+   if (T_LIT) \
+      TexXCache_Bind(gpu, clut >> 4, MO_LIT); \
    SPR_DISPATCH_DRAW(TM_LIT, BM_TAG, MO_LIT, ME_LIT, T_LIT) \
 }
 
@@ -0,0 +1,266 @@
+#ifndef __MDFN_PSX_GPU_TEXPAGE_CACHE_H
+#define __MDFN_PSX_GPU_TEXPAGE_CACHE_H
+
+/* CLUT-expanded texture page cache for the software rasteriser
+ * ("Software Texture Page Cache" core option).
+ *
+ * Normally every 4bpp or 8bpp textured pixel goes through the emulated
+ * texture cache (tag check, 4-texel refill from VRAM), a nibble/byte
+ * extract and a CLUT_Cache lookup.  With the option on, the rasteriser
+ * instead reads the final 16-bit texel from an expanded copy of the
+ * whole texture page: one load per pixel, indexed by the
+ * texture-window-applied (u, v).  15bpp textures already are one load
+ * per pixel and keep using the emulated cache.
+ *
+ * A page is keyed on texture page X/Y, depth and CLUT position, and
+ * holds the 256x256 texels of that combination as data[v][u].  It is filled lazily, 16 rows (one "band") at a time, the
+ * first time a pixel samples a row of the band.  TEX_XC_ENTRIES pages
+ * are kept; the least recently bound one is reused.
+ *
+ * Invalidation works on 64x16 cells of native VRAM.  A page records
+ * the cells its texels and CLUT come from in tex_xc_cells, and every
+ * VRAM writer reports the cells it has written (TexXCache_Touch).  A
+ * write to a recorded cell drops all bands of the page.  If that page
+ * is bound to the command being drawn (a primitive drawing into its
+ * own texture) it is also unbound, and the rest of the command samples
+ * through the emulated caches rather than re-expanding a band per span.
+ * Writers report after they store, so a band is never refilled from
+ * VRAM that is about to change under it; the one exception is a span
+ * sampling texels it wrote itself, see DrawSpanNative.
+ *
+ * This is not cycle accurate.  Texture cache refills are not charged to
+ * DrawTimeAvail, and the page sees every VRAM write where the real
+ * texture and CLUT caches keep stale data until a texture page change,
+ * fill, copy or CLUT reload.  Hence off by default.
+ *
+ * Included once, by gpu.c, ahead of gpu_common.h (whose GetTexel_*
+ * calls TexXCache_Fetch); reads the native VRAM view directly, as
+ * texel_fetch does. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEX_XC_ENTRIES 8
+
+struct TexXCache_t
+{
+   uint32_t  key;       /* TexXCache_Key; 0 for a never-used entry */
+   uint32_t  bands;     /* bit b set: rows 16b..16b+15 of data are current */
+   uint32_t  last_used;
+   uint16_t *data;      /* 256 x 256 texels, [v][u] */
+};
+
+static struct TexXCache_t tex_xc[TEX_XC_ENTRIES];
+
+/* Bit e set: tex_xc[e] was expanded from that 64x16 cell of native
+ * VRAM.  Bits of a reused entry are cleared before it is re-keyed. */
+static uint8_t  tex_xc_cells[512 >> 4][1024 >> 6];
+static uint32_t tex_xc_clock;
+static bool     tex_xc_enabled;
+
+/* Bit 31 keeps a valid key distinct from a zeroed entry. */
+static INLINE uint32_t TexXCache_Key(const PS_GPU *g, uint32_t raw_clut,
+      unsigned tm)
+{
+   return 0x80000000U | (g->TexPageX >> 6) | ((g->TexPageY >> 8) << 4)
+      | (tm << 5) | ((raw_clut & 0x7FFF) << 6);
+}
+
+static void TexXCache_SetCells(uint32_t x, uint32_t y,
+      uint32_t w, uint32_t h, uint8_t bit)
+{
+   const uint32_t c0 = x >> 6;
+   uint32_t       nc = ((x & 63) + w + 63) >> 6;
+   uint32_t       r  = y >> 4;
+   uint32_t       nr = ((y & 15) + h + 15) >> 4;
+
+   if (nc > 16)
+      nc = 16;
+
+   for (; nr--; r++)
+   {
+      uint32_t c;
+      for (c = 0; c < nc; c++)
+         tex_xc_cells[r & 31][(c0 + c) & 15] |= bit;
+   }
+}
+
+static void TexXCache_Flush(PS_GPU *g)
+{
+   unsigned i;
+   for (i = 0; i < TEX_XC_ENTRIES; i++)
+      tex_xc[i].bands = 0;
+   g->tex_xc = NULL;
+}
+
+static void TexXCache_Free(PS_GPU *g)
+{
+   unsigned i;
+   for (i = 0; i < TEX_XC_ENTRIES; i++)
+      free(tex_xc[i].data);
+   memset(tex_xc, 0, sizeof(tex_xc));
+   memset(tex_xc_cells, 0, sizeof(tex_xc_cells));
+   tex_xc_clock = 0;
+   g->tex_xc    = NULL;
+}
+
+static void TexXCache_Invalidate(PS_GPU *g, uint8_t hit)
+{
+   unsigned i;
+   for (i = 0; i < TEX_XC_ENTRIES; i++)
+   {
+      if (!(hit & (1 << i)))
+         continue;
+      tex_xc[i].bands = 0;
+      if (g->tex_xc == &tex_xc[i])
+         g->tex_xc = NULL;
+   }
+}
+
+/* Native VRAM row y, columns x .. x + w - 1 (w > 0, wrapping at 1024)
+ * have been written.  Callers test tex_xc_enabled first, as
+ * TexXCache_Bind does, so the default configuration pays no per-write
+ * cost; switching the cache off frees every page and clears the cell
+ * map, so no write missed while it was off can leave a stale band. */
+static INLINE void TexXCache_Touch(PS_GPU *g, uint32_t y, uint32_t x,
+      uint32_t w)
+{
+   const uint8_t *row = tex_xc_cells[(y & 511) >> 4];
+   uint32_t       c   = x >> 6;
+   uint32_t       n   = ((x & 63) + w + 63) >> 6;
+   uint8_t        hit = 0;
+
+   if (n > 16)
+      n = 16;
+
+   for (; n--; c++)
+      hit |= row[c & 15];
+
+   if (MDFN_UNLIKELY(hit))
+      TexXCache_Invalidate(g, hit);
+}
+
+/* Bind the page for the texture page, window and CLUT of the textured
+ * command about to be drawn, or leave g->tex_xc NULL to sample through
+ * the emulated caches (option off, 15bpp, out of memory). */
+static void TexXCache_Bind(PS_GPU *g, uint32_t raw_clut, unsigned tm)
+{
+   uint32_t            key;
+   struct TexXCache_t *e      = NULL;
+   struct TexXCache_t *victim = &tex_xc[0];
+   unsigned            i;
+
+   g->tex_xc = NULL;
+
+   if (!tex_xc_enabled || tm >= 2)
+      return;
+
+   key = TexXCache_Key(g, raw_clut, tm);
+
+   for (i = 0; i < TEX_XC_ENTRIES; i++)
+   {
+      if (tex_xc[i].key == key)
+      {
+         e = &tex_xc[i];
+         break;
+      }
+      if (tex_xc[i].last_used < victim->last_used)
+         victim = &tex_xc[i];
+   }
+
+   if (!e)
+   {
+      const uint8_t bit = 1 << (victim - tex_xc);
+      uint8_t      *cell;
+
+      if (!victim->data)
+      {
+         victim->data = (uint16_t*)malloc(256 * 256 * sizeof(uint16_t));
+         if (!victim->data)
+            return;
+      }
+
+      for (cell = &tex_xc_cells[0][0];
+            cell != &tex_xc_cells[0][0] + sizeof(tex_xc_cells); cell++)
+         *cell &= ~bit;
+
+      victim->key   = key;
+      victim->bands = 0;
+      TexXCache_SetCells(g->TexPageX, g->TexPageY, 64 << tm, 256, bit);
+      TexXCache_SetCells((raw_clut & 0x3F) << 4, (raw_clut >> 6) & 0x1FF,
+            tm ? 256 : 16, 1, bit);
+      e = victim;
+   }
+
+   /* The texture window's offset within the page; the page origin
+    * part of SUCV.TWX_ADD/TWY_ADD is in the key instead. */
+   g->tex_xc_u_add = (g->twx & g->tww) << 3;
+   g->tex_xc_v_add = (g->twy & g->twh) << 3;
+   e->last_used    = ++tex_xc_clock;
+   g->tex_xc       = e;
+}
+
+static void TexXCache_FillBand(PS_GPU *g, struct TexXCache_t *e,
+      unsigned band)
+{
+   const bool      tm8  = (e->key >> 5) & 1;
+   const uint32_t  px   = (e->key & 0xF) << 6;
+   const uint32_t  py   = ((e->key >> 4) & 1) << 8;
+   const uint32_t  raw  = (e->key >> 6) & 0x7FFF;
+   const uint16_t *vn   = g->vram_native;
+   const uint16_t *crow = &vn[((raw >> 6) & 0x1FF) << 10];
+   const uint32_t  cxo  = (raw & 0x3F) << 4;
+   uint16_t        clut[256];
+   unsigned        i, v;
+
+   for (i = 0; i < (tm8 ? 256u : 16u); i++)
+      clut[i] = crow[(cxo + i) & 0x3FF];
+
+   for (v = band << 4; v < (band + 1) << 4; v++)
+   {
+      const uint16_t *src = &vn[(py + v) << 10];
+      uint16_t       *dst = &e->data[v << 8];
+      unsigned        x;
+
+      if (tm8)
+      {
+         for (x = 0; x < 128; x++, dst += 2)
+         {
+            const uint16_t w = src[(px + x) & 1023];
+            dst[0] = clut[w & 0xFF];
+            dst[1] = clut[w >> 8];
+         }
+      }
+      else
+      {
+         for (x = 0; x < 64; x++, dst += 4)
+         {
+            const uint16_t w = src[px + x];
+            dst[0] = clut[w & 0xF];
+            dst[1] = clut[(w >> 4) & 0xF];
+            dst[2] = clut[(w >> 8) & 0xF];
+            dst[3] = clut[w >> 12];
+         }
+      }
+   }
+
+   e->bands |= 1U << band;
+}
+
+/* The texel GetTexel_TM<n> would return for (u_arg, v_arg), from the
+ * bound page.  (u & TWX_AND) + tex_xc_u_add stays within 0..255: the
+ * window offset only sets bits the mask clears. */
+static INLINE uint16_t TexXCache_Fetch(PS_GPU *g, int32_t u_arg,
+      int32_t v_arg)
+{
+   struct TexXCache_t *e  = (struct TexXCache_t *)g->tex_xc;
+   const uint32_t      tu = ((u_arg & g->SUCV.TWX_AND) + g->tex_xc_u_add) & 0xFF;
+   const uint32_t      tv = ((v_arg & g->SUCV.TWY_AND) + g->tex_xc_v_add) & 0xFF;
+
+   if (MDFN_UNLIKELY(!(e->bands & (1U << (tv >> 4)))))
+      TexXCache_FillBand(g, e, tv >> 4);
+
+   return e->data[(tv << 8) | tu];
+}
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef __MDFN_PSX_GPU_VRAM_SCALE_H
+#define __MDFN_PSX_GPU_VRAM_SCALE_H
+
+/* Native <-> upscaled VRAM conversion for savestates and GPU_Rescale.
+ *
+ * At an internal resolution above 1x, GPU.vram holds every native
+ * pixel as an UPSCALE x UPSCALE block, while savestates always store
+ * VRAM at 1x.  Saving takes the top-left pixel of each block
+ * (texel_fetch); loading writes each native pixel back as a whole
+ * block (texel_put).  Both used to run per pixel, and texel_put stores
+ * its UPSCALE^2 subpixels one at a time - 16M scalar stores per load
+ * at 4x, every frame under run-ahead.
+ *
+ * Here both directions work a row at a time:
+ *
+ *   - vram_downsample_row gathers every UPSCALE-th pixel of one
+ *     upscaled row;
+ *   - vram_replicate_row widens a native row into one upscaled row,
+ *     which is then copied to the other UPSCALE - 1 rows of its blocks.
+ *
+ * Saving no longer downscales at all: PS_GPU.vram_native keeps the
+ * native pixels current as VRAM is written, and the state is saved
+ * from there.  vram_downsample_row still brings that view up to date
+ * after a vector span store, and vram_downscale rebuilds it from
+ * GPU.vram once a state has been loaded; tools/gpu_vram also checks
+ * the rows against it.
+ *
+ * vram_upscale_changed is the load path.  It compares the state's
+ * native VRAM with what GPU.vram holds now, one 64x256 texture page at
+ * a time, and only rewrites the pages that differ.  Under run-ahead
+ * and rewind most pages (textures, CLUTs) are the same from one state
+ * to the next, and only the drawn areas change.  A page whose native
+ * pixels all match keeps its upscaled detail.  That detail was drawn
+ * by the renderer over the same native content.  The full rewrite
+ * would have flattened it into blocks, and the next frame would have
+ * drawn it again.
+ *
+ * Instruction sets are picked at compile time, like the other GPU
+ * kernels: SSE2 on x86, else NEON on ARM.  The vector paths cover 2x
+ * and 4x, which are the common internal resolutions.  8x and 16x use
+ * the scalar loops, where a single native pixel already spans one or
+ * more full vector stores.  Defining GPU_VRAM_SCALE_SCALAR before
+ * including this header compiles the scalar loops only; tools/gpu_vram
+ * checks the two builds against each other. */
+
+#include <stdint.h>
+#include <string.h>
+#include <boolean.h>
+
+#include "../mednafen-types.h"
+
+#if !defined(GPU_VRAM_SCALE_SCALAR)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GPU_VRAM_SCALE_SSE2 1
+#elif defined(GPU_HAVE_NEON) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GPU_VRAM_SCALE_NEON 1
+#endif
+#endif
+
+/* Page size, in native pixels, for vram_upscale_changed. */
+#define VRAM_SCALE_PAGE_W   64
+#define VRAM_SCALE_PAGE_H   256
+#define VRAM_SCALE_PAGES    ((1024 / VRAM_SCALE_PAGE_W) * (512 / VRAM_SCALE_PAGE_H))
+
+#if defined(GPU_VRAM_SCALE_SSE2)
+/* Keep the even 16-bit lanes of a and b: a0 a2 a4 a6 b0 b2 b4 b6.
+ * The sign extension makes packs_epi32 exact: every lane is then
+ * within int16_t range and never saturates. */
+static INLINE __m128i vram_scale_even_sse2(__m128i a, __m128i b)
+{
+   a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+   b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+   return _mm_packs_epi32(a, b);
+}
+#endif
+
+/* dst[x] = src[x << shift], for x in [0, n). */
+static INLINE void vram_downsample_row(uint16_t *dst, const uint16_t *src,
+      unsigned n, unsigned shift)
+{
+   unsigned x = 0;
+
+#if defined(GPU_VRAM_SCALE_SSE2)
+   if (shift == 1)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         const __m128i a = _mm_loadu_si128((const __m128i*)&src[2 * x]);
+         const __m128i b = _mm_loadu_si128((const __m128i*)&src[2 * x + 8]);
+         _mm_storeu_si128((__m128i*)&dst[x], vram_scale_even_sse2(a, b));
+      }
+   }
+   else if (shift == 2)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         const __m128i a = _mm_loadu_si128((const __m128i*)&src[4 * x]);
+         const __m128i b = _mm_loadu_si128((const __m128i*)&src[4 * x + 8]);
+         const __m128i c = _mm_loadu_si128((const __m128i*)&src[4 * x + 16]);
+         const __m128i d = _mm_loadu_si128((const __m128i*)&src[4 * x + 24]);
+         _mm_storeu_si128((__m128i*)&dst[x], vram_scale_even_sse2(
+                  vram_scale_even_sse2(a, b), vram_scale_even_sse2(c, d)));
+      }
+   }
+#elif defined(GPU_VRAM_SCALE_NEON)
+   if (shift == 1)
+   {
+      for (; x + 8 <= n; x += 8)
+         vst1q_u16(&dst[x], vld2q_u16(&src[2 * x]).val[0]);
+   }
+   else if (shift == 2)
+   {
+      for (; x + 8 <= n; x += 8)
+         vst1q_u16(&dst[x], vld4q_u16(&src[4 * x]).val[0]);
+   }
+#endif
+
+   for (; x < n; x++)
+      dst[x] = src[x << shift];
+}
+
+/* dst[x] = src[x >> shift], for x in [0, n << shift). */
+static INLINE void vram_replicate_row(uint16_t *dst, const uint16_t *src,
+      unsigned n, unsigned shift)
+{
+   const unsigned up = 1u << shift;
+   unsigned       x  = 0;
+
+#if defined(GPU_VRAM_SCALE_SSE2)
+   if (shift == 1)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         const __m128i v = _mm_loadu_si128((const __m128i*)&src[x]);
+         _mm_storeu_si128((__m128i*)&dst[2 * x],     _mm_unpacklo_epi16(v, v));
+         _mm_storeu_si128((__m128i*)&dst[2 * x + 8], _mm_unpackhi_epi16(v, v));
+      }
+   }
+   else if (shift == 2)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         const __m128i v  = _mm_loadu_si128((const __m128i*)&src[x]);
+         const __m128i lo = _mm_unpacklo_epi16(v, v);
+         const __m128i hi = _mm_unpackhi_epi16(v, v);
+         _mm_storeu_si128((__m128i*)&dst[4 * x],      _mm_unpacklo_epi32(lo, lo));
+         _mm_storeu_si128((__m128i*)&dst[4 * x + 8],  _mm_unpackhi_epi32(lo, lo));
+         _mm_storeu_si128((__m128i*)&dst[4 * x + 16], _mm_unpacklo_epi32(hi, hi));
+         _mm_storeu_si128((__m128i*)&dst[4 * x + 24], _mm_unpackhi_epi32(hi, hi));
+      }
+   }
+#elif defined(GPU_VRAM_SCALE_NEON)
+   if (shift == 1)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         uint16x8x2_t w;
+         w.val[0] = w.val[1] = vld1q_u16(&src[x]);
+         vst2q_u16(&dst[2 * x], w);
+      }
+   }
+   else if (shift == 2)
+   {
+      for (; x + 8 <= n; x += 8)
+      {
+         uint16x8x4_t w;
+         w.val[0] = w.val[1] = w.val[2] = w.val[3] = vld1q_u16(&src[x]);
+         vst4q_u16(&dst[4 * x], w);
+      }
+   }
+#endif
+
+   for (; x < n; x++)
+   {
+      const uint16_t v = src[x];
+      uint16_t      *d = &dst[x << shift];
+      unsigned       k;
+
+      for (k = 0; k < up; k++)
+         d[k] = v;
+   }
+}
+
+/* native (1024x512) = the top-left pixel of every block of vram. */
+static INLINE void vram_downscale(uint16_t *native, const uint16_t *vram,
+      unsigned shift)
+{
+   const size_t pitch = (size_t)1024 << shift;
+   unsigned     y;
+
+   for (y = 0; y < 512; y++)
+      vram_downsample_row(&native[y * 1024],
+            &vram[((size_t)y << shift) * pitch], 1024, shift);
+}
+
+/* Rewrite native columns [x0, x0 + n) of native rows [y0, y0 + h) into
+ * vram as full blocks. */
+static INLINE void vram_upscale_rect(uint16_t *vram, const uint16_t *native,
+      unsigned shift, unsigned x0, unsigned y0, unsigned n, unsigned h)
+{
+   const unsigned up    = 1u << shift;
+   const size_t   pitch = (size_t)1024 << shift;
+   unsigned       y, k;
+
+   for (y = y0; y < y0 + h; y++)
+   {
+      uint16_t *row = &vram[((size_t)y << shift) * pitch + (x0 << shift)];
+
+      vram_replicate_row(row, &native[y * 1024 + x0], n, shift);
+      for (k = 1; k < up; k++)
+         memcpy(row + k * pitch, row, (size_t)(n << shift) * sizeof(uint16_t));
+   }
+}
+
+/* Bring vram in line with native, rewriting only the 64x256 pages
+ * whose native pixels differ from the top-left pixels of vram's
+ * blocks; with force set, rewrite every page.  Returns the number of
+ * pages rewritten.
+ *
+ * Dirty pages are found first and then written a band of 256 rows at
+ * a time, each run of adjacent dirty pages as one span per row, so a
+ * full rewrite streams whole VRAM rows. */
+static INLINE unsigned vram_upscale_changed(uint16_t *vram,
+      const uint16_t *native, unsigned shift, bool force)
+{
+   const size_t pitch = (size_t)1024 << shift;
+   unsigned     rewritten = 0;
+   unsigned     px, py;
+
+   for (py = 0; py < 512; py += VRAM_SCALE_PAGE_H)
+   {
+      bool dirty[1024 / VRAM_SCALE_PAGE_W];
+
+      for (px = 0; px < 1024; px += VRAM_SCALE_PAGE_W)
+      {
+         bool    *d = &dirty[px / VRAM_SCALE_PAGE_W];
+         unsigned y;
+
+         *d = force;
+         for (y = py; !*d && y < py + VRAM_SCALE_PAGE_H; y++)
+         {
+            uint16_t cur[VRAM_SCALE_PAGE_W];
+
+            vram_downsample_row(cur,
+                  &vram[((size_t)y << shift) * pitch + (px << shift)],
+                  VRAM_SCALE_PAGE_W, shift);
+            *d = memcmp(cur, &native[y * 1024 + px], sizeof(cur)) != 0;
+         }
+      }
+
+      for (px = 0; px < 1024; )
+      {
+         unsigned end = px;
+
+         while (end < 1024 && dirty[end / VRAM_SCALE_PAGE_W])
+            end += VRAM_SCALE_PAGE_W;
+
+         if (end == px)
+         {
+            px += VRAM_SCALE_PAGE_W;
+            continue;
+         }
+
+         vram_upscale_rect(vram, native, shift, px, py, end - px,
+               VRAM_SCALE_PAGE_H);
+         rewritten += (end - px) / VRAM_SCALE_PAGE_W;
+         px = end;
+      }
+   }
+
+   return rewritten;
+}
+
+#endif
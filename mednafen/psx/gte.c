@@ -28,6 +28,7 @@
 #include "../pgxp/pgxp_gte.h"
 #include "../pgxp/pgxp_main.h"
 #include "gte.h"
+#include "gte_triple.h"
 
 extern bool psx_gte_overclock;
 
@@ -1144,6 +1145,25 @@ static INLINE void MultiplyMatrixByVector(uint32_t mx, uint32_t v, uint32_t cv,
    MAC_to_IR(lm);
 }
 
+/* Store one transformed vertex: MAC1-3, IR1-3 and the SZ push, from
+ * the three 44-bit row accumulators. */
+static INLINE void StorePT(const int64_t tmp[3], uint32_t sf, int lm)
+{
+   SET_MAC(1, tmp[0] >> sf);
+   SET_MAC(2, tmp[1] >> sf);
+   SET_MAC(3, tmp[2] >> sf);
+
+   SET_IR(1, Lm_B(0, MAC(1), lm));
+   SET_IR(2, Lm_B(1, MAC(2), lm));
+   //printf("FTV: %08x %08x\n", CR[cv*CRV_NEXT+CRV_T+2], (uint32)(tmp[2] >> 12));
+   SET_IR(3, Lm_B_PTZ(2, MAC(3), tmp[2] >> 12, lm));
+
+   SET_Z_FIFO(0, Z_FIFO(1));
+   SET_Z_FIFO(1, Z_FIFO(2));
+   SET_Z_FIFO(2, Z_FIFO(3));
+   SET_Z_FIFO(3, Lm_D(tmp[2] >> 12, true));
+}
+
 /* precise_z_acc receives the raw 44-bit Z accumulator, i.e. the value that
  * feeds SZ3 *before* the >>12 truncation and the Lm_D saturation.  It is the
  * exact view-space Z in 1/4096 units and exists solely for the PGXP shadow
@@ -1186,21 +1206,91 @@ static INLINE void MultiplyMatrixByVector_PT(uint32_t mx, uint32_t v, uint32_t c
       tmp[i] = A_MV(i, tmp[i] + mulr[0]);
       tmp[i] = A_MV(i, tmp[i] + mulr[1]);
       tmp[i] = A_MV(i, tmp[i] + mulr[2]);
+   }
+
+   StorePT(tmp, sf, lm);
+
+   *precise_z_acc = tmp[2];
+}
 
-      SET_MAC(1 + i, tmp[i] >> sf);
+/* Operands of the triple ops in the shape GTE_MulMat3x3 takes. */
+static INLINE void LoadMatrix(uint32_t mx, int16_t m[3][3])
+{
+   const uint32_t *c = &CR[mx * M_NEXT];
+
+   m[0][0] = (int16_t)c[0];
+   m[0][1] = (int16_t)(c[0] >> 16);
+   m[0][2] = (int16_t)c[1];
+   m[1][0] = (int16_t)(c[1] >> 16);
+   m[1][1] = (int16_t)c[2];
+   m[1][2] = (int16_t)(c[2] >> 16);
+   m[2][0] = (int16_t)c[3];
+   m[2][1] = (int16_t)(c[3] >> 16);
+   m[2][2] = (int16_t)c[4];
+}
+
+static INLINE void LoadTranslation(uint32_t cv, int32_t t[3])
+{
+   unsigned i;
+
+   for(i = 0; i < 3; i++)
+      t[i] = (cv == CRVectors_Null) ? 0 : (int32_t)CR[(cv*CRV_NEXT)+CRV_T+i];
+}
+
+static INLINE void LoadVectors(int16_t v[3][3])
+{
+   unsigned i;
+
+   for(i = 0; i < 3; i++)
+   {
+      v[i][0] = Vectors(i, 0);
+      v[i][1] = Vectors(i, 1);
+      v[i][2] = Vectors(i, 2);
    }
+}
 
-   SET_IR(1, Lm_B(0, MAC(1), lm));
-   SET_IR(2, Lm_B(1, MAC(2), lm));
-   //printf("FTV: %08x %08x\n", CR[cv*CRV_NEXT+CRV_T+2], (uint32)(tmp[2] >> 12));
-   SET_IR(3, Lm_B_PTZ(2, MAC(3), tmp[2] >> 12, lm));
+/* The light and colour stages of NCT, NCCT and NCDT for V0-V2 at once,
+ * i.e. what three rounds of
+ *
+ *    MultiplyMatrixByVector(Matrices_Light, v, CRVectors_Null, sf, lm);
+ *    MultiplyMatrixByVector(Matrices_Color, VEC3IR, CRVectors_B, sf, lm);
+ *
+ * compute, left in acc[v] for the caller to store vertex by vertex.
+ * The colour stage overwrites the light stage's MAC1-3 and IR1-3
+ * before anything can read them, so of the light stage only the
+ * saturated IR is kept, as the colour stage's input. */
+static INLINE void NormColorTriple(uint32_t sf, int lm, int64_t acc[3][3])
+{
+   int16_t m[3][3];
+   int16_t vec[3][3];
+   int16_t ir[3][3];
+   int32_t t[3];
+   int64_t light[3][3];
+   unsigned v, i;
+
+   LoadMatrix(Matrices_Light, m);
+   LoadTranslation(CRVectors_Null, t);
+   LoadVectors(vec);
+   FLAGS |= GTE_MulMat3x3(m, t, vec, light);
+
+   for(v = 0; v < 3; v++)
+      for(i = 0; i < 3; i++)
+         ir[v][i] = i32_to_i16_saturate(i, (int32_t)(light[v][i] >> sf), lm);
+
+   LoadMatrix(Matrices_Color, m);
+   LoadTranslation(CRVectors_B, t);
+   FLAGS |= GTE_MulMat3x3(m, t, ir, acc);
+}
 
-   SET_Z_FIFO(0, Z_FIFO(1));
-   SET_Z_FIFO(1, Z_FIFO(2));
-   SET_Z_FIFO(2, Z_FIFO(3));
-   SET_Z_FIFO(3, Lm_D(tmp[2] >> 12, true));
+/* MAC1-3 and IR1-3 from one vertex's accumulators, as the end of
+ * MultiplyMatrixByVector leaves them. */
+static INLINE void StoreMV(const int64_t tmp[3], uint32_t sf, int lm)
+{
+   SET_MAC(1, tmp[0] >> sf);
+   SET_MAC(2, tmp[1] >> sf);
+   SET_MAC(3, tmp[2] >> sf);
 
-   *precise_z_acc = tmp[2];
+   MAC_to_IR(lm);
 }
 
 #define DECODE_FIELDS							\
@@ -1518,19 +1608,38 @@ static int32_t RTPS(uint32_t instr)
 static int32_t RTPT(uint32_t instr)
 {
  int i;
+ int64_t acc[3][3];
  DECODE_FIELDS;
 
+ /* The three rotations at once (gte_triple.h); the rest per vertex,
+  * in order, as RTPS does it. */
+#ifndef GTE_TRIPLE_REFERENCE
+ {
+  int16_t m[3][3];
+  int16_t vec[3][3];
+  int32_t t[3];
+
+  LoadMatrix(Matrices_Rot, m);
+  LoadTranslation(CRVectors_T, t);
+  LoadVectors(vec);
+  FLAGS |= GTE_MulMat3x3(m, t, vec, acc);
+ }
+#endif
+
  for(i = 0; i < 3; i++)
  {
   int64_t h_div_sz;
-  int64_t precise_z_acc;
   float precise_z;
   float precise_h_div_sz;
 
-  MultiplyMatrixByVector_PT(Matrices_Rot, i, CRVectors_T, sf, lm, &precise_z_acc);
+#ifdef GTE_TRIPLE_REFERENCE
+  MultiplyMatrixByVector_PT(Matrices_Rot, i, CRVectors_T, sf, lm, &acc[i][2]);
+#else
+  StorePT(acc[i], sf, lm);
+#endif
   h_div_sz = Divide(H, Z_FIFO(3));
 
-  precise_z = pgxp_precise_z(precise_z_acc);
+  precise_z = pgxp_precise_z(acc[i][2]);
   precise_h_div_sz  = pgxp_precise_h_div_sz(precise_z);
 
   TransformXY(h_div_sz, precise_h_div_sz, precise_z);
@@ -1566,19 +1675,29 @@ static int32_t NCT(uint32_t instr)
    const uint32_t sf = (instr & (1 << 19)) ? 12 : 0;
    const int      lm = (instr >> 10) & 1;
 
-   NormColor(sf, lm, 0);
-   NormColor(sf, lm, 1);
-   NormColor(sf, lm, 2);
+   int64_t        acc[3][3];
+   unsigned       v;
+
+#ifdef GTE_TRIPLE_REFERENCE
+   for(v = 0; v < 3; v++)
+      NormColor(sf, lm, v);
+#else
+   NormColorTriple(sf, lm, acc);
+
+   for(v = 0; v < 3; v++)
+   {
+      StoreMV(acc[v], sf, lm);
+      MAC_to_RGB_FIFO();
+   }
+#endif
 
    return(30);
 }
 
-/* NCC - Normal Color Color */
-static INLINE void NCC(uint32_t vector_index, uint32_t sf, int lm)
+/* The colour-register stage of NCC, after the light and colour
+ * products. */
+static INLINE void NCC_Color(uint32_t sf, int lm)
 {
-   MultiplyMatrixByVector(Matrices_Light, vector_index, CRVectors_Null, sf, lm);
-   MultiplyMatrixByVector(Matrices_Color, VEC3IR, CRVectors_B, sf, lm);
-
    SET_MAC(1, ((RGB_R << 4) * IR1) >> sf);
    SET_MAC(2, ((RGB_G << 4) * IR2) >> sf);
    SET_MAC(3, ((RGB_B << 4) * IR3) >> sf);
@@ -1587,6 +1706,15 @@ static INLINE void NCC(uint32_t vector_index, uint32_t sf, int lm)
    MAC_to_RGB_FIFO();
 }
 
+/* NCC - Normal Color Color */
+static INLINE void NCC(uint32_t vector_index, uint32_t sf, int lm)
+{
+   MultiplyMatrixByVector(Matrices_Light, vector_index, CRVectors_Null, sf, lm);
+   MultiplyMatrixByVector(Matrices_Color, VEC3IR, CRVectors_B, sf, lm);
+
+   NCC_Color(sf, lm);
+}
+
 static int32_t NCCS(uint32_t instr)
 {
    const uint32_t sf = (instr & (1 << 19)) ? 12 : 0;
@@ -1602,9 +1730,21 @@ static int32_t NCCT(uint32_t instr)
    const uint32_t sf = (instr & (1 << 19)) ? 12 : 0;
    const int      lm = (instr >> 10) & 1;
 
-   NCC(0, sf, lm);
-   NCC(1, sf, lm);
-   NCC(2, sf, lm);
+   int64_t        acc[3][3];
+   unsigned       v;
+
+#ifdef GTE_TRIPLE_REFERENCE
+   for(v = 0; v < 3; v++)
+      NCC(v, sf, lm);
+#else
+   NormColorTriple(sf, lm, acc);
+
+   for(v = 0; v < 3; v++)
+   {
+      StoreMV(acc[v], sf, lm);
+      NCC_Color(sf, lm);
+   }
+#endif
 
    return(39);
 }
@@ -1860,9 +2000,23 @@ static int32_t NCDS(uint32_t instr)
 /* NDCT - Normal Color Depth Cue Triple */
 static int32_t NCDT(uint32_t instr)
 {
-   NormColorDepthCue(instr, 0);
-   NormColorDepthCue(instr, 1);
-   NormColorDepthCue(instr, 2);
+   const uint32_t sf = (instr & (1 << 19)) ? 12 : 0;
+   const int      lm = (instr >> 10) & 1;
+   int64_t        acc[3][3];
+   unsigned       v;
+
+#ifdef GTE_TRIPLE_REFERENCE
+   for(v = 0; v < 3; v++)
+      NormColorDepthCue(instr, v);
+#else
+   NormColorTriple(sf, lm, acc);
+
+   for(v = 0; v < 3; v++)
+   {
+      StoreMV(acc[v], sf, lm);
+      DCPL(instr);
+   }
+#endif
 
    return(44);
 }
@@ -0,0 +1,197 @@
+#ifndef __MDFN_PSX_GTE_TRIPLE_H
+#define __MDFN_PSX_GTE_TRIPLE_H
+
+/* GTE matrix-by-vector product for three vectors at once.
+ *
+ * RTPT, NCT, NCCT and NCDT each repeat the same matrix products for
+ * V0, V1 and V2.  The three products share no state: each reads only
+ * its own vector, the matrix and the translation, and the FLAGS bits
+ * they raise are sticky, so ORing them in vertex order or all at once
+ * gives the same register.  GTE_MulMat3x3 therefore runs the three
+ * vertices in parallel lanes; everything after it - saturation into
+ * IR, the FIFOs, the divide, the PGXP pushes - still runs per vertex,
+ * in order, in gte.c.
+ *
+ * Each of the three accumulation steps per row is checked and wrapped
+ * exactly as A_MV in gte.c does it: a 44-bit signed accumulator, bit
+ * (30 - row) on a result >= 2^43, bit (27 - row) on one < -2^43, and
+ * the stored value sign-extended from bit 43.  The check cannot be
+ * deferred to the end of a row: T << 12 close to the limit plus one
+ * product can overflow where the full sum would not.
+ *
+ * In the vector paths the check costs no compares.  Every step adds a
+ * product of at most 2^30 in magnitude to a value already inside
+ * [-2^43, 2^43), so after biasing by 3 * 2^43 the top bits (>> 44) are
+ * 0 for an underflow, 1 in range and 2 for an overflow.  ORing each
+ * with itself shifted down by one leaves bit 0 clear for an underflow
+ * only, so ANDing that across steps and lanes catches any 0; ORing the
+ * plain values catches any 2.  Masking the biased value to 44 bits and
+ * subtracting 2^43 is the sign extension.  Products are formed as
+ * 32-bit lanes (pmaddwd against a zero high half on SSE2, vmull on
+ * NEON) and widened into 64-bit accumulators, two lanes per register;
+ * the fourth lane multiplies by zero and only ever holds T << 12.
+ *
+ * Defining GTE_TRIPLE_SCALAR before including this header compiles the
+ * scalar loop only, which is what targets without SSE2 or NEON run.
+ * Building gte.c with GTE_TRIPLE_REFERENCE instead takes this header
+ * out of the triple ops altogether: they go back to running V0, V1 and
+ * V2 one after another through the single-vector paths, which is the
+ * historical code and the reference tools/gte compares both kernels
+ * against.  Instruction sets are picked at compile time, as for the
+ * other kernels: SSE2 on x86, else NEON on ARM. */
+
+#include <stdint.h>
+#include <boolean.h>
+
+#include "../mednafen-types.h"
+
+#if !defined(GTE_TRIPLE_SCALAR)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GTE_TRIPLE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GTE_TRIPLE_NEON 1
+#endif
+#endif
+
+/* acc[l][r] = row r of m times v[l], plus t[r] << 12, accumulated one
+ * column at a time through the 44-bit check and wrap.  Returns the
+ * FLAGS bits those checks raised, for all three vectors together. */
+static INLINE uint32_t GTE_MulMat3x3(const int16_t m[3][3], const int32_t t[3],
+      const int16_t v[3][3], int64_t acc[3][3])
+{
+   uint32_t flags = 0;
+   unsigned r;
+
+#if defined(GTE_TRIPLE_SSE2)
+   const __m128i bias   = _mm_set1_epi64x(INT64_C(3) << 43);
+   const __m128i mask44 = _mm_set1_epi64x((INT64_C(1) << 44) - 1);
+   const __m128i half   = _mm_set1_epi64x(INT64_C(1) << 43);
+   /* Column k of the three vectors, one per 32-bit lane, with the
+    * high half zero so pmaddwd yields a single signed product. */
+   const __m128i col[3] =
+   {
+      _mm_setr_epi32((uint16_t)v[0][0], (uint16_t)v[1][0], (uint16_t)v[2][0], 0),
+      _mm_setr_epi32((uint16_t)v[0][1], (uint16_t)v[1][1], (uint16_t)v[2][1], 0),
+      _mm_setr_epi32((uint16_t)v[0][2], (uint16_t)v[1][2], (uint16_t)v[2][2], 0),
+   };
+
+   for (r = 0; r < 3; r++)
+   {
+      __m128i  a01  = _mm_set1_epi64x((int64_t)((uint64_t)(int64_t)t[r] << 12));
+      __m128i  a2x  = a01;
+      __m128i  lo   = _mm_set1_epi32(-1);
+      __m128i  hi   = _mm_setzero_si128();
+      int64_t  out[4];
+      unsigned k;
+
+      for (k = 0; k < 3; k++)
+      {
+         const __m128i p = _mm_madd_epi16(_mm_set1_epi32((uint16_t)m[r][k]), col[k]);
+         const __m128i s = _mm_srai_epi32(p, 31);
+         __m128i u01, u2x, top;
+
+         u01 = _mm_add_epi64(_mm_add_epi64(a01, _mm_unpacklo_epi32(p, s)), bias);
+         u2x = _mm_add_epi64(_mm_add_epi64(a2x, _mm_unpackhi_epi32(p, s)), bias);
+         top = _mm_or_si128(_mm_srli_epi64(u01, 44), _mm_slli_epi64(_mm_srli_epi64(u2x, 44), 32));
+         lo  = _mm_and_si128(lo, _mm_or_si128(top, _mm_srli_epi32(top, 1)));
+         hi  = _mm_or_si128(hi, top);
+         a01 = _mm_sub_epi64(_mm_and_si128(u01, mask44), half);
+         a2x = _mm_sub_epi64(_mm_and_si128(u2x, mask44), half);
+      }
+
+      /* `top` packs lane 0/1 in the low dwords and lane 2/pad in the
+       * high dwords of each qword; fold all four. */
+      lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+      lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+      hi = _mm_or_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+      hi = _mm_or_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+      if (!(_mm_cvtsi128_si32(lo) & 1))
+         flags |= 1 << (27 - r);
+      if (_mm_cvtsi128_si32(hi) & 2)
+         flags |= 1 << (30 - r);
+
+      _mm_storeu_si128((__m128i*)&out[0], a01);
+      _mm_storeu_si128((__m128i*)&out[2], a2x);
+      acc[0][r] = out[0];
+      acc[1][r] = out[1];
+      acc[2][r] = out[2];
+   }
+#elif defined(GTE_TRIPLE_NEON)
+   const uint64x2_t bias   = vdupq_n_u64(UINT64_C(3) << 43);
+   const uint64x2_t mask44 = vdupq_n_u64((UINT64_C(1) << 44) - 1);
+   const int64x2_t  half   = vdupq_n_s64(INT64_C(1) << 43);
+   int16x4_t        col[3];
+   unsigned         k;
+
+   for (k = 0; k < 3; k++)
+   {
+      const int16_t c[4] = { v[0][k], v[1][k], v[2][k], 0 };
+      col[k] = vld1_s16(c);
+   }
+
+   for (r = 0; r < 3; r++)
+   {
+      int64x2_t  a01 = vdupq_n_s64((int64_t)((uint64_t)(int64_t)t[r] << 12));
+      int64x2_t  a2x = a01;
+      uint64x2_t lo  = vdupq_n_u64(~UINT64_C(0));
+      uint64x2_t hi  = vdupq_n_u64(0);
+
+      for (k = 0; k < 3; k++)
+      {
+         const int32x4_t p   = vmull_n_s16(col[k], m[r][k]);
+         const uint64x2_t u01 = vaddq_u64(vreinterpretq_u64_s64(
+                  vaddw_s32(a01, vget_low_s32(p))), bias);
+         const uint64x2_t u2x = vaddq_u64(vreinterpretq_u64_s64(
+                  vaddw_s32(a2x, vget_high_s32(p))), bias);
+         const uint64x2_t t01 = vshrq_n_u64(u01, 44);
+         const uint64x2_t t2x = vshrq_n_u64(u2x, 44);
+
+         lo  = vandq_u64(lo, vandq_u64(vorrq_u64(t01, vshrq_n_u64(t01, 1)),
+                  vorrq_u64(t2x, vshrq_n_u64(t2x, 1))));
+         hi  = vorrq_u64(hi, vorrq_u64(t01, t2x));
+         a01 = vsubq_s64(vreinterpretq_s64_u64(vandq_u64(u01, mask44)), half);
+         a2x = vsubq_s64(vreinterpretq_s64_u64(vandq_u64(u2x, mask44)), half);
+      }
+
+      if (!((vgetq_lane_u64(lo, 0) & vgetq_lane_u64(lo, 1)) & 1))
+         flags |= 1 << (27 - r);
+      if ((vgetq_lane_u64(hi, 0) | vgetq_lane_u64(hi, 1)) & 2)
+         flags |= 1 << (30 - r);
+
+      acc[0][r] = vgetq_lane_s64(a01, 0);
+      acc[1][r] = vgetq_lane_s64(a01, 1);
+      acc[2][r] = vgetq_lane_s64(a2x, 0);
+   }
+#else
+   unsigned l;
+
+   for (l = 0; l < 3; l++)
+   {
+      for (r = 0; r < 3; r++)
+      {
+         int64_t  tmp = (int64_t)((uint64_t)(int64_t)t[r] << 12);
+         unsigned k;
+
+         for (k = 0; k < 3; k++)
+         {
+            tmp += (int32_t)m[r][k] * v[l][k];
+
+            if (tmp >= (INT64_C(1) << 43))
+               flags |= 1 << (30 - r);
+            if (tmp < -(INT64_C(1) << 43))
+               flags |= 1 << (27 - r);
+
+            tmp = (int64_t)((uint64_t)tmp << 20) >> 20;
+         }
+
+         acc[l][r] = tmp;
+      }
+   }
+#endif
+
+   return flags;
+}
+
+#endif
@@ -67,6 +67,7 @@
 
 #include "mdec.h"
 #include "FastFIFO.h"
+#include "../../frame_profile.h"
 
 #if defined(__SSE2__)
 #include <xmmintrin.h>
@@ -750,7 +751,7 @@ static INLINE void WriteImageData(uint16_t V, int32_t* eat_cycles)
    }
 }
 
-void MDEC_Run(int32_t clocks)
+static void MDEC_RunInner(int32_t clocks)
 {
    static const unsigned MDRPhaseBias = 0 + 1;
 
@@ -881,6 +882,15 @@ void MDEC_Run(int32_t clocks)
    }
 }
 
+/* The decoder coroutine above returns from a dozen places; profile it
+ * from one. */
+void MDEC_Run(int32_t clocks)
+{
+   PROF_PUSH(PROF_MDEC);
+   MDEC_RunInner(clocks);
+   PROF_POP();
+}
+
 void MDEC_DMAWrite(uint32_t V)
 {
    if(!FastFIFO_CanWrite(&InFIFO))
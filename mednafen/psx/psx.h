@@ -74,7 +74,7 @@ extern unsigned psx_gpu_overclock_shift;
 struct FrontIO;
 extern struct FrontIO *PSX_FIO;
 
-void FrontIO_GPULineHook(struct FrontIO *fio,
+bool FrontIO_GPULineHook(struct FrontIO *fio,
                          const int32_t  timestamp,
                          const int32_t  line_timestamp,
                          bool           vsync,
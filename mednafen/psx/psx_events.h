@@ -29,6 +29,7 @@ enum
 
 void PSX_SetEventNT(const int type, const int32_t next_timestamp);
 void PSX_SetDMACycleSteal(unsigned stealage);
+unsigned PSX_GetDMACycleSteal(void);
 
 uint32_t PSX_GetRandU32(uint32_t mina, uint32_t maxa);
 
@@ -88,6 +88,8 @@
 
 #include <libretro.h>
 
+#include "../masmem.h"
+
 #include "irq.h"
 #include "cdc.h"
 #include "spu.h"
@@ -1640,6 +1642,50 @@ static INLINE void SPU_RunNoise(void)
    return(ret);
 }
 
+/* Block forms of the two above. The IRQ address compare is the only
+ * per-halfword side effect, and it is a no-op unless the SPU IRQ is
+ * enabled; nothing a DMA word does can enable it, so with it off the
+ * transfer is a plain copy into / out of SPU RAM. */
+void SPU_WriteDMABlock(const uint8_t *ram, uint32_t count)
+{
+   if (SPUControl & 0x40)
+   {
+      for (; count; count--, ram += 4)
+         SPU_WriteDMA(LoadU32_LE((const uint32_t*)ram));
+      return;
+   }
+
+   for (; count; count--, ram += 4)
+   {
+      uint32_t V = LoadU32_LE((const uint32_t*)ram);
+
+      SPURAM[RWAddr] = V;
+      RWAddr         = (RWAddr + 1) & 0x3FFFF;
+      SPURAM[RWAddr] = V >> 16;
+      RWAddr         = (RWAddr + 1) & 0x3FFFF;
+   }
+}
+
+void SPU_ReadDMABlock(uint8_t *ram, uint32_t count)
+{
+   if (SPUControl & 0x40)
+   {
+      for (; count; count--, ram += 4)
+         StoreU32_LE((uint32_t*)ram, SPU_ReadDMA());
+      return;
+   }
+
+   for (; count; count--, ram += 4)
+   {
+      uint32_t V = SPURAM[RWAddr];
+
+      RWAddr     = (RWAddr + 1) & 0x3FFFF;
+      V         |= (uint32_t)SPURAM[RWAddr] << 16;
+      RWAddr     = (RWAddr + 1) & 0x3FFFF;
+      StoreU32_LE((uint32_t*)ram, V);
+   }
+}
+
 /*
  * External API for the SPU module. The public functions
  * (SPU_Power / SPU_Write / SPU_Read / etc.) are defined directly
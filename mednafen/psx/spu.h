@@ -98,6 +98,10 @@ uint16_t SPU_Read(int32_t timestamp, uint32_t A);
 
 void     SPU_WriteDMA(uint32_t V);
 uint32_t SPU_ReadDMA(void);
+/* `count` consecutive SPU_WriteDMA / SPU_ReadDMA words, from / to
+ * little-endian main RAM at `ram`. */
+void     SPU_WriteDMABlock(const uint8_t *ram, uint32_t count);
+void     SPU_ReadDMABlock(uint8_t *ram, uint32_t count);
 
 int32_t  SPU_UpdateFromCDC(int32_t clocks);
 
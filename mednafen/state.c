@@ -584,10 +584,67 @@ static int WriteStateChunk(StateMem *st, const char *sname, SFORMAT *sf)
    return(end_pos - data_start_pos);
 }
 
-static SFORMAT *FindSF(const char *name, SFORMAT *sf)
+/* Compiled section layouts.
+ *
+ * Loading used to resolve every recorded field with a FindSF walk of
+ * the section's SFORMAT list - strcmp per entry, recursing through
+ * links - which is quadratic per section and showed up on the CDC,
+ * GPU and FrontIO sections with hundreds of entries each.
+ *
+ * Instead, each section's SFORMAT tree is flattened once into a plain
+ * array (links expanded, unsaved entries dropped, in exactly the order
+ * SubWrite emits them) with an open-addressed name-hash index beside
+ * it. ReadStateChunk then keeps a cursor into the array: a state saved
+ * by the same build has its records in that order, so each one is
+ * matched by a single strcmp against the field under the cursor, and
+ * the hash index is only consulted when the layouts differ.
+ *
+ * Most StateRegs arrays are rebuilt on the stack per call, and the
+ * FrontIO devices reuse one function (hence one stack address) for
+ * several ports, so a layout is keyed by SFORMAT pointer plus section
+ * name and revalidated on every use: the tree is flattened again into
+ * scratch and compared against the cached copy. That walk is linear
+ * and does no string work; only a mismatch pays for re-hashing. */
+#define SF_LAYOUT_CACHE 64
+
+struct sf_layout
+{
+   SFORMAT *root;
+   char name[32];
+   SFORMAT *fields;        /* Flattened copy of the tree.        */
+   uint32_t count;
+   uint32_t cap;
+   uint32_t *hashes;       /* Name hash per field.               */
+   uint32_t *name_lens;    /* strlen of each name, ~0 if none.   */
+   uint32_t *stamps;       /* Chunk epoch that last loaded it.   */
+   int32_t *slots;         /* Field index per hash slot, or -1.  */
+   uint32_t slot_mask;
+   uint32_t epoch;
+};
+
+static struct sf_layout sf_layouts[SF_LAYOUT_CACHE];
+static unsigned sf_layout_victim;
+
+static SFORMAT *sf_scratch;
+static uint32_t sf_scratch_count;
+static uint32_t sf_scratch_cap;
+
+static uint32_t sf_hash(const char *name)
+{
+   uint32_t h = 2166136261u;  /* FNV-1a */
+
+   while (*name)
+   {
+      h ^= (uint8_t)*name++;
+      h *= 16777619u;
+   }
+   return h;
+}
+
+static bool sf_flatten(SFORMAT *sf)
 {
    /* Size can sometimes be zero, so also check for the text name.  These two should both be zero only at the end of a struct. */
-   while(sf->size || sf->name) 
+   while(sf->size || sf->name)
    {
       if(!sf->size || !sf->v)
       {
@@ -597,31 +654,193 @@ static SFORMAT *FindSF(const char *name, SFORMAT *sf)
 
       if (sf->size == (uint32_t)~0) /* Link to another SFORMAT structure. */
       {
-         SFORMAT *temp_sf = FindSF(name, (SFORMAT*)sf->v);
-         if (temp_sf)
-            return temp_sf;
+         if (!sf_flatten((SFORMAT*)sf->v))
+            return false;
       }
       else
       {
-         /* for fast savestates, we no longer have the 
-          * text label in the state, and need to assume 
-          * that it is the correct one. */
-         if (FastSaveStates)
-            return sf;
-         assert(sf->name);
-         if (!strcmp(sf->name, name))
-            return sf;
+         if (sf_scratch_count == sf_scratch_cap)
+         {
+            uint32_t new_cap  = sf_scratch_cap ? sf_scratch_cap * 2 : 256;
+            SFORMAT *new_data = (SFORMAT*)realloc(sf_scratch,
+                  new_cap * sizeof(SFORMAT));
+            if (!new_data)
+               return false;
+            sf_scratch     = new_data;
+            sf_scratch_cap = new_cap;
+         }
+         sf_scratch[sf_scratch_count++] = *sf;
       }
 
       sf++;
    }
 
-   return NULL;
+   return true;
 }
 
-static int ReadStateChunk(StateMem *st, SFORMAT *sf, int size)
+static void sf_layout_free(struct sf_layout *l)
+{
+   free(l->fields);
+   free(l->hashes);
+   free(l->name_lens);
+   free(l->stamps);
+   free(l->slots);
+   memset(l, 0, sizeof(*l));
+}
+
+/* (Re)build the hash index over l->fields. Equal names are inserted
+ * in field order, so a probe meets them in that order too. */
+static bool sf_layout_index(struct sf_layout *l)
+{
+   uint32_t i;
+   uint32_t nslots = 16;
+   uint32_t *hashes, *name_lens, *stamps;
+   int32_t  *slots;
+
+   while (nslots < l->count * 2)
+      nslots *= 2;
+
+   hashes    = (uint32_t*)malloc((l->count ? l->count : 1) * sizeof(uint32_t));
+   name_lens = (uint32_t*)malloc((l->count ? l->count : 1) * sizeof(uint32_t));
+   stamps    = (uint32_t*)calloc(l->count ? l->count : 1, sizeof(uint32_t));
+   slots     = (int32_t*)malloc(nslots * sizeof(int32_t));
+   if (!hashes || !name_lens || !stamps || !slots)
+   {
+      free(hashes);
+      free(name_lens);
+      free(stamps);
+      free(slots);
+      return false;
+   }
+
+   free(l->hashes);
+   free(l->name_lens);
+   free(l->stamps);
+   free(l->slots);
+   l->hashes    = hashes;
+   l->name_lens = name_lens;
+   l->stamps    = stamps;
+   l->slots     = slots;
+   l->slot_mask = nslots - 1;
+   l->epoch     = 0;
+
+   memset(slots, 0xFF, nslots * sizeof(int32_t));
+   for (i = 0; i < l->count; i++)
+   {
+      uint32_t h = sf_hash(l->fields[i].name ? l->fields[i].name : "");
+      uint32_t s = h & l->slot_mask;
+
+      while (slots[s] >= 0)
+         s = (s + 1) & l->slot_mask;
+      slots[s]     = (int32_t)i;
+      hashes[i]    = h;
+      name_lens[i] = l->fields[i].name
+         ? (uint32_t)strlen(l->fields[i].name) : (uint32_t)~0;
+   }
+
+   return true;
+}
+
+static struct sf_layout *sf_layout_get(SFORMAT *sf, const char *name)
+{
+   struct sf_layout *l = NULL;
+   SFORMAT *swap;
+   uint32_t swap_cap;
+   unsigned i;
+
+   sf_scratch_count = 0;
+   if (!sf_flatten(sf))
+      return NULL;
+
+   for (i = 0; i < SF_LAYOUT_CACHE; i++)
+   {
+      if (sf_layouts[i].root == sf && !strncmp(sf_layouts[i].name, name, 32))
+      {
+         l = &sf_layouts[i];
+         if (l->count == sf_scratch_count
+               && !memcmp(l->fields, sf_scratch, l->count * sizeof(SFORMAT)))
+            return l;
+         break;
+      }
+   }
+
+   if (!l)
+   {
+      for (i = 0; i < SF_LAYOUT_CACHE; i++)
+         if (!sf_layouts[i].root)
+            break;
+      if (i == SF_LAYOUT_CACHE)
+      {
+         i = sf_layout_victim;
+         sf_layout_victim = (sf_layout_victim + 1) % SF_LAYOUT_CACHE;
+      }
+      l = &sf_layouts[i];
+      sf_layout_free(l);
+      l->root = sf;
+      strncpy(l->name, name, sizeof(l->name));
+   }
+
+   /* The scratch array becomes the layout; the layout's old array is
+    * kept as scratch for the next flatten. */
+   swap             = l->fields;
+   swap_cap         = l->cap;
+   l->fields        = sf_scratch;
+   l->cap           = sf_scratch_cap;
+   l->count         = sf_scratch_count;
+   sf_scratch       = swap;
+   sf_scratch_cap   = swap_cap;
+   sf_scratch_count = 0;
+
+   if (!sf_layout_index(l))
+   {
+      sf_layout_free(l);
+      return NULL;
+   }
+
+   return l;
+}
+
+/* Field for the record `name`, or -1. The first not-yet-loaded field
+ * of that name wins, so repeated names take their records in order. */
+static int32_t sf_layout_find(struct sf_layout *l, const char *name)
+{
+   uint32_t h = sf_hash(name);
+   uint32_t s;
+   int32_t first = -1;
+
+   for (s = h & l->slot_mask; l->slots[s] >= 0; s = (s + 1) & l->slot_mask)
+   {
+      int32_t i = l->slots[s];
+
+      if (l->hashes[i] != h || l->name_lens[i] == (uint32_t)~0
+            || strcmp(l->fields[i].name, name))
+         continue;
+      if (l->stamps[i] != l->epoch)
+         return i;
+      if (first < 0)
+         first = i;
+   }
+
+   return first;
+}
+
+void MDFNSS_FreeLayouts(void)
+{
+   unsigned i;
+
+   for (i = 0; i < SF_LAYOUT_CACHE; i++)
+      sf_layout_free(&sf_layouts[i]);
+   free(sf_scratch);
+   sf_scratch         = NULL;
+   sf_scratch_count   = 0;
+   sf_scratch_cap     = 0;
+   sf_layout_victim   = 0;
+}
+
+static int ReadStateChunk(StateMem *st, struct sf_layout *l, int size)
 {
    int temp = st->loc;
+   uint32_t cursor = 0;
 
    uint32_t recorded_size;  /* In bytes */
    uint8_t toa[1 + 256];    /* Don't change to char unless 
@@ -630,19 +849,49 @@ static int ReadStateChunk(StateMem *st, SFORMAT *sf, int size)
    toa[0] = 0;
    toa[1] = 0;
 
+   /* New epoch: no field has been loaded by this chunk yet. On wrap,
+    * clear the stamps rather than let a stale one alias. */
+   if (++l->epoch == 0)
+   {
+      memset(l->stamps, 0, l->count * sizeof(uint32_t));
+      l->epoch = 1;
+   }
+
    while (st->loc < (uint32_t)(temp + size))
    {
+      int32_t idx  = -1;
+      SFORMAT *tmp = NULL;
+
       /* exclude text labels from fast savestates */
       if (!FastSaveStates)
       {
          if (smem_read(st, toa, 1) != 1)
             return(0);
 
-         if (smem_read(st, toa + 1, toa[0]) != toa[0])
-            return 0;
+         /* Common case: the record belongs to the field under the
+          * cursor. Check the label in place in the stream and step
+          * over it, without copying it out or hashing it. */
+         if (cursor < l->count && l->stamps[cursor] != l->epoch
+               && l->name_lens[cursor] == toa[0]
+               && toa[0] <= st->len - st->loc
+               && !memcmp(st->data + st->loc, l->fields[cursor].name, toa[0]))
+         {
+            idx      = (int32_t)cursor;
+            st->loc += toa[0];
+         }
+         else
+         {
+            if (smem_read(st, toa + 1, toa[0]) != toa[0])
+               return 0;
 
-         toa[1 + toa[0]] = 0;
+            toa[1 + toa[0]] = 0;
+            idx = sf_layout_find(l, (char*)toa + 1);
+         }
       }
+      /* Fast savestates carry no labels; their records are in
+       * SubWrite order by construction, so take the next field. */
+      else if (cursor < l->count)
+         idx = (int32_t)cursor;
 
       /* Defensive: if we couldn't read the recorded-size word, the
        * stream is truncated - bail rather than dispatching on an
@@ -651,12 +900,12 @@ static int ReadStateChunk(StateMem *st, SFORMAT *sf, int size)
       if (smem_read32le(st, &recorded_size) != 4)
          return 0;
 
-      SFORMAT *tmp = FindSF((char*)toa + 1, sf);
-      /* Fix for unnecessary name checks, when we find 
-       * it in the first slot, don't recheck that slot again.
-       * Also necessary for fast savestates to work. */
-      if (tmp == sf)
-         sf++;
+      if (idx >= 0)
+      {
+         tmp       = &l->fields[idx];
+         cursor    = (uint32_t)idx + 1;
+         l->stamps[idx] = l->epoch;
+      }
 
       if(tmp)
       {
@@ -781,7 +1030,8 @@ static int MDFNSS_StateAction_internal(void *st_p, int load, int data_only, stru
          /* Yay, we found the section */
          if(!strncmp(sname, section->name, 32))
          {
-            if(!ReadStateChunk(st, section->sf, tmp_size))
+            struct sf_layout *l = sf_layout_get(section->sf, section->name);
+            if(!l || !ReadStateChunk(st, l, tmp_size))
                return(0);
             found = 1;
             break;
@@ -55,6 +55,9 @@ int MDFNSS_LoadSM(void *st, int a, int b);
 int MDFNSS_StateAction(void *st, int load, int data_only,
       SFORMAT *sf, const char *name);
 
+/* Release the compiled section layouts MDFNSS_LoadSM caches. */
+void MDFNSS_FreeLayouts(void);
+
 #ifdef __cplusplus
 }
 #endif
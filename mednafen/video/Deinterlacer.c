@@ -25,6 +25,10 @@
 #include "Deinterlacer.h"
 #include "../../beetle_psx_globals.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 /*
  * Layout the deinterlacer assumes:
  *
@@ -47,6 +51,283 @@
  *     LineWidths[0]; we no longer touch it here at all.
  */
 
+/* ====================================================================
+ * Row-parallel worker pool
+ *
+ * FastMAD and BOB_OFFSET produce every output row block from input
+ * rows no other row block writes, so a frame's rows can be handed out
+ * in chunks to a few threads.  The pool is fork-join: the thread that
+ * calls deint_run_rows() publishes a row range, takes chunks itself
+ * alongside the helpers, and returns once every chunk has finished.
+ * Each participant has a fixed slot (0 for the caller, 1.. for the
+ * helpers) that indexes its private FastMAD scratch row.
+ *
+ * The same struct owns the FastMAD pipeline thread, which runs one
+ * prepared frame at a time (deint_job_main) and itself calls
+ * deint_run_rows() as the fork-join caller.  Only one thread ever
+ * runs a batch at a time: the emulation thread waits for the
+ * pipelined job at the top of every Process() before doing any row
+ * work of its own.
+ *
+ * Helpers are created on the first batch that can use them.  If
+ * rthreads cannot create them the pool stays empty and everything
+ * runs inline, as it does in builds without HAVE_THREADS.
+ * ==================================================================== */
+
+#define DEINT_MAX_THREADS  4     /* caller + up to 3 helpers */
+#define DEINT_MIN_CHUNK    16    /* native rows per chunk, at least */
+
+typedef void (*deint_rows_fn)(void *ctx, int begin, int end, unsigned slot);
+
+#ifdef HAVE_THREADS
+struct deint_helper
+{
+   struct deint_workers *w;
+   unsigned              slot;
+};
+
+struct deint_workers
+{
+   slock_t            *lock;
+   scond_t            *wake;   /* helpers: rows published; job thread: job kicked */
+   scond_t            *idle;   /* caller: batch drained; producer: job done      */
+   bool                quit;
+
+   sthread_t          *helpers[DEINT_MAX_THREADS - 1];
+   struct deint_helper helper_args[DEINT_MAX_THREADS - 1];
+   unsigned            helper_count;
+
+   /* Current batch.  fn is NULL between batches. */
+   deint_rows_fn       fn;
+   void               *ctx;
+   int                 next;
+   int                 end;
+   int                 chunk;
+   unsigned            busy;   /* chunks handed out and not yet finished */
+
+   /* FastMAD pipeline thread. */
+   Deinterlacer       *owner;
+   sthread_t          *job_thread;
+   bool                job_queued;
+   bool                job_busy;
+};
+
+static bool deint_grab_rows(struct deint_workers *w, int *begin, int *end)
+{
+   if (!w->fn || w->next >= w->end)
+      return false;
+   *begin   = w->next;
+   *end     = (w->end - w->next > w->chunk) ? w->next + w->chunk : w->end;
+   w->next  = *end;
+   w->busy++;
+   return true;
+}
+
+static void deint_helper_main(void *arg)
+{
+   struct deint_helper  *h = (struct deint_helper*)arg;
+   struct deint_workers *w = h->w;
+   int begin, end;
+
+   slock_lock(w->lock);
+   while (!w->quit)
+   {
+      if (deint_grab_rows(w, &begin, &end))
+      {
+         deint_rows_fn fn  = w->fn;
+         void         *ctx = w->ctx;
+         slock_unlock(w->lock);
+         fn(ctx, begin, end, h->slot);
+         slock_lock(w->lock);
+         if (--w->busy == 0)
+            scond_broadcast(w->idle);
+         continue;
+      }
+      scond_wait(w->wake, w->lock);
+   }
+   slock_unlock(w->lock);
+}
+
+static void deint_job_run(Deinterlacer *d);
+
+static void deint_job_main(void *arg)
+{
+   struct deint_workers *w = (struct deint_workers*)arg;
+
+   slock_lock(w->lock);
+   while (!w->quit)
+   {
+      if (w->job_queued)
+      {
+         w->job_queued = false;
+         slock_unlock(w->lock);
+         deint_job_run(w->owner);
+         slock_lock(w->lock);
+         w->job_busy = false;
+         scond_broadcast(w->idle);
+         continue;
+      }
+      scond_wait(w->wake, w->lock);
+   }
+   slock_unlock(w->lock);
+}
+
+static struct deint_workers *deint_workers_get(Deinterlacer *d)
+{
+   struct deint_workers *w = d->Workers;
+
+   if (w)
+      return w;
+   w = (struct deint_workers*)calloc(1, sizeof(*w));
+   if (!w)
+      return NULL;
+   w->owner = d;
+   w->lock  = slock_new();
+   w->wake  = scond_new();
+   w->idle  = scond_new();
+   if (!w->lock || !w->wake || !w->idle)
+   {
+      if (w->lock) slock_free(w->lock);
+      if (w->wake) scond_free(w->wake);
+      if (w->idle) scond_free(w->idle);
+      free(w);
+      return NULL;
+   }
+   d->Workers = w;
+   return w;
+}
+
+/* Grow the helper set to threads-1.  Never shrinks; a lower setting
+ * just leaves the surplus helpers asleep until the pool is torn down
+ * by Deinterlacer_SetThreads. */
+static void deint_workers_spawn(struct deint_workers *w, unsigned threads)
+{
+   if (threads > DEINT_MAX_THREADS)
+      threads = DEINT_MAX_THREADS;
+   while (w->helper_count + 1 < threads)
+   {
+      struct deint_helper *h = &w->helper_args[w->helper_count];
+      h->w    = w;
+      h->slot = w->helper_count + 1;
+      w->helpers[w->helper_count] = sthread_create(deint_helper_main, h);
+      if (!w->helpers[w->helper_count])
+         break;
+      w->helper_count++;
+   }
+}
+
+static bool deint_job_thread_start(Deinterlacer *d)
+{
+   struct deint_workers *w = deint_workers_get(d);
+
+   if (!w)
+      return false;
+   if (!w->job_thread)
+      w->job_thread = sthread_create(deint_job_main, w);
+   return w->job_thread != NULL;
+}
+
+static void deint_workers_destroy(Deinterlacer *d)
+{
+   struct deint_workers *w = d->Workers;
+   unsigned i;
+
+   if (!w)
+      return;
+   slock_lock(w->lock);
+   while (w->job_busy)
+      scond_wait(w->idle, w->lock);
+   w->quit = true;
+   scond_broadcast(w->wake);
+   slock_unlock(w->lock);
+
+   for (i = 0; i < w->helper_count; i++)
+      sthread_join(w->helpers[i]);
+   if (w->job_thread)
+      sthread_join(w->job_thread);
+
+   slock_free(w->lock);
+   scond_free(w->wake);
+   scond_free(w->idle);
+   free(w);
+   d->Workers = NULL;
+}
+#endif
+
+/* Run fn over native rows [0, rows), split across the pool when it
+ * has helpers and the frame is big enough to be worth waking them. */
+static void deint_run_rows(Deinterlacer *d, deint_rows_fn fn, void *ctx, int rows)
+{
+#ifdef HAVE_THREADS
+   struct deint_workers *w = NULL;
+
+   if (d->Threads > 1 && rows >= 2 * DEINT_MIN_CHUNK)
+   {
+      w = deint_workers_get(d);
+      if (w)
+         deint_workers_spawn(w, d->Threads);
+   }
+
+   if (w && w->helper_count)
+   {
+      int begin, end;
+
+      slock_lock(w->lock);
+      w->fn    = fn;
+      w->ctx   = ctx;
+      w->next  = 0;
+      w->end   = rows;
+      /* A few chunks per participant, so a helper that wakes late
+       * doesn't leave everyone else waiting on its share. */
+      w->chunk = rows / (int)((w->helper_count + 1) * 4);
+      if (w->chunk < DEINT_MIN_CHUNK)
+         w->chunk = DEINT_MIN_CHUNK;
+      scond_broadcast(w->wake);
+
+      while (deint_grab_rows(w, &begin, &end))
+      {
+         slock_unlock(w->lock);
+         fn(ctx, begin, end, 0);
+         slock_lock(w->lock);
+         w->busy--;
+      }
+      while (w->busy)
+         scond_wait(w->idle, w->lock);
+      w->fn  = NULL;
+      w->ctx = NULL;
+      slock_unlock(w->lock);
+      return;
+   }
+#endif
+   fn(ctx, 0, rows, 0);
+}
+
+/* Finish the pipelined job, if any, so the caller owns every FastMAD
+ * buffer again.  A job that was prepared but never kicked runs here,
+ * on the calling thread; `discard` drops it instead. */
+static void deint_job_wait(Deinterlacer *d, bool discard)
+{
+#ifdef HAVE_THREADS
+   struct deint_workers *w = d->Workers;
+
+   if (w && w->job_thread)
+   {
+      slock_lock(w->lock);
+      while (w->job_busy)
+         scond_wait(w->idle, w->lock);
+      slock_unlock(w->lock);
+   }
+   if (d->JobReady)
+   {
+      d->JobReady = false;
+      if (discard)
+         d->MadOutValid = false;
+      else
+         deint_job_run(d);
+   }
+#endif
+}
+
 void Deinterlacer_Init(Deinterlacer *d)
 {
    d->StateValid            = false;
@@ -62,12 +343,32 @@ void Deinterlacer_Init(Deinterlacer *d)
    d->MadScratchW     = 0;
    d->MadIdx          = 0;
    d->MadFramesValid  = 0;
+   d->Workers         = NULL;
+   d->Threads         = 1;
+   d->Pipelined       = false;
+   d->PresentOut      = false;
+   d->MadOutValid     = false;
+   d->JobReady        = false;
+   d->MadIn           = NULL;
+   d->MadInPix        = 0;
+   d->MadOut          = NULL;
 }
 
 void Deinterlacer_Cleanup(Deinterlacer *d)
 {
    if (!d)
       return;
+   deint_job_wait(d, true);
+#ifdef HAVE_THREADS
+   deint_workers_destroy(d);
+#endif
+   free(d->MadIn);
+   MDFN_Surface_Delete(d->MadOut);
+   d->MadIn       = NULL;
+   d->MadInPix    = 0;
+   d->MadOut      = NULL;
+   d->MadOutValid = false;
+   d->PresentOut  = false;
    free(d->MadHist[0]);
    free(d->MadHist[1]);
    free(d->MadScratch);
@@ -82,6 +383,7 @@ void Deinterlacer_SetType(Deinterlacer *d, unsigned dt)
 {
    if (d->DeintType != dt)
    {
+      deint_job_wait(d, true);
       d->DeintType  = dt;
       d->StateValid = false;
    }
@@ -97,8 +399,69 @@ bool Deinterlacer_DidDisturbMargins(const Deinterlacer *d)
    return d->LastDisturbedMargins;
 }
 
+void Deinterlacer_SetThreads(Deinterlacer *d, unsigned threads)
+{
+   if (threads < 1)
+      threads = 1;
+   if (threads > DEINT_MAX_THREADS)
+      threads = DEINT_MAX_THREADS;
+   if (d->Threads == threads)
+      return;
+#ifdef HAVE_THREADS
+   /* Lowering the count retires the surplus helpers; the pipeline
+    * thread (if any) is recreated on the next pipelined frame. */
+   if (d->Workers && threads < d->Workers->helper_count + 1)
+   {
+      deint_job_wait(d, true);
+      deint_workers_destroy(d);
+   }
+#endif
+   d->Threads = threads;
+}
+
+void Deinterlacer_SetPipelined(Deinterlacer *d, bool enable)
+{
+#ifdef HAVE_THREADS
+   if (d->Pipelined == enable)
+      return;
+   deint_job_wait(d, true);
+   d->Pipelined   = enable;
+   d->MadOutValid = false;
+   d->PresentOut  = false;
+#else
+   (void)d;
+   (void)enable;
+#endif
+}
+
+const MDFN_Surface *Deinterlacer_OutputSurface(const Deinterlacer *d,
+      const MDFN_Surface *surface)
+{
+   return d->PresentOut ? d->MadOut : surface;
+}
+
+void Deinterlacer_Kick(Deinterlacer *d)
+{
+#ifdef HAVE_THREADS
+   struct deint_workers *w = d->Workers;
+
+   if (!d->JobReady || !w || !w->job_thread)
+      return;
+   d->JobReady = false;
+   slock_lock(w->lock);
+   w->job_queued = true;
+   w->job_busy   = true;
+   scond_broadcast(w->wake);
+   slock_unlock(w->lock);
+#else
+   (void)d;
+#endif
+}
+
 void Deinterlacer_ClearState(Deinterlacer *d)
 {
+   deint_job_wait(d, true);
+   d->MadOutValid           = false;
    d->StateValid            = false;
    d->PrevDRect_h           = 0;
    d->PrevDRect_x           = 0;
@@ -108,8 +471,9 @@ void Deinterlacer_ClearState(Deinterlacer *d)
 
 /*
  * Per-mode inner loops.  Each one runs `field_h` iterations and
- * reads/writes upscaled row blocks.  pitch_pix is the surface pitch
- * in pixels, up = 1 << s, copy_pix = surface_w << s if you want to
+ * reads/writes upscaled row blocks.  pitch_bytes is the surface
+ * pitch in bytes and bpp the bytes per pixel (4 for XRGB8888, 2 for
+ * RGB565), up = 1 << s, copy width = surface_w << s if you want to
  * copy padding too, but we use the active native width from
  * LineWidths to avoid clobbering the opposite field's pixels past
  * the active area (matters for BOB/BOB_OFFSET when WEAVE is the
@@ -121,7 +485,7 @@ void Deinterlacer_ClearState(Deinterlacer *d)
  * far-right padding in the surface stays at whatever the GPU left
  * there.  Cheap insurance against future width-change shenanigans.
  */
-static void deint_bob(uint32_t *pixels, int32_t pitch_pix,
+static void deint_bob(uint8_t *pixels, size_t pitch_bytes, unsigned bpp,
       const MDFN_Rect *DisplayRect, const int32_t *LineWidths,
       bool field, unsigned s)
 {
@@ -134,13 +498,13 @@ static void deint_bob(uint32_t *pixels, int32_t pitch_pix,
    {
       const int32_t   src_native = (k * 2) + (int32_t)field + dy;
       const int32_t   dst_native = k + dy;
-      const size_t    copy_pix   = (size_t)LineWidths[src_native] << s;
-      const uint32_t *src        = pixels
-         + (size_t)(src_native << s) * pitch_pix
-         + DisplayRect->x;
-      uint32_t       *dst        = pixels
-         + (size_t)(dst_native << s) * pitch_pix
-         + DisplayRect->x;
+      const size_t    copy_bytes = ((size_t)LineWidths[src_native] << s) * bpp;
+      const uint8_t  *src        = pixels
+         + (size_t)(src_native << s) * pitch_bytes
+         + (size_t)DisplayRect->x * bpp;
+      uint8_t        *dst        = pixels
+         + (size_t)(dst_native << s) * pitch_bytes
+         + (size_t)DisplayRect->x * bpp;
       unsigned u;
 
       /* k=0, field=0 case: src and dst are the same row block; the
@@ -149,21 +513,70 @@ static void deint_bob(uint32_t *pixels, int32_t pitch_pix,
          continue;
 
       for (u = 0; u < up; u++)
-         memcpy(dst + (size_t)u * pitch_pix,
-                src + (size_t)u * pitch_pix,
-                copy_pix * sizeof(uint32_t));
+         memcpy(dst + (size_t)u * pitch_bytes,
+                src + (size_t)u * pitch_bytes,
+                copy_bytes);
+   }
+}
+
+typedef struct
+{
+   uint8_t         *pixels;
+   size_t           pitch_bytes;
+   unsigned         bpp;
+   const MDFN_Rect *DisplayRect;
+   const int32_t   *LineWidths;
+   bool             field;
+   unsigned         s;
+} bob_offset_pass;
+
+/* Copies for this field's rows [begin, end).  Each one reads its own
+ * row block and writes the opposite-parity block below it, which no
+ * other k reads, so ranges can run concurrently. */
+static void deint_bob_offset_rows(void *ctx, int begin, int end, unsigned slot)
+{
+   const bob_offset_pass *p       = (const bob_offset_pass*)ctx;
+   const MDFN_Rect       *rect    = p->DisplayRect;
+   const unsigned         up      = 1u << p->s;
+   const int32_t          dy      = rect->y;
+   const int32_t          rect_end_native = dy + rect->h;
+   int32_t                k;
+
+   (void)slot;
+
+   for (k = begin; k < end; k++)
+   {
+      const int32_t   src_native = (k * 2) + (int32_t)p->field + dy;
+      const int32_t   dly        = (k * 2) + (int32_t)p->field + 1 + dy;
+      const size_t    copy_bytes = ((size_t)p->LineWidths[src_native] << p->s) * p->bpp;
+      const uint8_t  *src;
+      uint8_t        *dst;
+      unsigned u;
+
+      if (dly >= rect_end_native)
+         continue;
+
+      src = p->pixels + (size_t)(src_native << p->s) * p->pitch_bytes
+         + (size_t)rect->x * p->bpp;
+      dst = p->pixels + (size_t)(dly        << p->s) * p->pitch_bytes
+         + (size_t)rect->x * p->bpp;
+
+      for (u = 0; u < up; u++)
+         memcpy(dst + (size_t)u * p->pitch_bytes,
+                src + (size_t)u * p->pitch_bytes,
+                copy_bytes);
    }
 }
 
-static void deint_bob_offset(uint32_t *pixels, int32_t pitch_pix,
+static void deint_bob_offset(Deinterlacer *d,
+      uint8_t *pixels, size_t pitch_bytes, unsigned bpp,
       const MDFN_Rect *DisplayRect, const int32_t *LineWidths,
       bool field, unsigned s)
 {
-   const unsigned up      = 1u << s;
-   const int32_t  field_h = DisplayRect->h / 2;
-   const int32_t  dy      = DisplayRect->y;
-   const int32_t  rect_end_native = dy + DisplayRect->h;
-   int32_t        k;
+   const unsigned  up      = 1u << s;
+   const int32_t   field_h = DisplayRect->h / 2;
+   const int32_t   dy      = DisplayRect->y;
+   bob_offset_pass pass;
 
    /*
     * For y=0 on the second field (field == true) only, the row block
@@ -178,40 +591,24 @@ static void deint_bob_offset(uint32_t *pixels, int32_t pitch_pix,
       const int32_t  blank_line = first_dly - 2;
       if (blank_line >= 0)
       {
-         const size_t   copy_pix = (size_t)LineWidths[(int32_t)field + dy] << s;
-         uint32_t      *dst      = pixels
-            + (size_t)(blank_line << s) * pitch_pix;
+         const size_t   copy_bytes = ((size_t)LineWidths[(int32_t)field + dy] << s) * bpp;
+         uint8_t       *dst        = pixels
+            + (size_t)(blank_line << s) * pitch_bytes;
          unsigned u;
+         /* Black is all-zero in both XRGB8888 and RGB565. */
          for (u = 0; u < up; u++)
-         {
-            uint32_t *row = dst + (size_t)u * pitch_pix;
-            size_t x;
-            for (x = 0; x < copy_pix; x++)
-               row[x] = 0; /* MAKECOLOR(0,0,0,0) - all zero shifts */
-         }
+            memset(dst + (size_t)u * pitch_bytes, 0, copy_bytes);
       }
    }
 
-   for (k = 0; k < field_h; k++)
-   {
-      const int32_t   src_native = (k * 2) + (int32_t)field + dy;
-      const int32_t   dly        = (k * 2) + (int32_t)field + 1 + dy;
-      const size_t    copy_pix   = (size_t)LineWidths[src_native] << s;
-      const uint32_t *src;
-      uint32_t       *dst;
-      unsigned u;
-
-      if (dly >= rect_end_native)
-         continue;
-
-      src = pixels + (size_t)(src_native << s) * pitch_pix + DisplayRect->x;
-      dst = pixels + (size_t)(dly        << s) * pitch_pix + DisplayRect->x;
-
-      for (u = 0; u < up; u++)
-         memcpy(dst + (size_t)u * pitch_pix,
-                src + (size_t)u * pitch_pix,
-                copy_pix * sizeof(uint32_t));
-   }
+   pass.pixels      = pixels;
+   pass.pitch_bytes = pitch_bytes;
+   pass.bpp         = bpp;
+   pass.DisplayRect = DisplayRect;
+   pass.LineWidths  = LineWidths;
+   pass.field       = field;
+   pass.s           = s;
+   deint_run_rows(d, deint_bob_offset_rows, &pass, field_h);
 }
 
 /*
@@ -238,7 +635,7 @@ static void deint_bob_offset(uint32_t *pixels, int32_t pitch_pix,
  * whatever was there before (typically zeroed by alloc_surface);
  * that's a one-frame visual transient, not a correctness problem.
  */
-static bool deint_weave(Deinterlacer *d, uint32_t *pixels, int32_t pitch_pix,
+static bool deint_weave(Deinterlacer *d, uint8_t *pixels, size_t pitch_bytes, unsigned bpp,
       MDFN_Rect *DisplayRect, const int32_t *LineWidths,
       bool field, unsigned s)
 {
@@ -251,19 +648,19 @@ static bool deint_weave(Deinterlacer *d, uint32_t *pixels, int32_t pitch_pix,
       const unsigned up      = 1u << s;
       const int32_t  field_h = DisplayRect->h / 2;
       const int32_t  dy      = DisplayRect->y;
-      const size_t   shift_pix = (size_t)XReposition << s;
+      const size_t   shift_bytes = ((size_t)XReposition << s) * bpp;
       int32_t        k;
 
       for (k = 0; k < field_h; k++)
       {
          const int32_t  src_native = (k * 2) + (int32_t)field + dy;
-         const size_t   copy_pix   = (size_t)LineWidths[src_native] << s;
-         uint32_t      *base       = pixels + (size_t)(src_native << s) * pitch_pix;
+         const size_t   copy_bytes = ((size_t)LineWidths[src_native] << s) * bpp;
+         uint8_t       *base       = pixels + (size_t)(src_native << s) * pitch_bytes;
          unsigned u;
          for (u = 0; u < up; u++)
          {
-            uint32_t *row = base + (size_t)u * pitch_pix;
-            memmove(row, row + shift_pix, copy_pix * sizeof(uint32_t));
+            uint8_t *row = base + (size_t)u * pitch_bytes;
+            memmove(row, row + shift_bytes, copy_bytes);
          }
       }
       DisplayRect->x = 0;
@@ -595,8 +992,9 @@ static void mad_expand_row(
              (size_t)(w_native * upscale) * sizeof(uint32_t));
 }
 
-/* Ensure history banks and scratch row are sized for the current
- * geometry.  Returns 0 on success, -1 on allocation failure or
+/* Ensure history banks and scratch rows are sized for the current
+ * geometry.  There is one scratch row per pool slot, MadScratchW
+ * pixels apart.  Returns 0 on success, -1 on allocation failure or
  * if the surface exceeds the size cap (caller falls back to
  * weave). */
 static int mad_ensure_buffers(Deinterlacer *d, int w_native, int h_native)
@@ -634,6 +1032,7 @@ static int mad_ensure_buffers(Deinterlacer *d, int w_native, int h_native)
    {
       free(d->MadScratch);
       d->MadScratch  = (uint32_t*)malloc((size_t)w_native
+                                          * DEINT_MAX_THREADS
                                           * sizeof(uint32_t));
       if (!d->MadScratch)
       {
@@ -645,137 +1044,310 @@ static int mad_ensure_buffers(Deinterlacer *d, int w_native, int h_native)
    return 0;
 }
 
-/* Top-level FastMAD entry, called from Deinterlacer_Process. */
-static void deint_fastmad(
-      Deinterlacer    *d,
-      uint32_t        *pixels,
-      int32_t          pitch_pix,
-      const MDFN_Rect *DisplayRect,
-      bool             field,
-      unsigned         s)
+/*
+ * One FastMAD pass over a frame, split into two row-parallel phases
+ * with a join in between:
+ *
+ *   1. output rows: reconstruct / weave every native row into its
+ *      output block.  Opposite-parity rows read the first rows of
+ *      the blocks above and below, which only the GPU (or the
+ *      pipeline copy-in) wrote, so rows are independent.
+ *   2. snapshot: sample the output back into the history bank that
+ *      phase 1 was reading as 2-frames-old state.
+ *
+ * `in` addresses the first row of native line y as in + y*in_stride.
+ * Inline it is the surface itself (in_stride = one upscale block of
+ * rows) and `out` aliases it; pipelined it is the compact MadIn
+ * copy and `out` is MadOut, so every row must be written, including
+ * the current-field ones the inline pass can leave alone.
+ */
+typedef struct
 {
-   const int       upscale  = 1 << s;
-   const int       w_native = (DisplayRect->w > 0)
-                              ? DisplayRect->w
-                              : (pitch_pix / upscale);
-   const int       h_native = DisplayRect->h;
-   const int       dy       = DisplayRect->y;
+   Deinterlacer   *d;
+   const uint32_t *in;
+   size_t          in_stride;
+   uint32_t       *out;         /* first row of native line 0 */
+   int32_t         pitch_pix;
    const uint32_t *hist;
-   int             k, y, v;
-
-   if (mad_ensure_buffers(d, w_native, h_native) < 0)
-      return;     /* silent weave fallback */
+   uint32_t       *snap;
+   int             w_native;
+   int             h_native;
+   int             upscale;
+   bool            field;
+   bool            reconstruct; /* past warmup */
+} mad_pass;
+
+static void mad_output_rows(void *ctx, int begin, int end, unsigned slot)
+{
+   const mad_pass *p         = (const mad_pass*)ctx;
+   const int       upscale   = p->upscale;
+   const int       w_native  = p->w_native;
+   const int       h_native  = p->h_native;
+   const int32_t   pitch_pix = p->pitch_pix;
+   const size_t    row_bytes = (size_t)(w_native * upscale) * sizeof(uint32_t);
+   uint32_t       *scratch   = p->d->MadScratch
+      + (size_t)slot * p->d->MadScratchW;
+   int             y, v;
+
+   for (y = begin; y < end; y++)
+   {
+      const uint32_t *cn_row    = p->in + (size_t)y * p->in_stride;
+      uint32_t       *first_dst = p->out + (size_t)(y * upscale) * pitch_pix;
+      int             is_current_parity, is_edge;
 
-   hist = d->MadHist[d->MadIdx];
+      is_current_parity = ((y & 1) == (int)p->field);
+      is_edge           = (y == 0 || y == h_native - 1);
 
-   if (d->MadFramesValid >= MAD_WARMUP)
-   {
-      for (y = 0; y < h_native; y++)
+      if (!p->reconstruct || is_current_parity || is_edge)
       {
-         int       is_current_parity, is_edge;
-         uint32_t *first_dst;
+         /* Weave.  Inline, the warmup frames leave the surface as
+          * the GPU wrote it, as they always have. */
+         if (cn_row == first_dst)
+         {
+            if (!p->reconstruct)
+               continue;
+         }
+         else
+            memcpy(first_dst, cn_row, row_bytes);
+
+         /* Replicate the block's first row across the rest of the
+          * upscale block. */
+         for (v = 1; v < upscale; v++)
+            memcpy(first_dst + (size_t)v * pitch_pix, first_dst, row_bytes);
+         continue;
+      }
 
-         is_current_parity = ((y & 1) == (int)field);
-         is_edge           = (y == 0 || y == h_native - 1);
-         if (is_current_parity)
-            continue;     /* GPU already filled this row */
+      {
+         const uint32_t *hn_row = cn_row - p->in_stride;
+         const uint32_t *ln_row = cn_row + p->in_stride;
+         const uint32_t *co_row = p->hist + (size_t)y       * w_native;
+         const uint32_t *ho_row = p->hist + (size_t)(y - 1) * w_native;
+         const uint32_t *lo_row = p->hist + (size_t)(y + 1) * w_native;
 
-         first_dst = pixels + (size_t)((y + dy) * upscale) * pitch_pix;
-         if (is_edge)
+         if (upscale == 1)
          {
-            /* Weave from surface.  Just replicate the GPU's first-
-             * row-of-block across the rest of the upscale block. */
-            for (v = 1; v < upscale; v++)
-               memcpy(first_dst + (size_t)v * pitch_pix, first_dst,
-                      (size_t)(w_native * upscale) * sizeof(uint32_t));
-            continue;
+            mad_reconstruct_row(scratch,
+                  cn_row, hn_row, ln_row,
+                  co_row, ho_row, lo_row,
+                  w_native);
          }
-
+         else
          {
-            const int       y_above   = y - 1;
-            const int       y_below   = y + 1;
-            const uint32_t *cn_row    = pixels
-               + (size_t)((y       + dy) * upscale) * pitch_pix;
-            const uint32_t *hn_row    = pixels
-               + (size_t)((y_above + dy) * upscale) * pitch_pix;
-            const uint32_t *ln_row    = pixels
-               + (size_t)((y_below + dy) * upscale) * pitch_pix;
-            const uint32_t *co_row    = hist + (size_t)y       * w_native;
-            const uint32_t *ho_row    = hist + (size_t)y_above * w_native;
-            const uint32_t *lo_row    = hist + (size_t)y_below * w_native;
-
-            if (upscale == 1)
+            /* Subsample current-frame rows on the fly.  Forfeits
+             * SSE2 in the upscaled path; at upscale > 1 the
+             * history buffer's column-stride still gives us
+             * tight reads for the older-frame side. */
+            int x;
+            for (x = 0; x < w_native; x++)
             {
-               mad_reconstruct_row(d->MadScratch,
-                     cn_row, hn_row, ln_row,
-                     co_row, ho_row, lo_row,
-                     w_native);
+               uint32_t hn = hn_row[x * upscale];
+               uint32_t cn = cn_row[x * upscale];
+               uint32_t ln = ln_row[x * upscale];
+               uint32_t ho = ho_row[x];
+               uint32_t co = co_row[x];
+               uint32_t lo = lo_row[x];
+               int mh = mad_pixel_motion(hn, ho, MAD_SENSITIVITY);
+               int mc = mad_pixel_motion(cn, co, MAD_SENSITIVITY);
+               int ml = mad_pixel_motion(ln, lo, MAD_SENSITIVITY);
+               scratch[x] = (mh > 0 || mc > 0 || ml > 0)
+                  ? mad_average_pixels(hn, ln)
+                  : cn;
             }
-            else
-            {
-               /* Subsample current-frame rows on the fly.  Forfeits
-                * SSE2 in the upscaled path; at upscale > 1 the
-                * history buffer's column-stride still gives us
-                * tight reads for the older-frame side. */
-               int x;
-               for (x = 0; x < w_native; x++)
-               {
-                  uint32_t hn = hn_row[x * upscale];
-                  uint32_t cn = cn_row[x * upscale];
-                  uint32_t ln = ln_row[x * upscale];
-                  uint32_t ho = ho_row[x];
-                  uint32_t co = co_row[x];
-                  uint32_t lo = lo_row[x];
-                  int mh = mad_pixel_motion(hn, ho, MAD_SENSITIVITY);
-                  int mc = mad_pixel_motion(cn, co, MAD_SENSITIVITY);
-                  int ml = mad_pixel_motion(ln, lo, MAD_SENSITIVITY);
-                  d->MadScratch[x] = (mh > 0 || mc > 0 || ml > 0)
-                     ? mad_average_pixels(hn, ln)
-                     : cn;
-               }
-            }
-
-            mad_expand_row(first_dst, pitch_pix,
-                  d->MadScratch, w_native, upscale);
          }
-      }
 
-      /* Replicate current-field rows across the upscale row block.
-       * The GPU's immediate-scanout path only wrote the first row
-       * of each block; rows 1..upscale-1 are scratch. */
-      if (upscale > 1)
-      {
-         for (k = 0; k < (h_native / 2); k++)
-         {
-            const int    native_y    = (k * 2) + (int)field;
-            uint32_t    *first_dst   = pixels
-               + (size_t)((native_y + dy) * upscale) * pitch_pix;
-            for (v = 1; v < upscale; v++)
-               memcpy(first_dst + (size_t)v * pitch_pix, first_dst,
-                      (size_t)(w_native * upscale) * sizeof(uint32_t));
-         }
+         mad_expand_row(first_dst, pitch_pix, scratch, w_native, upscale);
       }
    }
-   else
-   {
+}
+
+static void mad_snapshot_rows(void *ctx, int begin, int end, unsigned slot)
+{
+   const mad_pass *p = (const mad_pass*)ctx;
+
+   (void)slot;
+   mad_snapshot_native(p->snap + (size_t)begin * p->w_native, p->w_native,
+         p->out, p->pitch_pix, begin, end - begin, p->upscale);
+}
+
+static void mad_run(Deinterlacer *d, mad_pass *p)
+{
+   p->d           = d;
+   p->hist        = d->MadHist[d->MadIdx];
+   /* Snapshot into the bank we'll READ from 2 calls from now. */
+   p->snap        = d->MadHist[d->MadIdx];
+   p->reconstruct = (d->MadFramesValid >= MAD_WARMUP);
+
+   if (p->reconstruct || p->in != p->out)
+      deint_run_rows(d, mad_output_rows, p, p->h_native);
+   if (!p->reconstruct)
       d->MadFramesValid++;
-   }
 
-   /* Snapshot the surface at native resolution into the bank we'll
-    * READ from 2 calls from now. */
-   mad_snapshot_native(d->MadHist[d->MadIdx], w_native,
-         pixels, pitch_pix, dy, h_native, upscale);
+   deint_run_rows(d, mad_snapshot_rows, p, p->h_native);
 
    /* Toggle bank pointer. */
    d->MadIdx ^= 1;
 }
 
+/* Top-level inline FastMAD entry, called from Deinterlacer_Process. */
+static void deint_fastmad(
+      Deinterlacer    *d,
+      uint32_t        *pixels,
+      int32_t          pitch_pix,
+      const MDFN_Rect *DisplayRect,
+      bool             field,
+      unsigned         s)
+{
+   const int upscale  = 1 << s;
+   const int w_native = (DisplayRect->w > 0)
+                        ? DisplayRect->w
+                        : (pitch_pix / upscale);
+   const int h_native = DisplayRect->h;
+   mad_pass  pass;
+
+   if (mad_ensure_buffers(d, w_native, h_native) < 0)
+      return;     /* silent weave fallback */
+
+   pass.out       = pixels + (size_t)(DisplayRect->y * upscale) * pitch_pix;
+   pass.in        = pass.out;
+   pass.in_stride = (size_t)upscale * pitch_pix;
+   pass.pitch_pix = pitch_pix;
+   pass.w_native  = w_native;
+   pass.h_native  = h_native;
+   pass.upscale   = upscale;
+   pass.field     = field;
+   mad_run(d, &pass);
+}
+
+#ifdef HAVE_THREADS
+/*
+ * Pipelined FastMAD.
+ *
+ * FastMAD only needs the first row of each native line's block, so
+ * Process() copies those (w_native * upscale pixels per line) into
+ * MadIn, which is a quarter of a 2x frame and a sixteenth of a 4x
+ * one, and hands the rest of the work - reconstruction, the upscale
+ * block fill and the history snapshot - to the pipeline thread,
+ * which writes MadOut while the next frame is emulated.  The frame
+ * presented is the previous one, from MadOut, along with the
+ * geometry it was produced with.  The GPU-owned surface is never
+ * written, so the SW scanout cache keeps trusting its rows.
+ *
+ * Once warmed up the output matches the inline path exactly; during
+ * the MAD_WARMUP frames it is a weave with every upscale block
+ * filled from its first row, where the inline path leaves the
+ * GPU's rows as they are.
+ */
+static void deint_job_run(Deinterlacer *d)
+{
+   const int upscale = 1 << d->JobShift;
+   mad_pass  pass;
+
+   pass.in        = d->MadIn;
+   pass.in_stride = (size_t)d->MadW * upscale;
+   pass.out       = d->MadOut->pixels
+      + (size_t)(d->JobRect.y * upscale) * d->MadOut->pitchinpix;
+   pass.pitch_pix = d->MadOut->pitchinpix;
+   pass.w_native  = d->MadW;
+   pass.h_native  = d->MadH;
+   pass.upscale   = upscale;
+   pass.field     = d->JobField;
+   mad_run(d, &pass);
+}
+
+/* Returns false when the pipelined buffers can't be had; the caller
+ * then runs the inline path on the surface instead. */
+static bool deint_fastmad_pipelined(
+      Deinterlacer    *d,
+      MDFN_Surface    *surface,
+      MDFN_Rect       *DisplayRect,
+      int32_t         *LineWidths,
+      bool             field,
+      unsigned         s)
+{
+   const int32_t pitch_pix = surface->pitchinpix;
+   const int     upscale   = 1 << s;
+   const int     w_native  = (DisplayRect->w > 0)
+                             ? DisplayRect->w
+                             : (pitch_pix / upscale);
+   const int     h_native  = DisplayRect->h;
+   const size_t  row_pix   = (size_t)w_native * upscale;
+   const size_t  in_pix    = row_pix * h_native;
+   const bool    had_hist  = (d->MadHist[0] != NULL);
+   const int32_t prev_w    = d->MadW;
+   const int32_t prev_h    = d->MadH;
+   int           y;
+
+   if (!deint_job_thread_start(d))
+      return false;
+   if (mad_ensure_buffers(d, w_native, h_native) < 0)
+      return false;
+
+   if (d->MadInPix < in_pix)
+   {
+      free(d->MadIn);
+      d->MadIn    = (uint32_t*)malloc(in_pix * sizeof(uint32_t));
+      d->MadInPix = d->MadIn ? in_pix : 0;
+      if (!d->MadIn)
+         return false;
+   }
+   if (   !d->MadOut
+       || d->MadOut->w          != surface->w
+       || d->MadOut->h          != surface->h
+       || d->MadOut->pitchinpix != pitch_pix)
+   {
+      MDFN_Surface_Delete(d->MadOut);
+      d->MadOut      = MDFN_Surface_New(surface->w, surface->h, pitch_pix,
+            sizeof(uint32_t));
+      d->MadOutValid = false;
+      if (!d->MadOut)
+         return false;
+   }
+   /* A geometry change reallocated the history; what sits in MadOut
+    * belongs to the old frame size. */
+   if (!had_hist || prev_w != d->MadW || prev_h != d->MadH)
+      d->MadOutValid = false;
+
+   for (y = 0; y < h_native; y++)
+      memcpy(d->MadIn + (size_t)y * row_pix,
+             surface->pixels
+               + (size_t)((y + DisplayRect->y) * upscale) * pitch_pix,
+             row_pix * sizeof(uint32_t));
+
+   d->JobRect  = *DisplayRect;
+   d->JobWidth = LineWidths[0];
+   d->JobField = field;
+   d->JobShift = s;
+
+   if (!d->MadOutValid)
+   {
+      /* Nothing to show yet: run this frame now and show it. */
+      deint_job_run(d);
+      d->MadOutValid = true;
+   }
+   else
+   {
+      /* Show the previous frame, then leave this one for Kick(). */
+      *DisplayRect   = d->OutRect;
+      LineWidths[0]  = d->OutWidth;
+      d->JobReady    = true;
+   }
+   d->OutRect  = d->JobRect;
+   d->OutWidth = d->JobWidth;
+   return true;
+}
+#endif
+
 void Deinterlacer_Process(Deinterlacer *d, MDFN_Surface *surface,
       MDFN_Rect *DisplayRect, int32_t *LineWidths, const bool field)
 {
    const unsigned s          = psx_gpu_upscale_shift;
    uint32_t      *pixels     = surface->pixels;
    const int32_t  pitch_pix  = surface->pitchinpix;
+   /* BOB, BOB_OFFSET and WEAVE only move whole pixels around, so they
+    * work in bytes and serve the RGB565 surface too, whose rows are
+    * pitch_pix 2-byte pixels. */
+   const unsigned bpp         = psx_sw_rgb565 ? 2 : 4;
+   const size_t   pitch_bytes = (size_t)pitch_pix * bpp;
    const int32_t  prev_h     = DisplayRect->h;
    const int32_t  prev_x     = DisplayRect->x;
 
@@ -784,6 +1356,11 @@ void Deinterlacer_Process(Deinterlacer *d, MDFN_Surface *surface,
     * region (currently just WEAVE's XReposition path). */
    d->LastDisturbedMargins = false;
 
+   /* Take the FastMAD buffers (and the pool) back from a pipelined
+    * job still running from the previous frame. */
+   deint_job_wait(d, false);
+   d->PresentOut = false;
+
    /*
     * The libretro frontend reads only LineWidths[0]; everything
     * past index 0 is scratch from the deinterlacer's perspective.
@@ -823,22 +1400,43 @@ void Deinterlacer_Process(Deinterlacer *d, MDFN_Surface *surface,
          break;
 
       case DEINT_WEAVE:
-         (void)deint_weave(d, pixels, pitch_pix, DisplayRect,
-               LineWidths, field, s);
+         (void)deint_weave(d, (uint8_t*)pixels, pitch_bytes, bpp,
+               DisplayRect, LineWidths, field, s);
          break;
 
       case DEINT_BOB:
-         deint_bob(pixels, pitch_pix, DisplayRect,
+         deint_bob((uint8_t*)pixels, pitch_bytes, bpp, DisplayRect,
                LineWidths, field, s);
          break;
 
       case DEINT_FASTMAD:
+         /* Motion detection and blending need 8-bit channels.  The
+          * RGB565 surface has none, so it gets BOB_OFFSET instead. */
+         if (psx_sw_rgb565)
+         {
+            d->MadFramesValid = 0;
+            deint_bob_offset(d, (uint8_t*)pixels, pitch_bytes, bpp,
+                  DisplayRect, LineWidths, field, s);
+            break;
+         }
+#ifdef HAVE_THREADS
+         if (d->Pipelined)
+         {
+            if (deint_fastmad_pipelined(d, surface, DisplayRect,
+                     LineWidths, field, s))
+            {
+               d->PresentOut = true;
+               break;
+            }
+            d->MadOutValid = false;
+         }
+#endif
          deint_fastmad(d, pixels, pitch_pix, DisplayRect, field, s);
          break;
 
       case DEINT_BOB_OFFSET:
       default:
-         deint_bob_offset(pixels, pitch_pix, DisplayRect,
+         deint_bob_offset(d, (uint8_t*)pixels, pitch_bytes, bpp, DisplayRect,
                LineWidths, field, s);
          break;
    }
@@ -96,6 +96,33 @@ typedef struct
    int32_t   MadScratchW;
    int32_t   MadIdx;
    int32_t   MadFramesValid;
+
+   /* Row-parallel worker pool (HAVE_THREADS builds only; NULL
+    * otherwise and until the first call that can use it).  Threads
+    * is the total number of threads sharing a frame's rows, the
+    * calling thread included, so 1 means "run inline". */
+   struct deint_workers *Workers;
+   unsigned  Threads;
+
+   /* One-frame FastMAD pipelining.  When enabled, Process() copies
+    * the field's first-of-block rows into MadIn, presents MadOut
+    * (the PREVIOUS frame's result) and leaves this frame's
+    * reconstruction to run on a worker thread while the next frame
+    * is emulated.  The GPU-owned surface is left untouched.  See
+    * deint_fastmad_pipelined() in Deinterlacer.c. */
+   bool      Pipelined;
+   bool      PresentOut;   /* last Process() presented MadOut */
+   bool      MadOutValid;  /* MadOut holds a finished frame */
+   bool      JobReady;     /* job prepared, not yet handed to a thread */
+   uint32_t *MadIn;
+   size_t    MadInPix;
+   MDFN_Surface *MadOut;
+   MDFN_Rect JobRect;      /* geometry of the frame being reconstructed */
+   int32_t   JobWidth;     /* its LineWidths[0] */
+   bool      JobField;
+   unsigned  JobShift;
+   MDFN_Rect OutRect;      /* geometry of the frame sitting in MadOut */
+   int32_t   OutWidth;
 } Deinterlacer;
 
 void     Deinterlacer_Init(Deinterlacer *d);
@@ -116,6 +143,30 @@ void     Deinterlacer_ClearState(Deinterlacer *d);
  * call before the per-mode work runs. */
 bool     Deinterlacer_DidDisturbMargins(const Deinterlacer *d);
 
+/* Number of threads (calling thread included) that FastMAD and
+ * BOB_OFFSET split their rows across; 0 or 1 runs inline.  Helper
+ * threads are created on first use.  Ignored without HAVE_THREADS. */
+void     Deinterlacer_SetThreads(Deinterlacer *d, unsigned threads);
+
+/* Enable one-frame FastMAD pipelining: the frame returned by
+ * Process() is the previous field's reconstruction, in exchange for
+ * running this field's on a worker thread.  Adds one frame of video
+ * latency.  Ignored without HAVE_THREADS. */
+void     Deinterlacer_SetPipelined(Deinterlacer *d, bool enable);
+
+/* The surface the caller should present after Process(): normally
+ * `surface` itself, or the deinterlacer's own output surface when the
+ * last call ran pipelined.  Same dimensions and pitch either way. */
+const MDFN_Surface *Deinterlacer_OutputSurface(const Deinterlacer *d,
+            const MDFN_Surface *surface);
+
+/* Hand a job prepared by a pipelined Process() call to its worker
+ * thread.  Call once the presented frame has been passed to the
+ * frontend, since the job writes into the output surface.  A job
+ * that is never kicked runs inline at the start of the next
+ * Process(); ClearState() discards it. */
+void     Deinterlacer_Kick(Deinterlacer *d);
+
 #ifdef __cplusplus
 }
 #endif
@@ -78,19 +78,21 @@ typedef struct
 } MDFN_Surface;
 
 /*
- * Allocate a new surface backed by a calloc'd uint32 pixel buffer
- * of pitchinpix*height entries. Returns NULL on allocation
- * failure (caller must check). Width and pitchinpix are normally
- * equal; the libretro driver picks them based on
- * MEDNAFEN_CORE_GEOMETRY_MAX_W and the current upscale shift.
+ * Allocate a new surface backed by a calloc'd pixel buffer of
+ * pitchinpix*height pixels of bpp bytes each: 4 for XRGB8888, 2 for
+ * the RGB565 software output, whose rows are pitchinpix 16-bit pixels
+ * (see psx_sw_rgb565). Returns NULL on allocation failure (caller
+ * must check). Width and pitchinpix are normally equal; the libretro
+ * driver picks them based on MEDNAFEN_CORE_GEOMETRY_MAX_W and the
+ * current upscale shift.
  */
 static INLINE MDFN_Surface *MDFN_Surface_New(uint32_t width, uint32_t height,
-      uint32_t pitchinpix)
+      uint32_t pitchinpix, uint32_t bpp)
 {
    MDFN_Surface *surf = (MDFN_Surface *)calloc(1, sizeof(MDFN_Surface));
    if (!surf)
       return NULL;
-   surf->pixels = (uint32_t *)calloc(1, pitchinpix * height * sizeof(uint32_t));
+   surf->pixels = (uint32_t *)calloc(1, (size_t)pitchinpix * height * bpp);
    if (!surf->pixels)
    {
       free(surf);
@@ -35,24 +35,14 @@ void PGXP_InitCPU()
 void InvalidLoad(uint32_t addr, uint32_t code, uint32_t value)
 {
 	uint32_t reg = ((code >> 16) & 0x1F); /* The rt part of the instruction register */
-	PGXP_value* pD = NULL;
 	PGXP_value p;
 
 	p.x = p.y = -1337; /* default values */
 
 					   /*p.valid = 0;
 					    *p.count = value; */
-	pD = ReadMem(addr);
-
-	if (pD)
-	{
-		p.count = addr;
-		p = *pD;
-	}
-	else
-	{
+	if (!ReadMem(&p, addr))
 		p.count = value;
-	}
 
 	p.flags = 0;
 
@@ -64,15 +54,11 @@ void InvalidLoad(uint32_t addr, uint32_t code, uint32_t value)
 void InvalidStore(uint32_t addr, uint32_t code, uint32_t value)
 {
 	uint32_t reg = ((code >> 16) & 0x1F); /* The rt part of the instruction register */
-	PGXP_value* pD = NULL;
 	PGXP_value p;
 
-	pD = ReadMem(addr);
-
 	p.x = p.y = -2337;
 
-	if (pD)
-		p = *pD;
+	ReadMem(&p, addr);
 
 	p.flags = 0;
 	p.count = (reg * 1000) + value;
@@ -76,25 +76,27 @@ uint32_t PGXP_tDebug = 0;
 /* ============================================================
  * Blade_Arma's Vertex Cache (CatBlade?)
  *
- * vertexCache is a 4096x4096 grid indexed by the 11-bit signed
- * vertex (sx, sy) screen coordinates.  At 28 bytes per PGXP_value
- * that grid would be 448 MB if we stored full PGXP_values; the
- * read path however only uses x, y, z, and a tiny session-validity
- * flag, so the cache is stored as a packed 16-byte
- * PGXP_cache_entry instead - shaving off ~192 MB of heap when the
- * cache is allocated.  The full PGXP_value's count / value / flags
- * / lFlags / hFlags fields are not relevant for cache reads; they
- * matter only on the FIFO/CB side, which uses PGXP_value directly.
+ * Maps the integer screen position (sx, sy) a vertex was projected to
+ * back to the precise x, y, z the GTE computed for it, so that
+ * PGXP_GetVertex can recover precision for vertices whose command words
+ * did not come through the parallel memory path.
+ *
+ * Storage.  This used to be a calloc'd 4096x4096 grid indexed directly
+ * by the 11-bit signed (sx, sy) - 256 MB at 16 bytes a cell, which rules
+ * the option out on 1-2 GB devices, and of which a frame touches a few
+ * thousand cells, every lookup a cache miss.  It is now an
+ * open-addressing hash table of VERTEX_CACHE_SLOTS entries (640 KB),
+ * keyed by the packed (sx, sy), with linear probing over at most
+ * VERTEX_CACHE_PROBES slots.  That is several frames' worth of
+ * transformed vertices: a write session (below) rarely holds more than
+ * a few thousand.  A write that finds no room in its probe window is
+ * dropped, which reads back as "not cached" - the same as the default
+ * cache-disabled setting, never as a wrong vertex.
  *
  * The buffer is allocated lazily via calloc() the first time it's
  * actually needed and only when the PGXP_VERTEX_CACHE mode bit is
- * set.  Most users do not enable the vertex cache, and previously
- * the buffer was static BSS that still consumed 448 MB of address
- * space (and got faulted in on the first memset) regardless of
- * whether the feature was on.
- *
- * The cache is freed in PGXP_Shutdown() (called from retro_deinit)
- * so we don't leak across libretro dlopen/dlclose cycles.
+ * set, and freed in PGXP_Shutdown() (called from retro_deinit) so we
+ * don't leak across libretro dlopen/dlclose cycles.
  *
  * False positives.  This is the defect the core option warns about
  * ("false positives when querying the cache may produce graphical
@@ -110,7 +112,7 @@ uint32_t PGXP_tDebug = 0;
  *      geometry that had long since moved or been discarded.
  *   2. Collision.  The key is the *integer* screen position, so two
  *      distinct vertices in the same frame that project to the same
- *      pixel share a cell.  The second write silently overwrote the
+ *      pixel share a key.  The second write silently overwrote the
  *      first and the reader had no way to tell.  The gFlags == 5
  *      "ambiguous" encoding the original author left behind was the
  *      intended guard for this, but the branch that would have set it
@@ -121,7 +123,17 @@ uint32_t PGXP_tDebug = 0;
  * is precisely what the (recommended, default) cache-disabled setting
  * yields.  Over-refusal therefore degrades to the current default,
  * while under-refusal is the glitch source - so the policy here is
- * deliberately conservative.
+ * deliberately conservative.  Hash collisions between different keys
+ * are not a third source: every slot stores its full key.
+ *
+ * Generations double as the table clear.  An entry from an older
+ * generation is dead, so a probe treats it exactly like an empty slot:
+ * both stop the walk, and both may be overwritten.  That is sound
+ * because entries are never removed within a generation.  A live key
+ * was stored in the first non-live slot of its window, every slot
+ * before it was live then and still is, so a walk for that key always
+ * reaches it before meeting a dead slot.  Opening a generation
+ * therefore empties the table in O(1) and chains never need tombstones.
  *
  * Determinism note: the generation counter is render-side state and is
  * not serialized, exactly as the cache contents were not serialized
@@ -135,14 +147,14 @@ typedef struct
 	float    x;
 	float    y;
 	float    z;
-	/* Validity tag, replacing the old uint8_t gFlags plus its 3 bytes of
-	 * tail padding.  The struct stays 16 bytes, so the 256 MB allocation
-	 * does not grow.
+	/* Packed screen position, (uint16_t)sy << 16 | (uint16_t)sx. */
+	uint32_t key;
+	/* Validity tag:
 	 *
 	 *   0                     : empty, never written
 	 *   bit 0                 : ambiguous - two different vertices landed
-	 *                           on this cell in the same write session
-	 *   bits 1..31            : generation in which the cell was written
+	 *                           on this key in the same write session
+	 *   bits 1..31            : generation in which the slot was written
 	 *
 	 * Generations start at 1, so a zeroed (calloc'd) buffer reads as
 	 * entirely empty without a separate init pass. */
@@ -152,14 +164,17 @@ typedef struct
 #define PGXP_TAG_MAKE(gen)   (((uint32_t)(gen) << 1))
 #define PGXP_TAG_GEN(tag)    ((tag) >> 1)
 #define PGXP_TAG_AMBIGUOUS   (1u)
+#define PGXP_GEN_MAX         (0x7FFFFFFFu)
 
 const uint32_t mode_init = 0;
 const uint32_t mode_write = 1;
 const uint32_t mode_read = 2;
 const uint32_t mode_fail = 3;
 
-#define VERTEX_CACHE_DIM	(0x800 * 2)
-#define VERTEX_CACHE_SIZE	(VERTEX_CACHE_DIM * VERTEX_CACHE_DIM)
+#define VERTEX_CACHE_BITS	15
+#define VERTEX_CACHE_SLOTS	(1u << VERTEX_CACHE_BITS)
+#define VERTEX_CACHE_MASK	(VERTEX_CACHE_SLOTS - 1)
+#define VERTEX_CACHE_PROBES	16
 
 static PGXP_cache_entry *vertexCache = NULL;
 
@@ -169,20 +184,19 @@ uint32_t cacheMode = 0;
  * every read -> write transition), which is what retires the previous
  * session's entries.
  *
- * It is only ever reset to 1 alongside a fresh calloc, never on its own:
- * resetting the counter while the buffer still holds tags from earlier
- * generations would make those stale entries validate again, which is
- * exactly the bug being fixed.  31 bits at one bump per frame is over a
- * year of continuous play, so the wrap is not reachable in practice; the
- * saturating guard below makes it a permanent refusal rather than a
- * wrap-to-collision if it ever were. */
+ * It is only ever reset to 1 alongside a zeroed buffer, never on its
+ * own: resetting the counter while the buffer still holds tags from
+ * earlier generations would make those stale entries validate again,
+ * which is exactly the bug being fixed.  The table is small enough that
+ * running out of generations simply clears it and starts over. */
 static uint32_t cacheGen = 1;
 
 /* Instrumentation, mirroring the PGXP_GetColorStats idiom.  Indices:
  *   0 writes                    3 read attempts
  *   1 writes marked ambiguous   4 read hits
  *   2 writes retiring an older  5 reads refused: stale generation
- *     generation                6 reads refused: ambiguous cell
+ *     generation                6 reads refused: ambiguous key
+ *                               7 writes dropped: probe window full
  *
  * Behind PGXP_DIAG and compiled out otherwise; see pgxp_gte.h.  These
  * shipped unconditional in c478571d, which was wrong for the same reason
@@ -190,17 +204,17 @@ static uint32_t cacheGen = 1;
  * feature path, and a counter nobody reads in a shipping build has no
  * business costing anything there. */
 #if PGXP_DIAG
-static uint32_t vcache_stats[7];
+static uint32_t vcache_stats[8];
 #define VCACHE_STAT(i) (vcache_stats[i]++)
 
 #else
 #define VCACHE_STAT(i) ((void)0)
 #endif
 
-void PGXP_GetVertexCacheStats(uint32_t stats[7])
+void PGXP_GetVertexCacheStats(uint32_t stats[8])
 {
 	unsigned i;
-	for (i = 0; i < 7; i++)
+	for (i = 0; i < 8; i++)
 #if PGXP_DIAG
 		stats[i] = vcache_stats[i];
 #else
@@ -217,7 +231,7 @@ static int VertexCacheEnsureAllocated(void)
 {
 	if (vertexCache)
 		return 1;
-	vertexCache = (PGXP_cache_entry*)calloc(VERTEX_CACHE_SIZE, sizeof(PGXP_cache_entry));
+	vertexCache = (PGXP_cache_entry*)calloc(VERTEX_CACHE_SLOTS, sizeof(PGXP_cache_entry));
 	if (!vertexCache)
 		return 0;
 
@@ -244,6 +258,38 @@ void PGXP_FreeVertexCache(void)
 	cacheMode = mode_init;
 }
 
+static inline uint32_t VertexCacheKey(int16_t sx, int16_t sy)
+{
+	return ((uint32_t)(uint16_t)sy << 16) | (uint16_t)sx;
+}
+
+/* Fibonacci hashing: the multiply spreads neighbouring pixels, which is
+ * what a mesh produces, across the whole table. */
+static inline uint32_t VertexCacheHash(uint32_t key)
+{
+	return (key * 0x9E3779B1u) >> (32 - VERTEX_CACHE_BITS);
+}
+
+/* Walk the probe window of `key` and return the slot holding it in the
+ * current generation, else the first dead (empty or retired) slot, else
+ * NULL when the whole window is live with other keys.  See the block
+ * comment above for why the walk may stop at the first dead slot. */
+static PGXP_cache_entry* VertexCacheFind(uint32_t key)
+{
+	uint32_t h = VertexCacheHash(key);
+	unsigned i;
+
+	for (i = 0; i < VERTEX_CACHE_PROBES; i++)
+	{
+		PGXP_cache_entry *e = &vertexCache[(h + i) & VERTEX_CACHE_MASK];
+
+		if (PGXP_TAG_GEN(e->tag) != cacheGen || e->key == key)
+			return e;
+	}
+
+	return NULL;
+}
+
 void PGXP_CacheVertex(int16_t sx, int16_t sy, const PGXP_value* _pVertex)
 {
 	const PGXP_value*	pNewVertex = (const PGXP_value*)_pVertex;
@@ -287,30 +333,40 @@ void PGXP_CacheVertex(int16_t sx, int16_t sy, const PGXP_value* _pVertex)
 		 * many frames issues no writes in those frames, so no
 		 * generation opens and its entries stay legitimately live.
 		 * Only a fresh transform batch retires the old one. */
-		if (cacheGen < 0x7FFFFFFFu)
+		if (cacheGen < PGXP_GEN_MAX)
 			cacheGen++;
+		else
+		{
+			memset(vertexCache, 0, VERTEX_CACHE_SLOTS * sizeof(PGXP_cache_entry));
+			cacheGen = 1;
+		}
 		cacheMode = mode_write;
 	}
 
 	if (sx >= -0x800 && sx <= 0x7ff &&
 		sy >= -0x800 && sy <= 0x7ff)
 	{
-		uint32_t tag = PGXP_TAG_MAKE(cacheGen);
-
-		pOldVertex = &vertexCache[(sy + 0x800) * VERTEX_CACHE_DIM + (sx + 0x800)];
+		uint32_t key = VertexCacheKey(sx, sy);
 
 		VCACHE_STAT(0);
 
+		pOldVertex = VertexCacheFind(key);
+		if (!pOldVertex)
+		{
+			VCACHE_STAT(7);
+			return;
+		}
+
 		if (PGXP_TAG_GEN(pOldVertex->tag) == cacheGen)
 		{
-			/* Something already claimed this cell this generation.
+			/* Something already claimed this key this generation.
 			 * If it is bit-identical the game simply transformed the
 			 * same vertex twice (RTPT overlap, a redundant RTPS) and
 			 * there is nothing ambiguous about it - the transform is
 			 * deterministic, so equal inputs give equal bits and an
 			 * exact compare is the right test.  Otherwise two
 			 * distinct vertices project to the same pixel and the
-			 * cell can no longer answer for either of them. */
+			 * key can no longer answer for either of them. */
 			if (pOldVertex->x != pNewVertex->x ||
 			    pOldVertex->y != pNewVertex->y ||
 			    pOldVertex->z != pNewVertex->z)
@@ -332,7 +388,8 @@ void PGXP_CacheVertex(int16_t sx, int16_t sy, const PGXP_value* _pVertex)
 		pOldVertex->x   = pNewVertex->x;
 		pOldVertex->y   = pNewVertex->y;
 		pOldVertex->z   = pNewVertex->z;
-		pOldVertex->tag = tag;
+		pOldVertex->key = key;
+		pOldVertex->tag = PGXP_TAG_MAKE(cacheGen);
 	}
 }
 
@@ -360,7 +417,8 @@ static PGXP_cache_entry* PGXP_GetCachedVertex(int16_t sx, int16_t sy)
 	if (sx >= -0x800 && sx <= 0x7ff &&
 		sy >= -0x800 && sy <= 0x7ff)
 	{
-		PGXP_cache_entry *e = &vertexCache[(sy + 0x800) * VERTEX_CACHE_DIM + (sx + 0x800)];
+		uint32_t          key = VertexCacheKey(sx, sy);
+		PGXP_cache_entry *e   = VertexCacheFind(key);
 
 		VCACHE_STAT(3);
 
@@ -369,12 +427,16 @@ static PGXP_cache_entry* PGXP_GetCachedVertex(int16_t sx, int16_t sy)
 		 * itself, which is the kind of check that gets dropped when a
 		 * second consumer is added; returning NULL for anything we
 		 * will not stand behind makes the refusal unskippable. */
-		if (e->tag == 0)
+		if (!e || e->tag == 0)
 			return NULL;                       /* never written */
 
 		if (PGXP_TAG_GEN(e->tag) != cacheGen)
 		{
-			VCACHE_STAT(5);                 /* retired generation */
+			/* The walk stopped on a dead slot.  It only counts as a
+			 * stale refusal when that slot last held this very key;
+			 * otherwise the key was simply not written. */
+			if (e->key == key)
+				VCACHE_STAT(5);         /* retired generation */
 			return NULL;
 		}
 
@@ -57,12 +57,14 @@ extern "C" {
 	 *   0 writes                    3 read attempts
 	 *   1 writes marked ambiguous   4 read hits
 	 *   2 writes retiring an older  5 reads refused: stale generation
-	 *     generation                6 reads refused: ambiguous cell
+	 *     generation                6 reads refused: ambiguous key
+	 *                               7 writes dropped: probe window full
 	 * Counters are zeroed when the cache is (re)allocated.  [1], [5] and
 	 * [6] are the false positives this cache used to answer with a wrong
 	 * vertex and now declines; [4]/[3] is the hit rate those refusals are
-	 * paid for out of. */
-	void	PGXP_GetVertexCacheStats(uint32_t stats[7]);
+	 * paid for out of.  [7] should stay at zero; if it does not, the hash
+	 * table is too small for the title. */
+	void	PGXP_GetVertexCacheStats(uint32_t stats[8]);
 
 	void	PGXP_SetAddress(uint32_t addr);
 	int		PGXP_GetVertices(const uint32_t* addr, void* pOutput, int xOffs, int yOffs);
@@ -398,7 +398,7 @@ void PGXP_GetTransformStats(uint64_t stats[3])
 void PGXP_DiagDump(void)
 {
 	static int   diag_state = -1;
-	uint32_t     vc[7];
+	uint32_t     vc[8];
 	double       sat_pct;
 
 	if (diag_state < 0)
@@ -425,8 +425,8 @@ void PGXP_DiagDump(void)
 	PGXP_GetVertexCacheStats(vc);
 	if (vc[0] || vc[3])
 		log_cb(RETRO_LOG_INFO,
-			"[pgxp_diag] vcache w=%u amb=%u retired=%u | r=%u hit=%u stale=%u ambref=%u\n",
-			vc[0], vc[1], vc[2], vc[3], vc[4], vc[5], vc[6]);
+			"[pgxp_diag] vcache w=%u amb=%u retired=%u dropped=%u | r=%u hit=%u stale=%u ambref=%u\n",
+			vc[0], vc[1], vc[2], vc[7], vc[3], vc[4], vc[5], vc[6]);
 }
 
 #endif /* PGXP_DIAG */
@@ -23,6 +23,7 @@ void PGXP_Shutdown(void)
 {
 	gMode = 0;
 	PGXP_FreeVertexCache();
+	PGXP_FreeMem();
 }
 
 /* Apply a mode transition.  If the PGXP_VERTEX_CACHE bit is being
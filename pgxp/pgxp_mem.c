@@ -1,93 +1,111 @@
+#include <stdlib.h>
 #include <string.h>
 
+#include <memalign.h>
+
 #include "pgxp_mem.h"
 #include "pgxp_cpu.h"
 #include "pgxp_gte.h"
 #include "pgxp_value.h"
 
-/* The PGXP shadow of PSX memory.  Previously a single
- * `Mem[3 * 2048 * 1024 / 4]` array of PGXP_value (42 MB) carved into
- * three equal 524288-entry slots, of which only:
- *   - the 524288-entry User RAM slot was actually filled,
- *   - the second slot needed 256 entries (1 KB scratch / 4 bytes),
- *   - the third slot needed 2048 entries (8 KB hardware regs / 4 bytes).
- * That left ~27 MB of unused PGXP_value in the middle and tail of
- * the buffer.  Splitting into three right-sized arrays drops the
- * static BSS from 42 MB to about 14.4 MB without changing the
- * external (u32) contract of PGXP_ConvertAddress.  The offset
- * constants are kept so callers that print or compare with
- * InvalidAddress continue to work, but the offsets are now packed
- * back-to-back instead of on 524288-entry strides. */
+/* The PGXP shadow of PSX memory: one PGXP_value per guest word of
+ * User RAM (524288 words), scratchpad (256) and hardware registers
+ * (2048), packed back-to-back into one index space so the external
+ * (u32) contract of PGXP_ConvertAddress stays what callers print and
+ * compare against InvalidAddress. */
 #define USER_MEM_COUNT		(2048 * 1024 / 4)	/* 524288 entries: 2 MB / 4 */
 #define SCRATCH_MEM_COUNT	(1024 / 4)		/* 256 entries: 1 KB / 4 */
 #define REGISTER_MEM_COUNT	(0x2000 / 4)		/* 2048 entries: 8 KB / 4 */
 
-static PGXP_value UserMem[USER_MEM_COUNT];
-static PGXP_value ScratchMem[SCRATCH_MEM_COUNT];
-static PGXP_value RegisterMem[REGISTER_MEM_COUNT];
-
 #define PGXP_MEM_TOTAL (USER_MEM_COUNT + SCRATCH_MEM_COUNT + REGISTER_MEM_COUNT)
 
-/* One-way "ever PGXP-written" bitmap over the packed address space,
- * one bit per shadow word (~64 KB total, L2-resident).
+/* Storage is paged, and each entry has one cache line to itself.
+ *
+ * By page: the shadow used to be a static 14.4 MB array of 28-byte
+ * entries, of which a typical game ever writes a few pages - stack,
+ * vertex scratch, the display-list staging area. It is now a table of
+ * pages of 1024 entries (one 4 KB page of guest RAM each), allocated
+ * zeroed on the first PGXP store into them. A missing page reads as
+ * what the old array held there, all zero, without touching memory
+ * at all; that replaces the one-bit-per-word "ever written" bitmap the
+ * flat array needed for the same shortcut. Pages are only released by
+ * PGXP_InitMem/PGXP_FreeMem, matching the old array's memset lifetime.
  *
- * The shadow arrays above total ~14.4 MB of 28-byte entries walked in
- * lockstep with guest loads, but for most games the overwhelming
- * majority of guest words are never stored through a PGXP-tracked
- * path: their entries stay exactly as PGXP_InitMem's memset left them
- * (all zero), and the 28-byte read on every guest load is pure L2/L3
- * traffic for a predetermined answer.  A clear bit proves the entry
- * is that memset zero, so the load path can synthesize the identical
- * result without touching the entry's cache line at all.
+ * By entry: a 28-byte PGXP_value used to straddle a cache line one
+ * time in two. Every load needs the whole of it - Validate compares
+ * the guest value, and the count and the per-half flags travel with
+ * the coordinates - so entries are padded to 32 bytes in 32-byte
+ * aligned pages, and a load touches exactly one line.
  *
- * Invariants that make this bit-exact rather than approximate:
- *   - The ONLY mutation paths into the arrays are WriteMem and
- *     WriteMem16 (InvalidStore funnels through WriteMem; ReadMem /
- *     GetPtr consumers in pgxp_cpu.c are read-only), and both set
- *     the bit before writing.
- *   - Validate()/MaskValidate() on an all-zero entry are no-ops
- *     (flags &= x on flags == 0), so the skipped array access could
- *     never have changed the entry either.
- *   - The bit is never cleared except by PGXP_InitMem, matching the
- *     lifetime of the memset.  Entries that were written once keep
- *     taking the full path even after invalidation - conservative,
- *     but the touched set (stack, vertex scratch) stays small.
  * PGXP state is not serialised in savestates, so there is nothing to
  * version. */
-static uint32_t MemEverWritten[(PGXP_MEM_TOTAL + 31) / 32];
+#define PGXP_MEM_PAGE_SHIFT	10
+#define PGXP_MEM_PAGE_SIZE	(1 << PGXP_MEM_PAGE_SHIFT)
+#define PGXP_MEM_PAGES		((PGXP_MEM_TOTAL + PGXP_MEM_PAGE_SIZE - 1) >> PGXP_MEM_PAGE_SHIFT)
+
+#define PGXP_MEM_ENTRY_SIZE	32
+
+typedef union
+{
+	PGXP_value	v;
+	uint8_t		pad[PGXP_MEM_ENTRY_SIZE];
+} PGXP_mem_entry;
+
+typedef struct
+{
+	PGXP_mem_entry	e[PGXP_MEM_PAGE_SIZE];
+} PGXP_mem_page;
+
+static PGXP_mem_page* MemPages[PGXP_MEM_PAGES];
 
 const uint32_t UserMemOffset  = 0;
 const uint32_t ScratchOffset  = USER_MEM_COUNT;
 const uint32_t RegisterOffset = USER_MEM_COUNT + SCRATCH_MEM_COUNT;
 const uint32_t InvalidAddress = USER_MEM_COUNT + SCRATCH_MEM_COUNT + REGISTER_MEM_COUNT;
 
-static inline int MemBitTest(uint32_t paddr)
+/* Page holding packed address paddr, allocating it if `create`.
+ * NULL for a page never stored to (or, with `create`, one that could
+ * not be allocated - the store is then dropped, and the entry keeps
+ * reading as zero, which PGXP treats as untracked). */
+static inline PGXP_mem_page* PageFromPacked(uint32_t paddr, int create)
 {
-	return (MemEverWritten[paddr >> 5] >> (paddr & 31)) & 1;
+	PGXP_mem_page* page = MemPages[paddr >> PGXP_MEM_PAGE_SHIFT];
+
+	if (!page && create)
+	{
+		page = (PGXP_mem_page*)memalign_alloc(PGXP_MEM_ENTRY_SIZE,
+				sizeof(PGXP_mem_page));
+		if (page)
+			memset(page, 0, sizeof(PGXP_mem_page));
+		MemPages[paddr >> PGXP_MEM_PAGE_SHIFT] = page;
+	}
+	return page;
+}
+
+static inline void MemLoad(const PGXP_mem_page* page, uint32_t i, PGXP_value* v)
+{
+	*v = page->e[i].v;
 }
 
-static inline void MemBitSet(uint32_t paddr)
+static inline void MemStore(PGXP_mem_page* page, uint32_t i, const PGXP_value* v)
 {
-	MemEverWritten[paddr >> 5] |= (uint32_t)1 << (paddr & 31);
+	page->e[i].v = *v;
 }
 
-/* Resolve an already-converted (packed) address to its entry.
- * Caller guarantees paddr < InvalidAddress. */
-static inline PGXP_value* PtrFromPacked(uint32_t paddr)
+void PGXP_FreeMem(void)
 {
-	if (paddr < ScratchOffset)
-		return &UserMem[paddr - UserMemOffset];
-	if (paddr < RegisterOffset)
-		return &ScratchMem[paddr - ScratchOffset];
-	return &RegisterMem[paddr - RegisterOffset];
+	unsigned i;
+
+	for (i = 0; i < PGXP_MEM_PAGES; i++)
+	{
+		memalign_free(MemPages[i]);
+		MemPages[i] = NULL;
+	}
 }
 
 void PGXP_InitMem()
 {
-	memset(UserMem,     0, sizeof(UserMem));
-	memset(ScratchMem,  0, sizeof(ScratchMem));
-	memset(RegisterMem, 0, sizeof(RegisterMem));
-	memset(MemEverWritten, 0, sizeof(MemEverWritten));
+	PGXP_FreeMem();
 }
 
 /*  Playstation Memory Map (from Playstation doc by Joshua Walker)
@@ -164,18 +182,20 @@ uint32_t PGXP_ConvertAddress(uint32_t addr)
 	return paddr;
 }
 
-PGXP_value* GetPtr(uint32_t addr)
+int ReadMem(PGXP_value* dest, uint32_t addr)
 {
-	addr = PGXP_ConvertAddress(addr);
+	uint32_t paddr = PGXP_ConvertAddress(addr);
+	PGXP_mem_page* page;
 
-	if (addr < InvalidAddress)
-		return PtrFromPacked(addr);
-	return NULL;
-}
+	if (paddr >= InvalidAddress)
+		return 0;
 
-PGXP_value* ReadMem(uint32_t addr)
-{
-	return GetPtr(addr);
+	page = PageFromPacked(paddr, 0);
+	if (page)
+		MemLoad(page, paddr & (PGXP_MEM_PAGE_SIZE - 1), dest);
+	else
+		memset(dest, 0, sizeof(*dest));
+	return 1;
 }
 
 void ValidateAndCopyMem(PGXP_value* dest, uint32_t addr, uint32_t value)
@@ -183,21 +203,21 @@ void ValidateAndCopyMem(PGXP_value* dest, uint32_t addr, uint32_t value)
 	uint32_t paddr = PGXP_ConvertAddress(addr);
 	if (paddr < InvalidAddress)
 	{
-		PGXP_value* pMem;
+		PGXP_mem_page* page = PageFromPacked(paddr, 0);
+		uint32_t i = paddr & (PGXP_MEM_PAGE_SIZE - 1);
 
-		if (!MemBitTest(paddr))
+		if (!page)
 		{
-			/* Entry is provably the InitMem memset zero: Validate()
-			 * on a zero entry is a no-op and the copy would yield
-			 * all-zero.  Synthesize that without touching the
-			 * entry's cache line. */
+			/* Never-stored page: every entry is zero, Validate() on
+			 * a zero entry is a no-op and the copy would yield all
+			 * zero.  Synthesize that without touching memory. */
 			memset(dest, 0, sizeof(*dest));
 			return;
 		}
 
-		pMem = PtrFromPacked(paddr);
-		Validate(pMem, value);
-		*dest = *pMem;
+		/* Validate() in place: only the flags can change. */
+		Validate(&page->e[i].v, value);
+		MemLoad(page, i, dest);
 		return;
 	}
 
@@ -208,29 +228,22 @@ void ValidateAndCopyMem16(PGXP_value* dest, uint32_t addr, uint32_t value, int s
 {
 	uint32_t validMask = 0;
 	psx_value val, mask;
-	PGXP_value zero_local;
-	PGXP_value* pMem = NULL;
+	PGXP_value entry;
+	PGXP_mem_page* page = NULL;
 	uint32_t paddr = PGXP_ConvertAddress(addr);
 
 	if (paddr < InvalidAddress)
 	{
-		if (!MemBitTest(paddr))
-		{
-			/* Never-written entry is the memset zero; run the
-			 * identical merge/truncate body below against a local
-			 * zero so the result is bit-for-bit what reading the
-			 * array would produce, without touching its cache
-			 * line.  MaskValidate's writeback lands in the
-			 * throwaway. */
-			memset(&zero_local, 0, sizeof(zero_local));
-			pMem = &zero_local;
-		}
+		uint32_t i = paddr & (PGXP_MEM_PAGE_SIZE - 1);
+
+		/* A never-stored page reads as the zero entry; MaskValidate's
+		 * writeback then only lands in the local copy. */
+		page = PageFromPacked(paddr, 0);
+		if (page)
+			MemLoad(page, i, &entry);
 		else
-			pMem = PtrFromPacked(paddr);
-	}
+			memset(&entry, 0, sizeof(entry));
 
-	if (pMem != NULL)
-	{
 		mask.d = val.d = 0;
 		/* determine if high or low word */
 		if ((addr % 4) == 2)
@@ -247,8 +260,10 @@ void ValidateAndCopyMem16(PGXP_value* dest, uint32_t addr, uint32_t value, int s
 		}
 
 		/* validate and copy whole value */
-		MaskValidate(pMem, val.d, mask.d, validMask);
-		*dest = *pMem;
+		MaskValidate(&entry, val.d, mask.d, validMask);
+		if (page)
+			page->e[i].v.flags = entry.flags;
+		*dest = entry;
 
 		/* if high word then shift */
 		if ((addr % 4) == 2)
@@ -275,28 +290,31 @@ void WriteMem(PGXP_value* value, uint32_t addr)
 
 	if (paddr < InvalidAddress)
 	{
-		MemBitSet(paddr);
-		*PtrFromPacked(paddr) = *value;
+		PGXP_mem_page* page = PageFromPacked(paddr, 1);
+		if (page)
+			MemStore(page, paddr & (PGXP_MEM_PAGE_SIZE - 1), value);
 	}
 }
 
 void WriteMem16(PGXP_value* src, uint32_t addr)
 {
-	PGXP_value* dest = NULL;
+	PGXP_mem_page* page = NULL;
 	uint32_t paddr = PGXP_ConvertAddress(addr);
 
 	if (paddr < InvalidAddress)
-	{
-		/* The halfword merge below reads the entry's other half, so
-		 * the bit must be set even though a never-written entry is
-		 * still all-zero at this point - reading zeros from the
-		 * array here is exactly the pre-bitmap behaviour. */
-		MemBitSet(paddr);
-		dest = PtrFromPacked(paddr);
-	}
+		page = PageFromPacked(paddr, 1);
 
-	if (dest)
+	if (page)
 	{
+		/* The halfword merge below reads the entry's other half, so it
+		 * works on a whole-entry copy that is stored back at the end. */
+		uint32_t i = paddr & (PGXP_MEM_PAGE_SIZE - 1);
+		PGXP_value entry;
+		PGXP_value* dest = &entry;
+		psx_value pVal;
+
+		MemLoad(page, i, &entry);
+
 		/* Load dest->value into a local psx_value, manipulate, store
 		 * back.  The previous code aliased dest->value (a u32) through
 		 * a psx_value pointer, which is a strict-aliasing violation
@@ -304,7 +322,6 @@ void WriteMem16(PGXP_value* src, uint32_t addr)
 		 * type rules).  The round-trip through a local is bit-exact,
 		 * defined behaviour, and the compiler optimises it identically
 		 * on every backend we ship. */
-		psx_value pVal;
 		pVal.d = dest->value;
 
 		/* determine if high or low word */
@@ -335,5 +352,7 @@ void WriteMem16(PGXP_value* src, uint32_t addr)
 
 		/*dest->valid = dest->valid && src->valid; */
 		dest->gFlags |= src->gFlags;				/* inherit flags from both values (?) */
+
+		MemStore(page, i, &entry);
 	}
 }
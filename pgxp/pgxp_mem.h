@@ -36,11 +36,13 @@ extern "C" {
 #include "pgxp_types.h"
 
    void PGXP_InitMem(void);
+   void PGXP_FreeMem(void);
 
    uint32_t		PGXP_ConvertAddress(uint32_t addr);
 
-   PGXP_value* GetPtr(uint32_t addr);
-   PGXP_value* ReadMem(uint32_t addr);
+   /* Copy the shadow of `addr` into *dest.  Returns 0, leaving *dest
+    * untouched, if `addr` has no shadow. */
+   int ReadMem(PGXP_value* dest, uint32_t addr);
 
    void ValidateAndCopyMem(PGXP_value* dest, uint32_t addr, uint32_t value);
    void ValidateAndCopyMem16(PGXP_value* dest, uint32_t addr, uint32_t value, int sign);
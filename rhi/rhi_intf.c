@@ -8,6 +8,7 @@
 
 #include "boolean.h"
 #include "libretro.h"
+#include <features/features_cpu.h>
 
 #include "beetle_psx_globals.h"
 #include "../osd_message.h"
@@ -31,6 +32,7 @@
 
 extern bool fast_pal;
 extern unsigned int image_height;
+extern retro_log_printf_t log_cb;
 
 enum rhi_renderer_type rhi_type                 = RHI_SOFTWARE;
 
@@ -61,6 +63,8 @@ static int rhi_height_mode = HEIGHT_MODE_240;
  *     covered boundary block keeps its prior state, as its uncovered pixels
  *     are not made coherent by the op.
  *   - A readback is skipped only when every block the rect touches is clean.
+ *     Otherwise the Vulkan backend copies only the dirty blocks' runs
+ *     (tt_coh_dirty_rects), all in one command buffer behind one fence.
  *
  * Default state is dirty (zero-init), and rhi_intf_open() re-dirties on every
  * renderer (re)creation, so the first read of any region always reads back.
@@ -68,15 +72,10 @@ static int rhi_height_mode = HEIGHT_MODE_240;
  * over 250k randomized op sequences incl. VRAM wrap, sub-block writes/reads,
  * and draw-area superset marking of scissor-clipped primitives.
  * ---------------------------------------------------------------------- */
-#define TT_COH_VRAM_W 1024
-#define TT_COH_VRAM_H 512
-#define TT_COH_SH     3
-#define TT_COH_BW     (TT_COH_VRAM_W >> TT_COH_SH)   /* 128 block columns */
-#define TT_COH_BH     (TT_COH_VRAM_H >> TT_COH_SH)   /* 64  block rows    */
+#include "rhi_vram_coh.h"
 
 static bool     tt_coh_skip_enabled = true;
 static bool     tt_coh_da_pending   = true;  /* re-mark draw area on next primitive */
-static uint8_t  tt_coh_clean[TT_COH_BH * TT_COH_BW]; /* 0=dirty (default), 1=clean */
 static uint16_t tt_coh_dax, tt_coh_day, tt_coh_daw, tt_coh_dah; /* draw area x,y,w,h */
 
 static void tt_coh_reset(void)
@@ -87,60 +86,6 @@ static void tt_coh_reset(void)
    tt_coh_da_pending = true;
 }
 
-/* DIRTY: every block the rect OVERLAPS (conservative superset). */
-static void tt_coh_dirty(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
-{
-   uint32_t bx0, by0, nbx, nby, kx, ky;
-   if (!w || !h)
-      return;
-   bx0 = (x & (TT_COH_VRAM_W - 1)) >> TT_COH_SH;
-   by0 = (y & (TT_COH_VRAM_H - 1)) >> TT_COH_SH;
-   nbx = ((x & 7) + w + 7) >> TT_COH_SH; if (nbx > TT_COH_BW) nbx = TT_COH_BW;
-   nby = ((y & 7) + h + 7) >> TT_COH_SH; if (nby > TT_COH_BH) nby = TT_COH_BH;
-   for (ky = 0; ky < nby; ky++)
-      for (kx = 0; kx < nbx; kx++)
-         tt_coh_clean[((by0 + ky) & (TT_COH_BH - 1)) * TT_COH_BW
-                    + ((bx0 + kx) & (TT_COH_BW - 1))] = 0;
-}
-
-/* CLEAN: only blocks FULLY CONTAINED in the rect (subset). */
-static void tt_coh_clean_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
-{
-   uint32_t cb0, cb1, rb0, rb1, sc, sr, bc, br;
-   if (w < 8 || h < 8)
-      return;
-   cb0 = (x + 7) >> TT_COH_SH;   /* first fully covered col (unwrapped) */
-   cb1 = (x + w) >> TT_COH_SH;   /* one past last fully covered col     */
-   rb0 = (y + 7) >> TT_COH_SH;
-   rb1 = (y + h) >> TT_COH_SH;
-   if (cb1 <= cb0 || rb1 <= rb0)
-      return;
-   sc = cb1 - cb0; if (sc > TT_COH_BW) sc = TT_COH_BW;
-   sr = rb1 - rb0; if (sr > TT_COH_BH) sr = TT_COH_BH;
-   for (br = 0; br < sr; br++)
-      for (bc = 0; bc < sc; bc++)
-         tt_coh_clean[((rb0 + br) & (TT_COH_BH - 1)) * TT_COH_BW
-                    + ((cb0 + bc) & (TT_COH_BW - 1))] = 1;
-}
-
-/* True iff every block the rect touches is clean (=> whole rect coherent). */
-static bool tt_coh_all_clean(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
-{
-   uint32_t bx0, by0, nbx, nby, kx, ky;
-   if (!w || !h)
-      return true;
-   bx0 = (x & (TT_COH_VRAM_W - 1)) >> TT_COH_SH;
-   by0 = (y & (TT_COH_VRAM_H - 1)) >> TT_COH_SH;
-   nbx = ((x & 7) + w + 7) >> TT_COH_SH; if (nbx > TT_COH_BW) nbx = TT_COH_BW;
-   nby = ((y & 7) + h + 7) >> TT_COH_SH; if (nby > TT_COH_BH) nby = TT_COH_BH;
-   for (ky = 0; ky < nby; ky++)
-      for (kx = 0; kx < nbx; kx++)
-         if (!tt_coh_clean[((by0 + ky) & (TT_COH_BH - 1)) * TT_COH_BW
-                         + ((bx0 + kx) & (TT_COH_BW - 1))])
-            return false;
-   return true;
-}
-
 /* Re-mark the whole draw area dirty, but only when it may have changed
  * (set_draw_area) or a clean op cleaned part of it since the last mark.
  * Primitives are scissor-clipped to the draw area, so this stays a superset
@@ -155,6 +100,30 @@ static void tt_coh_mark_draw_area(void)
    }
 }
 
+/* Ring length for rhi_intf_snapshot_vram, from the core option; 0 keeps
+ * every save on the readback path. */
+static unsigned rhi_vram_snap_slots;
+/* Last id handed out.  Seeded from the clock on first use so that an id
+ * read from a state saved by an earlier run is unlikely to name a live
+ * snapshot of this one. */
+static uint32_t rhi_vram_snap_seq;
+static bool     rhi_vram_snap_warned;
+
+static void rhi_vram_snap_read_option(void)
+{
+   struct retro_variable var = {0};
+
+   rhi_vram_snap_slots = 0;
+   var.key             = BEETLE_OPT(gpu_vram_snapshots);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value
+         && strcmp(var.value, "disabled"))
+   {
+      rhi_vram_snap_slots = strtoul(var.value, NULL, 10);
+      if (rhi_vram_snap_slots > RHI_VRAM_SNAPSHOTS_MAX)
+         rhi_vram_snap_slots = RHI_VRAM_SNAPSHOTS_MAX;
+   }
+}
+
 static bool rhi_soft_open(bool is_pal)
 {
    content_is_pal = is_pal;
@@ -294,6 +263,7 @@ bool rhi_intf_open(bool is_pal, bool force_software)
    gl_initialized            = false;
 
    tt_coh_reset();
+   rhi_vram_snap_read_option();
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES) || defined(HAVE_VULKAN)
    struct retro_variable var = {0};
@@ -449,6 +419,8 @@ void rhi_intf_close(void)
 
 void rhi_intf_refresh_variables(void)
 {
+   rhi_vram_snap_read_option();
+
    switch (rhi_type)
    {
       case RHI_SOFTWARE:
@@ -959,7 +931,25 @@ bool rhi_intf_read_vram(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t
    {
       case RHI_VULKAN:
 #if defined(HAVE_VULKAN)
-         ret = rhi_vulkan_read_vram(x, y, w, h, vram);
+         {
+            /* Only the dirty blocks need the GPU's copy; the clean ones
+             * already match it in g->vram.  A HUD drawn over an otherwise
+             * CPU-uploaded 320x240 region then costs a few small copy
+             * regions instead of the whole rect. */
+            struct rhi_vram_rect whole;
+            struct rhi_vram_rect runs[RHI_READBACK_MAX_RECTS];
+            int n = tt_coh_skip_enabled
+               ? tt_coh_dirty_rects(x, y, w, h, runs) : -1;
+
+            whole.x = x;
+            whole.y = y;
+            whole.w = w;
+            whole.h = h;
+            if (n > 0 && !(n == 1 && runs[0].w == w && runs[0].h == h))
+               ret = rhi_vulkan_read_vram_rects(&whole, runs, (unsigned)n, vram);
+            else
+               ret = rhi_vulkan_read_vram(x, y, w, h, vram);
+         }
 #endif
          break;
       case RHI_OPENGL:
@@ -981,6 +971,80 @@ bool rhi_intf_read_vram(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t
    return ret;
 }
 
+uint32_t rhi_intf_snapshot_vram(void)
+{
+   bool ok = false;
+
+   if (!rhi_vram_snap_slots || rhi_intf_has_software_renderer())
+      return 0;
+
+   if (!rhi_vram_snap_seq)
+      rhi_vram_snap_seq = (uint32_t)cpu_features_get_time_usec();
+   if (!++rhi_vram_snap_seq)
+      rhi_vram_snap_seq = 1;
+
+   switch (rhi_type)
+   {
+      case RHI_OPENGL:
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+         ok = rhi_gl_snapshot_vram(rhi_vram_snap_seq, rhi_vram_snap_slots);
+#endif
+         break;
+      case RHI_VULKAN:
+#if defined(HAVE_VULKAN)
+         ok = rhi_vulkan_snapshot_vram(rhi_vram_snap_seq, rhi_vram_snap_slots);
+#endif
+         break;
+      default:
+         break;
+   }
+
+   return ok ? rhi_vram_snap_seq : 0;
+}
+
+bool rhi_intf_restore_vram(uint32_t id, uint16_t *vram)
+{
+   bool ok = false;
+
+   if (!id)
+      return false;
+
+   switch (rhi_type)
+   {
+      case RHI_OPENGL:
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+         ok = rhi_gl_restore_vram(id, vram);
+#endif
+         break;
+      case RHI_VULKAN:
+#if defined(HAVE_VULKAN)
+         ok = rhi_vulkan_restore_vram(id, vram);
+#endif
+         break;
+      default:
+         break;
+   }
+
+   if (!ok)
+   {
+      /* The state's CPU copy is only coherent where the game last read
+       * back or uploaded, so whatever was rendered since shows stale
+       * until it is drawn again.  Say so once rather than every load. */
+      if (!rhi_vram_snap_warned && log_cb)
+         log_cb(RETRO_LOG_WARN, "[RHI] VRAM snapshot %u is no longer on the GPU "
+               "(renderer recreated, or state older than the snapshot ring); "
+               "restoring the state's CPU copy.\n", (unsigned)id);
+      rhi_vram_snap_warned = true;
+      return false;
+   }
+
+   /* g->vram now holds the state's CPU copy, which is no more coherent
+    * with the restored GPU image than it was at save time - and how
+    * coherent that was is not saved.  Assume nothing. */
+   tt_coh_reset();
+   return true;
+}
+
 void rhi_intf_load_image(uint16_t x, uint16_t y,
       uint16_t w, uint16_t h,
       uint16_t *vram, bool mask_test, bool set_mask)
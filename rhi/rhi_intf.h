@@ -153,10 +153,44 @@ void rhi_intf_load_image(uint16_t x, uint16_t y,
                          bool mask_test,
                          bool set_mask);
 
+/* A VRAM rectangle in 16bpp VRAM pixels.  x + w and y + h may run past
+ * the VRAM edge; the rect then wraps like the GPU's own accesses. */
+struct rhi_vram_rect
+{
+   uint16_t x, y, w, h;
+};
+
+/* Most rects a partial readback is split into; a dirty area that needs
+ * more is read back whole. */
+#define RHI_READBACK_MAX_RECTS 32
+
 bool rhi_intf_read_vram(uint16_t x, uint16_t y,
                         uint16_t w, uint16_t h,
                         uint16_t *vram);
 
+/* GPU-side VRAM snapshots for in-memory savestates.
+ *
+ * Saving a state under a pure hardware renderer used to read the whole
+ * framebuffer back to GPU.vram first, a blocking GPU->CPU sync on every
+ * run-ahead / preemptive-frames / rollback serialize.  For states that
+ * never leave the process (the frontend's fast-savestate flag), the
+ * backend can instead copy its VRAM image into one of a small ring of
+ * GPU images and hand back an id, which the state stores in place of
+ * the pixels; loading the state copies that image back, again without
+ * the CPU seeing a pixel.
+ *
+ * rhi_intf_snapshot_vram returns 0 when no snapshot was taken (option
+ * off, software renderer or software framebuffer, backend failure);
+ * the caller then reads VRAM back as before.  rhi_intf_restore_vram
+ * returns false when the id is 0 or has left the ring (the renderer
+ * was recreated, or the state is older than the ring is long); the
+ * caller then uploads the state's CPU copy.  `vram` is that copy, for
+ * the HD texture tracker, which sees a restore as a full upload. */
+#define RHI_VRAM_SNAPSHOTS_MAX 8
+
+uint32_t rhi_intf_snapshot_vram(void);
+bool rhi_intf_restore_vram(uint32_t id, uint16_t *vram);
+
 void rhi_intf_fill_rect(uint32_t color,
                         uint16_t x, uint16_t y,
                         uint16_t w, uint16_t h);
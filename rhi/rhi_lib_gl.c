@@ -1045,6 +1045,15 @@ struct gl_renderer {
       struct gl_vram_sync_tile tiles
             [GL_VRAM_SYNC_TILES_Y][GL_VRAM_SYNC_TILES_X];
    } vram_sync;
+
+   /* Ring of fb_out copies for in-memory savestates, see
+    * rhi_gl_snapshot_vram. Textures are created on first use;
+    * vram_snap_id[i] is 0 while slot i holds nothing. */
+   gl_texture vram_snap[RHI_VRAM_SNAPSHOTS_MAX];
+   uint32_t   vram_snap_id[RHI_VRAM_SNAPSHOTS_MAX];
+   unsigned   vram_snap_next;
+   /* Internal format fb_out was created with, for the copies above */
+   GLenum     fb_out_storage;
 };
 typedef struct gl_renderer gl_renderer;
 
@@ -3450,6 +3459,7 @@ static bool gl_renderer_new(gl_renderer *renderer, gl_draw_config config)
    if (renderer->fb_out_fp16)
       texture_storage = GL_RGBA16F;
 
+   renderer->fb_out_storage = texture_storage;
    gl_texture_init(
          &renderer->fb_out,
          native_width  * upscaling,
@@ -4415,6 +4425,20 @@ static void gl_renderer_free(gl_renderer *renderer)
    renderer->fb_out_depth.width  = 0;
    renderer->fb_out_depth.height = 0;
 
+   {
+      unsigned i;
+      for (i = 0; i < RHI_VRAM_SNAPSHOTS_MAX; i++)
+      {
+         if (renderer->vram_snap[i].id)
+            glDeleteTextures(1, &renderer->vram_snap[i].id);
+         renderer->vram_snap[i].id     = 0;
+         renderer->vram_snap[i].width  = 0;
+         renderer->vram_snap[i].height = 0;
+         renderer->vram_snap_id[i]     = 0;
+      }
+      renderer->vram_snap_next = 0;
+   }
+
    /* Shared HD texture replacement/tracking teardown. The tracker
     * releases every TTGpuImage it holds through the GL backend, so this
     * must run while the context is still current (it is: we're called
@@ -7734,8 +7758,162 @@ static void gl_mirror_fb_out_to_fb_texture(gl_renderer *renderer,
    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 }
+
+/* Same-size copy of one fb_out-shaped texture into another, for the
+ * savestate snapshot ring below. Binds and unbinds like the mirror
+ * above. */
+static void gl_vram_snap_copy(gl_renderer *renderer,
+      const gl_texture *dst, const gl_texture *src)
+{
+   GLboolean scissor_was_enabled = glIsEnabled(GL_SCISSOR_TEST);
+
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->vram_sync_read_fbo);
+#ifdef HAVE_OPENGLES3
+   glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
+         GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, src->id, 0);
+#else
+   glFramebufferTexture(GL_READ_FRAMEBUFFER,
+         GL_COLOR_ATTACHMENT0, src->id, 0);
+#endif
+   glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->vram_sync_draw_fbo);
+#ifdef HAVE_OPENGLES3
+   glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER,
+         GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dst->id, 0);
+#else
+   glFramebufferTexture(GL_DRAW_FRAMEBUFFER,
+         GL_COLOR_ATTACHMENT0, dst->id, 0);
+#endif
+
+   if (scissor_was_enabled)
+      glDisable(GL_SCISSOR_TEST);
+
+   gl_caps.fp_glBlitFramebuffer(
+         0, 0, (GLint) src->width, (GLint) src->height,
+         0, 0, (GLint) dst->width, (GLint) dst->height,
+         GL_COLOR_BUFFER_BIT,
+         GL_NEAREST);
+
+   if (scissor_was_enabled)
+      glEnable(GL_SCISSOR_TEST);
+
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
 #endif /* GL_READ_FRAMEBUFFER */
 
+/* In-memory savestates (run-ahead, preemptive frames, rollback) keep
+ * their VRAM here instead of reading fb_out back: the snapshot is a
+ * copy of fb_out at internal resolution, so a restore also keeps the
+ * upscaled detail that the 1x readback-and-upload path flattens.
+ * fb_texture is not copied; a restore re-derives it from fb_out with
+ * the usual mirror blit, which is what the upload path leaves behind
+ * too (fb_texture equal to fb_out at 1x, everything in sync). */
+bool rhi_gl_snapshot_vram(uint32_t id, unsigned slots)
+{
+#ifdef GL_READ_FRAMEBUFFER
+   gl_renderer *renderer;
+   gl_texture  *snap;
+   unsigned     slot;
+
+   if (static_renderer.state == GL_STATE_INVALID)
+      return false;
+   renderer = static_renderer.state_data;
+   if (!renderer || !slots || !gl_caps.fp_glBlitFramebuffer)
+      return false;
+   if (slots > RHI_VRAM_SNAPSHOTS_MAX)
+      slots = RHI_VRAM_SNAPSHOTS_MAX;
+
+   gl_normalize_inherited_state();
+
+   if (!gl_draw_buffer_is_empty(renderer->command_buffer))
+      gl_renderer_draw(renderer);
+
+   /* The ring was shortened: drop what no longer fits. */
+   for (slot = slots; slot < RHI_VRAM_SNAPSHOTS_MAX; slot++)
+   {
+      if (renderer->vram_snap[slot].id)
+         glDeleteTextures(1, &renderer->vram_snap[slot].id);
+      renderer->vram_snap[slot].id = 0;
+      renderer->vram_snap_id[slot] = 0;
+   }
+
+   slot                     = renderer->vram_snap_next % slots;
+   renderer->vram_snap_next = slot + 1;
+   snap                     = &renderer->vram_snap[slot];
+
+   if (!snap->id)
+      gl_texture_init(snap,
+            renderer->fb_out.width,
+            renderer->fb_out.height,
+            renderer->fb_out_storage);
+
+   gl_vram_snap_copy(renderer, snap, &renderer->fb_out);
+   renderer->vram_snap_id[slot] = id;
+
+#ifdef DEBUG
+   get_error("rhi_gl_snapshot_vram");
+#endif
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool rhi_gl_restore_vram(uint32_t id, uint16_t *vram)
+{
+#ifdef GL_READ_FRAMEBUFFER
+   gl_renderer *renderer;
+   unsigned     slot;
+
+   if (static_renderer.state == GL_STATE_INVALID)
+      return false;
+   renderer = static_renderer.state_data;
+   if (!renderer || !gl_caps.fp_glBlitFramebuffer)
+      return false;
+
+   for (slot = 0; slot < RHI_VRAM_SNAPSHOTS_MAX; slot++)
+      if (renderer->vram_snap_id[slot] == id && renderer->vram_snap[slot].id)
+         break;
+   if (slot == RHI_VRAM_SNAPSHOTS_MAX)
+      return false;
+
+   gl_normalize_inherited_state();
+
+   if (!gl_draw_buffer_is_empty(renderer->command_buffer))
+      gl_renderer_draw(renderer);
+
+   /* What the full-VRAM upload this replaces would leave behind. */
+   renderer->set_mask   = false;
+   renderer->force_mask = false;
+   renderer->mask_test  = false;
+
+   if (renderer->tracker && renderer->texture_tracking_enabled)
+   {
+      TTRect _ntu_rect;
+      _ntu_rect.x = 0; _ntu_rect.y = 0;
+      _ntu_rect.width = VRAM_WIDTH_PIXELS; _ntu_rect.height = VRAM_HEIGHT;
+      texture_tracker_upload(renderer->tracker, _ntu_rect, vram);
+   }
+
+   gl_vram_snap_copy(renderer, &renderer->fb_out, &renderer->vram_snap[slot]);
+   gl_mirror_fb_out_to_fb_texture(renderer, 0, 0,
+         VRAM_WIDTH_PIXELS, VRAM_HEIGHT, false);
+   gl_vram_sync_clean_rect(renderer, 0, 0, VRAM_WIDTH_PIXELS, VRAM_HEIGHT);
+   gl_vram_sync_update_gpu_written_rect(renderer,
+         0, 0, VRAM_WIDTH_PIXELS, VRAM_HEIGHT, false);
+
+#ifdef DEBUG
+   get_error("rhi_gl_restore_vram");
+#endif
+   return true;
+#else
+   (void)vram;
+   return false;
+#endif
+}
+
 
 void rhi_gl_fill_rect(
       uint32_t color,
@@ -101,6 +101,11 @@ bool rhi_gl_read_vram(uint16_t x, uint16_t y,
                       uint16_t w, uint16_t h,
                       uint16_t *vram);
 
+/* See rhi_intf_snapshot_vram.  `slots` (at most RHI_VRAM_SNAPSHOTS_MAX)
+ * is the ring length; snapshots live as long as the renderer. */
+bool rhi_gl_snapshot_vram(uint32_t id, unsigned slots);
+bool rhi_gl_restore_vram(uint32_t id, uint16_t *vram);
+
 void rhi_gl_fill_rect(uint32_t color,
                       uint16_t x, uint16_t y,
                       uint16_t w, uint16_t h);
@@ -94,15 +94,18 @@ extern PFN_vkCmdClearColorImage vkCmdClearColorImage;
 extern PFN_vkCmdClearDepthStencilImage vkCmdClearDepthStencilImage;
 extern PFN_vkCmdCopyBuffer vkCmdCopyBuffer;
 extern PFN_vkCmdCopyBufferToImage vkCmdCopyBufferToImage;
+extern PFN_vkCmdCopyImage vkCmdCopyImage;
 extern PFN_vkCmdCopyImageToBuffer vkCmdCopyImageToBuffer;
 extern PFN_vkCmdDispatch vkCmdDispatch;
 extern PFN_vkCmdDraw vkCmdDraw;
 extern PFN_vkCmdEndRenderPass vkCmdEndRenderPass;
 extern PFN_vkCmdPipelineBarrier vkCmdPipelineBarrier;
 extern PFN_vkCmdPushConstants vkCmdPushConstants;
+extern PFN_vkCmdResetQueryPool vkCmdResetQueryPool;
 extern PFN_vkCmdResolveImage vkCmdResolveImage;
 extern PFN_vkCmdSetScissor vkCmdSetScissor;
 extern PFN_vkCmdSetViewport vkCmdSetViewport;
+extern PFN_vkCmdWriteTimestamp vkCmdWriteTimestamp;
 extern PFN_vkCreateBuffer vkCreateBuffer;
 extern PFN_vkCreateBufferView vkCreateBufferView;
 extern PFN_vkCreateCommandPool vkCreateCommandPool;
@@ -116,6 +119,7 @@ extern PFN_vkCreateGraphicsPipelines vkCreateGraphicsPipelines;
 extern PFN_vkCreateImage vkCreateImage;
 extern PFN_vkCreateImageView vkCreateImageView;
 extern PFN_vkCreatePipelineLayout vkCreatePipelineLayout;
+extern PFN_vkCreateQueryPool vkCreateQueryPool;
 extern PFN_vkCreateRenderPass vkCreateRenderPass;
 extern PFN_vkCreateSampler vkCreateSampler;
 extern PFN_vkCreateSemaphore vkCreateSemaphore;
@@ -132,6 +136,7 @@ extern PFN_vkDestroyImage vkDestroyImage;
 extern PFN_vkDestroyImageView vkDestroyImageView;
 extern PFN_vkDestroyPipeline vkDestroyPipeline;
 extern PFN_vkDestroyPipelineLayout vkDestroyPipelineLayout;
+extern PFN_vkDestroyQueryPool vkDestroyQueryPool;
 extern PFN_vkDestroyRenderPass vkDestroyRenderPass;
 extern PFN_vkDestroySampler vkDestroySampler;
 extern PFN_vkDestroySemaphore vkDestroySemaphore;
@@ -157,6 +162,7 @@ extern PFN_vkGetPhysicalDeviceImageFormatProperties vkGetPhysicalDeviceImageForm
 extern PFN_vkGetPhysicalDeviceMemoryProperties vkGetPhysicalDeviceMemoryProperties;
 extern PFN_vkGetPhysicalDeviceProperties vkGetPhysicalDeviceProperties;
 extern PFN_vkGetPhysicalDeviceQueueFamilyProperties vkGetPhysicalDeviceQueueFamilyProperties;
+extern PFN_vkGetQueryPoolResults vkGetQueryPoolResults;
 extern PFN_vkInvalidateMappedMemoryRanges vkInvalidateMappedMemoryRanges;
 extern PFN_vkMapMemory vkMapMemory;
 extern PFN_vkQueueSubmit vkQueueSubmit;
@@ -246,15 +252,18 @@ static void volkGenLoadDevice(void* context,
    vkCmdClearDepthStencilImage = (PFN_vkCmdClearDepthStencilImage)load(context, "vkCmdClearDepthStencilImage");
    vkCmdCopyBuffer = (PFN_vkCmdCopyBuffer)load(context, "vkCmdCopyBuffer");
    vkCmdCopyBufferToImage = (PFN_vkCmdCopyBufferToImage)load(context, "vkCmdCopyBufferToImage");
+   vkCmdCopyImage = (PFN_vkCmdCopyImage)load(context, "vkCmdCopyImage");
    vkCmdCopyImageToBuffer = (PFN_vkCmdCopyImageToBuffer)load(context, "vkCmdCopyImageToBuffer");
    vkCmdDispatch = (PFN_vkCmdDispatch)load(context, "vkCmdDispatch");
    vkCmdDraw = (PFN_vkCmdDraw)load(context, "vkCmdDraw");
    vkCmdEndRenderPass = (PFN_vkCmdEndRenderPass)load(context, "vkCmdEndRenderPass");
    vkCmdPipelineBarrier = (PFN_vkCmdPipelineBarrier)load(context, "vkCmdPipelineBarrier");
    vkCmdPushConstants = (PFN_vkCmdPushConstants)load(context, "vkCmdPushConstants");
+   vkCmdResetQueryPool = (PFN_vkCmdResetQueryPool)load(context, "vkCmdResetQueryPool");
    vkCmdResolveImage = (PFN_vkCmdResolveImage)load(context, "vkCmdResolveImage");
    vkCmdSetScissor = (PFN_vkCmdSetScissor)load(context, "vkCmdSetScissor");
    vkCmdSetViewport = (PFN_vkCmdSetViewport)load(context, "vkCmdSetViewport");
+   vkCmdWriteTimestamp = (PFN_vkCmdWriteTimestamp)load(context, "vkCmdWriteTimestamp");
    vkCreateBuffer = (PFN_vkCreateBuffer)load(context, "vkCreateBuffer");
    vkCreateBufferView = (PFN_vkCreateBufferView)load(context, "vkCreateBufferView");
    vkCreateCommandPool = (PFN_vkCreateCommandPool)load(context, "vkCreateCommandPool");
@@ -267,6 +276,7 @@ static void volkGenLoadDevice(void* context,
    vkCreateImage = (PFN_vkCreateImage)load(context, "vkCreateImage");
    vkCreateImageView = (PFN_vkCreateImageView)load(context, "vkCreateImageView");
    vkCreatePipelineLayout = (PFN_vkCreatePipelineLayout)load(context, "vkCreatePipelineLayout");
+   vkCreateQueryPool = (PFN_vkCreateQueryPool)load(context, "vkCreateQueryPool");
    vkCreateRenderPass = (PFN_vkCreateRenderPass)load(context, "vkCreateRenderPass");
    vkCreateSampler = (PFN_vkCreateSampler)load(context, "vkCreateSampler");
    vkCreateSemaphore = (PFN_vkCreateSemaphore)load(context, "vkCreateSemaphore");
@@ -283,6 +293,7 @@ static void volkGenLoadDevice(void* context,
    vkDestroyImageView = (PFN_vkDestroyImageView)load(context, "vkDestroyImageView");
    vkDestroyPipeline = (PFN_vkDestroyPipeline)load(context, "vkDestroyPipeline");
    vkDestroyPipelineLayout = (PFN_vkDestroyPipelineLayout)load(context, "vkDestroyPipelineLayout");
+   vkDestroyQueryPool = (PFN_vkDestroyQueryPool)load(context, "vkDestroyQueryPool");
    vkDestroyRenderPass = (PFN_vkDestroyRenderPass)load(context, "vkDestroyRenderPass");
    vkDestroySampler = (PFN_vkDestroySampler)load(context, "vkDestroySampler");
    vkDestroySemaphore = (PFN_vkDestroySemaphore)load(context, "vkDestroySemaphore");
@@ -295,6 +306,7 @@ static void volkGenLoadDevice(void* context,
    vkGetBufferMemoryRequirements = (PFN_vkGetBufferMemoryRequirements)load(context, "vkGetBufferMemoryRequirements");
    vkGetDeviceQueue = (PFN_vkGetDeviceQueue)load(context, "vkGetDeviceQueue");
    vkGetImageMemoryRequirements = (PFN_vkGetImageMemoryRequirements)load(context, "vkGetImageMemoryRequirements");
+   vkGetQueryPoolResults = (PFN_vkGetQueryPoolResults)load(context, "vkGetQueryPoolResults");
    vkInvalidateMappedMemoryRanges = (PFN_vkInvalidateMappedMemoryRanges)load(context, "vkInvalidateMappedMemoryRanges");
    vkMapMemory = (PFN_vkMapMemory)load(context, "vkMapMemory");
    vkQueueSubmit = (PFN_vkQueueSubmit)load(context, "vkQueueSubmit");
@@ -343,15 +355,18 @@ PFN_vkCmdClearColorImage vkCmdClearColorImage;
 PFN_vkCmdClearDepthStencilImage vkCmdClearDepthStencilImage;
 PFN_vkCmdCopyBuffer vkCmdCopyBuffer;
 PFN_vkCmdCopyBufferToImage vkCmdCopyBufferToImage;
+PFN_vkCmdCopyImage vkCmdCopyImage;
 PFN_vkCmdCopyImageToBuffer vkCmdCopyImageToBuffer;
 PFN_vkCmdDispatch vkCmdDispatch;
 PFN_vkCmdDraw vkCmdDraw;
 PFN_vkCmdEndRenderPass vkCmdEndRenderPass;
 PFN_vkCmdPipelineBarrier vkCmdPipelineBarrier;
 PFN_vkCmdPushConstants vkCmdPushConstants;
+PFN_vkCmdResetQueryPool vkCmdResetQueryPool;
 PFN_vkCmdResolveImage vkCmdResolveImage;
 PFN_vkCmdSetScissor vkCmdSetScissor;
 PFN_vkCmdSetViewport vkCmdSetViewport;
+PFN_vkCmdWriteTimestamp vkCmdWriteTimestamp;
 PFN_vkCreateBuffer vkCreateBuffer;
 PFN_vkCreateBufferView vkCreateBufferView;
 PFN_vkCreateCommandPool vkCreateCommandPool;
@@ -365,6 +380,7 @@ PFN_vkCreateGraphicsPipelines vkCreateGraphicsPipelines;
 PFN_vkCreateImage vkCreateImage;
 PFN_vkCreateImageView vkCreateImageView;
 PFN_vkCreatePipelineLayout vkCreatePipelineLayout;
+PFN_vkCreateQueryPool vkCreateQueryPool;
 PFN_vkCreateRenderPass vkCreateRenderPass;
 PFN_vkCreateSampler vkCreateSampler;
 PFN_vkCreateSemaphore vkCreateSemaphore;
@@ -381,6 +397,7 @@ PFN_vkDestroyImage vkDestroyImage;
 PFN_vkDestroyImageView vkDestroyImageView;
 PFN_vkDestroyPipeline vkDestroyPipeline;
 PFN_vkDestroyPipelineLayout vkDestroyPipelineLayout;
+PFN_vkDestroyQueryPool vkDestroyQueryPool;
 PFN_vkDestroyRenderPass vkDestroyRenderPass;
 PFN_vkDestroySampler vkDestroySampler;
 PFN_vkDestroySemaphore vkDestroySemaphore;
@@ -406,6 +423,7 @@ PFN_vkGetPhysicalDeviceImageFormatProperties vkGetPhysicalDeviceImageFormatPrope
 PFN_vkGetPhysicalDeviceMemoryProperties vkGetPhysicalDeviceMemoryProperties;
 PFN_vkGetPhysicalDeviceProperties vkGetPhysicalDeviceProperties;
 PFN_vkGetPhysicalDeviceQueueFamilyProperties vkGetPhysicalDeviceQueueFamilyProperties;
+PFN_vkGetQueryPoolResults vkGetQueryPoolResults;
 PFN_vkInvalidateMappedMemoryRanges vkInvalidateMappedMemoryRanges;
 PFN_vkMapMemory vkMapMemory;
 PFN_vkQueueSubmit vkQueueSubmit;
@@ -4471,6 +4489,10 @@ static void commandbuffer_copy_buffer_whole(struct CommandBuffer *self,
          unsigned row_length,
          unsigned slice_height,
          const VkImageSubresourceLayers *subresrouce);
+   static void commandbuffer_copy_image(struct CommandBuffer *self,
+         const Image *dst,
+         const Image *src,
+         const VkExtent3D *extent);
    static void commandbuffer_full_barrier(struct CommandBuffer *self);
    static void commandbuffer_pixel_barrier(struct CommandBuffer *self);
    static void commandbuffer_barrier_simple(struct CommandBuffer *self,
@@ -5723,6 +5745,12 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
       SpecConstIndex_PgxpFog = 9
    };
 
+   /* GPU timing ring for dynamic resolution (see Renderer::gpu_timing):
+    * frames kept in flight before a slot is read back, and timestamp pairs
+    * (command buffers) one frame may record. */
+#define RENDERER_TIMESTAMP_FRAMES 4
+#define RENDERER_TIMESTAMP_PAIRS 32
+
    struct SaveState
    {
       OwnedU32Buf vram;
@@ -5768,6 +5796,10 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
 
          Device *device;
          unsigned scaling;
+         /* Scale the scanout is produced at. Equal to scaling, except under
+          * dynamic resolution, where scaling moves below it and the display
+          * quad resamples back up so the output size never changes. */
+         unsigned output_scaling;
          unsigned msaa;
          /* Cached, device-probed format for the HDR scanout image (lazily
           * filled on first HDR frame). VK_FORMAT_UNDEFINED = not yet probed. */
@@ -5787,6 +5819,12 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
          ImageHandle bias_framebuffer;
          ImageHandle framebuffer;
          ImageHandle framebuffer_ssaa;
+         /* Ring of framebuffer copies for in-memory savestates, see
+          * rhi_vulkan_snapshot_vram. vram_snap_id[i] is 0 while slot i
+          * holds nothing. */
+         ImageHandle vram_snap[RHI_VRAM_SNAPSHOTS_MAX];
+         uint32_t vram_snap_id[RHI_VRAM_SNAPSHOTS_MAX];
+         unsigned vram_snap_next;
          ImageViewHandleVec scaled_views;
          FBAtlas atlas;
    uint32_t vram_gpu_written[VRAM_PROV_WORDS];
@@ -5795,6 +5833,23 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
 
          CommandBufferHandle cmd;
 
+         /* GPU frame timing for dynamic resolution, on while gpu_timing is
+          * set. Every command buffer the renderer records is bracketed by a
+          * timestamp pair; a frame owns one slot of RENDERER_TIMESTAMP_PAIRS
+          * pairs and its GPU time is the sum of them, read back
+          * RENDERER_TIMESTAMP_FRAMES frames later so the read never waits.
+          * Command buffers past the limit go untimed and are counted in
+          * timestamp_untimed[slot]; the frame's time is then extrapolated
+          * from the pairs it did record. */
+         bool gpu_timing;
+         bool timestamp_unsupported;
+         bool timestamp_open;
+         VkQueryPool timestamp_pool;
+         unsigned timestamp_slot;
+         unsigned timestamp_query;
+         unsigned timestamp_pairs[RENDERER_TIMESTAMP_FRAMES];
+         unsigned timestamp_untimed[RENDERER_TIMESTAMP_FRAMES];
+
          /* Called by FBAtlas (formerly via HazardListener interface). */
 
          /* Called by TextureTracker (formerly via TextureUploader interface). */
@@ -5995,10 +6050,86 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
          const TextureWindow *window);
    static void renderer_reset_scissor_queue(Renderer *self);
    static void renderer_reset_queue(Renderer *self);
+   static bool renderer_timestamp_create(Renderer *self)
+   {
+      const VkPhysicalDeviceProperties *props = device_get_gpu_properties(self->device);
+      VkQueryPoolCreateInfo info;
+
+      if (self->timestamp_unsupported)
+         return false;
+
+      /* timestampComputeAndGraphics guarantees every graphics queue can
+       * write timestamps, so the queue family need not be probed. */
+      if (!props->limits.timestampComputeAndGraphics || props->limits.timestampPeriod <= 0.0f)
+      {
+         LOGI("[Vulkan]: Timestamp queries are not supported by this device, dynamic resolution is unavailable.\n");
+         self->timestamp_unsupported = true;
+         return false;
+      }
+
+      memset(&info, 0, sizeof(info));
+      info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+      info.queryCount = RENDERER_TIMESTAMP_FRAMES * RENDERER_TIMESTAMP_PAIRS * 2;
+      if (vkCreateQueryPool(device_get_device(self->device), &info, NULL, &self->timestamp_pool) != VK_SUCCESS)
+      {
+         self->timestamp_pool = VK_NULL_HANDLE;
+         self->timestamp_unsupported = true;
+         return false;
+      }
+      return true;
+   }
+
+   /* Open a timestamp pair at the top of a freshly requested command
+    * buffer. The first pair of a frame also resets the frame's slot, which
+    * must be recorded outside a render pass - a new command buffer is. */
+   static void renderer_timestamp_begin(Renderer *self)
+   {
+      const unsigned slot  = self->timestamp_slot;
+      const unsigned pairs = self->timestamp_pairs[slot];
+      const unsigned base  = slot * RENDERER_TIMESTAMP_PAIRS * 2;
+      VkCommandBuffer vk_cmd;
+
+      if (self->timestamp_pool == VK_NULL_HANDLE && !renderer_timestamp_create(self))
+         return;
+
+      if (pairs >= RENDERER_TIMESTAMP_PAIRS)
+      {
+         self->timestamp_untimed[slot]++;
+         return;
+      }
+
+      vk_cmd = commandbuffer_get_command_buffer(cbh_get(&self->cmd));
+      if (pairs == 0)
+         vkCmdResetQueryPool(vk_cmd, self->timestamp_pool, base, RENDERER_TIMESTAMP_PAIRS * 2);
+      vkCmdWriteTimestamp(vk_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, self->timestamp_pool, base + pairs * 2);
+      self->timestamp_query = base + pairs * 2;
+      self->timestamp_open  = true;
+   }
+
+   /* Close the pair opened by renderer_timestamp_begin, just before the
+    * command buffer is submitted. Keyed on the query the pair was opened
+    * with, so a command buffer left open across a frame boundary still
+    * lands in the slot it started in. */
+   static void renderer_timestamp_end(Renderer *self)
+   {
+      if (!self->timestamp_open)
+         return;
+
+      vkCmdWriteTimestamp(commandbuffer_get_command_buffer(cbh_get(&self->cmd)),
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, self->timestamp_pool, self->timestamp_query + 1);
+      self->timestamp_pairs[self->timestamp_query / (RENDERER_TIMESTAMP_PAIRS * 2)]++;
+      self->timestamp_open = false;
+   }
+
    static void renderer_ensure_command_buffer(Renderer *self)
    {
       if (!cbh_is_valid(&self->cmd))
+      {
          self->cmd = device_request_command_buffer(self->device, Type_Generic);
+         if (self->gpu_timing)
+            renderer_timestamp_begin(self);
+      }
    }
 
    static void renderer_flush_blits(Renderer *self)
@@ -6101,6 +6232,7 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                0, 1, &_b, 0, NULL, 0, NULL); }
+         renderer_timestamp_end(self);
          device_submit(self->device, &self->cmd, NULL, 0, NULL);
       }
       cbh_reset(&self->cmd);
@@ -6111,7 +6243,10 @@ static bool owned_u32_empty(const struct OwnedU32Buf *b) { return b->n == 0; }
       Fence fence;
       fence.data = NULL;
       if (cbh_is_valid(&self->cmd))
+      {
+         renderer_timestamp_end(self);
          device_submit(self->device, &self->cmd, &fence, 0, NULL);
+      }
       cbh_reset(&self->cmd);
       device_flush_frame_nolock(self->device);
       /* Return by value transfers ownership to the caller; the struct copy does
@@ -6508,6 +6643,100 @@ static INLINE void fbcolor_to_rgba32f(float *v, uint32_t color)
 }
 
 
+/* Allocate the scaled-domain targets (the mip-chained scaled framebuffer,
+ * its per-level views and, with MSAA, the multisampled colour target) at
+ * self->scaling. Shared by renderer_init and renderer_set_scaling. */
+static void renderer_create_scaled_targets(Renderer *self)
+{
+   VkImageFormatProperties props;
+   ImageCreateInfo info = image_create_info_render_target(
+         FB_WIDTH * self->scaling, FB_HEIGHT * self->scaling, VK_FORMAT_R8G8B8A8_UNORM);
+
+   /* Decide the scaled-framebuffer colour format. Widen to 16F only when a
+    * 30-bit/HDR format was requested AND the device supports R16F for every
+    * usage the scaled fb needs (colour attachment, sampled, storage). SDR and
+    * unsupported GPUs keep R8G8B8A8 and render exactly as before. */
+   self->scaled_fb_format = VK_FORMAT_R8G8B8A8_UNORM;
+   if (psx_color_format != 0 &&
+         device_image_format_is_supported(self->device, VK_FORMAT_R16G16B16A16_SFLOAT,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+            VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT,
+            VK_IMAGE_TILING_OPTIMAL))
+      self->scaled_fb_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+   info.format = self->scaled_fb_format;
+   info.levels = trailing_zeroes(self->scaling) + 1;
+   info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+   info.initial_layout = VK_IMAGE_LAYOUT_GENERAL;
+   ih_move(&self->scaled_framebuffer, device_create_image(self->device, &info, NULL));
+   image_set_layout(ih_get(&self->scaled_framebuffer), Layout_General);
+
+   {
+      ImageViewCreateInfo view_info = *imageview_get_create_info(image_get_view(ih_get(&self->scaled_framebuffer)));
+      { unsigned i; for (i = 0; i < info.levels; i++) {
+         view_info.base_level = i;
+         view_info.levels = 1;
+         imageview_vec_push(&self->scaled_views, device_create_image_view(self->device, &view_info));
+      } }
+   }
+
+   /* Check for support. */
+   if (self->msaa > 1)
+   {
+      if (!device_get_device_features(self->device)->enabled_features.sampleRateShading)
+      {
+         self->msaa = 1;
+         LOGI("[Vulkan]: sampleRateShading is not supported by self implementation. Cannot use MSAA.\n");
+      }
+      else if (!device_get_device_features(self->device)->enabled_features.shaderStorageImageMultisample)
+      {
+         self->msaa = 1;
+         LOGI("[Vulkan]: shaderStorageImageMultisample is not supported by self implementation. Cannot use MSAA.\n");
+      }
+      else if (!device_get_image_format_properties(self->device, self->scaled_fb_format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
+               VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_STORAGE_BIT |
+               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_SAMPLED_BIT,
+               0,
+               &props))
+      {
+         LOGI("[Vulkan]: Cannot use multisampling with self self->device.\n");
+         self->msaa = 1;
+      }
+      else if ((self->msaa & props.sampleCounts) == 0)
+      {
+         unsigned new_msaa = self->msaa >> 1;
+         while (new_msaa)
+         {
+            if (new_msaa & props.sampleCounts)
+            {
+               LOGI("[Vulkan]: MSAA sample count of %u is not supported, falling back to %u.\n",
+                     self->msaa, new_msaa);
+               self->msaa = new_msaa;
+               break;
+            }
+         }
+
+         if (self->msaa == 0)
+            self->msaa = 1;
+      }
+   }
+
+   if (self->msaa > 1)
+   {
+      info.levels = 1;
+      info.samples = (VkSampleCountFlagBits)(self->msaa);
+      ih_move(&self->scaled_framebuffer_msaa, device_create_image(self->device, &info, NULL));
+      image_set_layout(ih_get(&self->scaled_framebuffer_msaa), Layout_General);
+      /* General layout for MSAA is going to be brutal bandwidth-wise, but we
+       * have no real choice. The expectation is that self will be used with a
+       * lower self->scaling factor to compensate. */
+   }
+}
+
 static void renderer_init(Renderer *self,
       Device *device_,
       unsigned scaling_,
@@ -6551,6 +6780,7 @@ static void renderer_init(Renderer *self,
    self->bias_framebuffer.data        = NULL;
    self->framebuffer.data             = NULL;
    self->framebuffer_ssaa.data        = NULL;
+   { unsigned i; for (i = 0; i < RHI_VRAM_SNAPSHOTS_MAX; i++) self->vram_snap[i].data = NULL; }
    self->dither_lut.data              = NULL;
    /* self->render_state's default member initializers were moved out when
     * RenderState seed them here (was implicit at construction). */
@@ -6601,6 +6831,8 @@ static void renderer_init(Renderer *self,
       return;
    }
 
+   self->output_scaling = self->scaling;
+
    info = image_create_info_render_target(FB_WIDTH, FB_HEIGHT, VK_FORMAT_R32_UINT);
    info.initial_layout = VK_IMAGE_LAYOUT_GENERAL;
    info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
@@ -6634,91 +6866,7 @@ static void renderer_init(Renderer *self,
    info.levels = 1;
    ih_move(&self->bias_framebuffer, device_create_image(self->device, &info, NULL));
 
-   info.width *= self->scaling;
-   info.height *= self->scaling;
-   /* Decide the scaled-framebuffer colour format. Widen to 16F only when a
-    * 30-bit/HDR format was requested AND the device supports R16F for every
-    * usage the scaled fb needs (colour attachment, sampled, storage). SDR and
-    * unsupported GPUs keep R8G8B8A8 and render exactly as before. */
-   self->scaled_fb_format = VK_FORMAT_R8G8B8A8_UNORM;
-   if (psx_color_format != 0 &&
-         device_image_format_is_supported(self->device, VK_FORMAT_R16G16B16A16_SFLOAT,
-            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
-            VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
-            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT,
-            VK_IMAGE_TILING_OPTIMAL))
-      self->scaled_fb_format = VK_FORMAT_R16G16B16A16_SFLOAT;
-   info.format = self->scaled_fb_format;
-   info.levels = trailing_zeroes(self->scaling) + 1;
-   info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
-                VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
-   info.initial_layout = VK_IMAGE_LAYOUT_GENERAL;
-   ih_move(&self->scaled_framebuffer, device_create_image(self->device, &info, NULL));
-   image_set_layout(ih_get(&self->scaled_framebuffer), Layout_General);
-
-   {
-      ImageViewCreateInfo view_info = *imageview_get_create_info(image_get_view(ih_get(&self->scaled_framebuffer)));
-      { unsigned i; for (i = 0; i < info.levels; i++) {
-         view_info.base_level = i;
-         view_info.levels = 1;
-         imageview_vec_push(&self->scaled_views, device_create_image_view(self->device, &view_info));
-      } }
-   }
-
-   /* Check for support. */
-   if (self->msaa > 1)
-   {
-      if (!device_get_device_features(self->device)->enabled_features.sampleRateShading)
-      {
-         self->msaa = 1;
-         LOGI("[Vulkan]: sampleRateShading is not supported by self implementation. Cannot use MSAA.\n");
-      }
-      else if (!device_get_device_features(self->device)->enabled_features.shaderStorageImageMultisample)
-      {
-         self->msaa = 1;
-         LOGI("[Vulkan]: shaderStorageImageMultisample is not supported by self implementation. Cannot use MSAA.\n");
-      }
-      else if (!device_get_image_format_properties(self->device, self->scaled_fb_format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
-               VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
-               VK_IMAGE_USAGE_STORAGE_BIT |
-               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
-               VK_IMAGE_USAGE_SAMPLED_BIT,
-               0,
-               &props))
-      {
-         LOGI("[Vulkan]: Cannot use multisampling with self self->device.\n");
-         self->msaa = 1;
-      }
-      else if ((self->msaa & props.sampleCounts) == 0)
-      {
-         unsigned new_msaa = self->msaa >> 1;
-         while (new_msaa)
-         {
-            if (new_msaa & props.sampleCounts)
-            {
-               LOGI("[Vulkan]: MSAA sample count of %u is not supported, falling back to %u.\n",
-                     self->msaa, new_msaa);
-               self->msaa = new_msaa;
-               break;
-            }
-         }
-
-         if (self->msaa == 0)
-            self->msaa = 1;
-      }
-   }
-
-   if (self->msaa > 1)
-   {
-      info.levels = 1;
-      info.samples = (VkSampleCountFlagBits)(self->msaa);
-      ih_move(&self->scaled_framebuffer_msaa, device_create_image(self->device, &info, NULL));
-      image_set_layout(ih_get(&self->scaled_framebuffer_msaa), Layout_General);
-      /* General layout for MSAA is going to be brutal bandwidth-wise, but we
-       * have no real choice. The expectation is that self will be used with a
-       * lower self->scaling factor to compensate. */
-   }
+   renderer_create_scaled_targets(self);
 
    fbatlas_set_hazard_listener(&self->atlas, self);
    {
@@ -6818,6 +6966,100 @@ static void renderer_save_vram_state(Renderer *self, SaveState *out){
    bh_reset(&buffer);
 }
 
+static void renderer_init_primitive_pipelines(Renderer *self);
+static void renderer_init_primitive_feedback_pipelines(Renderer *self);
+
+/* Re-render the scaled domain at a new scale without tearing the renderer
+ * down. The same hand-off a rebuild through renderer_init does, minus the
+ * CPU round trip: the unscaled framebuffer is brought current, the scaled
+ * targets are reallocated, and the atlas is told VRAM was written in the
+ * unscaled domain so the scaled view is upscaled again on first use. Only
+ * what has been drawn since is rendered at the new scale. */
+static void renderer_set_scaling(Renderer *self, unsigned scaling_)
+{
+   TTRect full = { 0, 0, FB_WIDTH, FB_HEIGHT };
+   unsigned old_scaling = self->scaling;
+
+   if (scaling_ == old_scaling)
+      return;
+
+   /* Resolve everything that only exists at the old scale down into the
+    * unscaled framebuffer while the old targets are still bound. */
+   fbatlas_read_transfer(&self->atlas, Domain_Unscaled, &full);
+   renderer_flush_blits(self);
+   renderer_flush_resolves(self);
+   renderer_flush(self);
+
+   /* In-flight uses of the old targets are safe: the device defers the
+    * actual destruction until this frame context comes round again. */
+   ih_reset(&self->scaled_framebuffer);
+   ih_reset(&self->scaled_framebuffer_msaa);
+   ih_reset(&self->last_scanout);
+   imageview_vec_destroy(&self->scaled_views);
+
+   self->scaling = scaling_;
+   renderer_create_scaled_targets(self);
+
+   /* Without MSAA the primitive programs at 1x use the *_unscaled vertex
+    * shaders, so crossing 1x in either direction has to pick them again.
+    * The device caches programs, so this costs nothing after the first
+    * time. */
+   if ((old_scaling > 1) != (scaling_ > 1))
+   {
+      renderer_init_primitive_pipelines(self);
+      renderer_init_primitive_feedback_pipelines(self);
+   }
+
+   renderer_ensure_command_buffer(self);
+   {
+      VkClearValue _clear_zero;
+      memset(&_clear_zero, 0, sizeof(_clear_zero));
+      commandbuffer_clear_image(cbh_get(&self->cmd), ih_get(&self->scaled_framebuffer), &_clear_zero);
+   }
+   commandbuffer_full_barrier(cbh_get(&self->cmd));
+
+   fbatlas_write_transfer(&self->atlas, Domain_Unscaled, &full);
+   renderer_reset_scissor_queue(self);
+}
+
+/* Move GPU timing on to the next frame's slot and report, in milliseconds,
+ * the GPU time of the frame that last used it. False when there is nothing
+ * to report: timing has just started or the results are not back yet. A
+ * frame that ran out of timestamp pairs is reported as the average of the
+ * pairs it recorded times the number of command buffers it submitted, so
+ * the heaviest frames are not the ones dynamic resolution never sees. */
+static bool renderer_next_gpu_timing_frame(Renderer *self, float *gpu_ms)
+{
+   uint64_t ts[RENDERER_TIMESTAMP_PAIRS * 2];
+   uint64_t ticks = 0;
+   unsigned pairs, untimed, i;
+
+   self->timestamp_slot = (self->timestamp_slot + 1) % RENDERER_TIMESTAMP_FRAMES;
+   pairs   = self->timestamp_pairs[self->timestamp_slot];
+   untimed = self->timestamp_untimed[self->timestamp_slot];
+   self->timestamp_pairs[self->timestamp_slot]   = 0;
+   self->timestamp_untimed[self->timestamp_slot] = 0;
+
+   if (self->timestamp_pool == VK_NULL_HANDLE || pairs == 0)
+      return false;
+
+   /* No WAIT flag: a frame this old has normally retired, and if the GPU
+    * is that far behind the sample is simply dropped (VK_NOT_READY). */
+   if (vkGetQueryPoolResults(device_get_device(self->device), self->timestamp_pool,
+            self->timestamp_slot * RENDERER_TIMESTAMP_PAIRS * 2, pairs * 2,
+            sizeof(ts), ts, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+      return false;
+
+   for (i = 0; i < pairs; i++)
+      if (ts[i * 2 + 1] > ts[i * 2])
+         ticks += ts[i * 2 + 1] - ts[i * 2];
+   if (untimed)
+      ticks = ticks * (pairs + untimed) / pairs;
+
+   *gpu_ms = (float)((double)ticks * device_get_gpu_properties(self->device)->limits.timestampPeriod * 1e-6);
+   return true;
+}
+
 static void renderer_init_primitive_pipelines(Renderer *self)
 {
    if (self->msaa > 1 || self->scaling > 1)
@@ -7074,102 +7316,120 @@ static TTRect renderer_compute_window_rect(Renderer *self,
    }
 }
 
-static void renderer_copy_vram_to_cpu_synchronous(Renderer *self,
-      const TTRect *rect,
+/* Upper bound on the rects one readback takes; rhi_intf.c merges its
+ * dirty-block runs down to at most this many (RHI_READBACK_MAX_RECTS)
+ * before asking.  Each rect splits into at most four tiles. */
+#define READBACK_MAX_RECTS  RHI_READBACK_MAX_RECTS
+#define READBACK_MAX_TILES  (READBACK_MAX_RECTS * 4)
+
+static void renderer_copy_vram_to_cpu_rects(Renderer *self,
+      const TTRect *whole,
+      const TTRect *rects, unsigned count,
       uint16_t *vram)
 {
    BufferHandle     buffer;
    BufferCreateInfo buffer_create_info;
    Fence            fence;
-   /* Split the (possibly VRAM-wrapping) request into up to four
+   /* Split every (possibly VRAM-wrapping) request into up to four
     * non-wrapping tiles in unscaled framebuffer space.  Only the covered
     * region is transferred GPU->CPU instead of widening a wrapping read to
     * the whole framebuffer (FB_WIDTH*FB_HEIGHT*4 bytes) purely to line up
-    * the scatter indices.  The non-wrapping case collapses to a single tile
-    * identical to the previous fast path. */
-   uint32_t x0 = rect->x & (FB_WIDTH  - 1);
-   uint32_t y0 = rect->y & (FB_HEIGHT - 1);
-   uint32_t hx[2], hw[2];
-   uint32_t vy[2], vh[2];
-   int      nh = 1;
-   int      nv = 1;
-   uint32_t sum_w;
-   uint32_t sum_h;
+    * the scatter indices.  A non-wrapping rect collapses to a single tile. */
+   TTRect       tiles[READBACK_MAX_TILES];
+   unsigned     ntiles = 0;
+   VkDeviceSize total  = 0;
+   unsigned     r;
 
-   if (rect->width >= FB_WIDTH)
-   {
-      hx[0] = 0;  hw[0] = FB_WIDTH;
-   }
-   else if (x0 + rect->width > FB_WIDTH)
-   {
-      nh    = 2;
-      hx[0] = x0; hw[0] = FB_WIDTH - x0;
-      hx[1] = 0;  hw[1] = rect->width - hw[0];
-   }
-   else
-   {
-      hx[0] = x0; hw[0] = rect->width;
-   }
+   if (count > READBACK_MAX_RECTS)
+      count = READBACK_MAX_RECTS;
 
-   if (rect->height >= FB_HEIGHT)
-   {
-      vy[0] = 0;  vh[0] = FB_HEIGHT;
-   }
-   else if (y0 + rect->height > FB_HEIGHT)
-   {
-      nv    = 2;
-      vy[0] = y0; vh[0] = FB_HEIGHT - y0;
-      vy[1] = 0;  vh[1] = rect->height - vh[0];
-   }
-   else
+   for (r = 0; r < count; r++)
    {
-      vy[0] = y0; vh[0] = rect->height;
-   }
+      const TTRect *rect = &rects[r];
+      uint32_t x0 = rect->x & (FB_WIDTH  - 1);
+      uint32_t y0 = rect->y & (FB_HEIGHT - 1);
+      uint32_t hx[2], hw[2];
+      uint32_t vy[2], vh[2];
+      int      nh = 1;
+      int      nv = 1;
+      int      i, j;
 
-   sum_w = (nh == 2) ? (hw[0] + hw[1]) : hw[0];
-   sum_h = (nv == 2) ? (vh[0] + vh[1]) : vh[0];
+      if (rect->width >= FB_WIDTH)
+      {
+         hx[0] = 0;  hw[0] = FB_WIDTH;
+      }
+      else if (x0 + rect->width > FB_WIDTH)
+      {
+         nh    = 2;
+         hx[0] = x0; hw[0] = FB_WIDTH - x0;
+         hx[1] = 0;  hw[1] = rect->width - hw[0];
+      }
+      else
+      {
+         hx[0] = x0; hw[0] = rect->width;
+      }
+
+      if (rect->height >= FB_HEIGHT)
+      {
+         vy[0] = 0;  vh[0] = FB_HEIGHT;
+      }
+      else if (y0 + rect->height > FB_HEIGHT)
+      {
+         nv    = 2;
+         vy[0] = y0; vh[0] = FB_HEIGHT - y0;
+         vy[1] = 0;  vh[1] = rect->height - vh[0];
+      }
+      else
+      {
+         vy[0] = y0; vh[0] = rect->height;
+      }
 
-   /* Sync each tile's source region from the scaled domain - mirrors the old
-    * single full-rect fbatlas_read_transfer, but only over what we read. */
-   {
-      int i, j;
       for (j = 0; j < nv; j++)
       {
          for (i = 0; i < nh; i++)
          {
-            TTRect tr;
-            tr.x     = hx[i]; tr.y      = vy[j];
-            tr.width = hw[i]; tr.height = vh[j];
-            fbatlas_read_transfer(&self->atlas, Domain_Unscaled, &tr);
+            TTRect *tr = &tiles[ntiles++];
+            tr->x     = hx[i]; tr->y      = vy[j];
+            tr->width = hw[i]; tr->height = vh[j];
+            total    += (VkDeviceSize)hw[i] * vh[j] * 4;
          }
       }
    }
 
+   if (!ntiles)
+      return;
+
+   /* Sync each tile's source region from the scaled domain - only over
+    * what we read. */
+   {
+      unsigned t;
+      for (t = 0; t < ntiles; t++)
+         fbatlas_read_transfer(&self->atlas, Domain_Unscaled, &tiles[t]);
+   }
+
    renderer_ensure_command_buffer(self);
 
    buffer_create_info.domain = BufferDomain_CachedHost;
-   buffer_create_info.size   = sum_w * sum_h * 4;
+   buffer_create_info.size   = total;
    buffer_create_info.usage  = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
    buffer = device_create_buffer(self->device, &buffer_create_info, NULL);
 
-   /* One copy per tile into a single tightly packed host buffer.  Still a
-    * single flush + single fence wait - no extra GPU round-trips. */
+   /* One copy region per tile into a single tightly packed host buffer,
+    * all in the same command buffer: still a single flush and a single
+    * fence wait however many rects were asked for. */
    {
-      int         i, j;
+      unsigned     t;
       VkDeviceSize byteoff = 0;
-      for (j = 0; j < nv; j++)
+      for (t = 0; t < ntiles; t++)
       {
-         for (i = 0; i < nh; i++)
-         {
-            VkOffset3D               _o = { 0, 0, 0 };
-            VkExtent3D               _e = { 0, 0, 1 };
-            VkImageSubresourceLayers _s = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-            _o.x = (int)hx[i]; _o.y = (int)vy[j];
-            _e.width = hw[i];  _e.height = vh[j];
-            commandbuffer_copy_image_to_buffer(cbh_get(&self->cmd), bh_get(&buffer),
-                  ih_get(&self->framebuffer), byteoff, &_o, &_e, 0, 0, &_s);
-            byteoff += (VkDeviceSize)hw[i] * vh[j] * 4;
-         }
+         VkOffset3D               _o = { 0, 0, 0 };
+         VkExtent3D               _e = { 0, 0, 1 };
+         VkImageSubresourceLayers _s = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+         _o.x = (int)tiles[t].x; _o.y = (int)tiles[t].y;
+         _e.width = tiles[t].width; _e.height = tiles[t].height;
+         commandbuffer_copy_image_to_buffer(cbh_get(&self->cmd), bh_get(&buffer),
+               ih_get(&self->framebuffer), byteoff, &_o, &_e, 0, 0, &_s);
+         byteoff += (VkDeviceSize)tiles[t].width * tiles[t].height * 4;
       }
    }
 
@@ -7181,34 +7441,30 @@ static void renderer_copy_vram_to_cpu_synchronous(Renderer *self,
 
    {
       const uint32_t *mapped = (const uint32_t *)(device_map_host_buffer(self->device, bh_get(&buffer), MEMORY_ACCESS_READ_BIT));
-      int             i, j;
+      unsigned        t;
       uint32_t        elemoff = 0;
-      for (j = 0; j < nv; j++)
-      {
-         for (i = 0; i < nh; i++)
+      for (t = 0; t < ntiles; t++)
+      {
+         uint32_t tw = tiles[t].width;
+         uint32_t th = tiles[t].height;
+         uint32_t bx = tiles[t].x;
+         uint32_t by = tiles[t].y;
+         uint32_t yy;
+         for (yy = 0; yy < th; yy++)
          {
-            uint32_t tw = hw[i];
-            uint32_t th = vh[j];
-            uint32_t bx = hx[i];
-            uint32_t by = vy[j];
-            {
-               uint32_t yy;
-               for (yy = 0; yy < th; yy++)
-               {
-                  uint32_t xx;
-                  for (xx = 0; xx < tw; xx++)
-                     vram[(by + yy) * FB_WIDTH + (bx + xx)] =
-                        (uint16_t)(mapped[elemoff + yy * tw + xx]);
-               }
-            }
-            elemoff += tw * th;
+            uint32_t xx;
+            for (xx = 0; xx < tw; xx++)
+               vram[(by + yy) * FB_WIDTH + (bx + xx)] =
+                  (uint16_t)(mapped[elemoff + yy * tw + xx]);
          }
+         elemoff += tw * th;
       }
 
+      /* The tracker hears about the rect the game asked for: every
+       * pixel of it is coherent in vram now, the parts not copied
+       * having been so already. */
       if (self->texture_tracking_enabled)
-      {
-         texture_tracker_notifyReadback(self->tracker, *rect, vram);
-      }
+         texture_tracker_notifyReadback(self->tracker, *whole, vram);
 
       device_unmap_host_buffer(self->device, bh_get(&buffer), MEMORY_ACCESS_READ_BIT);
 
@@ -7225,6 +7481,13 @@ static void renderer_copy_vram_to_cpu_synchronous(Renderer *self,
    }
 }
 
+static void renderer_copy_vram_to_cpu_synchronous(Renderer *self,
+      const TTRect *rect,
+      uint16_t *vram)
+{
+   renderer_copy_vram_to_cpu_rects(self, rect, rect, 1, vram);
+}
+
 static void renderer_mipmap_framebuffer(Renderer *self)
 {
    unsigned levels;
@@ -7558,6 +7821,10 @@ static ImageHandle renderer_scanout_vram_to_texture(Renderer *self, bool scaled)
    }
 
    render_scale = scaled ? self->scaling : 1;
+   /* Below the dynamic resolution ceiling the scanout stays at the
+    * output size. */
+   if (scaled && self->scaling != self->output_scaling)
+      render_scale = self->output_scaling;
 
    { ImageCreateInfo info = image_create_info_render_target(
          FB_WIDTH * render_scale,
@@ -8345,7 +8612,13 @@ static ImageHandle renderer_scanout_to_texture(Renderer *self)
 
    { bool scaled = !ssaa;
 
-   unsigned render_scale = scaled ? self->scaling : 1;
+   /* Below the dynamic resolution ceiling the quad resamples whatever
+    * scale was rendered to a fixed-size scanout. Keyed on the filter
+    * rather than on ssaa so supersampling stays at native size when the
+    * scale drops to 1x and the SSAA pass is skipped. */
+   unsigned render_scale = self->scaling == self->output_scaling
+      ? (scaled ? self->scaling : 1)
+      : (self->render_state.scanout_filter == ScanoutFilter_SSAA ? 1 : self->output_scaling);
 
    DisplayRect display_rect = renderer_compute_display_rect(self);
 
@@ -8470,7 +8743,7 @@ static ImageHandle renderer_scanout_to_texture(Renderer *self)
       if (self->render_state.dither_native_resolution && scaled)
       {
          int32_t shift = 0;
-         unsigned tmp = self->scaling >> 1;
+         unsigned tmp = render_scale >> 1;
          while (tmp)
          {
             shift++;
@@ -10329,6 +10602,60 @@ static TTGpuBackend vk_tt_make_backend(Renderer *self)
    return vt;
 }
 
+/* In-memory savestates (run-ahead, preemptive frames, rollback) keep
+ * their VRAM in a ring of copies of the unscaled framebuffer instead of
+ * reading it back: one image-to-image copy recorded into the command
+ * buffer, no fence.  A restore is the same copy the other way round and
+ * leaves the atlas as a full CPU upload does - unscaled current, scaled
+ * stale until next needed, no block marked texture-rendered. */
+static bool renderer_snapshot_vram(Renderer *self, unsigned slot)
+{
+   TTRect     full   = { 0, 0, FB_WIDTH, FB_HEIGHT };
+   VkExtent3D extent = { FB_WIDTH, FB_HEIGHT, 1 };
+
+   if (!ih_get(&self->vram_snap[slot]))
+   {
+      ImageCreateInfo info = image_create_info_render_target(FB_WIDTH, FB_HEIGHT, VK_FORMAT_R32_UINT);
+      info.initial_layout = VK_IMAGE_LAYOUT_GENERAL;
+      info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+      ih_move(&self->vram_snap[slot], device_create_image(self->device, &info, NULL));
+      if (!ih_get(&self->vram_snap[slot]))
+         return false;
+      image_set_layout(ih_get(&self->vram_snap[slot]), Layout_General);
+   }
+
+   fbatlas_read_transfer(&self->atlas, Domain_Unscaled, &full);
+   renderer_ensure_command_buffer(self);
+   /* Snapshot images are only ever touched by transfers; this orders the
+    * copy after a restore that read the same slot. */
+   commandbuffer_barrier_simple(cbh_get(&self->cmd),
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+   commandbuffer_copy_image(cbh_get(&self->cmd),
+         ih_get(&self->vram_snap[slot]), ih_get(&self->framebuffer), &extent);
+   return true;
+}
+
+static void renderer_restore_vram(Renderer *self, unsigned slot)
+{
+   TTRect     full   = { 0, 0, FB_WIDTH, FB_HEIGHT };
+   VkExtent3D extent = { FB_WIDTH, FB_HEIGHT, 1 };
+   unsigned   i;
+
+   ih_reset(&self->last_scanout);
+   fbatlas_write_transfer(&self->atlas, Domain_Unscaled, &full);
+   for (i = 0; i < NUM_BLOCKS_X * NUM_BLOCKS_Y; i++)
+      self->atlas.fb_info[i] &= ~STATUS_TEXTURE_RENDERED;
+   vram_prov_op(self, 0, 0, FB_WIDTH, FB_HEIGHT, 0);
+
+   renderer_ensure_command_buffer(self);
+   commandbuffer_barrier_simple(cbh_get(&self->cmd),
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+   commandbuffer_copy_image(cbh_get(&self->cmd),
+         ih_get(&self->framebuffer), ih_get(&self->vram_snap[slot]), &extent);
+}
+
 static BufferHandle renderer_copy_cpu_to_vram(Renderer *self, const TTRect *rect){
    VkDeviceSize size;
    BufferHandle buffer;
@@ -10410,6 +10737,13 @@ static BufferHandle renderer_copy_cpu_to_vram(Renderer *self, const TTRect *rect
 static void renderer_fini(Renderer *self)
 {
    renderer_flush(self);
+   if (self->timestamp_pool != VK_NULL_HANDLE)
+   {
+      /* Not deferred like images are; wait out the frames still writing it. */
+      vkDeviceWaitIdle(device_get_device(self->device));
+      vkDestroyQueryPool(device_get_device(self->device), self->timestamp_pool, NULL);
+      self->timestamp_pool = VK_NULL_HANDLE;
+   }
    texture_tracker_free(self->tracker); /* heap tracker: explicit teardown */
    self->tracker = NULL;
    /* Release the ImageHandle members (previously dropped by implicit member
@@ -10419,6 +10753,7 @@ static void renderer_fini(Renderer *self)
    ih_reset(&self->bias_framebuffer);
    ih_reset(&self->framebuffer);
    ih_reset(&self->framebuffer_ssaa);
+   { unsigned i; for (i = 0; i < RHI_VRAM_SNAPSHOTS_MAX; i++) ih_reset(&self->vram_snap[i]); }
    ih_reset(&self->dither_lut);
    ih_reset(&self->last_scanout);
    ih_reset(&self->reuseable_scanout);
@@ -13794,6 +14129,22 @@ static VkOffset3D cb_add_offset(const VkOffset3D *a, const VkOffset3D *b)
             buffer_get_buffer(buffer), 1, &region);
    }
 
+   /* Whole-extent copy of mip 0, layer 0 between two colour images. */
+   static void commandbuffer_copy_image(struct CommandBuffer *self, const Image *dst, const Image *src,
+         const VkExtent3D *extent)
+   {
+      VkImageCopy region;
+      memset(&region, 0, sizeof(region));
+      region.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.srcSubresource.layerCount     = 1;
+      region.dstSubresource                = region.srcSubresource;
+      region.extent                        = *extent;
+      vkCmdCopyImage(self->cmd,
+            image_get_image(src), image_get_layout(src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL),
+            image_get_image(dst), image_get_layout(dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+            1, &region);
+   }
+
    static void commandbuffer_clear_image(struct CommandBuffer *self,
          const Image *image,
          const VkClearValue *value)
@@ -18789,6 +19140,13 @@ static bool adaptive_smoothing;
 static bool super_sampling;
 static unsigned msaa = 1;
 static bool mdec_yuv;
+/* Dynamic resolution: the internal resolution option is the ceiling (and
+ * the output size), dynamic_resolution_min the floor, and the scale moves
+ * in powers of two to keep GPU time under dynamic_resolution_budget percent
+ * of a frame. See rhi_vulkan_update_dynamic_resolution. */
+static bool dynamic_resolution;
+static unsigned dynamic_resolution_min = 1;
+static unsigned dynamic_resolution_budget = 75;
 /*
  * Queue for rhi_vulkan_* operations that arrive between the libretro
  * frontend's RETRO_ENVIRONMENT_SET_HW_RENDER acceptance and the
@@ -19246,6 +19604,31 @@ void rhi_vulkan_refresh_variables(void)
       msaa = strtoul(var.value, NULL, 0);
    }
 
+   var.key = BEETLE_OPT(dynamic_resolution);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "enabled"))
+         dynamic_resolution = true;
+      else
+         dynamic_resolution = false;
+   }
+
+   var.key = BEETLE_OPT(dynamic_resolution_min);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      dynamic_resolution_min = strtoul(var.value, NULL, 0);
+      if (dynamic_resolution_min == 0)
+         dynamic_resolution_min = 1;
+   }
+
+   var.key = BEETLE_OPT(dynamic_resolution_budget);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      dynamic_resolution_budget = strtoul(var.value, NULL, 0);
+      if (dynamic_resolution_budget == 0)
+         dynamic_resolution_budget = 75;
+   }
+
    var.key = BEETLE_OPT(mdec_yuv);
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
@@ -19535,6 +19918,60 @@ void rhi_vulkan_apply_pending_geometry(void)
    }
 }
 
+/* Dynamic resolution hysteresis. The scale is halved only after GPU time
+ * has been over budget for DYNRES_DOWN_FRAMES frames in a row, and doubled
+ * only after DYNRES_UP_FRAMES frames in a row under a quarter of the budget
+ * - doubling the scale quadruples the pixel work, so anything less would
+ * just bounce back down. A frame in between resets both counts. */
+#define DYNRES_DOWN_FRAMES 30
+#define DYNRES_UP_FRAMES   300
+
+static unsigned dynres_over;
+static unsigned dynres_under;
+
+static void rhi_vulkan_update_dynamic_resolution(void)
+{
+   float gpu_ms;
+   const unsigned ceiling = renderer->output_scaling;
+   const unsigned floor_  = min_(dynamic_resolution_min, ceiling);
+   unsigned target        = renderer->scaling;
+
+   if (renderer_next_gpu_timing_frame(renderer, &gpu_ms))
+   {
+      const float budget_ms = (float)(1000.0 / rhi_common_get_timing_fps())
+         * dynamic_resolution_budget / 100.0f;
+
+      if (gpu_ms > budget_ms)
+      {
+         dynres_under = 0;
+         if (++dynres_over >= DYNRES_DOWN_FRAMES && target > floor_)
+            target >>= 1;
+      }
+      else if (gpu_ms * 4.0f < budget_ms)
+      {
+         dynres_over = 0;
+         if (++dynres_under >= DYNRES_UP_FRAMES && target < ceiling)
+            target <<= 1;
+      }
+      else
+         dynres_over = dynres_under = 0;
+   }
+
+   /* The bounds are options and may have moved past the current scale. */
+   if (target < floor_)
+      target = floor_;
+   if (target > ceiling)
+      target = ceiling;
+
+   if (target != renderer->scaling)
+   {
+      log_cb(RETRO_LOG_INFO, "[Vulkan]: Dynamic resolution %ux -> %ux.\n",
+            renderer->scaling, target);
+      renderer_set_scaling(renderer, target);
+      dynres_over = dynres_under = 0;
+   }
+}
+
 void rhi_vulkan_prepare_frame(void)
 {
    if (device == NULL)
@@ -19568,6 +20005,22 @@ void rhi_vulkan_prepare_frame(void)
    renderer->primitive_filter_mode = (FilterMode)(filter_mode);
    renderer->sprite_filter_exclude = (FilterExclude)(filter_exclude_sprites);
    renderer->polygon_2d_filter_exclude = (FilterExclude)(filter_exclude_2d_polygons);
+
+   /* Between frames, with the new frame context begun and nothing recorded
+    * for it yet, is the one point a rescale cannot land mid-frame. */
+   if (dynamic_resolution && !renderer->gpu_timing)
+   {
+      /* Counts left over from an earlier timing run would point the next
+       * pairs at queries that were never reset for them. */
+      memset(renderer->timestamp_pairs, 0, sizeof(renderer->timestamp_pairs));
+      memset(renderer->timestamp_untimed, 0, sizeof(renderer->timestamp_untimed));
+      dynres_over = dynres_under = 0;
+   }
+   renderer->gpu_timing = dynamic_resolution;
+   if (dynamic_resolution)
+      rhi_vulkan_update_dynamic_resolution();
+   else if (renderer->scaling != renderer->output_scaling)
+      renderer_set_scaling(renderer, renderer->output_scaling);
 }
 
 static ScanoutMode get_scanout_mode(bool bpp24)
@@ -20165,6 +20618,61 @@ void rhi_vulkan_load_image(
    }
 }
 
+bool rhi_vulkan_snapshot_vram(uint32_t id, unsigned slots)
+{
+   unsigned slot;
+
+   if (!renderer || !slots)
+      return false;
+   if (slots > RHI_VRAM_SNAPSHOTS_MAX)
+      slots = RHI_VRAM_SNAPSHOTS_MAX;
+
+   /* The ring was shortened: drop what no longer fits. */
+   for (slot = slots; slot < RHI_VRAM_SNAPSHOTS_MAX; slot++)
+   {
+      ih_reset(&renderer->vram_snap[slot]);
+      renderer->vram_snap_id[slot] = 0;
+   }
+
+   slot                     = renderer->vram_snap_next % slots;
+   renderer->vram_snap_next = slot + 1;
+   renderer->vram_snap_id[slot] = 0;
+   if (!renderer_snapshot_vram(renderer, slot))
+      return false;
+   renderer->vram_snap_id[slot] = id;
+
+   /* Outside a frame this is the savestate path, like load_image's
+    * flush below: submit, but do not wait. */
+   if (!inside_frame)
+      renderer_flush(renderer);
+   return true;
+}
+
+bool rhi_vulkan_restore_vram(uint32_t id, uint16_t *vram)
+{
+   unsigned slot;
+
+   if (!renderer)
+      return false;
+
+   for (slot = 0; slot < RHI_VRAM_SNAPSHOTS_MAX; slot++)
+      if (renderer->vram_snap_id[slot] == id && ih_get(&renderer->vram_snap[slot]))
+         break;
+   if (slot == RHI_VRAM_SNAPSHOTS_MAX)
+      return false;
+
+   { TTRect _ntu_rect = { 0, 0, FB_WIDTH, FB_HEIGHT };
+     renderer_notify_texture_upload(renderer, _ntu_rect, vram); }
+   /* What the full-VRAM upload this replaces would leave behind. */
+   renderer->render_state.mask_test      = false;
+   renderer->render_state.force_mask_bit = false;
+   renderer_restore_vram(renderer, slot);
+
+   if (!inside_frame)
+      renderer_flush(renderer);
+   return true;
+}
+
 bool rhi_vulkan_read_vram(uint16_t x, uint16_t y,
                           uint16_t w, uint16_t h,
                           uint16_t *vram)
@@ -20178,6 +20686,33 @@ bool rhi_vulkan_read_vram(uint16_t x, uint16_t y,
    return true;
 }
 
+bool rhi_vulkan_read_vram_rects(const struct rhi_vram_rect *whole,
+                                const struct rhi_vram_rect *rects,
+                                unsigned count, uint16_t *vram)
+{
+   TTRect   tr[READBACK_MAX_RECTS];
+   TTRect   wr;
+   unsigned i;
+
+   if (!renderer)
+      return false;
+   if (count > READBACK_MAX_RECTS)
+      return false;
+   for (i = 0; i < count; i++)
+   {
+      tr[i].x      = rects[i].x;
+      tr[i].y      = rects[i].y;
+      tr[i].width  = rects[i].w;
+      tr[i].height = rects[i].h;
+   }
+   wr.x      = whole->x;
+   wr.y      = whole->y;
+   wr.width  = whole->w;
+   wr.height = whole->h;
+   renderer_copy_vram_to_cpu_rects(renderer, &wr, tr, count, vram);
+   return true;
+}
+
 void rhi_vulkan_fill_rect(uint32_t color,
                           uint16_t x, uint16_t y,
                           uint16_t w, uint16_t h)
@@ -100,6 +100,20 @@ void rhi_vulkan_load_image(uint16_t x, uint16_t y,
 
 bool rhi_vulkan_read_vram(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *vram);
 
+/* Read back `count` (at most RHI_READBACK_MAX_RECTS) sub-rects of
+ * `whole` with one command buffer and one fence wait, for a caller that
+ * knows the rest of `whole` is already coherent in vram.  Each rect lands
+ * in vram at its own position; rects may wrap. */
+struct rhi_vram_rect;
+bool rhi_vulkan_read_vram_rects(const struct rhi_vram_rect *whole,
+                                const struct rhi_vram_rect *rects,
+                                unsigned count, uint16_t *vram);
+
+/* See rhi_intf_snapshot_vram.  `slots` (at most RHI_VRAM_SNAPSHOTS_MAX)
+ * is the ring length; snapshots live as long as the renderer. */
+bool rhi_vulkan_snapshot_vram(uint32_t id, unsigned slots);
+bool rhi_vulkan_restore_vram(uint32_t id, uint16_t *vram);
+
 void rhi_vulkan_fill_rect(uint32_t color,
                           uint16_t x, uint16_t y,
                           uint16_t w, uint16_t h);
@@ -0,0 +1,147 @@
+#ifndef RHI_VRAM_COH_H
+#define RHI_VRAM_COH_H
+
+/* The block grid of the VRAM readback coherence tracker, see the
+ * comment above its include in rhi_intf.c.  Only rhi_intf.c includes
+ * this, and the grid is that file's state; it lives in a header so
+ * tools/rhi_coh can build the block operations outside the core and
+ * check tt_coh_dirty_rects against a per-block scan. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "boolean.h"
+#include "rhi_intf.h"
+
+#define TT_COH_VRAM_W 1024
+#define TT_COH_VRAM_H 512
+#define TT_COH_SH     3
+#define TT_COH_BW     (TT_COH_VRAM_W >> TT_COH_SH)   /* 128 block columns */
+#define TT_COH_BH     (TT_COH_VRAM_H >> TT_COH_SH)   /* 64  block rows    */
+
+static uint8_t  tt_coh_clean[TT_COH_BH * TT_COH_BW]; /* 0=dirty (default), 1=clean */
+
+/* DIRTY: every block the rect OVERLAPS (conservative superset). */
+static void tt_coh_dirty(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   uint32_t bx0, by0, nbx, nby, kx, ky;
+   if (!w || !h)
+      return;
+   bx0 = (x & (TT_COH_VRAM_W - 1)) >> TT_COH_SH;
+   by0 = (y & (TT_COH_VRAM_H - 1)) >> TT_COH_SH;
+   nbx = ((x & 7) + w + 7) >> TT_COH_SH; if (nbx > TT_COH_BW) nbx = TT_COH_BW;
+   nby = ((y & 7) + h + 7) >> TT_COH_SH; if (nby > TT_COH_BH) nby = TT_COH_BH;
+   for (ky = 0; ky < nby; ky++)
+      for (kx = 0; kx < nbx; kx++)
+         tt_coh_clean[((by0 + ky) & (TT_COH_BH - 1)) * TT_COH_BW
+                    + ((bx0 + kx) & (TT_COH_BW - 1))] = 0;
+}
+
+/* CLEAN: only blocks FULLY CONTAINED in the rect (subset). */
+static void tt_coh_clean_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   uint32_t cb0, cb1, rb0, rb1, sc, sr, bc, br;
+   if (w < 8 || h < 8)
+      return;
+   cb0 = (x + 7) >> TT_COH_SH;   /* first fully covered col (unwrapped) */
+   cb1 = (x + w) >> TT_COH_SH;   /* one past last fully covered col     */
+   rb0 = (y + 7) >> TT_COH_SH;
+   rb1 = (y + h) >> TT_COH_SH;
+   if (cb1 <= cb0 || rb1 <= rb0)
+      return;
+   sc = cb1 - cb0; if (sc > TT_COH_BW) sc = TT_COH_BW;
+   sr = rb1 - rb0; if (sr > TT_COH_BH) sr = TT_COH_BH;
+   for (br = 0; br < sr; br++)
+      for (bc = 0; bc < sc; bc++)
+         tt_coh_clean[((rb0 + br) & (TT_COH_BH - 1)) * TT_COH_BW
+                    + ((cb0 + bc) & (TT_COH_BW - 1))] = 1;
+}
+
+/* True iff every block the rect touches is clean (=> whole rect coherent). */
+static bool tt_coh_all_clean(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   uint32_t bx0, by0, nbx, nby, kx, ky;
+   if (!w || !h)
+      return true;
+   bx0 = (x & (TT_COH_VRAM_W - 1)) >> TT_COH_SH;
+   by0 = (y & (TT_COH_VRAM_H - 1)) >> TT_COH_SH;
+   nbx = ((x & 7) + w + 7) >> TT_COH_SH; if (nbx > TT_COH_BW) nbx = TT_COH_BW;
+   nby = ((y & 7) + h + 7) >> TT_COH_SH; if (nby > TT_COH_BH) nby = TT_COH_BH;
+   for (ky = 0; ky < nby; ky++)
+      for (kx = 0; kx < nbx; kx++)
+         if (!tt_coh_clean[((by0 + ky) & (TT_COH_BH - 1)) * TT_COH_BW
+                         + ((bx0 + kx) & (TT_COH_BW - 1))])
+            return false;
+   return true;
+}
+
+#if defined(HAVE_VULKAN)
+/* Cover the dirty blocks of a rect with as few sub-rects as the block
+ * grid allows: each 8-row band contributes its runs of horizontally
+ * adjacent dirty blocks, and a run spanning the same columns as one in
+ * the band above extends that rect downwards instead of starting a new
+ * one.  Rects are clipped to the request and kept in its unwrapped
+ * coordinates (x + w may pass 1024), which the backend splits at the
+ * VRAM edge like any wrapping read.  Returns the number of rects, or -1
+ * if more than RHI_READBACK_MAX_RECTS would be needed. */
+static int tt_coh_dirty_rects(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+      struct rhi_vram_rect *out)
+{
+   uint8_t  open[RHI_READBACK_MAX_RECTS], next[RHI_READBACK_MAX_RECTS];
+   unsigned nopen = 0, n = 0;
+   uint32_t x_end = x + w, y_end = y + h, by;
+
+   if (w > TT_COH_VRAM_W)
+      x_end = x + TT_COH_VRAM_W;
+   if (h > TT_COH_VRAM_H)
+      y_end = y + TT_COH_VRAM_H;
+
+   for (by = y; by < y_end; )
+   {
+      const uint8_t *row = tt_coh_clean
+         + ((by >> TT_COH_SH) & (TT_COH_BH - 1)) * TT_COH_BW;
+      uint32_t band_end  = ((by | 7) + 1 < y_end) ? (by | 7) + 1 : y_end;
+      unsigned nnext = 0, o = 0;
+      uint32_t bx = x;
+
+      while (bx < x_end)
+      {
+         uint32_t run0;
+
+         if (row[(bx >> TT_COH_SH) & (TT_COH_BW - 1)])
+         {
+            bx = ((bx | 7) + 1 < x_end) ? (bx | 7) + 1 : x_end;
+            continue;
+         }
+         run0 = bx;
+         while (bx < x_end && !row[(bx >> TT_COH_SH) & (TT_COH_BW - 1)])
+            bx = ((bx | 7) + 1 < x_end) ? (bx | 7) + 1 : x_end;
+
+         /* Runs come in x order, and so do the rects still open from
+          * the band above. */
+         while (o < nopen && out[open[o]].x < run0)
+            o++;
+         if (o < nopen && out[open[o]].x == run0 && out[open[o]].w == bx - run0)
+         {
+            out[open[o]].h += band_end - by;
+            next[nnext++]   = open[o++];
+            continue;
+         }
+         if (n == RHI_READBACK_MAX_RECTS)
+            return -1;
+         out[n].x      = (uint16_t)run0;
+         out[n].y      = (uint16_t)by;
+         out[n].w      = (uint16_t)(bx - run0);
+         out[n].h      = (uint16_t)(band_end - by);
+         next[nnext++] = (uint8_t)n++;
+      }
+
+      memcpy(open, next, nnext);
+      nopen = nnext;
+      by    = band_end;
+   }
+   return (int)n;
+}
+#endif
+
+#endif
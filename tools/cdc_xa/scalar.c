@@ -0,0 +1,19 @@
+/* The scalar reference: cdc_xa.h with every SIMD path compiled out.
+ * Kept in its own translation unit so the reference and the vector
+ * build of the same static INLINE kernels cannot be mixed up by the
+ * compiler. */
+#define CDC_XA_SCALAR
+#include "mednafen/psx/cdc_xa.h"
+
+#include "xa.h"
+
+uint32_t ref_decode_sector(const uint8_t *sdata, int16_t xa_previous[2][2],
+      int16_t samples[2][0x1000])
+{
+   return CDC_XA_DecodeSector(sdata, xa_previous, samples);
+}
+
+int32_t ref_resample(const int16_t *buf, unsigned pos, unsigned phase)
+{
+   return CDC_XA_Resample(buf, pos, phase);
+}
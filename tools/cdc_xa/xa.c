@@ -0,0 +1,394 @@
+/* Differential check for the CD-XA ADPCM kernels.
+ *
+ * CDC_XA_DecodeSector and CDC_XA_Resample (mednafen/psx/cdc_xa.h)
+ * carry SSE2/NEON blocks for the sound-group unpack and the 25-tap
+ * resampler.  This builds the header twice - here with whatever SIMD
+ * the compiler targets, in scalar.c with CDC_XA_SCALAR - and feeds
+ * both the same sector streams:
+ *
+ *   - raw 2352-byte sector images named on the command line (a .bin
+ *     track of an XA-heavy disc); every Form 2 audio sector in them is
+ *     decoded in order, as the CDC would play one interleaved file;
+ *   - a generated stream covering every coding (4/8-bit, mono/stereo,
+ *     37.8/18.9 kHz), every shift and filter the format can encode,
+ *     mismatched parameter copies, and full-scale data that drives the
+ *     filter into its clamp.
+ *
+ * Per sector the decoded samples, the count and the filter history
+ * must match; each decoded stream is then pushed through the
+ * resampler state machine of PS_CDC_GetCDAudio, and every output
+ * sample must match too.  The resampler is also run over every
+ * phase/position pair on saturated buffers, where a lane overflow
+ * would show.
+ *
+ * Afterwards it times both builds; the numbers are only meaningful
+ * relative to each other.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mednafen/psx/cdc_xa.h"
+
+#include "xa.h"
+
+#define SECTOR_SIZE        2352
+#define GENERATED_SECTORS  4000
+
+static uint32_t rng_state = 0x6C8E9CF5u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static int fails = 0;
+static void chk(const char *what, int cond)
+{ printf("  %-54s %s\n", what, cond ? "ok" : "FAIL"); if (!cond) fails++; }
+
+/* Decoder and resampler state for one build, carried across the
+ * sectors of a stream like PS_CDC carries it. */
+typedef struct
+{
+   int16_t  prev[2][2];
+   int16_t  samples[2][0x1000];
+   int16_t  resamp[2][64];
+   unsigned phase;
+   unsigned pos;
+} xa_state;
+
+/* PS_CDC_GetCDAudio's fractional-rate path without the volume stage,
+ * draining one decoded sector. */
+static unsigned resample_sector(xa_state *st, uint32_t size, unsigned freq,
+      int ref, int32_t *out)
+{
+   uint32_t rd = 0;
+   unsigned n  = 0;
+
+   while (rd < size)
+   {
+      unsigned i;
+
+      for (i = 0; i < 2; i++)
+         out[n++] = ref ? ref_resample(st->resamp[i], st->pos, st->phase)
+                        : CDC_XA_Resample(st->resamp[i], st->pos, st->phase);
+
+      st->phase += freq;
+      if (st->phase >= 7)
+      {
+         st->phase -= 7;
+         for (i = 0; i < 2; i++)
+            st->resamp[i][st->pos] = st->resamp[i][st->pos + 32] = st->samples[i][rd];
+         rd++;
+         st->pos = (st->pos + 1) & 0x1F;
+      }
+   }
+   return n;
+}
+
+static xa_state ref_st, simd_st;
+static int32_t  ref_out[2 * 0x1000 * 3], simd_out[2 * 0x1000 * 3];
+
+static void stream_reset(void)
+{
+   memset(&ref_st, 0, sizeof(ref_st));
+   memset(&simd_st, 0, sizeof(simd_st));
+}
+
+/* Both builds decode and resample one sector; 0 on any difference. */
+static int stream_sector(const uint8_t *sdata, unsigned index)
+{
+   const unsigned freq = (sdata[12 + 4 + 3] & XA_CODING_189) ? 3 : 6;
+   uint32_t       rn, sn;
+   unsigned       n;
+
+   rn = ref_decode_sector(sdata, ref_st.prev, ref_st.samples);
+   sn = CDC_XA_DecodeSector(sdata, simd_st.prev, simd_st.samples);
+
+   if (rn != sn || memcmp(ref_st.prev, simd_st.prev, sizeof(ref_st.prev)))
+   {
+      printf("    sector %u (coding %02x): count %u/%u or filter history differs\n",
+            index, sdata[12 + 4 + 3], sn, rn);
+      return 0;
+   }
+   if (memcmp(ref_st.samples[0], simd_st.samples[0], rn * sizeof(int16_t))
+         || memcmp(ref_st.samples[1], simd_st.samples[1], rn * sizeof(int16_t)))
+   {
+      uint32_t c, i;
+      for (c = 0; c < 2; c++)
+         for (i = 0; i < rn; i++)
+            if (ref_st.samples[c][i] != simd_st.samples[c][i])
+            {
+               printf("    sector %u (coding %02x): ch %u sample %u is %d, want %d\n",
+                     index, sdata[12 + 4 + 3], c, i,
+                     simd_st.samples[c][i], ref_st.samples[c][i]);
+               return 0;
+            }
+   }
+
+   n = resample_sector(&ref_st, rn, freq, 1, ref_out);
+   resample_sector(&simd_st, sn, freq, 0, simd_out);
+   if (memcmp(ref_out, simd_out, n * sizeof(int32_t)))
+   {
+      unsigned i;
+      for (i = 0; i < n && ref_out[i] == simd_out[i]; i++)
+         ;
+      printf("    sector %u: resampled output %u is %d, want %d\n",
+            index, i, simd_out[i], ref_out[i]);
+      return 0;
+   }
+   return 1;
+}
+
+/* A Form 2 audio sector: sync, header, subheader, 18 sound groups.
+ * Parameters are what an encoder emits (shift 0-12, filter 0-3,
+ * copies equal) except in one sector in eight, where they are random
+ * bytes with random copies.  One sector in eight is full-scale. */
+static void make_sector(uint8_t *s, uint8_t coding)
+{
+   const int wild = (rng() & 7) == 0;
+   const int loud = (rng() & 7) == 0;
+   unsigned  g, i;
+
+   memset(s, 0, SECTOR_SIZE);
+   memset(s + 1, 0xFF, 10);
+   s[15] = 2;
+   s[16] = s[20] = 1;                                  /* file */
+   s[17] = s[21] = 0;                                  /* channel */
+   s[18] = s[22] = 0x64;                               /* realtime|form2|audio */
+   s[19] = s[23] = coding;
+
+   for (g = 0; g < 18; g++)
+   {
+      uint8_t *sg = &s[24 + g * 128];
+
+      for (i = 0; i < 4; i++)
+      {
+         uint8_t p0 = wild ? (uint8_t)rng()
+                           : (uint8_t)(((rng() & 3) << 4) | (rng() % 13));
+         uint8_t p1 = wild ? (uint8_t)rng()
+                           : (uint8_t)(((rng() & 3) << 4) | (rng() % 13));
+
+         sg[i]      = p0;
+         sg[8 + i]  = p1;
+         sg[4 + i]  = (wild && (rng() & 1)) ? (uint8_t)rng() : p0;
+         sg[12 + i] = (wild && (rng() & 1)) ? (uint8_t)rng() : p1;
+      }
+      for (i = 0; i < 112; i++)
+         sg[16 + i] = loud ? ((rng() & 1) ? 0x77 : 0x88) : (uint8_t)rng();
+   }
+}
+
+static int run_generated(void)
+{
+   static const uint8_t codings[] =
+   {
+      0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15,
+   };
+   static uint8_t sector[SECTOR_SIZE];
+   unsigned       c, i;
+
+   for (c = 0; c < sizeof(codings); c++)
+   {
+      stream_reset();
+      for (i = 0; i < GENERATED_SECTORS / sizeof(codings); i++)
+      {
+         make_sector(sector, codings[c]);
+         if (!stream_sector(sector, i))
+            return 0;
+      }
+   }
+   return 1;
+}
+
+/* Every Form 2 audio sector of a raw image, in order.  Returns the
+ * number decoded, or -1 on a mismatch or unreadable file. */
+static long run_image(const char *path)
+{
+   static const uint8_t sync[12] =
+   { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+   static uint8_t sector[SECTOR_SIZE];
+   FILE          *f = fopen(path, "rb");
+   long           n = 0;
+   unsigned       index = 0;
+
+   if (!f)
+   {
+      printf("    %s: cannot open\n", path);
+      return -1;
+   }
+
+   stream_reset();
+   while (fread(sector, 1, SECTOR_SIZE, f) == SECTOR_SIZE)
+   {
+      index++;
+      if (memcmp(sector, sync, sizeof(sync)) || sector[15] != 2
+            || (sector[18] & 0x24) != 0x24)
+         continue;
+      if (!stream_sector(sector, index - 1))
+      {
+         fclose(f);
+         return -1;
+      }
+      n++;
+   }
+   fclose(f);
+   return n;
+}
+
+/* Every phase at every ring position, over noise, over each
+ * full-scale constant, and over windows whose signs follow the
+ * impulse's (and the reverse), which give the largest sums of all.  A
+ * 32-bit lane overflow in the vector sum would differ from the scalar
+ * sum there. */
+static int run_resample_exhaustive(void)
+{
+   int16_t  buf[64];
+   unsigned f, phase, pos, i;
+
+   for (f = 0; f < 6; f++)
+      for (phase = 0; phase < 7; phase++)
+         for (pos = 0; pos < 32; pos++)
+         {
+            const unsigned start = (pos + 32 - 25) & 0x1F;
+            int32_t        r, s;
+
+            for (i = 0; i < 64; i++)
+            {
+               const int      tap  = (int)i - (int)start;
+               const int16_t  imp  = (tap >= 0 && tap < 25) ? CDADPCMImpulse[phase][tap] : 0;
+
+               switch (f)
+               {
+                  case 0:  buf[i] = (int16_t)rng();                break;
+                  case 1:  buf[i] = 32767;                         break;
+                  case 2:  buf[i] = -32768;                        break;
+                  case 3:  buf[i] = (imp < 0) ? -32768 : 32767;    break;
+                  case 4:  buf[i] = (imp < 0) ? 32767 : -32768;    break;
+                  default: buf[i] = (int16_t)((rng() & 1) ? 32767 : -32768); break;
+               }
+            }
+
+            r = ref_resample(buf, pos, phase);
+            s = CDC_XA_Resample(buf, pos, phase);
+            if (r != s)
+            {
+               printf("    fill %u phase %u pos %u: %d, want %d\n",
+                     f, phase, pos, s, r);
+               return 0;
+            }
+         }
+   return 1;
+}
+
+static double now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench(void)
+{
+   enum { SECTORS = 64, REPS = 200 };
+   static uint8_t sectors[SECTORS][SECTOR_SIZE];
+   static int16_t prev[2][2], samples[2][0x1000];
+   static int16_t buf[2][64];
+   double         t0, t_ref, t_simd;
+   volatile int32_t sink = 0;
+   unsigned       r, i;
+
+   for (i = 0; i < SECTORS; i++)
+      make_sector(sectors[i], (i & 1) ? 0x01 : 0x00);
+
+   t0 = now_ns();
+   for (r = 0; r < REPS; r++)
+      for (i = 0; i < SECTORS; i++)
+         ref_decode_sector(sectors[i], prev, samples);
+   t_ref = (now_ns() - t0) / ((double)REPS * SECTORS);
+
+   t0 = now_ns();
+   for (r = 0; r < REPS; r++)
+      for (i = 0; i < SECTORS; i++)
+      {
+         CDC_XA_DecodeSector(sectors[i], prev, samples);
+         __asm__ __volatile__("" : : "r"(samples) : "memory");
+      }
+   t_simd = (now_ns() - t0) / ((double)REPS * SECTORS);
+
+   printf("  sector decode  scalar %8.1f ns  simd %8.1f ns  (%.2fx)\n",
+         t_ref, t_simd, t_simd > 0.0 ? t_ref / t_simd : 0.0);
+
+   for (i = 0; i < 64; i++)
+      buf[0][i] = buf[1][i] = (int16_t)rng();
+
+   t0 = now_ns();
+   for (r = 0; r < 2000000; r++)
+      sink += ref_resample(buf[r & 1], r & 31, r % 7);
+   t_ref = (now_ns() - t0) / 2000000.0;
+
+   t0 = now_ns();
+   for (r = 0; r < 2000000; r++)
+      sink += CDC_XA_Resample(buf[r & 1], r & 31, r % 7);
+   t_simd = (now_ns() - t0) / 2000000.0;
+
+   printf("  resample       scalar %8.2f ns  simd %8.2f ns  (%.2fx)\n",
+         t_ref, t_simd, t_simd > 0.0 ? t_ref / t_simd : 0.0);
+   (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+   int  do_bench = 1;
+   int  a;
+   char what[96];
+
+   printf("SIMD paths:%s%s%s\n",
+#if defined(CDC_XA_SSE2)
+         " SSE2",
+#else
+         "",
+#endif
+#if defined(CDC_XA_NEON)
+         " NEON",
+#else
+         "",
+#endif
+#if !defined(CDC_XA_SSE2) && !defined(CDC_XA_NEON)
+         " none (scalar against scalar)"
+#else
+         ""
+#endif
+         );
+
+   chk("resampler, every phase and position, bit-exact", run_resample_exhaustive());
+   chk("generated sector streams, bit-exact", run_generated());
+
+   for (a = 1; a < argc; a++)
+   {
+      long n;
+
+      if (!strcmp(argv[a], "--no-bench"))
+      {
+         do_bench = 0;
+         continue;
+      }
+      n = run_image(argv[a]);
+      snprintf(what, sizeof(what), "%.32s: %ld XA sectors, bit-exact",
+            argv[a], n < 0 ? 0 : n);
+      chk(what, n >= 0);
+   }
+
+   if (do_bench)
+   {
+      printf("\n");
+      bench();
+   }
+
+   printf("\n%s\n", fails ? "FAILED" : "all ok");
+   return fails ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#ifndef TOOLS_CDC_XA_H
+#define TOOLS_CDC_XA_H
+
+#include <stdint.h>
+
+/* scalar.c: the kernels with CDC_XA_SCALAR defined. */
+uint32_t ref_decode_sector(const uint8_t *sdata, int16_t xa_previous[2][2],
+      int16_t samples[2][0x1000]);
+int32_t ref_resample(const int16_t *buf, unsigned pos, unsigned phase);
+
+#endif
@@ -0,0 +1,252 @@
+/* Randomized bit-exactness check for the software scanout kernels.
+ *
+ * ReorderRGB_Var and ReorderRGB565_Var (mednafen/psx/gpu_scanout.h)
+ * carry SSE2/AVX2/NEON blocks in front of the historical scalar loops.
+ * This builds the header twice - here with whatever SIMD the compiler
+ * targets, in scalar.c with GPU_SCANOUT_SCALAR - and requires the two
+ * to write identical bytes for random VRAM rows, random start offsets
+ * (including ones right at the fb_x wrap) and random spans, at every
+ * upscale shift the GPU supports and in both 15- and 24-bit modes.
+ *
+ * The destination is compared in full, guard pixels included, so a
+ * vector store that runs past dx_end fails as loudly as a wrong pixel.
+ *
+ * Afterwards it times both builds over full 640-pixel rows; the
+ * numbers are only meaningful relative to each other.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mednafen/psx/gpu_scanout.h"
+
+#include "scanout.h"
+
+#define MAX_SHIFT   4        /* 16x, the largest internal resolution */
+#define DEST_GUARD  64
+#define CASES       20000
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static int fails = 0;
+static void chk(const char *what, int cond)
+{ printf("  %-54s %s\n", what, cond ? "ok" : "FAIL"); if (!cond) fails++; }
+
+/* Three upscaled VRAM rows of noise.  The kernels read row 1; the
+ * 24-bit scalar path's last pixel reads one word into row 2, which is
+ * part of the behaviour being matched, so it has to be readable. */
+static uint16_t *make_rows(unsigned s)
+{
+   const size_t words = (size_t)3 * (1024u << s);
+   uint16_t    *rows  = (uint16_t*)malloc(words * sizeof(uint16_t));
+   size_t       i;
+
+   for (i = 0; i < words; i++)
+      rows[i] = (uint16_t)rng();
+   return rows;
+}
+
+/* Scanout geometry the way gpu.c produces it: native values, then
+ * shifted up.  One case in four starts within a few pixels of the
+ * row wrap, where every SIMD loop has to hand over to scalar. */
+static void pick(unsigned s, int32_t *dx_start, int32_t *dx_end, int32_t *fb_x)
+{
+   int32_t a = (int32_t)(rng() % 769);
+   int32_t b = (int32_t)(rng() % 769);
+   int32_t f = (rng() & 3) ? (int32_t)(rng() & 0x7FF)
+                           : (int32_t)(0x7FF - (rng() % 48));
+
+   if (a > b)
+   {
+      int32_t t = a;
+      a = b;
+      b = t;
+   }
+   *dx_start = a << s;
+   *dx_end   = b << s;
+   *fb_x     = f << s;
+}
+
+static int run_xrgb(unsigned s, bool bpp24)
+{
+   const size_t    n    = ((size_t)768 << s) + DEST_GUARD;
+   uint16_t       *rows = make_rows(s);
+   const uint16_t *src  = rows + (1024u << s);
+   uint32_t       *ref  = (uint32_t*)malloc(n * sizeof(uint32_t));
+   uint32_t       *got  = (uint32_t*)malloc(n * sizeof(uint32_t));
+   int             bad  = 0;
+   int             c;
+
+   for (c = 0; c < CASES && !bad; c++)
+   {
+      int32_t dx_start, dx_end, fb_x;
+      size_t  i;
+
+      pick(s, &dx_start, &dx_end, &fb_x);
+      for (i = 0; i < n; i++)
+         ref[i] = got[i] = 0xDEADBEEFu ^ (uint32_t)i;
+
+      ref_reorder_rgb(bpp24, src, ref, dx_start, dx_end, fb_x, s);
+      ReorderRGB_Var(RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, bpp24, src, got,
+            dx_start, dx_end, fb_x, s, 1u << s);
+
+      if (memcmp(ref, got, n * sizeof(uint32_t)))
+      {
+         for (i = 0; i < n && ref[i] == got[i]; i++)
+            ;
+         printf("    shift %u %s: dx [%d, %d) fb_x %d: pixel %zu is %08x, want %08x\n",
+               s, bpp24 ? "24-bit" : "15-bit", dx_start, dx_end, fb_x,
+               i, got[i], ref[i]);
+         bad = 1;
+      }
+   }
+
+   free(rows);
+   free(ref);
+   free(got);
+   return !bad;
+}
+
+static int run_rgb565(unsigned s, bool bpp24)
+{
+   const size_t    n    = ((size_t)768 << s) + DEST_GUARD;
+   uint16_t       *rows = make_rows(s);
+   const uint16_t *src  = rows + (1024u << s);
+   uint16_t       *ref  = (uint16_t*)malloc(n * sizeof(uint16_t));
+   uint16_t       *got  = (uint16_t*)malloc(n * sizeof(uint16_t));
+   int             bad  = 0;
+   int             c;
+
+   for (c = 0; c < CASES && !bad; c++)
+   {
+      int32_t dx_start, dx_end, fb_x;
+      size_t  i;
+
+      pick(s, &dx_start, &dx_end, &fb_x);
+      for (i = 0; i < n; i++)
+         ref[i] = got[i] = (uint16_t)(0xBEEFu ^ i);
+
+      ref_reorder_rgb565(bpp24, src, ref, dx_start, dx_end, fb_x, s);
+      ReorderRGB565_Var(bpp24, src, got, dx_start, dx_end, fb_x, s, 1u << s);
+
+      if (memcmp(ref, got, n * sizeof(uint16_t)))
+      {
+         for (i = 0; i < n && ref[i] == got[i]; i++)
+            ;
+         printf("    shift %u %s: dx [%d, %d) fb_x %d: pixel %zu is %04x, want %04x\n",
+               s, bpp24 ? "24-bit" : "15-bit", dx_start, dx_end, fb_x,
+               i, got[i], ref[i]);
+         bad = 1;
+      }
+   }
+
+   free(rows);
+   free(ref);
+   free(got);
+   return !bad;
+}
+
+static double now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* ns per output pixel converting a 640-wide row at shift s, i.e. what
+ * one surface row costs in the GPU_Update scanout. */
+static void bench(unsigned s, bool bpp24)
+{
+   const int32_t   w    = 640 << s;
+   const int       reps = 20000 >> s;
+   uint16_t       *rows = make_rows(s);
+   const uint16_t *src  = rows + (1024u << s);
+   uint32_t       *dest = (uint32_t*)calloc((size_t)w + DEST_GUARD, sizeof(uint32_t));
+   double          t0, t_ref, t_simd;
+   int             r;
+
+   t0 = now_ns();
+   for (r = 0; r < reps; r++)
+      ref_reorder_rgb(bpp24, src, dest, 0, w, 0, s);
+   t_ref = (now_ns() - t0) / ((double)reps * w);
+
+   t0 = now_ns();
+   for (r = 0; r < reps; r++)
+   {
+      ReorderRGB_Var(RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, bpp24, src, dest,
+            0, w, 0, s, 1u << s);
+      /* Keep the stores from being folded across iterations. */
+      __asm__ __volatile__("" : : "r"(dest) : "memory");
+   }
+   t_simd = (now_ns() - t0) / ((double)reps * w);
+
+   printf("  shift %u %s  scalar %6.3f ns/px  simd %6.3f ns/px  (%.1fx)\n",
+         s, bpp24 ? "24-bit" : "15-bit", t_ref, t_simd,
+         t_simd > 0.0 ? t_ref / t_simd : 0.0);
+
+   free(rows);
+   free(dest);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned s;
+   char     what[64];
+
+   printf("SIMD paths:%s%s%s%s\n",
+#if defined(GPU_SCANOUT_AVX2)
+         " AVX2",
+#else
+         "",
+#endif
+#if defined(GPU_SCANOUT_SSE2)
+         " SSE2",
+#else
+         "",
+#endif
+#if defined(GPU_SCANOUT_NEON)
+         " NEON",
+#else
+         "",
+#endif
+#if !defined(GPU_SCANOUT_SSE2) && !defined(GPU_SCANOUT_NEON)
+         " none (scalar against scalar)"
+#else
+         ""
+#endif
+         );
+
+   for (s = 0; s <= MAX_SHIFT; s++)
+   {
+      snprintf(what, sizeof(what), "XRGB8888 15-bit, shift %u, bit-exact", s);
+      chk(what, run_xrgb(s, false));
+      snprintf(what, sizeof(what), "XRGB8888 24-bit, shift %u, bit-exact", s);
+      chk(what, run_xrgb(s, true));
+      snprintf(what, sizeof(what), "RGB565 15-bit, shift %u, bit-exact", s);
+      chk(what, run_rgb565(s, false));
+      snprintf(what, sizeof(what), "RGB565 24-bit, shift %u, bit-exact", s);
+      chk(what, run_rgb565(s, true));
+   }
+
+   if (!(argc > 1 && !strcmp(argv[1], "--no-bench")))
+   {
+      printf("\n");
+      for (s = 0; s <= MAX_SHIFT; s++)
+      {
+         bench(s, false);
+         bench(s, true);
+      }
+   }
+
+   printf("\n%s\n", fails ? "FAILED" : "all ok");
+   return fails ? 1 : 0;
+}
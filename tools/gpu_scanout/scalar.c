@@ -0,0 +1,21 @@
+/* The scalar reference: gpu_scanout.h with every SIMD path compiled
+ * out.  Kept in its own translation unit so the reference and the
+ * vector build of the same static INLINE kernels cannot be mixed up
+ * by the compiler. */
+#define GPU_SCANOUT_SCALAR
+#include "mednafen/psx/gpu_scanout.h"
+
+#include "scanout.h"
+
+void ref_reorder_rgb(bool bpp24, const uint16_t *src, uint32_t *dest,
+      int32_t dx_start, int32_t dx_end, int32_t fb_x, unsigned s)
+{
+   ReorderRGB_Var(RED_SHIFT, GREEN_SHIFT, BLUE_SHIFT, bpp24, src, dest,
+         dx_start, dx_end, fb_x, s, 1u << s);
+}
+
+void ref_reorder_rgb565(bool bpp24, const uint16_t *src, uint16_t *dest,
+      int32_t dx_start, int32_t dx_end, int32_t fb_x, unsigned s)
+{
+   ReorderRGB565_Var(bpp24, src, dest, dx_start, dx_end, fb_x, s, 1u << s);
+}
@@ -0,0 +1,13 @@
+#ifndef TOOLS_GPU_SCANOUT_H
+#define TOOLS_GPU_SCANOUT_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+/* scalar.c: the kernels with GPU_SCANOUT_SCALAR defined. */
+void ref_reorder_rgb(bool bpp24, const uint16_t *src, uint32_t *dest,
+      int32_t dx_start, int32_t dx_end, int32_t fb_x, unsigned s);
+void ref_reorder_rgb565(bool bpp24, const uint16_t *src, uint16_t *dest,
+      int32_t dx_start, int32_t dx_end, int32_t fb_x, unsigned s);
+
+#endif
@@ -0,0 +1,26 @@
+/* The scalar reference: gpu_vram_scale.h with every SIMD path compiled
+ * out.  Kept in its own translation unit so the reference and the
+ * vector build of the same static INLINE kernels cannot be mixed up
+ * by the compiler. */
+#define GPU_VRAM_SCALE_SCALAR
+#include "mednafen/psx/gpu_vram_scale.h"
+
+#include "scale.h"
+
+void ref_downsample_row(uint16_t *dst, const uint16_t *src, unsigned n,
+      unsigned shift)
+{
+   vram_downsample_row(dst, src, n, shift);
+}
+
+void ref_replicate_row(uint16_t *dst, const uint16_t *src, unsigned n,
+      unsigned shift)
+{
+   vram_replicate_row(dst, src, n, shift);
+}
+
+unsigned ref_upscale_changed(uint16_t *vram, const uint16_t *native,
+      unsigned shift, bool force)
+{
+   return vram_upscale_changed(vram, native, shift, force);
+}
@@ -0,0 +1,330 @@
+/* Checks and timing for the savestate VRAM scaling kernels.
+ *
+ * vram_downsample_row and vram_replicate_row (mednafen/psx/gpu_vram_scale.h)
+ * carry SSE2/NEON blocks in front of scalar loops.  This builds the
+ * header twice - here with whatever SIMD the compiler targets, in
+ * scalar.c with GPU_VRAM_SCALE_SCALAR - and requires identical bytes
+ * from both for random rows, lengths and offsets at every upscale shift
+ * the GPU supports.
+ *
+ * vram_upscale_changed is then checked against what the per-pixel
+ * texel_put loop it replaces would have left in VRAM, page by page:
+ * pages whose native pixels changed must come out as exact blocks,
+ * pages that did not must be left byte for byte as they were, upscaled
+ * detail included.
+ *
+ * Afterwards it times the old per-pixel save and load loops against the
+ * new ones on a full VRAM; the numbers are only meaningful relative to
+ * each other.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mednafen/psx/gpu_vram_scale.h"
+
+#include "scale.h"
+
+#define MAX_SHIFT   4        /* 16x, the largest internal resolution */
+#define GUARD       64
+#define CASES       20000
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static int fails = 0;
+static void chk(const char *what, int cond)
+{ printf("  %-54s %s\n", what, cond ? "ok" : "FAIL"); if (!cond) fails++; }
+
+/* The loops gpu.c used before, verbatim apart from the GPU struct. */
+static void old_downscale(uint16_t *native, const uint16_t *vram, unsigned s)
+{
+   unsigned x, y;
+   for (y = 0; y < 512; y++)
+      for (x = 0; x < 1024; x++)
+         native[y * 1024 + x] = vram[((y << s) << (10 + s)) | (x << s)];
+}
+
+static void old_upscale(uint16_t *vram, const uint16_t *native, unsigned s)
+{
+   unsigned x, y, dx, dy;
+   for (y = 0; y < 512; y++)
+      for (x = 0; x < 1024; x++)
+         for (dy = 0; dy < (1u << s); dy++)
+            for (dx = 0; dx < (1u << s); dx++)
+               vram[(((y << s) + dy) << (10 + s)) | ((x << s) + dx)] =
+                  native[y * 1024 + x];
+}
+
+static uint16_t *alloc_words(size_t n)
+{
+   uint16_t *p = (uint16_t*)malloc(n * sizeof(uint16_t));
+   if (!p)
+   {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+   }
+   return p;
+}
+
+static void fill(uint16_t *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = (uint16_t)rng();
+}
+
+static void check_rows(unsigned s)
+{
+   uint16_t      *src = alloc_words((1024u << s) + GUARD);
+   uint16_t      *a   = alloc_words((1024u << s) + GUARD);
+   uint16_t      *b   = alloc_words((1024u << s) + GUARD);
+   int            down_ok = 1, rep_ok = 1;
+   unsigned       c;
+   char           what[64];
+
+   for (c = 0; c < CASES; c++)
+   {
+      /* Lengths straddle the 8-pixel vector block; offsets are not
+       * vector aligned. */
+      const unsigned n   = (c & 1) ? (rng() % 24) : (rng() % 1024) + 1;
+      const unsigned off = rng() % 8;
+
+      if (n + off > 1024)
+         continue;
+
+      fill(src, (1024u << s) + GUARD);
+      fill(a, (1024u << s) + GUARD);
+      memcpy(b, a, ((1024u << s) + GUARD) * sizeof(uint16_t));
+      vram_downsample_row(a + off, src + (off << s), n, s);
+      ref_downsample_row(b + off, src + (off << s), n, s);
+      if (memcmp(a, b, ((1024u << s) + GUARD) * sizeof(uint16_t)))
+         down_ok = 0;
+
+      fill(a, (1024u << s) + GUARD);
+      memcpy(b, a, ((1024u << s) + GUARD) * sizeof(uint16_t));
+      vram_replicate_row(a + (off << s), src + off, n, s);
+      ref_replicate_row(b + (off << s), src + off, n, s);
+      if (memcmp(a, b, ((1024u << s) + GUARD) * sizeof(uint16_t)))
+         rep_ok = 0;
+   }
+
+   snprintf(what, sizeof(what), "%ux downsample_row matches scalar", 1u << s);
+   chk(what, down_ok);
+   snprintf(what, sizeof(what), "%ux replicate_row matches scalar", 1u << s);
+   chk(what, rep_ok);
+
+   free(src);
+   free(a);
+   free(b);
+}
+
+/* Are all pixels of native (px, py)'s page in vram exact blocks of
+ * native? */
+static int page_is_blocks(const uint16_t *vram, const uint16_t *native,
+      unsigned s, unsigned px, unsigned py)
+{
+   unsigned x, y, dx, dy;
+   for (y = py; y < py + VRAM_SCALE_PAGE_H; y++)
+      for (x = px; x < px + VRAM_SCALE_PAGE_W; x++)
+         for (dy = 0; dy < (1u << s); dy++)
+            for (dx = 0; dx < (1u << s); dx++)
+               if (vram[(((y << s) + dy) << (10 + s)) | ((x << s) + dx)]
+                     != native[y * 1024 + x])
+                  return 0;
+   return 1;
+}
+
+static int page_equal(const uint16_t *a, const uint16_t *b, unsigned s,
+      unsigned px, unsigned py)
+{
+   const size_t pitch = (size_t)1024 << s;
+   unsigned     y;
+   for (y = py << s; y < (py + VRAM_SCALE_PAGE_H) << s; y++)
+      if (memcmp(&a[y * pitch + (px << s)], &b[y * pitch + (px << s)],
+               (VRAM_SCALE_PAGE_W << s) * sizeof(uint16_t)))
+         return 0;
+   return 1;
+}
+
+static void check_upscale(unsigned s)
+{
+   const size_t words = (size_t)(1024u << s) * (512u << s);
+   uint16_t    *vram  = alloc_words(words);
+   uint16_t    *ref   = alloc_words(words);
+   uint16_t    *prev  = alloc_words(words);
+   uint16_t    *nat   = alloc_words(1024 * 512);
+   uint16_t    *back  = alloc_words(1024 * 512);
+   bool         changed[VRAM_SCALE_PAGES];
+   unsigned     expect = 0, got, got_ref, p, i;
+   int          blocks_ok = 1, kept_ok = 1;
+   char         what[64];
+
+   /* Full rewrite from scratch matches the texel_put loop. */
+   fill(nat, 1024 * 512);
+   fill(vram, words);
+   got = vram_upscale_changed(vram, nat, s, true);
+   old_upscale(ref, nat, s);
+   snprintf(what, sizeof(what), "%ux forced upscale matches texel_put loop", 1u << s);
+   chk(what, got == VRAM_SCALE_PAGES && !memcmp(vram, ref, words * sizeof(uint16_t)));
+
+   vram_downscale(back, vram, s);
+   old_downscale(nat, vram, s);
+   snprintf(what, sizeof(what), "%ux downscale matches texel_fetch loop", 1u << s);
+   chk(what, !memcmp(back, nat, 1024 * 512 * sizeof(uint16_t)));
+
+   /* Upscaled detail the renderer drew: noise in every non-top-left
+    * subpixel, which a load must keep on unchanged pages. */
+   for (i = 0; i < words; i++)
+   {
+      const size_t x = i & ((1024u << s) - 1), y = i >> (10 + s);
+      if ((x | y) & ((1u << s) - 1))
+         vram[i] = (uint16_t)rng();
+   }
+   memcpy(prev, vram, words * sizeof(uint16_t));
+
+   /* Change one native pixel on a third of the pages. */
+   for (p = 0; p < VRAM_SCALE_PAGES; p++)
+   {
+      const unsigned px = (p % (1024 / VRAM_SCALE_PAGE_W)) * VRAM_SCALE_PAGE_W;
+      const unsigned py = (p / (1024 / VRAM_SCALE_PAGE_W)) * VRAM_SCALE_PAGE_H;
+
+      changed[p] = (rng() % 3) == 0;
+      if (changed[p])
+      {
+         const unsigned x = px + rng() % VRAM_SCALE_PAGE_W;
+         const unsigned y = py + rng() % VRAM_SCALE_PAGE_H;
+         nat[y * 1024 + x] ^= 1 + (rng() & 0x7FFF);
+         expect++;
+      }
+   }
+
+   memcpy(ref, vram, words * sizeof(uint16_t));
+   got     = vram_upscale_changed(vram, nat, s, false);
+   got_ref = ref_upscale_changed(ref, nat, s, false);
+
+   for (p = 0; p < VRAM_SCALE_PAGES; p++)
+   {
+      const unsigned px = (p % (1024 / VRAM_SCALE_PAGE_W)) * VRAM_SCALE_PAGE_W;
+      const unsigned py = (p / (1024 / VRAM_SCALE_PAGE_W)) * VRAM_SCALE_PAGE_H;
+
+      if (changed[p])
+         blocks_ok &= page_is_blocks(vram, nat, s, px, py);
+      else
+         kept_ok &= page_equal(vram, prev, s, px, py);
+   }
+
+   snprintf(what, sizeof(what), "%ux load rewrites exactly the changed pages", 1u << s);
+   chk(what, got == expect && got_ref == expect);
+   snprintf(what, sizeof(what), "%ux rewritten pages are exact blocks", 1u << s);
+   chk(what, blocks_ok);
+   snprintf(what, sizeof(what), "%ux unchanged pages keep their detail", 1u << s);
+   chk(what, kept_ok);
+   snprintf(what, sizeof(what), "%ux load matches scalar build", 1u << s);
+   chk(what, !memcmp(vram, ref, words * sizeof(uint16_t)));
+
+   vram_downscale(back, vram, s);
+   snprintf(what, sizeof(what), "%ux save after load gives the loaded VRAM", 1u << s);
+   chk(what, !memcmp(back, nat, 1024 * 512 * sizeof(uint16_t)));
+
+   free(vram);
+   free(ref);
+   free(prev);
+   free(nat);
+   free(back);
+}
+
+static double now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void bench(unsigned s)
+{
+   const size_t words = (size_t)(1024u << s) * (512u << s);
+   uint16_t    *vram  = alloc_words(words);
+   uint16_t    *nat   = alloc_words(1024 * 512);
+   const int    reps  = s >= 3 ? 2 : 10;
+   double       t, t_old_save, t_new_save, t_old_load, t_new_all, t_new_few;
+   int          r;
+
+   fill(nat, 1024 * 512);
+   old_upscale(vram, nat, s);
+
+   t = now_ms();
+   for (r = 0; r < reps; r++)
+      old_downscale(nat, vram, s);
+   t_old_save = (now_ms() - t) / reps;
+
+   t = now_ms();
+   for (r = 0; r < reps; r++)
+      vram_downscale(nat, vram, s);
+   t_new_save = (now_ms() - t) / reps;
+
+   t = now_ms();
+   for (r = 0; r < reps; r++)
+      old_upscale(vram, nat, s);
+   t_old_load = (now_ms() - t) / reps;
+
+   t = now_ms();
+   for (r = 0; r < reps; r++)
+      vram_upscale_changed(vram, nat, s, true);
+   t_new_all = (now_ms() - t) / reps;
+
+   /* The run-ahead case: two pages of drawing changed since the state
+    * was saved. */
+   t = now_ms();
+   for (r = 0; r < reps; r++)
+   {
+      nat[100 * 1024 + 100] ^= 1;
+      nat[300 * 1024 + 700] ^= 1;
+      vram_upscale_changed(vram, nat, s, false);
+   }
+   t_new_few = (now_ms() - t) / reps;
+
+   printf("  %2ux  save %7.2f -> %6.2f ms   load %7.2f -> %6.2f ms (all pages)"
+         " / %5.2f ms (2 pages)\n", 1u << s, t_old_save, t_new_save,
+         t_old_load, t_new_all, t_new_few);
+
+   free(vram);
+   free(nat);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned s;
+   int      do_bench = !(argc > 1 && !strcmp(argv[1], "--no-bench"));
+
+   printf("row kernels\n");
+   for (s = 1; s <= MAX_SHIFT; s++)
+      check_rows(s);
+
+   printf("savestate load/save\n");
+   for (s = 1; s <= MAX_SHIFT; s++)
+      check_upscale(s);
+
+   if (fails)
+   {
+      printf("%d check(s) FAILED\n", fails);
+      return 1;
+   }
+   printf("all checks passed\n");
+
+   if (do_bench)
+   {
+      printf("\ntiming, per whole VRAM (old per-pixel loops -> new)\n");
+      for (s = 1; s <= MAX_SHIFT; s++)
+         bench(s);
+   }
+   return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef TOOLS_GPU_VRAM_H
+#define TOOLS_GPU_VRAM_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+/* scalar.c: the kernels with GPU_VRAM_SCALE_SCALAR defined. */
+void ref_downsample_row(uint16_t *dst, const uint16_t *src, unsigned n,
+      unsigned shift);
+void ref_replicate_row(uint16_t *dst, const uint16_t *src, unsigned n,
+      unsigned shift);
+unsigned ref_upscale_changed(uint16_t *vram, const uint16_t *native,
+      unsigned shift, bool force);
+
+#endif
@@ -0,0 +1,64 @@
+/* What gte.c links against outside the GTE: the PGXP shadow hooks,
+ * which record their calls so the builds can be compared on them too,
+ * and the core options it reads. */
+#include <stdint.h>
+#include <string.h>
+#include <boolean.h>
+
+#include "stubs.h"
+
+uint32_t gMode;
+uint8_t  widescreen_hack;
+uint8_t  widescreen_hack_aspect_ratio_setting;
+bool     psx_gte_overclock;
+
+pgxp_call pgxp_log[PGXP_LOG_MAX];
+unsigned  pgxp_log_count;
+
+static void record(unsigned what, const float *f, unsigned nf, uint32_t v)
+{
+   pgxp_call *c;
+
+   if (pgxp_log_count >= PGXP_LOG_MAX)
+      return;
+   c = &pgxp_log[pgxp_log_count++];
+   memset(c, 0, sizeof(*c));
+   c->what  = what;
+   c->value = v;
+   memcpy(c->f, f, nf * sizeof(float));
+}
+
+void PGXP_pushSXYZ2f(float x, float y, float z, uint32_t v)
+{
+   const float f[3] = { x, y, z };
+   record(1, f, 3, v);
+}
+
+void PGXP_pushRGBf(float r, float g, float b, uint32_t v)
+{
+   const float f[3] = { r, g, b };
+   record(2, f, 3, v);
+}
+
+void PGXP_GTE_SetFogContext(float pre_r, float pre_g, float pre_b,
+      float fc_r, float fc_g, float fc_b, float t)
+{
+   const float f[7] = { pre_r, pre_g, pre_b, fc_r, fc_g, fc_b, t };
+   record(3, f, 7, 0);
+}
+
+int PGXP_NCLIP_valid(uint32_t sxy0, uint32_t sxy1, uint32_t sxy2)
+{
+   return 0;
+}
+
+double PGXP_NCLIP(void)
+{
+   return 0.0;
+}
+
+int MDFNSS_StateAction(void *st, int load, int data_only,
+      void *sf, const char *name)
+{
+   return 1;
+}
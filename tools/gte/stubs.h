@@ -0,0 +1,19 @@
+#ifndef TOOLS_GTE_STUBS_H
+#define TOOLS_GTE_STUBS_H
+
+#include <stdint.h>
+
+/* One PGXP hook call: 1 = pushSXYZ2f, 2 = pushRGBf, 3 = SetFogContext. */
+typedef struct
+{
+   unsigned what;
+   uint32_t value;
+   float    f[7];
+} pgxp_call;
+
+#define PGXP_LOG_MAX 64
+
+extern pgxp_call pgxp_log[PGXP_LOG_MAX];
+extern unsigned  pgxp_log_count;
+
+#endif
@@ -0,0 +1,333 @@
+/* Differential check for the GTE triple-vertex ops.
+ *
+ * RTPT, NCT, NCCT and NCDT run their matrix products for V0-V2 in
+ * parallel lanes (GTE_MulMat3x3, mednafen/psx/gte_triple.h).  The
+ * Makefile builds the whole of mednafen/psx/gte.c three times:
+ *
+ *   ref - GTE_TRIPLE_REFERENCE: the historical ops, one vertex after
+ *         another through the single-vector paths;
+ *   scl - the triple ops on the scalar kernel, as a target without
+ *         SSE2 or NEON runs them;
+ *   vec - the triple ops on the SSE2 or NEON kernel.
+ *
+ * Every case runs one GTE instruction on the same random register file
+ * in all three builds.  The 64 registers afterwards (FLAG included),
+ * the returned cycle count and the sequence of PGXP shadow calls must
+ * be identical.  Register files are drawn to reach the edges:
+ * translations straddling the 44-bit accumulator limit in both
+ * directions, matrix and vector elements at -32768 and 32767, and H
+ * around the vertex Z so the divide clips.  Every instruction code is
+ * exercised, not only the triple ops, with random sf, lm, mx, v and cv
+ * fields, with the PGXP shadow both off and on and with the widescreen
+ * hack both off and on.  The run fails unless every A_MV overflow bit
+ * was raised by at least one case of each triple op.
+ *
+ * Afterwards it times the triple ops in the three builds on game-like
+ * register files; the numbers are only meaningful relative to each
+ * other.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <boolean.h>
+
+#include "stubs.h"
+
+#define GTE_DECLARE(p) \
+   void    p##_GTE_SwitchRegisters(bool use_regs, uint32_t *regs); \
+   void    p##_GTE_Init(void); \
+   void    p##_GTE_Power(void); \
+   int32_t p##_GTE_Instruction(uint32_t instr);
+
+GTE_DECLARE(ref)
+GTE_DECLARE(scl)
+GTE_DECLARE(vec)
+
+extern uint32_t gMode;
+extern uint8_t  widescreen_hack;
+extern uint8_t  widescreen_hack_aspect_ratio_setting;
+
+typedef struct
+{
+   const char *name;
+   int32_t   (*instruction)(uint32_t instr);
+   uint32_t    regs[64];
+   pgxp_call   log[PGXP_LOG_MAX];
+   unsigned    log_count;
+} build;
+
+static build builds[3];
+
+#define CASES_PER_CODE 200000
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static int fails = 0;
+static void chk(const char *what, int cond)
+{ printf("  %-54s %s\n", what, cond ? "ok" : "FAIL"); if (!cond) fails++; }
+
+/* A 16-bit matrix or vector element, weighted toward the extremes. */
+static uint16_t edge16(void)
+{
+   switch (rng() & 7)
+   {
+      case 0:  return 0x8000;
+      case 1:  return 0x7FFF;
+      case 2:  return 0x8000 + (rng() & 0xFF);
+      case 3:  return 0x7FFF - (rng() & 0xFF);
+      case 4:  return rng() & 0x1FFF;
+      case 5:  return (rng() & 1) ? 0 : 1 << (rng() & 15);
+      default: return rng();
+   }
+}
+
+/* A 32-bit translation.  T << 12 plus three products reaches the
+ * 44-bit limit for |T| within 786432 of 2^31, so straddle that; the
+ * ends themselves, with zero or power-of-two products, land exactly on
+ * the limit. */
+static uint32_t edge32(void)
+{
+   switch (rng() & 7)
+   {
+      case 0:  return 0x7FFFFFFFu - (rng() & 0x1FFFFF);
+      case 1:  return 0x80000000u + (rng() & 0x1FFFFF);
+      case 2:  return rng() & 0xFFFF;
+      case 3:  return -(rng() & 0xFFFF);
+      case 4:  return (rng() & 1) ? 0x7FFFFFFFu : 0x80000000u;
+      default: return rng();
+   }
+}
+
+static void random_regs(uint32_t *r)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++)
+      r[i] = (rng() & 1) ? rng() : ((uint32_t)edge16() | ((uint32_t)edge16() << 16));
+
+   /* Translations: TR, BK, FC. */
+   for (i = 0; i < 3; i++)
+   {
+      r[32 + 5 + i]  = edge32();
+      r[32 + 13 + i] = edge32();
+      r[32 + 21 + i] = edge32();
+   }
+
+   /* H against the Z range, so Divide both divides and clips. */
+   switch (rng() & 3)
+   {
+      case 0: r[32 + 26] = 0; break;
+      case 1: r[32 + 26] = rng() & 0x3FF; break;
+      default: break;
+   }
+}
+
+/* A register file a game might run the op on: unit-ish matrices,
+ * small translations and vectors, a normal projection. */
+static void game_regs(uint32_t *r)
+{
+   unsigned i;
+
+   memset(r, 0, 64 * sizeof(*r));
+   for (i = 0; i < 6; i++)
+      r[i] = ((rng() & 0x3FF) - 0x200) | (((rng() & 0x3FF) - 0x200) << 16);
+   r[6] = rng();
+   r[8] = rng() & 0xFFF;
+   for (i = 0; i < 3; i++)
+   {
+      r[32 + 0 + i * 8] = ((rng() & 0x1FFF) - 0x1000) | (((rng() & 0x1FFF) - 0x1000) << 16);
+      r[32 + 1 + i * 8] = ((rng() & 0x1FFF) - 0x1000) | (((rng() & 0x1FFF) - 0x1000) << 16);
+      r[32 + 2 + i * 8] = ((rng() & 0x1FFF) - 0x1000) | (((rng() & 0x1FFF) - 0x1000) << 16);
+      r[32 + 3 + i * 8] = ((rng() & 0x1FFF) - 0x1000) | (((rng() & 0x1FFF) - 0x1000) << 16);
+      r[32 + 4 + i * 8] = (rng() & 0x1FFF) - 0x1000;
+      r[32 + 5 + i * 8] = (rng() & 0x7FF) - 0x400;
+      r[32 + 6 + i * 8] = (rng() & 0x7FF) - 0x400;
+      r[32 + 7 + i * 8] = (rng() & 0x7FF) + 0x400;
+   }
+   r[32 + 24] = 160 << 16;
+   r[32 + 25] = 120 << 16;
+   r[32 + 26] = 320;
+   r[32 + 27] = 0xFF00;
+   r[32 + 28] = 0x1400000;
+}
+
+static void run(build *b, const uint32_t *in, uint32_t instr, int32_t *ret)
+{
+   memcpy(b->regs, in, sizeof(b->regs));
+   pgxp_log_count = 0;
+   *ret = b->instruction(instr);
+   b->log_count = pgxp_log_count;
+   memcpy(b->log, pgxp_log, sizeof(b->log));
+}
+
+static int same(const build *a, const build *b, int32_t ra, int32_t rb)
+{
+   return ra == rb
+      && !memcmp(a->regs, b->regs, sizeof(a->regs))
+      && a->log_count == b->log_count
+      && !memcmp(a->log, b->log, a->log_count * sizeof(a->log[0]));
+}
+
+static void report(const char *what, uint32_t instr, const uint32_t *in,
+      const build *a, const build *b)
+{
+   unsigned i;
+
+   printf("    %s: %s vs %s differ, instr %08x, gMode %u, ws %u\n", what,
+         a->name, b->name, instr, gMode, widescreen_hack);
+   for (i = 0; i < 64; i++)
+      if (a->regs[i] != b->regs[i])
+         printf("      %s[%2u]: in %08x  %s %08x  %s %08x\n",
+               i < 32 ? "DR" : "CR", i & 31, in[i],
+               a->name, a->regs[i], b->name, b->regs[i]);
+   if (a->log_count != b->log_count)
+      printf("      pgxp calls: %u vs %u\n", a->log_count, b->log_count);
+}
+
+static const struct
+{
+   const char *name;
+   unsigned    code;
+   bool        triple;
+} ops[] =
+{
+   { "RTPS",  0x01, false }, { "NCLIP", 0x06, false }, { "OP",    0x0C, false },
+   { "DPCS",  0x10, false }, { "INTPL", 0x11, false }, { "MVMVA", 0x12, false },
+   { "NCDS",  0x13, false }, { "CDP",   0x14, false }, { "NCDT",  0x16, true  },
+   { "DCPL",  0x1A, false }, { "NCCS",  0x1B, false }, { "CC",    0x1C, false },
+   { "NCS",   0x1E, false }, { "NCT",   0x20, true  }, { "SQR",   0x28, false },
+   { "DPCT",  0x2A, false }, { "AVSZ3", 0x2D, false }, { "AVSZ4", 0x2E, false },
+   { "RTPT",  0x30, true  }, { "GPF",   0x3D, false }, { "GPL",   0x3E, false },
+   { "NCCT",  0x3F, true  },
+};
+
+#define NOPS (sizeof(ops) / sizeof(ops[0]))
+
+static void check_op(unsigned o)
+{
+   static uint32_t in[64];
+   uint32_t seen = 0;
+   unsigned n, bad = 0;
+   char     line[96];
+
+   for (n = 0; n < CASES_PER_CODE; n++)
+   {
+      const uint32_t instr = ops[o].code | ((rng() & 0x1FFFF) << 6) | (0x25u << 25);
+      int32_t        ret[3];
+      unsigned       b;
+
+      random_regs(in);
+      gMode                                = (rng() & 3) ? 0 : 0xFFFFFFFFu;
+      widescreen_hack                      = (rng() & 3) == 0;
+      widescreen_hack_aspect_ratio_setting = rng() % 8;
+
+      for (b = 0; b < 3; b++)
+         run(&builds[b], in, instr, &ret[b]);
+
+      seen |= builds[0].regs[32 + 31];
+
+      for (b = 1; b < 3; b++)
+         if (!same(&builds[0], &builds[b], ret[0], ret[b]))
+         {
+            if (bad++ < 3)
+               report(ops[o].name, instr, in, &builds[0], &builds[b]);
+         }
+   }
+
+   snprintf(line, sizeof(line), "%-5s %u cases, scl and vec match ref",
+         ops[o].name, CASES_PER_CODE);
+   chk(line, !bad);
+
+   /* Bits 25-30: A_MV overflow/underflow on each of the three rows. */
+   if (ops[o].triple)
+   {
+      snprintf(line, sizeof(line), "%-5s raised every MAC1-3 overflow flag",
+            ops[o].name);
+      chk(line, (seen & 0x7E000000u) == 0x7E000000u);
+   }
+}
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define BENCH_STATES 256
+#define BENCH_ITERS  2000000
+
+static void bench(void)
+{
+   static uint32_t states[BENCH_STATES][64];
+   unsigned o, b, i;
+
+   gMode           = 0;
+   widescreen_hack = 0;
+   for (i = 0; i < BENCH_STATES; i++)
+      game_regs(states[i]);
+
+   printf("\nns per op (game-like registers, PGXP off):\n");
+   printf("  %-6s %8s %8s %8s\n", "", "ref", "scl", "vec");
+   for (o = 0; o < NOPS; o++)
+   {
+      double ns[3];
+
+      if (!ops[o].triple)
+         continue;
+
+      for (b = 0; b < 3; b++)
+      {
+         const uint32_t instr = ops[o].code | (1 << 19) | (0x25u << 25);
+         double t0;
+
+         t0 = now_sec();
+         for (i = 0; i < BENCH_ITERS; i++)
+         {
+            memcpy(builds[b].regs, states[i & (BENCH_STATES - 1)], 64 * sizeof(uint32_t));
+            builds[b].instruction(instr);
+         }
+         ns[b] = (now_sec() - t0) * 1e9 / BENCH_ITERS;
+      }
+      printf("  %-6s %8.1f %8.1f %8.1f\n", ops[o].name, ns[0], ns[1], ns[2]);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   bool     timing = !(argc > 1 && !strcmp(argv[1], "--no-bench"));
+   unsigned o;
+
+   builds[0].name = "ref"; builds[0].instruction = ref_GTE_Instruction;
+   builds[1].name = "scl"; builds[1].instruction = scl_GTE_Instruction;
+   builds[2].name = "vec"; builds[2].instruction = vec_GTE_Instruction;
+
+   ref_GTE_Init(); ref_GTE_Power(); ref_GTE_SwitchRegisters(true, builds[0].regs);
+   scl_GTE_Init(); scl_GTE_Power(); scl_GTE_SwitchRegisters(true, builds[1].regs);
+   vec_GTE_Init(); vec_GTE_Power(); vec_GTE_SwitchRegisters(true, builds[2].regs);
+
+   printf("GTE ops, three builds of gte.c on random register files:\n");
+   for (o = 0; o < NOPS; o++)
+      check_op(o);
+
+   if (fails)
+   {
+      printf("\nFAILED (%d)\n", fails);
+      return 1;
+   }
+   printf("\nPASS\n");
+
+   if (timing)
+      bench();
+   return 0;
+}
@@ -83,7 +83,12 @@ static void gpu_deliver(const uint32_t* addrs, const uint32_t* words,
 {
    unsigned i;
    for (i = 0; i < n; i++)
-      PGXP_WriteFIFO(ReadMem(addrs[i]), i);   /* GPU_WriteCB */
+   {
+      PGXP_value v;
+      if (!ReadMem(&v, addrs[i]))
+         v = PGXP_value_invalid_address;
+      PGXP_WriteFIFO(&v, i);                  /* GPU_WriteCB */
+   }
    for (i = 0; i < n; i++)
       PGXP_WriteCB(PGXP_ReadFIFO(i), i);      /* ProcessFIFO */
    (void)words;
@@ -0,0 +1,302 @@
+/* Readback coherence harness: tt_coh_dirty_rects against a pixel scan.
+ *
+ * rhi/rhi_vram_coh.h is included as rhi_intf.c includes it, so the block
+ * grid and the four block operations are the core's own.  The grid is
+ * filled either directly (random patterns of every density) or through
+ * tt_coh_dirty / tt_coh_clean_rect, then random read requests are split
+ * with tt_coh_dirty_rects and the result is checked three ways:
+ *
+ *  - Cover: every pixel of the request whose block is dirty is covered by
+ *    exactly one rect, no pixel of a clean block is covered, and no rect
+ *    leaves the request (in its unwrapped coordinates).
+ *  - Count: a reference built per pixel rather than per block (the runs of
+ *    dirty pixels in each 8-row band, a run continuing the rect above it
+ *    when its columns are the same) gives the same number of rects, and
+ *    -1 exactly when that number is over RHI_READBACK_MAX_RECTS.
+ *  - Agreement with tt_coh_all_clean: no rects iff the request is clean.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rhi/rhi_vram_coh.h"
+
+static int failures;
+static unsigned long cases, fallbacks, empty;
+
+static uint8_t cover[TT_COH_VRAM_H][TT_COH_VRAM_W];
+
+static uint32_t rng_state = 0x12345678u;
+
+static uint32_t rng(void)
+{
+   /* xorshift32 */
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static void fail(const char *what, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   if (failures++ < 10)
+      printf("FAIL: %s (request %u,%u %ux%u)\n", what,
+            (unsigned)x, (unsigned)y, (unsigned)w, (unsigned)h);
+}
+
+static bool pixel_dirty(uint32_t px, uint32_t py)
+{
+   px &= TT_COH_VRAM_W - 1;
+   py &= TT_COH_VRAM_H - 1;
+   return !tt_coh_clean[(py >> TT_COH_SH) * TT_COH_BW + (px >> TT_COH_SH)];
+}
+
+/* Number of rects the per-pixel reference needs for the request. */
+static unsigned ref_rects(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   static uint32_t prev0[TT_COH_BW], prev1[TT_COH_BW];
+   static uint32_t cur0[TT_COH_BW], cur1[TT_COH_BW];
+   unsigned nprev = 0, count = 0;
+   uint32_t by;
+
+   if (w > TT_COH_VRAM_W)
+      w = TT_COH_VRAM_W;
+   if (h > TT_COH_VRAM_H)
+      h = TT_COH_VRAM_H;
+
+   for (by = y; by < y + h; )
+   {
+      uint32_t band_end = (by | 7) + 1;
+      unsigned ncur = 0, i, k;
+      uint32_t px = x;
+
+      if (band_end > y + h)
+         band_end = y + h;
+
+      while (px < x + w)
+      {
+         uint32_t run0;
+
+         if (!pixel_dirty(px, by))
+         {
+            px++;
+            continue;
+         }
+         run0 = px;
+         while (px < x + w && pixel_dirty(px, by))
+            px++;
+         cur0[ncur]   = run0;
+         cur1[ncur++] = px;
+      }
+
+      for (i = 0; i < ncur; i++)
+      {
+         for (k = 0; k < nprev; k++)
+            if (prev0[k] == cur0[i] && prev1[k] == cur1[i])
+               break;
+         if (k == nprev)
+            count++;
+      }
+
+      memcpy(prev0, cur0, ncur * sizeof(*cur0));
+      memcpy(prev1, cur1, ncur * sizeof(*cur1));
+      nprev = ncur;
+      by    = band_end;
+   }
+   return count;
+}
+
+static void check_request(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+   struct rhi_vram_rect out[RHI_READBACK_MAX_RECTS];
+   uint32_t cw = w > TT_COH_VRAM_W ? TT_COH_VRAM_W : w;
+   uint32_t ch = h > TT_COH_VRAM_H ? TT_COH_VRAM_H : h;
+   unsigned expect = ref_rects(x, y, w, h);
+   int n = tt_coh_dirty_rects(x, y, w, h, out);
+   int i;
+   uint32_t px, py;
+
+   cases++;
+
+   if (expect > RHI_READBACK_MAX_RECTS)
+   {
+      fallbacks++;
+      if (n != -1)
+         fail("more rects than allowed, but no fallback", x, y, w, h);
+      return;
+   }
+   if (n != (int)expect)
+   {
+      if (failures < 10)
+         printf("      got %d rects, reference %u\n", n, expect);
+      fail("rect count", x, y, w, h);
+      return;
+   }
+   if ((n == 0) != tt_coh_all_clean(x, y, w, h))
+      fail("disagrees with tt_coh_all_clean", x, y, w, h);
+   if (n == 0)
+   {
+      empty++;
+      return;
+   }
+
+   for (py = 0; py < ch; py++)
+      memset(cover[py], 0, cw);
+
+   for (i = 0; i < n; i++)
+   {
+      const struct rhi_vram_rect *r = &out[i];
+
+      if (!r->w || !r->h
+            || r->x < x || r->x + r->w > x + cw
+            || r->y < y || r->y + r->h > y + ch)
+      {
+         fail("rect outside the request", x, y, w, h);
+         return;
+      }
+      for (py = r->y - y; py < r->y - y + r->h; py++)
+         for (px = r->x - x; px < r->x - x + r->w; px++)
+            cover[py][px]++;
+   }
+
+   for (py = 0; py < ch; py++)
+      for (px = 0; px < cw; px++)
+         if (cover[py][px] != (pixel_dirty(x + px, y + py) ? 1 : 0))
+         {
+            fail(cover[py][px] > 1 ? "rects overlap"
+                  : cover[py][px] ? "clean block read back"
+                  : "dirty block missed", x, y, w, h);
+            return;
+         }
+}
+
+/* A request anywhere in VRAM.  Half of them are small, as most reads
+ * are; some are wider or taller than VRAM, which the core clamps. */
+static void random_request(void)
+{
+   uint32_t x = rng() % TT_COH_VRAM_W;
+   uint32_t y = rng() % TT_COH_VRAM_H;
+   uint32_t w, h;
+
+   switch (rng() % 4)
+   {
+      case 0:
+         w = 1 + rng() % 64;
+         h = 1 + rng() % 64;
+         break;
+      case 1:
+         w = 1 + rng() % TT_COH_VRAM_W;
+         h = 1 + rng() % TT_COH_VRAM_H;
+         break;
+      case 2:
+         /* Aligned, like a framebuffer read. */
+         x &= ~7u;
+         y &= ~7u;
+         w = 8 * (1 + rng() % 48);
+         h = 8 * (1 + rng() % 32);
+         break;
+      default:
+         w = 1 + rng() % (TT_COH_VRAM_W + 64);
+         h = 1 + rng() % (TT_COH_VRAM_H + 64);
+         break;
+   }
+   check_request(x, y, w, h);
+}
+
+static void fill_random(unsigned dirty_per_256)
+{
+   unsigned i;
+   for (i = 0; i < sizeof(tt_coh_clean); i++)
+      tt_coh_clean[i] = (rng() & 255) >= dirty_per_256;
+}
+
+static void fill_ops(unsigned ops)
+{
+   unsigned i;
+
+   memset(tt_coh_clean, 0, sizeof(tt_coh_clean));
+   for (i = 0; i < ops; i++)
+   {
+      uint32_t x = rng() % TT_COH_VRAM_W, y = rng() % TT_COH_VRAM_H;
+      uint32_t w = 1 + rng() % 400, h = 1 + rng() % 300;
+
+      if (rng() % 3)
+         tt_coh_clean_rect(x, y, w, h);
+      else
+         tt_coh_dirty(x, y, w, h);
+   }
+}
+
+int main(void)
+{
+   static const unsigned densities[] = { 0, 1, 4, 16, 64, 128, 192, 255, 256 };
+   unsigned d, i;
+
+   /* Fixed layouts first, at offsets on and off the block grid. */
+   memset(tt_coh_clean, 1, sizeof(tt_coh_clean));
+   for (i = 0; i < 64; i++)
+      check_request(i, i, 8, 8);           /* all clean */
+
+   memset(tt_coh_clean, 0, sizeof(tt_coh_clean));
+   for (i = 0; i < 64; i++)
+   {
+      check_request(i, i, TT_COH_VRAM_W, TT_COH_VRAM_H);   /* one rect */
+      check_request(1020 + (i & 3), 508 + (i >> 4), 16, 16); /* wraps both */
+   }
+
+   /* Checkerboard: no two rects merge, and every band of a full-width
+    * read has 64 runs. */
+   for (i = 0; i < sizeof(tt_coh_clean); i++)
+      tt_coh_clean[i] = ((i / TT_COH_BW) ^ i) & 1;
+   check_request(0, 0, TT_COH_VRAM_W, 8);
+   for (i = 0; i < 8; i++)
+   {
+      struct rhi_vram_rect out[RHI_READBACK_MAX_RECTS];
+
+      /* 8 columns hold 4 runs, so 8 bands are exactly the 32 rects
+       * allowed and one more row is the fallback. */
+      check_request(i * 16, 0, 8 * 8, 8 * 8);
+      if (tt_coh_dirty_rects(i * 16, 0, 8 * 8, 8 * 8, out) != 32)
+         fail("32 rects not returned", i * 16, 0, 8 * 8, 8 * 8);
+      check_request(i * 16, 0, 8 * 8, 8 * 8 + 1);
+      if (tt_coh_dirty_rects(i * 16, 0, 8 * 8, 8 * 8 + 1, out) != -1)
+         fail("33 rects did not fall back", i * 16, 0, 8 * 8, 8 * 8 + 1);
+      /* Unaligned and wrapping past both edges. */
+      check_request(1000 + i, 500 + i, 8 * 8, 8 * 4);
+      check_request(1020 + i, 504 + i, 8 * 8, 8 * 8);
+   }
+
+   /* Random grids of every density. */
+   for (d = 0; d < sizeof(densities) / sizeof(*densities); d++)
+   {
+      unsigned g;
+      for (g = 0; g < 20; g++)
+      {
+         fill_random(densities[d]);
+         for (i = 0; i < 100; i++)
+            random_request();
+      }
+   }
+
+   /* Grids as the core builds them: blocks are dirtied by anything that
+    * overlaps them and cleaned only when fully covered. */
+   for (i = 0; i < 200; i++)
+   {
+      unsigned k;
+      fill_ops(1 + rng() % 64);
+      for (k = 0; k < 50; k++)
+         random_request();
+   }
+
+   printf("%lu requests (%lu clean, %lu over %u rects)\n",
+         cases, empty, fallbacks, RHI_READBACK_MAX_RECTS);
+
+   if (failures)
+   {
+      printf("%d failure(s)\n", failures);
+      return 1;
+   }
+   printf("OK\n");
+   return 0;
+}
@@ -0,0 +1,463 @@
+/* Round-trip check and latency benchmark for mednafen/state.c.
+ *
+ * Links the real state.c and supplies the StateAction() it calls back
+ * into, with synthetic sections shaped like the core's: a 2 MB "MAIN",
+ * a 1 MB-VRAM "GPU", a 512 KB-RAM "SPU", a "CDC" with a few hundred
+ * scalars, eight FrontIO-style port sections, and one section that
+ * reaches half of its fields through an SFORMAT link.
+ *
+ * Checks, in both the labelled and the fast (unlabelled) format:
+ *
+ *   - save, scribble over every field, load, and every byte is back;
+ *   - a state saved by one layout loads into a different one: fields
+ *     shuffled, one dropped, one added, one resized.  Matching names
+ *     load, the added and the resized field keep their values, and
+ *     the dropped record is skipped;
+ *   - a section whose fields repeat a name loads the records into the
+ *     repeats in order;
+ *   - two sections sharing one SFORMAT array (as the FrontIO devices
+ *     do, one stack array per call) load into their own variables.
+ *
+ * Then it times MDFNSS_SaveSM and MDFNSS_LoadSM, over the whole state
+ * and again without the three sections that are mostly one big array;
+ * the last line loads into every section's fields in reverse order,
+ * the worst case for resolving records by name.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mednafen/state.h"
+
+extern bool FastSaveStates;
+
+#define NPORTS     8
+
+struct section
+{
+   const char *name;
+   unsigned    nscalar;     /* uint32_t scalars */
+   unsigned    nbool;       /* bool scalars     */
+   size_t      blob;        /* one byte array, 0 for none */
+   int         linked;      /* second half of the scalars through a link */
+
+   uint32_t   *scalars;
+   bool       *bools;
+   uint8_t    *blob_data;
+   char      **names;
+   SFORMAT    *sf;
+   SFORMAT    *sub;
+   SFORMAT    *rev;         /* same fields, flat, in reverse order */
+};
+
+static struct section sections[] = {
+   { "MAIN",  8,   0,  2048 * 1024, 0 },
+   { "CPU",   80,  4,  1024,        0 },
+   { "GTE",   70,  2,  0,           0 },
+   { "DMA",   60,  8,  0,           0 },
+   { "CDC",   320, 40, 2352 * 8,    0 },
+   { "GPU",   240, 24, 1024 * 1024, 0 },
+   { "SPU",   200, 16, 512 * 1024,  0 },
+   { "MDEC",  40,  4,  4096,        1 },
+   { "TIMER", 36,  6,  0,           0 },
+};
+#define NSECTIONS (sizeof(sections) / sizeof(sections[0]))
+
+/* Ports share one SFORMAT array, rebuilt per call like the stack
+ * arrays in frontio.c, each pointing at its own variables. */
+static uint32_t port_regs[NPORTS][64];
+static bool     port_bools[NPORTS][8];
+static char    *port_names[72];
+
+static uint32_t rng_state = 0x9E3779B9u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static int fails = 0;
+static void chk(const char *what, int cond)
+{ printf("  %-54s %s\n", what, cond ? "ok" : "FAIL"); if (!cond) fails++; }
+
+static char *mkname(const char *sec, const char *kind, unsigned i)
+{
+   char  buf[64];
+   char *s;
+
+   snprintf(buf, sizeof(buf), "%s_%s_%03u", sec, kind, i);
+   s = (char*)malloc(strlen(buf) + 1);
+   strcpy(s, buf);
+   return s;
+}
+
+static void build_section(struct section *s)
+{
+   unsigned n     = s->nscalar + s->nbool + 1;
+   unsigned split = s->linked ? s->nscalar / 2 : s->nscalar;
+   unsigned i, k  = 0, j = 0;
+
+   s->scalars   = (uint32_t*)calloc(s->nscalar ? s->nscalar : 1, sizeof(uint32_t));
+   s->bools     = (bool*)calloc(s->nbool ? s->nbool : 1, sizeof(bool));
+   s->blob_data = s->blob ? (uint8_t*)malloc(s->blob) : NULL;
+   s->names     = (char**)calloc(n, sizeof(char*));
+   s->sf        = (SFORMAT*)calloc(n + 2, sizeof(SFORMAT));
+   s->sub       = (SFORMAT*)calloc(n + 1, sizeof(SFORMAT));
+
+   for (i = 0; i < s->nscalar; i++)
+   {
+      SFORMAT *e = (i < split) ? &s->sf[k++] : &s->sub[j++];
+      s->names[i] = mkname(s->name, "r", i);
+      e->v     = &s->scalars[i];
+      e->size  = sizeof(uint32_t);
+      e->flags = MDFNSTATE_RLSB;
+      e->name  = s->names[i];
+   }
+   for (i = 0; i < s->nbool; i++)
+   {
+      SFORMAT *e = &s->sf[k++];
+      s->names[s->nscalar + i] = mkname(s->name, "b", i);
+      e->v     = &s->bools[i];
+      e->size  = 1;
+      e->flags = MDFNSTATE_RLSB | MDFNSTATE_BOOL;
+      e->name  = s->names[s->nscalar + i];
+   }
+   if (s->blob)
+   {
+      SFORMAT *e = &s->sf[k++];
+      s->names[n - 1] = mkname(s->name, "blob", 0);
+      e->v     = s->blob_data;
+      e->size  = (uint32_t)s->blob;
+      e->name  = s->names[n - 1];
+   }
+   if (s->linked)
+   {
+      s->sf[k].v    = s->sub;
+      s->sf[k].size = ~0U;
+      s->sf[k].name = "link";
+   }
+
+   s->rev = (SFORMAT*)calloc(k + j + 1, sizeof(SFORMAT));
+   for (i = 0; i < j; i++)
+      s->rev[i] = s->sub[j - 1 - i];
+   for (i = 0; i < k; i++)
+      s->rev[j + i] = s->sf[k - 1 - i];
+}
+
+static void fill(uint8_t *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = (uint8_t)rng();
+}
+
+static void fill_bools(bool *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = rng() & 1;
+}
+
+static void randomize_all(void)
+{
+   unsigned i;
+
+   for (i = 0; i < NSECTIONS; i++)
+   {
+      fill((uint8_t*)sections[i].scalars, sections[i].nscalar * sizeof(uint32_t));
+      fill_bools(sections[i].bools, sections[i].nbool);
+      if (sections[i].blob)
+         fill(sections[i].blob_data, sections[i].blob);
+   }
+   fill((uint8_t*)port_regs, sizeof(port_regs));
+   for (i = 0; i < NPORTS; i++)
+      fill_bools(port_bools[i], 8);
+}
+
+/* Snapshot of every variable, to compare after a load. */
+static uint8_t *snapshot(size_t *len)
+{
+   size_t   total = sizeof(port_regs) + sizeof(port_bools);
+   uint8_t *buf, *p;
+   unsigned i;
+
+   for (i = 0; i < NSECTIONS; i++)
+      total += sections[i].nscalar * sizeof(uint32_t)
+             + sections[i].nbool * sizeof(bool) + sections[i].blob;
+
+   buf = p = (uint8_t*)malloc(total);
+   for (i = 0; i < NSECTIONS; i++)
+   {
+      memcpy(p, sections[i].scalars, sections[i].nscalar * sizeof(uint32_t));
+      p += sections[i].nscalar * sizeof(uint32_t);
+      memcpy(p, sections[i].bools, sections[i].nbool * sizeof(bool));
+      p += sections[i].nbool * sizeof(bool);
+      if (sections[i].blob)
+         memcpy(p, sections[i].blob_data, sections[i].blob);
+      p += sections[i].blob;
+   }
+   memcpy(p, port_regs, sizeof(port_regs));
+   p += sizeof(port_regs);
+   memcpy(p, port_bools, sizeof(port_bools));
+   *len = total;
+   return buf;
+}
+
+static int port_action(StateMem *sm, int load, unsigned port)
+{
+   SFORMAT  sf[64 + 8 + 1];
+   char     section_name[32];
+   unsigned i;
+
+   for (i = 0; i < 64; i++)
+   {
+      sf[i].v     = &port_regs[port][i];
+      sf[i].size  = sizeof(uint32_t);
+      sf[i].flags = MDFNSTATE_RLSB;
+      sf[i].name  = port_names[i];
+   }
+   for (i = 0; i < 8; i++)
+   {
+      sf[64 + i].v     = &port_bools[port][i];
+      sf[64 + i].size  = 1;
+      sf[64 + i].flags = MDFNSTATE_RLSB | MDFNSTATE_BOOL;
+      sf[64 + i].name  = port_names[64 + i];
+   }
+   memset(&sf[72], 0, sizeof(sf[72]));
+
+   snprintf(section_name, sizeof(section_name), "PORT%u", port);
+   return MDFNSS_StateAction(sm, load, 0, sf, section_name);
+}
+
+/* What StateAction hands to MDFNSS_StateAction for the "ALT" section
+ * used by the layout-change check; NULL outside that check. */
+static SFORMAT *alt_sf = NULL;
+
+/* Benchmark only: leave out the sections dominated by one big array,
+ * so what is timed is the per-field work rather than memcpy. */
+static bool fields_only = false;
+
+/* Benchmark only: load into the reversed layouts, as a state from a
+ * build that ordered its fields differently would. */
+static bool reversed = false;
+
+int StateAction(StateMem *sm, int load, int data_only)
+{
+   int      ret = 1;
+   unsigned i;
+
+   if (alt_sf)
+      return MDFNSS_StateAction(sm, load, data_only, alt_sf, "ALT");
+
+   for (i = 0; i < NSECTIONS; i++)
+   {
+      if (fields_only && sections[i].blob >= 65536)
+         continue;
+      ret &= MDFNSS_StateAction(sm, load, data_only,
+            (load && reversed) ? sections[i].rev : sections[i].sf,
+            sections[i].name);
+   }
+   for (i = 0; i < NPORTS; i++)
+      ret &= port_action(sm, load, i);
+   return ret;
+}
+
+static void sm_reset(StateMem *st)
+{
+   st->loc = 0;
+   st->len = 0;
+}
+
+static int roundtrip(bool fast)
+{
+   StateMem st;
+   uint8_t *want, *got;
+   size_t   len, len2;
+   int      ok;
+
+   memset(&st, 0, sizeof(st));
+   FastSaveStates = fast;
+
+   randomize_all();
+   want = snapshot(&len);
+   ok   = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+
+   randomize_all();
+   st.loc = 0;
+   ok    &= MDFNSS_LoadSM(&st, 0, 0);
+   got    = snapshot(&len2);
+   ok    &= len == len2 && !memcmp(want, got, len);
+
+   FastSaveStates = false;
+   free(want);
+   free(got);
+   free(st.data);
+   return ok;
+}
+
+/* Save with layout A, load with layout B. */
+static int layout_change(void)
+{
+   uint32_t a[6], b[6];
+   uint64_t wide = 0x1122334455667788ULL;
+   SFORMAT  la[] = {
+      { &a[0], 4, MDFNSTATE_RLSB, "alpha" },
+      { &a[1], 4, MDFNSTATE_RLSB, "beta" },
+      { &a[2], 4, MDFNSTATE_RLSB, "gamma" },
+      { &a[3], 4, MDFNSTATE_RLSB, "delta" },
+      { &a[4], 4, MDFNSTATE_RLSB, "dropped" },
+      { &a[5], 4, MDFNSTATE_RLSB, "resized" },
+      { 0, 0, 0, 0 }
+   };
+   SFORMAT  lb[] = {
+      { &b[3], 4, MDFNSTATE_RLSB, "delta" },
+      { &b[0], 4, MDFNSTATE_RLSB, "alpha" },
+      { &b[5], 4, MDFNSTATE_RLSB, "added" },
+      { &wide, 8, MDFNSTATE_RLSB, "resized" },
+      { &b[2], 4, MDFNSTATE_RLSB, "gamma" },
+      { &b[1], 4, MDFNSTATE_RLSB, "beta" },
+      { 0, 0, 0, 0 }
+   };
+   StateMem st;
+   int      ok;
+   unsigned i;
+
+   memset(&st, 0, sizeof(st));
+   for (i = 0; i < 6; i++)
+   {
+      a[i] = 0xA0000000u + i;
+      b[i] = 0xB0000000u + i;
+   }
+
+   alt_sf = la;
+   ok     = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   alt_sf = lb;
+   st.loc = 0;
+   ok    &= MDFNSS_LoadSM(&st, 0, 0);
+   alt_sf = NULL;
+
+   ok &= b[0] == a[0] && b[1] == a[1] && b[2] == a[2] && b[3] == a[3];
+   ok &= b[4] == 0xB0000004u;                   /* not in layout B */
+   ok &= b[5] == 0xB0000005u;                   /* added */
+   ok &= wide == 0x1122334455667788ULL;         /* resized, skipped */
+
+   free(st.data);
+   return ok;
+}
+
+/* Repeated names: the n-th record goes to the n-th field so named. */
+static int repeated_names(void)
+{
+   uint32_t v[4] = { 1, 2, 3, 4 };
+   SFORMAT  sf[] = {
+      { &v[0], 4, MDFNSTATE_RLSB, "same" },
+      { &v[1], 4, MDFNSTATE_RLSB, "other" },
+      { &v[2], 4, MDFNSTATE_RLSB, "same" },
+      { &v[3], 4, MDFNSTATE_RLSB, "same" },
+      { 0, 0, 0, 0 }
+   };
+   StateMem st;
+   int      ok;
+
+   memset(&st, 0, sizeof(st));
+   alt_sf = sf;
+   ok     = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   v[0] = v[1] = v[2] = v[3] = 0;
+   st.loc = 0;
+   ok    &= MDFNSS_LoadSM(&st, 0, 0);
+   alt_sf = NULL;
+
+   free(st.data);
+   return ok && v[0] == 1 && v[1] == 2 && v[2] == 3 && v[3] == 4;
+}
+
+static double now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench(bool fast, bool fields, bool rev)
+{
+   const int reps = 200;
+   StateMem  st;
+   double    t0, t_save, t_load;
+   int       r;
+
+   memset(&st, 0, sizeof(st));
+   FastSaveStates = fast;
+   fields_only    = fields;
+   randomize_all();
+
+   /* One save up front so the buffer is already grown. */
+   MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+
+   t0 = now_ns();
+   for (r = 0; r < reps; r++)
+   {
+      sm_reset(&st);
+      MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
+   }
+   t_save = (now_ns() - t0) / reps / 1000.0;
+
+   reversed = rev;
+   t0 = now_ns();
+   for (r = 0; r < reps; r++)
+   {
+      st.loc = 0;
+      MDFNSS_LoadSM(&st, 0, 0);
+   }
+   t_load = (now_ns() - t0) / reps / 1000.0;
+
+   printf("  %-8s %-11s %-9s %7u bytes  SaveSM %7.1f us  LoadSM %7.1f us\n",
+         fast ? "fast" : "labelled", fields ? "fields only" : "whole state",
+         rev ? "reversed" : "same", st.len, t_save, t_load);
+
+   FastSaveStates = false;
+   fields_only    = false;
+   reversed       = false;
+   free(st.data);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i, fields = 0;
+
+   for (i = 0; i < NSECTIONS; i++)
+   {
+      build_section(&sections[i]);
+      fields += sections[i].nscalar + sections[i].nbool + (sections[i].blob ? 1 : 0);
+   }
+   for (i = 0; i < 64; i++)
+      port_names[i] = mkname("port", "r", i);
+   for (i = 0; i < 8; i++)
+      port_names[64 + i] = mkname("port", "b", i);
+   fields += NPORTS * 72;
+
+   printf("%u sections, %u fields\n", (unsigned)(NSECTIONS + NPORTS), fields);
+
+   chk("labelled round trip", roundtrip(false));
+   chk("fast round trip", roundtrip(true));
+   chk("labelled round trip, second time", roundtrip(false));
+   chk("layout change: shuffled, dropped, added, resized", layout_change());
+   chk("layout change, then the original layout again", roundtrip(false));
+   chk("repeated names load in order", repeated_names());
+
+   if (!(argc > 1 && !strcmp(argv[1], "--no-bench")))
+   {
+      printf("\n");
+      bench(false, false, false);
+      bench(true,  false, false);
+      bench(false, true,  false);
+      bench(true,  true,  false);
+      bench(false, true,  true);
+   }
+
+   printf("\n%s\n", fails ? "FAILED" : "all ok");
+   return fails ? 1 : 0;
+}